@@ -0,0 +1,909 @@
+/***********************************************************************
+ * Header:
+ *    BALANCE
+ * Summary:
+ *    Balancing policies for our custom BST. The policy is a template
+ *    parameter of the BST so the choice is made at compile time:
+ *      __       ____       ____         __
+ *     /  |    .'    '.   .'    '.   _  / /
+ *     `| |   |  .--.  | |  .--.  | (_)/ /
+ *      | |   | |    | | | |    | |   / / _
+ *     _| |_  |  `--'  | |  `--'  |  / / (_)
+ *    |_____|  '.____.'   '.____.'  /_/
+ *
+ *    This will contain the class definition of:
+ *        balance::none       : No balancing at all, the tree takes the
+ *                              shape of the insertion order
+ *        balance::redBlack   : Red-black tree. Few rotations per update,
+ *                              good for write-heavy trees
+ *        balance::avl        : AVL tree. Shallower than red-black, good
+ *                              for lookup-heavy trees
+ *        balance::treap      : Randomized treap. Simple, cheap to split
+ *                              and join
+ *
+ *    Every policy provides:
+ *        NodeData            : Extra data kept in each BNode
+ *        afterInsert()       : Restore balance after a node is hooked up
+ *        beforeErase()       : Prepare a node to be removed
+ *        afterErase()        : Restore balance after a node is unhooked
+ *        afterBuild()        : Fill in the data of a node in a tree that
+ *                              was built perfectly balanced
+ *        afterRotate()       : Fix up the data of two nodes that swapped
+ *                              places in a rotation
+ *        rank(), childRank() : A measure of a subtree's height, for join
+ *        join()              : Hang two subtrees on either side of a node
+ *                              and restore balance
+ *
+ *    And any of them can be wrapped in:
+ *        balance::sized<>    : Also count the nodes in every subtree, for
+ *                              rank() and select() in O(log n)
+ *        balance::threaded<> : Also link every node to its neighbors in
+ *                              order, so iterators step in O(1)
+ * Author
+ *    Sam Heaven, Abram Hansen
+ ************************************************************************/
+
+#pragma once
+
+#include <cassert>
+#include <algorithm>  // for std::max
+#include <cstddef>    // for size_t
+#include <type_traits> // for std::void_t
+#include <utility>    // for std::declval
+
+namespace custom
+{
+namespace balance
+{
+
+   /*****************************************************************
+    * NONE
+    * A plain binary search tree. Nothing is done to keep it balanced
+    *****************************************************************/
+   struct none
+   {
+      struct NodeData
+      {
+      };
+
+      template <class Tree>
+      static void afterInsert(Tree& tree, typename Tree::BNode* pNode) {}
+
+      template <class Tree>
+      static void beforeErase(Tree& tree, typename Tree::BNode* pNode) {}
+
+      template <class Tree>
+      static void afterErase(Tree& tree, typename Tree::BNode* pChild,
+                             typename Tree::BNode* pParent,
+                             const typename Tree::BNode* pRemoved) {}
+
+      template <class Node>
+      static void afterBuild(Node* pNode, int depth, int levels) {}
+
+      template <class Node>
+      static void afterRotate(Node* pDown, Node* pUp) {}
+
+      // no measure of the pieces is needed to join them
+      template <class Node>
+      static int rank(const Node* p) { return 0; }
+
+      template <class Node>
+      static int childRank(const Node* pParent, int rankParent, const Node* pChild) { return 0; }
+
+      template <class Tree>
+      static int join(Tree& tree, typename Tree::BNode* pLeft, int rankLeft,
+                      typename Tree::BNode* pMid,
+                      typename Tree::BNode* pRight, int rankRight);
+   };
+
+   /*****************************************************************
+    * RED BLACK
+    * No red node has a red child, and every path from a node to a leaf
+    * has the same number of black nodes. Height <= 2 log2(n + 1)
+    *****************************************************************/
+   struct redBlack
+   {
+      struct NodeData
+      {
+         bool isRed = false;   // New nodes are black until inserted
+      };
+
+      template <class Node>
+      static bool isBlack(const Node* p) { return p == nullptr || !p->isRed; }
+
+      template <class Tree>
+      static void afterInsert(Tree& tree, typename Tree::BNode* pNode);
+
+      template <class Tree>
+      static void beforeErase(Tree& tree, typename Tree::BNode* pNode) {}
+
+      template <class Tree>
+      static void afterErase(Tree& tree, typename Tree::BNode* pChild,
+                             typename Tree::BNode* pParent,
+                             const typename Tree::BNode* pRemoved);
+
+      // a perfectly balanced tree is valid with only the bottom level red
+      template <class Node>
+      static void afterBuild(Node* pNode, int depth, int levels)
+      {
+         pNode->isRed = (depth > 0 && depth == levels - 1);
+      }
+
+      template <class Node>
+      static void afterRotate(Node* pDown, Node* pUp) {}
+
+      // the rank of a subtree is its black height
+      template <class Node>
+      static int rank(const Node* p)
+      {
+         int numBlack = 0;
+         for (; p; p = p->pLeft)
+         {
+            numBlack += (p->isRed ? 0 : 1);
+         }
+         return numBlack;
+      }
+
+      template <class Node>
+      static int childRank(const Node* pParent, int rankParent, const Node* pChild)
+      {
+         return rankParent - (pParent->isRed ? 0 : 1);
+      }
+
+      template <class Tree>
+      static int join(Tree& tree, typename Tree::BNode* pLeft, int rankLeft,
+                      typename Tree::BNode* pMid,
+                      typename Tree::BNode* pRight, int rankRight);
+
+      template <class Tree>
+      static bool repairRed(Tree& tree, typename Tree::BNode* pNode);
+   };
+
+   /*****************************************************************
+    * AVL
+    * The heights of the two subtrees of every node differ by at most
+    * one. Height <= 1.44 log2(n + 2)
+    *****************************************************************/
+   struct avl
+   {
+      struct NodeData
+      {
+         int height = 1;       // Levels in the subtree rooted here
+      };
+
+      template <class Node>
+      static int height(const Node* p) { return p ? p->height : 0; }
+
+      template <class Node>
+      static void update(Node* p)
+      {
+         p->height = 1 + std::max(height(p->pLeft), height(p->pRight));
+      }
+
+      template <class Tree>
+      static typename Tree::BNode* rebalance(Tree& tree, typename Tree::BNode* pNode);
+
+      template <class Tree>
+      static void afterInsert(Tree& tree, typename Tree::BNode* pNode);
+
+      template <class Tree>
+      static void beforeErase(Tree& tree, typename Tree::BNode* pNode) {}
+
+      template <class Tree>
+      static void afterErase(Tree& tree, typename Tree::BNode* pChild,
+                             typename Tree::BNode* pParent,
+                             const typename Tree::BNode* pRemoved);
+
+      template <class Node>
+      static void afterBuild(Node* pNode, int depth, int levels)
+      {
+         update(pNode);
+      }
+
+      template <class Node>
+      static void afterRotate(Node* pDown, Node* pUp) {}
+
+      // the rank of a subtree is its height
+      template <class Node>
+      static int rank(const Node* p) { return height(p); }
+
+      template <class Node>
+      static int childRank(const Node* pParent, int rankParent, const Node* pChild)
+      {
+         return height(pChild);
+      }
+
+      template <class Tree>
+      static int join(Tree& tree, typename Tree::BNode* pLeft, int rankLeft,
+                      typename Tree::BNode* pMid,
+                      typename Tree::BNode* pRight, int rankRight);
+   };
+
+   /*****************************************************************
+    * TREAP
+    * A binary search tree on the data and a max-heap on a random
+    * priority. Expected height is O(log n)
+    *****************************************************************/
+   struct treap
+   {
+      struct NodeData
+      {
+         unsigned int priority = 0;   // Random heap key, set when inserted
+      };
+
+      static unsigned int random();
+
+      template <class Tree>
+      static void afterInsert(Tree& tree, typename Tree::BNode* pNode);
+
+      template <class Tree>
+      static void beforeErase(Tree& tree, typename Tree::BNode* pNode);
+
+      template <class Tree>
+      static void afterErase(Tree& tree, typename Tree::BNode* pChild,
+                             typename Tree::BNode* pParent,
+                             const typename Tree::BNode* pRemoved) {}
+
+      // each level gets its own band of priorities, highest at the root,
+      // so the balanced shape is also a heap
+      template <class Node>
+      static void afterBuild(Node* pNode, int depth, int levels)
+      {
+         unsigned int band = 0xFFFFFFFFu / levels;
+         pNode->priority = (levels - 1 - depth) * band + random() % band;
+      }
+
+      template <class Node>
+      static void afterRotate(Node* pDown, Node* pUp) {}
+
+      // the priorities alone decide how two pieces are joined
+      template <class Node>
+      static int rank(const Node* p) { return 0; }
+
+      template <class Node>
+      static int childRank(const Node* pParent, int rankParent, const Node* pChild) { return 0; }
+
+      template <class Tree>
+      static int join(Tree& tree, typename Tree::BNode* pLeft, int rankLeft,
+                      typename Tree::BNode* pMid,
+                      typename Tree::BNode* pRight, int rankRight);
+   };
+
+   /*****************************************************************
+    * SIZED
+    * Any of the policies above, with every node also knowing how many
+    * nodes are in its subtree. Costs a size_t per node and a walk to
+    * the root on every insert and erase
+    *****************************************************************/
+   template <class Base = redBlack>
+   struct sized : public Base
+   {
+      struct NodeData : public Base::NodeData
+      {
+         size_t size = 1;      // Nodes in the subtree rooted here
+      };
+
+      template <class Node>
+      static size_t size(const Node* p) { return p ? p->size : 0; }
+
+      template <class Node>
+      static void resize(Node* p)
+      {
+         p->size = 1 + size(p->pLeft) + size(p->pRight);
+      }
+
+      // count the new node in every subtree above it, then let the
+      // rotations of the base policy move the counts around
+      template <class Tree>
+      static void afterInsert(Tree& tree, typename Tree::BNode* pNode)
+      {
+         for (auto p = pNode->pParent; p; p = p->pParent)
+         {
+            p->size++;
+         }
+         Base::afterInsert(tree, pNode);
+      }
+
+      template <class Tree>
+      static void afterErase(Tree& tree, typename Tree::BNode* pChild,
+                             typename Tree::BNode* pParent,
+                             const typename Tree::BNode* pRemoved)
+      {
+         for (auto p = pParent; p; p = p->pParent)
+         {
+            p->size--;
+         }
+         Base::afterErase(tree, pChild, pParent, pRemoved);
+      }
+
+      template <class Node>
+      static void afterBuild(Node* pNode, int depth, int levels)
+      {
+         resize(pNode);
+         Base::afterBuild(pNode, depth, levels);
+      }
+
+      // the node moving up takes over the whole subtree
+      template <class Node>
+      static void afterRotate(Node* pDown, Node* pUp)
+      {
+         pUp->size = pDown->size;
+         resize(pDown);
+         Base::afterRotate(pDown, pUp);
+      }
+
+      // only pMid and the nodes above it can have a stale count: anything
+      // rotated off that path was recounted from children that were not
+      template <class Tree>
+      static int join(Tree& tree, typename Tree::BNode* pLeft, int rankLeft,
+                      typename Tree::BNode* pMid,
+                      typename Tree::BNode* pRight, int rankRight)
+      {
+         int rank = Base::join(tree, pLeft, rankLeft, pMid, pRight, rankRight);
+         for (auto p = pMid; p; p = p->pParent)
+         {
+            resize(p);
+         }
+         return rank;
+      }
+   };
+
+   /*****************************************************************
+    * IS SIZED
+    * Does the policy count the nodes in each subtree?
+    *****************************************************************/
+   template <class Balance, class = void>
+   struct isSized : std::false_type
+   {
+   };
+
+   template <class Balance>
+   struct isSized <Balance, std::void_t<decltype(std::declval<typename Balance::NodeData&>().size)>>
+      : std::true_type
+   {
+   };
+
+   /*****************************************************************
+    * THREADED
+    * Wraps another policy to thread every node onto the nodes before and
+    * after it in order. The BST keeps the threads: rotations never change
+    * the order, so the balancing itself is left to Base
+    *****************************************************************/
+   template <class Base = redBlack>
+   struct threaded : public Base
+   {
+      static const bool threadsNodes = true;
+   };
+
+   /*****************************************************************
+    * IS THREADED
+    * Does the policy thread the nodes in order?
+    *****************************************************************/
+   template <class Balance, class = void>
+   struct isThreaded : std::false_type
+   {
+   };
+
+   template <class Balance>
+   struct isThreaded <Balance, std::void_t<decltype(Balance::threadsNodes)>>
+      : std::true_type
+   {
+   };
+
+   /**************************************************
+    * NONE :: JOIN
+    * pMid simply goes on top of the two pieces
+    *************************************************/
+   template <class Tree>
+   int none::join(Tree& tree, typename Tree::BNode* pLeft, int rankLeft,
+                  typename Tree::BNode* pMid,
+                  typename Tree::BNode* pRight, int rankRight)
+   {
+      pMid->addLeft(pLeft);
+      pMid->addRight(pRight);
+      tree.root = pMid;
+      return 0;
+   }
+
+   /******************************************************
+    ******************************************************
+    ******************************************************
+    ********************* RED BLACK **********************
+    ******************************************************
+    ******************************************************
+    ******************************************************/
+
+   /**************************************************
+    * RED BLACK :: AFTER INSERT
+    * Color a freshly inserted node red and then walk up the tree
+    * recoloring and rotating until no red node has a red parent
+    *************************************************/
+   template <class Tree>
+   void redBlack::afterInsert(Tree& tree, typename Tree::BNode* pNode)
+   {
+      pNode->isRed = true;
+      repairRed(tree, pNode);
+   }
+
+   /**************************************************
+    * RED BLACK :: REPAIR RED
+    * pNode is red and may have a red parent. Walk up the tree recoloring
+    * and rotating until no red node has a red parent. Returns true if
+    * the root turned red on the way and the black height grew
+    *************************************************/
+   template <class Tree>
+   bool redBlack::repairRed(Tree& tree, typename Tree::BNode* pNode)
+   {
+      using BNode = typename Tree::BNode;
+
+      while (pNode->pParent && pNode->pParent->isRed)
+      {
+         // a red parent is never the root so there is always a grandparent
+         BNode* pParent = pNode->pParent;
+         BNode* pGranny = pParent->pParent;
+         assert(pGranny != nullptr);
+         bool parentIsLeft = pGranny->isLeftChild(pParent);
+         BNode* pAunt = (parentIsLeft ? pGranny->pRight : pGranny->pLeft);
+
+         // red aunt: push the blackness down from the grandparent and continue up
+         if (!isBlack(pAunt))
+         {
+            pParent->isRed = false;
+            pAunt->isRed = false;
+            pGranny->isRed = true;
+            pNode = pGranny;
+            continue;
+         }
+
+         // black aunt, inside grandchild: rotate it to the outside
+         if (parentIsLeft && pParent->isRightChild(pNode))
+         {
+            tree.rotateLeft(pParent);
+            pParent = pNode;
+         }
+         else if (!parentIsLeft && pParent->isLeftChild(pNode))
+         {
+            tree.rotateRight(pParent);
+            pParent = pNode;
+         }
+
+         // black aunt, outside grandchild: rotate the parent above the grandparent
+         pParent->isRed = false;
+         pGranny->isRed = true;
+         if (parentIsLeft)
+         {
+            tree.rotateRight(pGranny);
+         }
+         else
+         {
+            tree.rotateLeft(pGranny);
+         }
+         break;
+      }
+
+      bool isTaller = tree.root->isRed;
+      tree.root->isRed = false;
+      return isTaller;
+   }
+
+   /**************************************************
+    * RED BLACK :: JOIN
+    * Walk down the side of the taller piece to a black node of the same
+    * black height as the shorter piece. pMid goes there in red, with the
+    * two as its children, and the red is repaired on the way back up.
+    * O(difference in black heights)
+    *************************************************/
+   template <class Tree>
+   int redBlack::join(Tree& tree, typename Tree::BNode* pLeft, int rankLeft,
+                      typename Tree::BNode* pMid,
+                      typename Tree::BNode* pRight, int rankRight)
+   {
+      using BNode = typename Tree::BNode;
+
+      // black roots so the red pMid can sit next to them
+      if (pLeft && pLeft->isRed)
+      {
+         pLeft->isRed = false;
+         rankLeft++;
+      }
+      if (pRight && pRight->isRed)
+      {
+         pRight->isRed = false;
+         rankRight++;
+      }
+
+      if (rankLeft == rankRight)
+      {
+         pMid->isRed = false;
+         pMid->addLeft(pLeft);
+         pMid->addRight(pRight);
+         tree.root = pMid;
+         return rankLeft + 1;
+      }
+
+      bool isLeftTaller = rankLeft > rankRight;
+      BNode* pTop = (isLeftTaller ? pLeft : pRight);
+      int rankShort = (isLeftTaller ? rankRight : rankLeft);
+      int rank = (isLeftTaller ? rankLeft : rankRight);
+
+      BNode* pParent = nullptr;
+      BNode* p = pTop;
+      for (int rankP = rank; !isBlack(p) || rankP > rankShort; )
+      {
+         rankP -= (p->isRed ? 0 : 1);
+         pParent = p;
+         p = (isLeftTaller ? p->pRight : p->pLeft);
+      }
+      assert(pParent != nullptr);
+
+      pMid->isRed = true;
+      if (isLeftTaller)
+      {
+         pMid->addLeft(p);
+         pMid->addRight(pRight);
+         pParent->addRight(pMid);
+      }
+      else
+      {
+         pMid->addLeft(pLeft);
+         pMid->addRight(p);
+         pParent->addLeft(pMid);
+      }
+      tree.root = pTop;
+
+      return rank + (repairRed(tree, pMid) ? 1 : 0);
+   }
+
+   /**************************************************
+    * RED BLACK :: AFTER ERASE
+    * If a black node was removed above pChild, which may be NULL, its
+    * side of pParent is one black short. Recolor and rotate until fixed
+    *************************************************/
+   template <class Tree>
+   void redBlack::afterErase(Tree& tree, typename Tree::BNode* pChild,
+                             typename Tree::BNode* pParent,
+                             const typename Tree::BNode* pRemoved)
+   {
+      using BNode = typename Tree::BNode;
+      if (pRemoved->isRed)
+      {
+         return;
+      }
+
+      BNode* pNode = pChild;
+      while (pNode != tree.root && isBlack(pNode))
+      {
+         assert(pParent != nullptr);
+         bool isLeft = (pParent->pLeft == pNode);
+         BNode* pSibling = (isLeft ? pParent->pRight : pParent->pLeft);
+
+         // red sibling: rotate it above the parent so the sibling is black
+         if (!isBlack(pSibling))
+         {
+            pSibling->isRed = false;
+            pParent->isRed = true;
+            if (isLeft)
+            {
+               tree.rotateLeft(pParent);
+               pSibling = pParent->pRight;
+            }
+            else
+            {
+               tree.rotateRight(pParent);
+               pSibling = pParent->pLeft;
+            }
+         }
+
+         // black sibling with black children: move the shortage up a level
+         if (pSibling == nullptr ||
+             (isBlack(pSibling->pLeft) && isBlack(pSibling->pRight)))
+         {
+            if (pSibling)
+            {
+               pSibling->isRed = true;
+            }
+            pNode = pParent;
+            pParent = pNode->pParent;
+            continue;
+         }
+
+         // black sibling with a red child: rotate the red nephew to the outside
+         if (isLeft && isBlack(pSibling->pRight))
+         {
+            pSibling->pLeft->isRed = false;
+            pSibling->isRed = true;
+            tree.rotateRight(pSibling);
+            pSibling = pParent->pRight;
+         }
+         else if (!isLeft && isBlack(pSibling->pLeft))
+         {
+            pSibling->pRight->isRed = false;
+            pSibling->isRed = true;
+            tree.rotateLeft(pSibling);
+            pSibling = pParent->pLeft;
+         }
+
+         // red outside nephew: one rotation of the parent fixes the black height
+         pSibling->isRed = pParent->isRed;
+         pParent->isRed = false;
+         if (isLeft)
+         {
+            pSibling->pRight->isRed = false;
+            tree.rotateLeft(pParent);
+         }
+         else
+         {
+            pSibling->pLeft->isRed = false;
+            tree.rotateRight(pParent);
+         }
+         pNode = tree.root;
+      }
+
+      if (pNode)
+      {
+         pNode->isRed = false;
+      }
+   }
+
+   /******************************************************
+    ******************************************************
+    ******************************************************
+    ************************ AVL *************************
+    ******************************************************
+    ******************************************************
+    ******************************************************/
+
+   /**************************************************
+    * AVL :: REBALANCE
+    * Fix the height of a node and rotate if its subtrees differ by
+    * more than one. Returns the node now at the top of the subtree
+    *************************************************/
+   template <class Tree>
+   typename Tree::BNode* avl::rebalance(Tree& tree, typename Tree::BNode* pNode)
+   {
+      using BNode = typename Tree::BNode;
+      int balance = height(pNode->pLeft) - height(pNode->pRight);
+
+      // left heavy: rotate right, first straightening a left-right zig-zag
+      if (balance > 1)
+      {
+         BNode* pLeft = pNode->pLeft;
+         if (height(pLeft->pLeft) < height(pLeft->pRight))
+         {
+            tree.rotateLeft(pLeft);
+            update(pLeft);
+            pLeft = pNode->pLeft;
+            update(pLeft);
+         }
+         tree.rotateRight(pNode);
+         update(pNode);
+         update(pLeft);
+         return pLeft;
+      }
+
+      // right heavy: rotate left, first straightening a right-left zig-zag
+      if (balance < -1)
+      {
+         BNode* pRight = pNode->pRight;
+         if (height(pRight->pRight) < height(pRight->pLeft))
+         {
+            tree.rotateRight(pRight);
+            update(pRight);
+            pRight = pNode->pRight;
+            update(pRight);
+         }
+         tree.rotateLeft(pNode);
+         update(pNode);
+         update(pRight);
+         return pRight;
+      }
+
+      update(pNode);
+      return pNode;
+   }
+
+   /**************************************************
+    * AVL :: JOIN
+    * Walk down the side of the taller piece to a subtree no more than
+    * one taller than the shorter piece. pMid goes there with the two as
+    * its children, then everything above is rebalanced.
+    * O(difference in heights)
+    *************************************************/
+   template <class Tree>
+   int avl::join(Tree& tree, typename Tree::BNode* pLeft, int rankLeft,
+                 typename Tree::BNode* pMid,
+                 typename Tree::BNode* pRight, int rankRight)
+   {
+      using BNode = typename Tree::BNode;
+
+      if (rankLeft - rankRight <= 1 && rankRight - rankLeft <= 1)
+      {
+         pMid->addLeft(pLeft);
+         pMid->addRight(pRight);
+         update(pMid);
+         tree.root = pMid;
+         return pMid->height;
+      }
+
+      bool isLeftTaller = rankLeft > rankRight;
+      BNode* pTop = (isLeftTaller ? pLeft : pRight);
+      int rankShort = (isLeftTaller ? rankRight : rankLeft);
+
+      BNode* pParent = nullptr;
+      BNode* p = pTop;
+      while (height(p) > rankShort + 1)
+      {
+         pParent = p;
+         p = (isLeftTaller ? p->pRight : p->pLeft);
+      }
+      assert(pParent != nullptr);
+
+      if (isLeftTaller)
+      {
+         pMid->addLeft(p);
+         pMid->addRight(pRight);
+         pParent->addRight(pMid);
+      }
+      else
+      {
+         pMid->addLeft(pLeft);
+         pMid->addRight(p);
+         pParent->addLeft(pMid);
+      }
+      update(pMid);
+      tree.root = pTop;
+
+      for (p = pParent; p != nullptr; p = p->pParent)
+      {
+         p = rebalance(tree, p);
+      }
+      return tree.root->height;
+   }
+
+   /**************************************************
+    * AVL :: AFTER INSERT
+    * Walk up from the new leaf until a subtree keeps its old height
+    *************************************************/
+   template <class Tree>
+   void avl::afterInsert(Tree& tree, typename Tree::BNode* pNode)
+   {
+      pNode->height = 1;
+      for (auto p = pNode->pParent; p != nullptr; p = p->pParent)
+      {
+         int heightOld = p->height;
+         p = rebalance(tree, p);
+         if (p->height == heightOld)
+         {
+            break;
+         }
+      }
+   }
+
+   /**************************************************
+    * AVL :: AFTER ERASE
+    * Walk up from the parent of the removed node until a subtree
+    * keeps its old height
+    *************************************************/
+   template <class Tree>
+   void avl::afterErase(Tree& tree, typename Tree::BNode* pChild,
+                        typename Tree::BNode* pParent,
+                        const typename Tree::BNode* pRemoved)
+   {
+      for (auto p = pParent; p != nullptr; p = p->pParent)
+      {
+         int heightOld = p->height;
+         p = rebalance(tree, p);
+         if (p->height == heightOld)
+         {
+            break;
+         }
+      }
+   }
+
+   /******************************************************
+    ******************************************************
+    ******************************************************
+    *********************** TREAP ************************
+    ******************************************************
+    ******************************************************
+    ******************************************************/
+
+   /**************************************************
+    * TREAP :: RANDOM
+    * A fast xorshift generator. Priorities only need to be spread out,
+    * not unpredictable
+    *************************************************/
+   inline unsigned int treap::random()
+   {
+      static thread_local unsigned int state = 2463534242u;
+      state ^= state << 13;
+      state ^= state >> 17;
+      state ^= state << 5;
+      return state;
+   }
+
+   /**************************************************
+    * TREAP :: AFTER INSERT
+    * Give the new leaf a priority and rotate it up past every parent
+    * with a lower priority
+    *************************************************/
+   template <class Tree>
+   void treap::afterInsert(Tree& tree, typename Tree::BNode* pNode)
+   {
+      pNode->priority = random();
+      while (pNode->pParent && pNode->pParent->priority < pNode->priority)
+      {
+         if (pNode->pParent->isLeftChild(pNode))
+         {
+            tree.rotateRight(pNode->pParent);
+         }
+         else
+         {
+            tree.rotateLeft(pNode->pParent);
+         }
+      }
+   }
+
+   /**************************************************
+    * TREAP :: BEFORE ERASE
+    * Rotate the node down, always lifting the child with the higher
+    * priority, until it has at most one child and can be unhooked
+    *************************************************/
+   template <class Tree>
+   void treap::beforeErase(Tree& tree, typename Tree::BNode* pNode)
+   {
+      while (pNode->pLeft && pNode->pRight)
+      {
+         if (pNode->pLeft->priority > pNode->pRight->priority)
+         {
+            tree.rotateRight(pNode);
+         }
+         else
+         {
+            tree.rotateLeft(pNode);
+         }
+      }
+   }
+
+   /**************************************************
+    * TREAP :: JOIN
+    * pMid goes on top of the two pieces, then sinks below any child
+    * with a higher priority. When pMid was the parent of both pieces,
+    * as it is in a split, it never moves
+    *************************************************/
+   template <class Tree>
+   int treap::join(Tree& tree, typename Tree::BNode* pLeft, int rankLeft,
+                   typename Tree::BNode* pMid,
+                   typename Tree::BNode* pRight, int rankRight)
+   {
+      using BNode = typename Tree::BNode;
+      pMid->addLeft(pLeft);
+      pMid->addRight(pRight);
+      tree.root = pMid;
+
+      while (true)
+      {
+         BNode* pChild = pMid->pLeft;
+         if (pMid->pRight && (!pChild || pMid->pRight->priority > pChild->priority))
+         {
+            pChild = pMid->pRight;
+         }
+         if (!pChild || pChild->priority <= pMid->priority)
+         {
+            break;
+         }
+
+         if (pChild == pMid->pLeft)
+         {
+            tree.rotateRight(pMid);
+         }
+         else
+         {
+            tree.rotateLeft(pMid);
+         }
+      }
+      return 0;
+   }
+
+} // namespace balance
+} // namespace custom
@@ -0,0 +1,677 @@
+/***********************************************************************
+ * Header:
+ *    BENCH BST
+ * Summary:
+ *    Timings for bst. Build with BENCHMARK defined to run them:
+ *       g++ -std=c++17 -O2 -DNDEBUG -DBENCHMARK testMap.cpp
+ * Author
+ *    Sam Heaven, Abram Hansen
+ ************************************************************************/
+
+#pragma once
+
+#ifdef BENCHMARK
+
+#include "bst.h"
+#include "pool.h"
+#include "map.h"
+#include "lean.h"
+#include "compact.h"
+#include "btree.h"
+#include "frozen.h"
+#include "simd.h"
+
+#include <chrono>     // for std::chrono::steady_clock
+#include <vector>     // for std::vector
+#include <random>     // for std::mt19937
+#include <algorithm>  // for std::shuffle
+#include <iostream>   // for std::cout
+#include <iomanip>    // for std::setw
+#include <string>     // for std::to_string
+
+/***********************************************
+ * BENCH BST
+ * Time the BST under the same workloads so the
+ * variations can be compared side by side
+ ***********************************************/
+class BenchBST
+{
+public:
+   void run()
+   {
+      bench_balance(50000);
+      bench_hint(1000000);
+      bench_build(1000000);
+      bench_setOps(1000000);
+      bench_scan(1000000);
+      bench_churn(1000000);
+      bench_layout(1000000);
+      bench_btree(10000000);
+      bench_frozen(10000000);
+      bench_simd(10000000);
+      bench_batch(10000000);
+   }
+
+   /***************************************
+    * BALANCE
+    * One row per balancing policy:
+    *    sorted  : insert 0..n-1 in order
+    *    random  : insert 0..n-1 shuffled
+    *    find    : find every key in random order
+    *    erase   : erase every other key in random order
+    *    height  : levels after the sorted insert
+    ***************************************/
+   void bench_balance(int num)
+   {
+      std::cout << "BST balancing policies, n = " << num << " (ms)\n";
+      header({ "policy", "sorted", "random", "find", "erase", "height" });
+      bench_balance<custom::balance::none    >("none",     num);
+      bench_balance<custom::balance::redBlack>("redBlack", num);
+      bench_balance<custom::balance::avl     >("avl",      num);
+      bench_balance<custom::balance::treap   >("treap",    num);
+      std::cout << std::endl;
+   }
+
+   /***************************************
+    * HINT
+    * Insert the same keys with and without a hint:
+    *    sorted  : 0..n-1 hinted at end()
+    *    reverse : n-1..0 hinted at begin()
+    *    random  : shuffled, hinted at the last insert
+    ***************************************/
+   void bench_hint(int num)
+   {
+      std::cout << "BST insert with a hint, n = " << num << " (ms)\n";
+      header({ "input", "insert", "hint" });
+
+      std::vector<int> keys(num);
+      for (int i = 0; i < num; i++)
+         keys[i] = i;
+      bench_hint("sorted", keys, [](custom::BST <int>& bst, custom::BST <int>::iterator)
+         { return bst.end(); });
+
+      std::reverse(keys.begin(), keys.end());
+      bench_hint("reverse", keys, [](custom::BST <int>& bst, custom::BST <int>::iterator)
+         { return bst.begin(); });
+
+      keys = shuffled(num);
+      bench_hint("random", keys, [](custom::BST <int>&, custom::BST <int>::iterator itLast)
+         { return itLast; });
+      std::cout << std::endl;
+   }
+
+   /***************************************
+    * BUILD
+    * Fill a tree from a whole range, one insert at a time and with
+    * the bulk build, from sorted and from shuffled keys
+    ***************************************/
+   void bench_build(int num)
+   {
+      std::cout << "BST bulk build, n = " << num << " (ms)\n";
+      header({ "input", "insert", "build" });
+
+      std::vector<int> keys(num);
+      for (int i = 0; i < num; i++)
+         keys[i] = i;
+      bench_build("sorted", keys);
+      bench_build("random", shuffled(num));
+      std::cout << std::endl;
+   }
+
+   /***************************************
+    * SET OPS
+    * Multiples of 2 against multiples of 3, up to n:
+    *    insert : union by inserting every rhs element into lhs
+    *    union, intersect, diff : split/join on the thread pool
+    ***************************************/
+   void bench_setOps(int num)
+   {
+      std::cout << "BST set algebra, n = " << num << " (ms)\n";
+      header({ "", "insert", "union", "intersect", "diff" });
+
+      auto setup = [num](custom::BST <int>& bstLeft, custom::BST <int>& bstRight)
+      {
+         std::vector<int> keys = shuffled(num);
+         for (int key : keys)
+            if (key % 2 == 0)
+               bstLeft.insert(key);
+            else if (key % 3 == 0)
+               bstRight.insert(key);
+      };
+
+      custom::BST <int> bstLeft;
+      custom::BST <int> bstRight;
+      setup(bstLeft, bstRight);
+      double msInsert = time([&]()
+         {
+            for (auto it = bstRight.begin(); it != bstRight.end(); ++it)
+               bstLeft.insert(*it, true /*keepUnique*/);
+         });
+
+      double ms[3];
+      for (int op = 0; op < 3; op++)
+      {
+         custom::BST <int> bstLeft;
+         custom::BST <int> bstRight;
+         setup(bstLeft, bstRight);
+         custom::BST <int> bst;
+         ms[op] = time([&]()
+            {
+               if (op == 0)
+                  bst = custom::BST <int>::setUnion(bstLeft, bstRight);
+               else if (op == 1)
+                  bst = custom::BST <int>::setIntersection(bstLeft, bstRight);
+               else
+                  bst = custom::BST <int>::setDifference(bstLeft, bstRight);
+            });
+      }
+
+      row("ms", { msInsert, ms[0], ms[1], ms[2] });
+      std::cout << "\n" << std::endl;
+   }
+
+   /***************************************
+    * SCAN
+    * Walk every element of a tree built from shuffled keys, with the
+    * iterators climbing the tree or following threads:
+    *    forward  : begin() to end()
+    *    backward : rbegin() to rend()
+    ***************************************/
+   void bench_scan(int num)
+   {
+      std::cout << "BST full scans, n = " << num << " (ms)\n";
+      header({ "nodes", "forward", "backward" });
+      bench_scan<custom::balance::redBlack  >("plain",    num);
+      bench_scan<custom::balance::threaded<>>("threaded", num);
+      std::cout << std::endl;
+   }
+
+   /***************************************
+    * CHURN
+    * Nodes from new and delete against nodes from a pool:
+    *    fill  : insert 0..n-1 shuffled
+    *    churn : erase each key and insert a new one in its place
+    *    clear : throw the whole tree away
+    ***************************************/
+   void bench_churn(int num)
+   {
+      std::cout << "BST node churn, n = " << num << " (ms)\n";
+      header({ "nodes", "fill", "churn", "clear" });
+      bench_churn<std::allocator<int>>("new",  num);
+      bench_churn<custom::pool<int>  >("pool", num);
+      std::cout << std::endl;
+   }
+
+   /***************************************
+    * LAYOUT
+    * The same map<int, int> with a node linked three ways:
+    *    bytes : size of one node
+    *    fill  : insert 0..n-1 shuffled
+    *    find  : find every key in random order
+    *    scan  : begin() to end()
+    ***************************************/
+   void bench_layout(int num)
+   {
+      std::cout << "Map node layouts, n = " << num << " (ms)\n";
+      header({ "links", "bytes", "fill", "find", "scan" });
+      bench_layout<custom::map<int, int>>("parent", num,
+         sizeof(custom::BST<custom::pair<int, int>>::BNode));
+      bench_layout<custom::leanMap<int, int>>("stack", num,
+         sizeof(custom::leanMap<int, int>::Node));
+      bench_layout<custom::compactMap<int, int>>("index", num,
+         sizeof(custom::compactMap<int, int>::Node));
+      std::cout << std::endl;
+   }
+   /***************************************
+    * BTREE
+    * map<int, int> over the BST and over a B-tree of 256 byte
+    * nodes, at ten times more keys each row:
+    *    find  : ns per find of a random key
+    *    scan  : ns per pair walking begin() to end()
+    ***************************************/
+   void bench_btree(int numMax)
+   {
+      std::cout << "BST against B-tree (ns)\n";
+      header({ "keys", "bst find", "bt find", "bst scan", "bt scan" });
+      for (int num = 1000; num <= numMax; num *= 10)
+      {
+         double nsBST[2];
+         double nsBTree[2];
+         bench_btree<custom::map<int, int>>(num, nsBST);
+         bench_btree<custom::map<int, int, custom::balance::btree<>>>(num, nsBTree);
+         row(std::to_string(num).c_str(), { nsBST[0], nsBTree[0], nsBST[1], nsBTree[1] });
+         std::cout << "\n";
+      }
+      std::cout << std::endl;
+   }
+   /***************************************
+    * FROZEN
+    * map<int, int> against its freeze(), at ten times more keys
+    * each row:
+    *    map    : ns per find of a random key in the BST
+    *    frozen : ns per find in the snapshot, which for int is in lines
+    *    freeze : ms to take the snapshot
+    ***************************************/
+   void bench_frozen(int numMax)
+   {
+      std::cout << "Map against frozen map\n";
+      header({ "keys", "map ns", "frozen ns", "freeze ms" });
+      for (int num = 1000; num <= numMax; num *= 10)
+      {
+         custom::map<int, int> m;
+         for (int key : shuffled(num))
+            m[key] = key;
+         custom::frozenMap<int, int> frozen;
+         double msFreeze = time([&]()
+            {
+               frozen = m.freeze();
+            });
+         row(std::to_string(num).c_str(), { nsFind(m, num), nsFind(frozen, num), msFreeze });
+         std::cout << "\n";
+      }
+      std::cout << std::endl;
+   }
+
+   /***************************************
+    * SIMD
+    * Millions of finds a second of random int keys, at ten times more
+    * keys each row:
+    *    bst    : BST<int>::find, one key a node
+    *    eytz   : the Eytzinger snapshot, one key a step
+    *    scalar : the snapshot in lines, counted one key at a time
+    *    sse4.2 : and four keys at a time
+    *    avx2   : and eight keys at a time
+    ***************************************/
+   void bench_simd(int numMax)
+   {
+      std::cout << "Integer key search (M finds/s)\n";
+      header({ "keys", "bst", "eytz", "scalar", "sse4.2", "avx2" });
+      for (int num = 1000; num <= numMax; num *= 10)
+      {
+         custom::BST<int> bst;
+         for (int key : shuffled(num))
+            bst.insert(key);
+         std::vector<std::pair<int, int>> pairs(num);
+         for (int i = 0; i < num; i++)
+            pairs[i] = std::pair<int, int>(i, i);
+         custom::frozenMap<int, int, std::less<int>, false> eytzinger(pairs.begin(), pairs.end(), num);
+         custom::frozenMap<int, int> blocked(pairs.begin(), pairs.end(), num);
+
+         std::vector<int> keys = randomKeys(num);
+         double finds[5] = {};
+         finds[0] = findsPerSecond(keys, [&](int key) { return bst.find(key) != bst.end(); });
+         finds[1] = findsPerSecond(keys, [&](int key) { return eytzinger.find(key) != eytzinger.end(); });
+         for (int level = custom::simd::scalar; level <= custom::simd::detect(); level++)
+         {
+            auto countLess = custom::simd::kernels<int>(custom::simd::Level(level)).countLess;
+            finds[2 + level] = findsPerSecond(keys, [&](int key)
+               {
+                  return blocked.keys[blocked.search(key, countLess)] == key;
+               });
+         }
+         row(std::to_string(num).c_str(), { finds[0], finds[1], finds[2], finds[3], finds[4] });
+         std::cout << "\n";
+      }
+      std::cout << std::endl;
+   }
+
+   /***************************************
+    * BATCH
+    * Millions of finds a second in a map<int, int> far bigger than the
+    * cache, for batches of each size:
+    *    find   : one find() after another
+    *    batch  : find_batch() of the keys as they come
+    *    sorted : find_batch() of the keys sorted first, not timed
+    ***************************************/
+   void bench_batch(int num)
+   {
+      std::cout << "Batched finds, n = " << num << " (M finds/s)\n";
+      header({ "batch", "find", "batch", "sorted" });
+      custom::map<int, int> m;
+      for (int key : shuffled(num))
+         m[key] = key;
+      std::vector<int> keys = randomKeys(num);
+
+      for (size_t sizeBatch : { 16, 64, 512 })
+      {
+         std::vector<std::vector<int>> batches;
+         std::vector<std::vector<int>> batchesSorted;
+         for (size_t i = 0; i + sizeBatch <= keys.size(); i += sizeBatch)
+         {
+            batches.emplace_back(keys.begin() + i, keys.begin() + i + sizeBatch);
+            batchesSorted.push_back(batches.back());
+            std::sort(batchesSorted.back().begin(), batchesSorted.back().end());
+         }
+         size_t numKeys = batches.size() * sizeBatch;
+         std::vector<custom::map<int, int>::iterator> out(sizeBatch);
+
+         size_t numFound = 0;
+         double msFind = time([&]()
+            {
+               for (const std::vector<int>& batch : batches)
+                  for (int key : batch)
+                     numFound += (m.find(key) != m.end());
+            });
+         assert(numFound == numKeys);
+
+         auto findBatches = [&](const std::vector<std::vector<int>>& batchesFind)
+         {
+            return time([&]()
+               {
+                  for (const std::vector<int>& batch : batchesFind)
+                  {
+                     m.find_batch(batch, out);
+                     for (auto it : out)
+                        numFound += (it != m.end());
+                  }
+               });
+         };
+         double msBatch = findBatches(batches);
+         double msSorted = findBatches(batchesSorted);
+         assert(numFound == 3 * numKeys);
+
+         row(std::to_string(sizeBatch).c_str(),
+             { numKeys / msFind / 1000.0, numKeys / msBatch / 1000.0, numKeys / msSorted / 1000.0 });
+         std::cout << "\n";
+      }
+      std::cout << std::endl;
+   }
+
+
+
+private:
+
+   void bench_build(const char * name, const std::vector<int> & keys)
+   {
+      custom::BST <int> bstInsert;
+      double msInsert = time([&]()
+         {
+            for (int key : keys)
+               bstInsert.insert(key, true /*keepUnique*/);
+         });
+
+      custom::BST <int> bstBuild;
+      double msBuild = time([&]()
+         {
+            bstBuild.build(keys.begin(), keys.end(), true /*keepUnique*/);
+         });
+      assert(bstBuild.size() == bstInsert.size());
+
+      row(name, { msInsert, msBuild });
+      std::cout << "\n";
+   }
+
+   template <class Hint>
+   void bench_hint(const char * name, const std::vector<int> & keys, Hint hint)
+   {
+      custom::BST <int> bstPlain;
+      double msPlain = time([&]()
+         {
+            for (int key : keys)
+               bstPlain.insert(key, true /*keepUnique*/);
+         });
+
+      custom::BST <int> bstHint;
+      double msHint = time([&]()
+         {
+            custom::BST <int>::iterator itLast = bstHint.end();
+            for (int key : keys)
+               itLast = bstHint.insert(hint(bstHint, itLast), key, true /*keepUnique*/);
+         });
+      assert(bstHint.size() == bstPlain.size());
+
+      row(name, { msPlain, msHint });
+      std::cout << "\n";
+   }
+
+   template <class Balance>
+   void bench_scan(const char * name, int num)
+   {
+      custom::BST <int, Balance> bst;
+      for (int key : shuffled(num))
+         bst.insert(key);
+
+      const int numScans = 10;
+      long long sum = 0;
+      double msForward = time([&]()
+         {
+            for (int i = 0; i < numScans; i++)
+               for (auto it = bst.begin(); it != bst.end(); ++it)
+                  sum += *it;
+         });
+      double msBackward = time([&]()
+         {
+            for (int i = 0; i < numScans; i++)
+               for (auto it = bst.rbegin(); it != bst.rend(); ++it)
+                  sum -= *it;
+         });
+      assert(sum == 0);
+
+      row(name, { msForward / numScans, msBackward / numScans });
+      std::cout << "\n";
+   }
+
+   template <class Allocator>
+   void bench_churn(const char * name, int num)
+   {
+      std::vector<int> keys = shuffled(num);
+      custom::BST <int, custom::balance::redBlack, std::less<int>, Allocator> bst;
+
+      double msFill = time([&]()
+         {
+            for (int key : keys)
+               bst.insert(key);
+         });
+
+      double msChurn = time([&]()
+         {
+            for (int key : keys)
+            {
+               auto it = bst.find(key);
+               bst.erase(it);
+               bst.insert(key + num);
+            }
+         });
+      assert(bst.size() == keys.size());
+
+      double msClear = time([&]()
+         {
+            bst.clear();
+         });
+
+      row(name, { msFill, msChurn, msClear });
+      std::cout << "\n";
+   }
+
+   template <class Map>
+   void bench_layout(const char * name, int num, size_t numBytes)
+   {
+      std::vector<int> keys = shuffled(num);
+      Map m;
+
+      double msFill = time([&]()
+         {
+            for (int key : keys)
+               m[key] = key;
+         });
+
+      size_t numFound = 0;
+      double msFind = time([&]()
+         {
+            for (int key : keys)
+               numFound += (m.find(key) != m.end());
+         });
+      assert(numFound == keys.size());
+
+      const int numScans = 10;
+      long long sum = 0;
+      double msScan = time([&]()
+         {
+            for (int i = 0; i < numScans; i++)
+               for (auto it = m.begin(); it != m.end(); ++it)
+                  sum += (*it).second;
+         });
+      assert(sum == (long long)numScans * num * (num - 1) / 2);
+
+      row(name, { double(numBytes), msFill, msFind, msScan / numScans });
+      std::cout << "\n";
+   }
+
+   // a million random keys in 0..num-1
+   static std::vector<int> randomKeys(int num)
+   {
+      std::vector<int> keys(1000000);
+      std::mt19937 random(20201225);
+      for (int& key : keys)
+         key = int(random() % num);
+      return keys;
+   }
+
+   // millions of keys a second isFound() finds
+   template <class IsFound>
+   static double findsPerSecond(const std::vector<int>& keys, IsFound isFound)
+   {
+      size_t numFound = 0;
+      double msFind = time([&]()
+         {
+            for (int key : keys)
+               numFound += isFound(key);
+         });
+      assert(numFound == keys.size());
+      return keys.size() / msFind / 1000.0;
+   }
+
+   // ns a find of a random key in 0..num-1 in m takes
+   template <class Map>
+   static double nsFind(Map& m, int num)
+   {
+      std::vector<int> keys = randomKeys(num);
+      return 1000.0 / findsPerSecond(keys, [&](int key) { return m.find(key) != m.end(); });
+   }
+
+   // fill a map with 0..num-1 shuffled, then time finds and scans
+   template <class Map>
+   void bench_btree(int num, double ns[2])
+   {
+      Map m;
+      for (int key : shuffled(num))
+         m[key] = key;
+
+      // walk at least ten million pairs so the small ones are timed too
+      const int numScans = std::max(1, 10000000 / num);
+      long long sum = 0;
+      double msScan = time([&]()
+         {
+            for (int i = 0; i < numScans; i++)
+               for (auto it = m.begin(); it != m.end(); ++it)
+                  sum += (*it).second;
+         });
+      assert(sum == (long long)numScans * num * (num - 1) / 2);
+
+      ns[0] = nsFind(m, num);
+      ns[1] = msScan * 1e6 / ((double)numScans * num);
+   }
+
+   template <class Balance>
+   void bench_balance(const char * name, int num)
+   {
+      std::vector<int> keys = shuffled(num);
+
+      custom::BST <int, Balance> bstSorted;
+      double msSorted = time([&]()
+         {
+            for (int i = 0; i < num; i++)
+               bstSorted.insert(i);
+         });
+
+      custom::BST <int, Balance> bst;
+      double msRandom = time([&]()
+         {
+            for (int key : keys)
+               bst.insert(key);
+         });
+
+      size_t numFound = 0;
+      double msFind = time([&]()
+         {
+            for (int key : keys)
+               numFound += (bst.find(key) != bst.end());
+         });
+      assert(numFound == keys.size());
+
+      double msErase = time([&]()
+         {
+            for (int i = 0; i < num; i += 2)
+            {
+               auto it = bst.find(keys[i]);
+               bst.erase(it);
+            }
+         });
+
+      row(name, { msSorted, msRandom, msFind, msErase });
+      std::cout << std::setw(10) << height(bstSorted.root) << "\n";
+   }
+
+   /***************************************
+    * HELPERS
+    ***************************************/
+
+   // 0 .. num-1 in a repeatable random order
+   static std::vector<int> shuffled(int num)
+   {
+      std::vector<int> keys(num);
+      for (int i = 0; i < num; i++)
+         keys[i] = i;
+      std::shuffle(keys.begin(), keys.end(), std::mt19937(20201225));
+      return keys;
+   }
+
+   // milliseconds spent in f()
+   template <class F>
+   static double time(F f)
+   {
+      auto start = std::chrono::steady_clock::now();
+      f();
+      auto finish = std::chrono::steady_clock::now();
+      return std::chrono::duration<double, std::milli>(finish - start).count();
+   }
+
+   // levels in a subtree, without recursion so vines are fine
+   template <class Node>
+   static int height(const Node* p)
+   {
+      int levels = 0;
+      std::vector<std::pair<const Node*, int>> stack;
+      if (p)
+         stack.push_back({ p, 1 });
+      while (!stack.empty())
+      {
+         auto top = stack.back();
+         stack.pop_back();
+         levels = std::max(levels, top.second);
+         if (top.first->pLeft)
+            stack.push_back({ top.first->pLeft, top.second + 1 });
+         if (top.first->pRight)
+            stack.push_back({ top.first->pRight, top.second + 1 });
+      }
+      return levels;
+   }
+
+   static void header(std::initializer_list<const char *> columns)
+   {
+      for (const char * column : columns)
+         std::cout << std::setw(10) << column;
+      std::cout << "\n";
+   }
+
+   static void row(const char * name, std::initializer_list<double> values)
+   {
+      std::cout << std::setw(10) << name;
+      std::cout.setf(std::ios::fixed);
+      std::cout.precision(1);
+      for (double value : values)
+         std::cout << std::setw(10) << value;
+   }
+};
+
+#endif // BENCHMARK
@@ -12,7 +12,9 @@
  *
  *    This will contain the class definition of:
  *        BST                 : A class that represents a binary search tree
+ *                              balanced by a policy from balance.h
  *        BST::iterator       : An iterator through BST
+ *        BST::reverse_iterator : A backwards iterator through BST
  * Author
  *    Sam Heaven, Abram Hansen
  ************************************************************************/
@@ -30,44 +32,181 @@
 #include <memory>     // for std::allocator
 #include <functional> // for std::less
 #include <utility>    // for std::pair
+#include <type_traits> // for std::void_t and std::is_empty
+#include <iterator>   // for std::reverse_iterator
+#include <vector>     // for std::vector
+#include <algorithm>  // for std::stable_sort
+#include <future>     // for std::async
+#include <thread>     // for std::thread::hardware_concurrency
+#include <system_error> // for std::system_error
+#include <optional>   // for std::optional
+#include "balance.h"  // for the balancing policies
+
+// ask for the cache line at p ahead of reading it
+#if defined(__GNUC__) || defined(__clang__)
+#define CUSTOM_PREFETCH(p) __builtin_prefetch(p)
+#elif defined(_MSC_VER) && (defined(_M_IX86) || defined(_M_X64))
+#include <xmmintrin.h>
+#define CUSTOM_PREFETCH(p) _mm_prefetch(reinterpret_cast<const char*>(p), _MM_HINT_T0)
+#else
+#define CUSTOM_PREFETCH(p)
+#endif
 
 class TestBST; // forward declaration for unit tests
 class TestMap;
 class TestSet;
+class BenchBST; // forward declaration for benchmarks
 
 namespace custom
 {
 
    template <class TT>
    class set;
-   template <class KK, class VV>
+   template <class KK, class VV, class BB, class CC, class AA>
    class map;
 
+   /*****************************************************************
+    * HAS COMPARE
+    * Does T have a three-way int compare(const T&) const, the way
+    * std::string does? If so the BST decides each level with one call
+    *****************************************************************/
+   template <class T, class = void>
+   struct hasCompare : std::false_type
+   {
+   };
+
+   template <class T>
+   struct hasCompare <T, std::void_t<decltype(int(std::declval<const T&>().compare(std::declval<const T&>())))>>
+      : std::true_type
+   {
+   };
+
+   /*****************************************************************
+    * CAN RELEASE
+    * Can the allocator take back every node at once with a
+    * bool release(size_t numLive), the way custom::pool can? If so
+    * clear() need not visit the nodes one by one
+    *****************************************************************/
+   template <class A, class = void>
+   struct canRelease : std::false_type
+   {
+   };
+
+   template <class A>
+   struct canRelease <A, std::void_t<decltype(bool(std::declval<A&>().release(size_t())))>>
+      : std::true_type
+   {
+   };
+
+   /*****************************************************************
+    * KEY OF
+    * The part of an element that a search looks at. By default it is
+    * the whole element; map picks out the key of its pairs
+    *****************************************************************/
+   template <class T>
+   struct KeyOf
+   {
+      using type = T;
+      static const T& get(const T& t) { return t; }
+   };
+
+   /*****************************************************************
+    * IS TRANSPARENT
+    * Does the comparator take a bare key of any type, the way
+    * std::less<> does? If not a foreign key is made into a key once
+    *****************************************************************/
+   template <class Compare, class = void>
+   struct isTransparent : std::false_type
+   {
+   };
+
+   template <class Compare>
+   struct isTransparent <Compare, std::void_t<typename Compare::is_transparent>>
+      : std::true_type
+   {
+   };
+
+   /*****************************************************************
+    * HOLDER
+    * Something kept once per tree: the comparator or the allocator.
+    * An empty one such as std::less or std::allocator is a base class
+    * so it takes no room at all. which tells the two holders apart
+    *****************************************************************/
+   template <class Value, int which, bool isEmpty = std::is_empty<Value>::value && !std::is_final<Value>::value>
+   class Holder : private Value
+   {
+   public:
+      Holder(const Value& value = Value()) : Value(value) {}
+      const Value& get() const noexcept { return *this; }
+            Value& get()       noexcept { return *this; }
+   };
+
+   template <class Value, int which>
+   class Holder <Value, which, false>
+   {
+   public:
+      Holder(const Value& value = Value()) : value(value) {}
+      const Value& get() const noexcept { return value; }
+            Value& get()       noexcept { return value; }
+   private:
+      Value value;
+   };
+
+   /*****************************************************************
+    * THREAD LINKS
+    * The nodes before and after a node in order. Only a threaded<>
+    * policy has them; otherwise this takes no room in the node
+    *****************************************************************/
+   template <class Node, bool isThreaded>
+   struct ThreadLinks
+   {
+   };
+
+   template <class Node>
+   struct ThreadLinks <Node, true>
+   {
+      Node* pPrev = nullptr;   // Previous node in order
+      Node* pNext = nullptr;   // Next node in order
+   };
+
    /*****************************************************************
     * BINARY SEARCH TREE
-    * Create a Binary Search Tree
+    * Create a Binary Search Tree, kept in shape by the Balance policy,
+    * ordered by Compare on the key of each element, with every node
+    * coming from Allocator rebound to the node
     *****************************************************************/
-   template <typename T>
-   class BST
+   template <typename T, typename Balance = balance::redBlack,
+             typename Compare = std::less<typename KeyOf<T>::type>,
+             typename Allocator = std::allocator<T>>
+   class BST : private Holder<Compare, 0>, private Holder<Allocator, 1>
    {
       friend class ::TestBST; // give unit tests access to the privates
       friend class ::TestMap;
       friend class ::TestSet;
+      friend class ::BenchBST;
 
-      template <class KK, class VV>
+      template <class KK, class VV, class BB, class CC, class AA>
       friend class map;
 
       template <class TT>
       friend class set;
 
-      template <class KK, class VV>
-      friend void swap(map<KK, VV>& lhs, map<KK, VV>& rhs);
+      template <class KK, class VV, class BB, class CC, class AA>
+      friend void swap(map<KK, VV, BB, CC, AA>& lhs, map<KK, VV, BB, CC, AA>& rhs);
+
+      friend Balance;           // the policy rotates and recolors the nodes
+      friend struct balance::none;      // and so do the ones sized<> wraps
+      friend struct balance::redBlack;
+      friend struct balance::avl;
+      friend struct balance::treap;
    public:
       //
       // Construct
       //
 
       BST();
+      explicit BST(const Compare& compare, const Allocator& allocator = Allocator());
+      explicit BST(const Allocator& allocator);
       BST(const BST& rhs);
       BST(BST&& rhs);
       BST(const std::initializer_list<T>& il);
@@ -87,14 +226,48 @@ namespace custom
       //
 
       class iterator;
-      iterator   begin() const noexcept;
-      iterator   end()   const noexcept { return iterator(nullptr); }
+      using reverse_iterator = std::reverse_iterator<iterator>;
+      iterator   begin() const noexcept { return iterator(pLeftmost, this); }
+      iterator   end()   const noexcept { return iterator(nullptr, this);   }
+      reverse_iterator rbegin() const noexcept { return reverse_iterator(end());   }
+      reverse_iterator rend()   const noexcept { return reverse_iterator(begin()); }
+
+      //
+      // Access, by an element, its key, or anything that compares with
+      // the key, so looking something up never builds an element
+      //
+
+      using key_type = typename KeyOf<T>::type;
+      using key_compare = Compare;
+      key_compare key_comp() const { return comp(); }
+      using allocator_type = Allocator;
+      allocator_type get_allocator() const noexcept { return alloc(); }
+      template <class Key>
+      iterator find(const Key& k);
+      template <class Key>
+      iterator lower_bound(const Key& k) const;
+      template <class Key>
+      iterator upper_bound(const Key& k) const;
+      template <class Key>
+      std::pair<iterator, iterator> equal_range(const Key& k) const;
+
+      // look up every key in keys together, and set out[i] to the
+      // element with keys[i], or end()
+      template <class Keys, class Out>
+      void find_batch(const Keys& keys, Out& out) const
+      {
+         findBatch(keys, [&](size_t i, BNode* p) { out[i] = iterator(p, this); });
+      }
 
       //
-      // Access
+      // Order statistics, when the Balance policy is sized<>
       //
 
-      iterator find(const T& t);
+      template <class Key>
+      size_t   rank(const Key& k) const;
+      iterator select(size_t k) const;
+      template <class Key>
+      size_t   count(const Key& lo, const Key& hi) const;
 
 
       // 
@@ -103,14 +276,68 @@ namespace custom
 
       std::pair<iterator, bool> insert(const T& t, bool keepUnique = false);
       std::pair<iterator, bool> insert(T&& t, bool keepUnique = false);
+      iterator insert(iterator hint, const T& t, bool keepUnique = false);
+      iterator insert(iterator hint, T&& t, bool keepUnique = false);
+      template <class ... Args>
+      std::pair<iterator, bool> emplace(Args&& ... args)
+      {
+         return emplaceNode(false /*keepUnique*/, std::forward<Args>(args)...);
+      }
+      template <class ... Args>
+      iterator emplace_hint(iterator hint, Args&& ... args)
+      {
+         return emplaceHintNode(hint, false /*keepUnique*/, std::forward<Args>(args)...);
+      }
 
       //
       // Remove
       // 
 
       iterator erase(iterator& it);
+      iterator erase(iterator first, iterator last);
+      template <class Key, class = std::enable_if_t<!std::is_convertible<const Key&, iterator>::value>>
+      size_t erase(const Key& k)
+      {
+         size_t numBefore = numElements;
+         auto range = equal_range(k);
+         erase(range.first, range.second);
+         return numBefore - numElements;
+      }
       void   clear() noexcept;
 
+      //
+      // Node handles, to move elements between trees without allocating
+      // or copying them
+      //
+
+      class node_type;
+      struct insert_return_type;
+      node_type extract(iterator it);
+      template <class Key>
+      node_type extract(const Key& k);
+      insert_return_type insert(node_type&& nh, bool keepUnique = false);
+      void merge(BST& rhs, bool keepUnique = false);
+
+      //
+      // Split and join, moving the nodes rather than copying them
+      //
+
+      template <class Key>
+      std::pair<BST, BST> split(const Key& k);
+      static BST join(BST& lhs, BST& rhs);
+
+      //
+      // Set algebra on trees of unique elements, moving the nodes of both
+      // trees into the result and freeing the ones left over
+      //
+
+      static BST setUnion       (BST& lhs, BST& rhs);
+      static BST setIntersection(BST& lhs, BST& rhs);
+      static BST setDifference  (BST& lhs, BST& rhs);
+
+      // subtrees at least this big are worked on by two threads at once
+      static const size_t numParallelCutoff = 50000;
+
       // 
       // Status
       //
@@ -122,17 +349,118 @@ namespace custom
 
    private:
 
+      bool findInsertPosition(const T& t, bool keepUnique, BNode*& pParent, bool& isLeft);
+      bool findHintPosition(iterator hint, const T& t, bool keepUnique, BNode*& pParent, bool& isLeft);
+      iterator insertNode(BNode* pNew, BNode* pParent, bool isLeft);
+      template <class ... Args>
+      BNode* newNode(Args&& ... args) const;
+      static void deleteNode(const Allocator& allocator, BNode* pNode) noexcept;
+      template <class ... Args>
+      std::pair<iterator, bool> emplaceNode(bool keepUnique, Args&& ... args);
+      template <class ... Args>
+      iterator emplaceHintNode(iterator hint, bool keepUnique, Args&& ... args);
+      iterator relinkNode(BNode* pNode, BNode* pParent, bool isLeft);
+      void unlink(BNode* pDelete);
+      BST adopt(BST& rhs) const;
+      BNode* joinNodes(BNode* pLeft, int rankLeft, BNode* pMid,
+                       BNode* pRight, int rankRight, int& rank) const;
+
+      // a detached subtree cut in two around a value, with the rank of each
+      struct Pieces
+      {
+         BNode* pLess = nullptr;
+         int rankLess = 0;
+         BNode* pEqual = nullptr;
+         BNode* pRest = nullptr;
+         int rankRest = 0;
+      };
+      template <class Key>
+      Pieces splitNodes(BNode* pRoot, int rank, const Key& key, bool isThreeWay) const;
+      Pieces splitBefore(BNode* pNode) const;
+
+      // a node on the way down to a split, and the side of it that it goes
+      struct Step
+      {
+         BNode* pNode;
+         int rank;
+         bool isLess;
+      };
+      void joinPath(const std::vector<Step>& path, Pieces& pieces) const;
+
+      // a detached subtree made by the set algebra, and how many nodes
+      // were freed making it
+      struct Subtree
+      {
+         BNode* pRoot;
+         int rank;
+         size_t numFreed;
+      };
+      enum class SetOp { UNION, INTERSECTION, DIFFERENCE };
+      static BST combine(SetOp op, BST& lhs, BST& rhs);
+      Subtree combineNodes(SetOp op, BNode* pLhs, int rankLhs,
+                           BNode* pRhs, int rankRhs, size_t num, int numSpawn) const;
+      Subtree joinNodes(const Subtree& left, BNode* pMid, const Subtree& right) const;
+      Subtree joinNodes(const Subtree& left, const Subtree& right) const;
+
+      // used by the balancing policy
+      void replaceChild(BNode* pOld, BNode* pNew);
+      void rotateLeft(BNode* pNode);
+      void rotateRight(BNode* pNode);
+
+      template <class Iterator>
+      void build(Iterator first, Iterator last, bool keepUnique);
+      BNode* buildBalanced(BNode** pNodes, size_t num, int depth, int levels);
+
+      size_t indexOf(const BNode* pNode) const;
+
+      void updateExtremes() noexcept;
+      void threadNodes() noexcept;
+      void threadEnds() noexcept;
+      static void thread(BNode* pPrev, BNode* pNext) noexcept;
+      static void threadSubtrees(BNode* pLeft, BNode* pRight) noexcept;
+      size_t deleteBinaryTree(BNode*& pDelete) const noexcept;
+      template <class Keys, class Found>
+      void findBatch(const Keys& keys, Found found) const;
+
+      // what a search compares: the key of an element, or a bare key as
+      // is when the comparator takes it, and made into a key otherwise
+      static const key_type& keyOf(const T& t) { return KeyOf<T>::get(t); }
+      template <class Key>
+      static std::conditional_t<isTransparent<Compare>::value || std::is_same<Key, key_type>::value,
+                                const Key&, key_type> keyOf(const Key& k) { return k; }
+
+      // the comparator and the allocator, each kept once per tree. Nodes
+      // come from the allocator rebound to BNode
+      using CompareHolder = Holder<Compare, 0>;
+      using AllocatorHolder = Holder<Allocator, 1>;
+      using NodeAllocator = typename std::allocator_traits<Allocator>::template rebind_alloc<BNode>;
+      using NodeTraits = std::allocator_traits<NodeAllocator>;
+      const Compare& comp() const noexcept { return CompareHolder::get(); }
+      const Allocator& alloc() const noexcept { return AllocatorHolder::get(); }
+
+      // is a ordered before b, by their keys
+      template <class A, class B>
+      static bool isLess(const Compare& compare, const A& a, const B& b)
+      {
+         return compare(keyOf(a), keyOf(b));
+      }
+      template <class A, class B>
+      bool isLess(const A& a, const B& b) const
+      {
+         return isLess(comp(), a, b);
+      }
 
-
-
-
-
-      void deleteBinaryTree(BNode*& pDelete) noexcept;
+      // a three-way compare of the key only agrees with the tree's order
+      // when the tree orders by operator<
+      static const bool isThreeWayOK = hasCompare<key_type>::value &&
+                                       std::is_same<Compare, std::less<key_type>>::value;
+      void copyNode(const BNode* pSrc, BNode*& pDest);
       void copyBinaryTree(const BNode* pSrc, BNode*& pDest);
-      void deleteNode(BNode*& pDelete, bool toRight);
 
 
       BNode* root;              // root node of the binary search tree
+      BNode* pLeftmost;         // first node in order, so begin() is O(1)
+      BNode* pRightmost;        // last node in order, so --end() is O(1)
       size_t numElements;        // number of elements currently in the tree
    };
 
@@ -141,9 +469,11 @@ namespace custom
     * BINARY NODE
     * A single node in a binary tree. Note that the node does not know
     * anything about the properties of the tree so no validation can be done.
+    * The balancing policy adds its own data (color, height, ...) as a base.
     *****************************************************************/
-   template <typename T>
-   class BST <T> ::BNode
+   template <typename T, typename Balance, typename Compare, typename Allocator>
+   class BST <T, Balance, Compare, Allocator> ::BNode : public Balance::NodeData,
+                                    public ThreadLinks<BNode, balance::isThreaded<Balance>::value>
    {
    public:
       // 
@@ -155,6 +485,10 @@ namespace custom
 
       BNode(T&& t) : data(std::move(t)), pLeft(nullptr), pRight(nullptr), pParent(nullptr) {}
 
+      template <class ... Args>
+      BNode(std::in_place_t, Args&& ... args)
+         : data(std::forward<Args>(args)...), pLeft(nullptr), pRight(nullptr), pParent(nullptr) {}
+
       //
       // Insert
       //
@@ -178,38 +512,47 @@ namespace custom
       BNode* pLeft;          // Left child - smaller
       BNode* pRight;         // Right child - larger
       BNode* pParent;        // Parent
-      bool isRed;              // Red-black balancing stuff
    };
 
    /**********************************************************
     * BINARY SEARCH TREE ITERATOR
     * Forward and reverse iterator through a BST
     *********************************************************/
-   template <typename T>
-   class BST <T> ::iterator
+   template <typename T, typename Balance, typename Compare, typename Allocator>
+   class BST <T, Balance, Compare, Allocator> ::iterator
    {
       friend class ::TestBST; // give unit tests access to the privates
       friend class ::TestMap;
       friend class ::TestSet;
 
-      template <class KK, class VV>
+      template <class KK, class VV, class BB, class CC, class AA>
       friend class map;
 
       template <class TT>
       friend class set;
    public:
+      // so std::reverse_iterator and the algorithms know what we are
+      using iterator_category = std::bidirectional_iterator_tag;
+      using value_type        = T;
+      using difference_type   = std::ptrdiff_t;
+      using pointer           = const T*;
+      using reference         = const T&;
+
       // constructors and assignment
-      iterator(BNode* p = nullptr)
+      iterator(BNode* p = nullptr, const BST* pBST = nullptr)
       {
          pNode = p;
+         this->pBST = pBST;
       }
       iterator(const iterator& rhs)
       {
          pNode = rhs.pNode;
+         pBST = rhs.pBST;
       }
       iterator& operator = (const iterator& rhs)
       {
          pNode = rhs.pNode;
+         pBST = rhs.pBST;
          return *this;
       }
 
@@ -228,6 +571,23 @@ namespace custom
       {
          return pNode->data;
       }
+      const T* operator -> () const
+      {
+         return &pNode->data;
+      }
+
+      // jump n places in O(log n), when the Balance policy is sized<>
+      iterator& operator += (difference_type n)
+      {
+         assert(pBST != nullptr);
+         size_t index = pBST->indexOf(pNode) + n;
+         pNode = pBST->select(index).pNode;
+         return *this;
+      }
+      iterator& operator -= (difference_type n)
+      {
+         return *this += -n;
+      }
 
       // increment and decrement
       iterator& operator ++ ();
@@ -245,13 +605,79 @@ namespace custom
          return itReturn;
       }
 
-      // must give friend status to remove so it can call getNode() from it
-      friend BST <T> ::iterator BST <T> ::erase(iterator& it);
+      // the tree reaches through its iterators to their nodes
+      friend class BST <T, Balance, Compare, Allocator>;
 
    private:
 
       // the node
       BNode* pNode;
+
+      // the tree, so we can step back from end()
+      const BST* pBST;
+   };
+
+   /**********************************************************
+    * BINARY SEARCH TREE NODE HANDLE
+    * Owns a node taken out of one tree until it is put into another.
+    * A node still in the handle when it goes away is freed by the
+    * allocator of the tree it came from
+    *********************************************************/
+   template <typename T, typename Balance, typename Compare, typename Allocator>
+   class BST <T, Balance, Compare, Allocator> ::node_type
+   {
+      friend class ::TestBST; // give unit tests access to the privates
+      friend class ::TestMap;
+      friend class BST <T, Balance, Compare, Allocator>;
+   public:
+      // constructors, destructor, and assignment operator
+      node_type() noexcept : pNode(nullptr) {}
+      node_type(node_type&& rhs) noexcept : pNode(rhs.pNode), allocator(std::move(rhs.allocator)) { rhs.pNode = nullptr; }
+      node_type(const node_type& rhs) = delete;
+      ~node_type()
+      {
+         if (pNode)
+            deleteNode(*allocator, pNode);
+      }
+      node_type& operator = (node_type&& rhs) noexcept
+      {
+         std::swap(pNode, rhs.pNode);
+         std::swap(allocator, rhs.allocator);
+         return *this;
+      }
+      node_type& operator = (const node_type& rhs) = delete;
+
+      // is there a node in the handle?
+      bool empty() const noexcept { return pNode == nullptr; }
+      explicit operator bool () const noexcept { return pNode != nullptr; }
+
+      // the element in the node
+      T& value() const
+      {
+         assert(pNode != nullptr);
+         return pNode->data;
+      }
+
+      Allocator get_allocator() const { return *allocator; }
+
+   private:
+      node_type(BNode* pNode, const Allocator& allocator) noexcept : pNode(pNode), allocator(allocator) {}
+
+      BNode* pNode;
+      std::optional<Allocator> allocator;   // frees the node if it is never put back
+   };
+
+   /**********************************************************
+    * BINARY SEARCH TREE INSERT RETURN TYPE
+    * Where a node handle went, or why it did not, in which case
+    * the node is handed back
+    *********************************************************/
+   template <typename T, typename Balance, typename Compare, typename Allocator>
+   struct BST <T, Balance, Compare, Allocator> ::insert_return_type
+   {
+      iterator position;
+      bool inserted;
+      node_type node;
    };
 
 
@@ -267,31 +693,65 @@ namespace custom
     /*********************************************
      * BST :: DEFAULT CONSTRUCTOR
      ********************************************/
-   template <typename T>
-   BST <T> ::BST() : root(nullptr), numElements(0)
+   template <typename T, typename Balance, typename Compare, typename Allocator>
+   BST <T, Balance, Compare, Allocator> ::BST() : root(nullptr), pLeftmost(nullptr), pRightmost(nullptr), numElements(0)
+   {
+   }
+
+   /*********************************************
+    * BST :: COMPARE CONSTRUCTOR
+    * An empty tree ordered by a given comparator
+    ********************************************/
+   template <typename T, typename Balance, typename Compare, typename Allocator>
+   BST <T, Balance, Compare, Allocator> ::BST(const Compare& compare, const Allocator& allocator)
+      : CompareHolder(compare), AllocatorHolder(allocator),
+        root(nullptr), pLeftmost(nullptr), pRightmost(nullptr), numElements(0)
+   {
+   }
+
+   /*********************************************
+    * BST :: ALLOCATOR CONSTRUCTOR
+    * An empty tree getting its nodes from a given allocator
+    ********************************************/
+   template <typename T, typename Balance, typename Compare, typename Allocator>
+   BST <T, Balance, Compare, Allocator> ::BST(const Allocator& allocator)
+      : AllocatorHolder(allocator), root(nullptr), pLeftmost(nullptr), pRightmost(nullptr), numElements(0)
    {
    }
 
    /*********************************************
     * BST :: COPY CONSTRUCTOR
-    * Copy one tree to another
+    * Copy one tree to another, with the allocator the allocator
+    * chooses for a copy
     ********************************************/
-   template <typename T>
-   BST <T> ::BST(const BST<T>& rhs) : root(nullptr), numElements(0)
+   template <typename T, typename Balance, typename Compare, typename Allocator>
+   BST <T, Balance, Compare, Allocator> ::BST(const BST<T, Balance, Compare, Allocator>& rhs)
+      : CompareHolder(rhs.comp()),
+        AllocatorHolder(std::allocator_traits<Allocator>::select_on_container_copy_construction(rhs.alloc())),
+        root(nullptr), pLeftmost(nullptr), pRightmost(nullptr), numElements(0)
    {
-      *this = rhs;
+      copyBinaryTree(rhs.root, root);
+      numElements = rhs.numElements;
+      updateExtremes();
+      threadNodes();
    }
 
    /*********************************************
     * BST :: MOVE CONSTRUCTOR
-    * Move one tree to another
+    * Move one tree to another. The allocator comes along with the nodes
     ********************************************/
-   template <typename T>
-   BST <T> ::BST(BST <T>&& rhs) : root(nullptr), numElements(0)
+   template <typename T, typename Balance, typename Compare, typename Allocator>
+   BST <T, Balance, Compare, Allocator> ::BST(BST <T, Balance, Compare, Allocator>&& rhs)
+      : CompareHolder(rhs.comp()), AllocatorHolder(rhs.alloc()),
+        root(nullptr), pLeftmost(nullptr), pRightmost(nullptr), numElements(0)
    {
       root = rhs.root;
       rhs.root = nullptr;
 
+      pLeftmost = rhs.pLeftmost;
+      pRightmost = rhs.pRightmost;
+      rhs.pLeftmost = rhs.pRightmost = nullptr;
+
       numElements = rhs.numElements;
       rhs.numElements = 0;
    }
@@ -300,19 +760,19 @@ namespace custom
     * BST :: INITIALIZER LIST CONSTRUCTOR
     * Create a BST from an initializer list
     ********************************************/
-   template <typename T>
-   BST <T> ::BST(const std::initializer_list<T>& il)
+   template <typename T, typename Balance, typename Compare, typename Allocator>
+   BST <T, Balance, Compare, Allocator> ::BST(const std::initializer_list<T>& il)
    {
       numElements = 0;
-      root = nullptr;
+      root = pLeftmost = pRightmost = nullptr;
       *this = il;
    }
 
    /*********************************************
     * BST :: DESTRUCTOR
     ********************************************/
-   template <typename T>
-   BST <T> :: ~BST()
+   template <typename T, typename Balance, typename Compare, typename Allocator>
+   BST <T, Balance, Compare, Allocator> :: ~BST()
    {
       clear();
    }
@@ -320,13 +780,25 @@ namespace custom
 
    /*********************************************
     * BST :: ASSIGNMENT OPERATOR
-    * Copy one tree to another
+    * Copy one tree to another. If the allocator follows the copy,
+    * nodes from the old one are freed first unless the two are equal
     ********************************************/
-   template <typename T>
-   BST <T>& BST <T> :: operator = (const BST <T>& rhs)
+   template <typename T, typename Balance, typename Compare, typename Allocator>
+   BST <T, Balance, Compare, Allocator>& BST <T, Balance, Compare, Allocator> :: operator = (const BST <T, Balance, Compare, Allocator>& rhs)
    {
+      if constexpr (NodeTraits::propagate_on_container_copy_assignment::value)
+      {
+         if (!(alloc() == rhs.alloc()))
+         {
+            clear();
+         }
+         AllocatorHolder::get() = rhs.alloc();
+      }
+      CompareHolder::get() = rhs.comp();
       copyBinaryTree(rhs.root, this->root);
       this->numElements = rhs.numElements;
+      updateExtremes();
+      threadNodes();
 
       return *this;
    }
@@ -335,327 +807,1782 @@ namespace custom
     * BST :: ASSIGNMENT OPERATOR with INITIALIZATION LIST
     * Copy nodes onto a BTree
     ********************************************/
-   template <typename T>
-   BST <T>& BST <T> :: operator = (const std::initializer_list<T>& il)
+   template <typename T, typename Balance, typename Compare, typename Allocator>
+   BST <T, Balance, Compare, Allocator>& BST <T, Balance, Compare, Allocator> :: operator = (const std::initializer_list<T>& il)
    {
-
-      deleteBinaryTree(root);
-      numElements = 0;
-
-      for (auto&& element : il)
-      {
-         insert(element);
-      }
+      build(il.begin(), il.end(), false /*keepUnique*/);
       return *this;
    }
 
    /*********************************************
     * BST :: ASSIGN-MOVE OPERATOR
-    * Move one tree to another
+    * Move one tree to another. The nodes are taken when the allocator
+    * follows the move or the two are equal. Otherwise our allocator could
+    * not free them, so each element is moved into a node of our own
     ********************************************/
-   template <typename T>
-   BST <T>& BST <T> :: operator = (BST <T>&& rhs)
+   template <typename T, typename Balance, typename Compare, typename Allocator>
+   BST <T, Balance, Compare, Allocator>& BST <T, Balance, Compare, Allocator> :: operator = (BST <T, Balance, Compare, Allocator>&& rhs)
    {
-
       clear();
-      swap(rhs);
+      CompareHolder::get() = rhs.comp();
+
+      if (NodeTraits::propagate_on_container_move_assignment::value || alloc() == rhs.alloc())
+      {
+         if constexpr (NodeTraits::propagate_on_container_move_assignment::value)
+         {
+            AllocatorHolder::get() = rhs.alloc();
+         }
+         std::swap(rhs.root, root);
+         std::swap(rhs.pLeftmost, pLeftmost);
+         std::swap(rhs.pRightmost, pRightmost);
+         std::swap(rhs.numElements, numElements);
+      }
+      else
+      {
+         for (BNode* p = rhs.pLeftmost; p != nullptr; p = (++iterator(p, &rhs)).pNode)
+         {
+            emplace_hint(end(), std::move(p->data));
+         }
+         rhs.clear();
+      }
 
       return *this;
    }
 
    /*********************************************
     * BST :: SWAP
-    * Swap two trees
+    * Swap two trees. The allocators are only swapped if they say so;
+    * otherwise, as with the standard containers, they must be equal
     ********************************************/
-   template <typename T>
-   void BST <T> ::swap(BST <T>& rhs)
+   template <typename T, typename Balance, typename Compare, typename Allocator>
+   void BST <T, Balance, Compare, Allocator> ::swap(BST <T, Balance, Compare, Allocator>& rhs)
    {
       std::swap(rhs.root, root);
+      std::swap(rhs.pLeftmost, pLeftmost);
+      std::swap(rhs.pRightmost, pRightmost);
       std::swap(rhs.numElements, numElements);
+      std::swap(rhs.CompareHolder::get(), CompareHolder::get());
+      if constexpr (NodeTraits::propagate_on_container_swap::value)
+      {
+         using std::swap;
+         swap(rhs.AllocatorHolder::get(), AllocatorHolder::get());
+      }
    }
 
    /*****************************************************
     * BST :: INSERT
     * Insert a node at a given location in the tree
     ****************************************************/
-   template <typename T>
-   std::pair<typename BST <T> ::iterator, bool> BST <T> ::insert(const T& t, bool keepUnique)
+   template <typename T, typename Balance, typename Compare, typename Allocator>
+   std::pair<typename BST <T, Balance, Compare, Allocator> ::iterator, bool> BST <T, Balance, Compare, Allocator> ::insert(const T& t, bool keepUnique)
    {
-
       std::pair<iterator, bool> pairReturn(end(), false);
 
-      try
+      // find where the new node goes, or the duplicate if we keep unique
+      BNode* pParent = nullptr;
+      bool isLeft = false;
+      if (!findInsertPosition(t, keepUnique, pParent, isLeft))
       {
-         if (root == nullptr)
-         {
-            assert(numElements == 0);
-            root = new BNode(t);
-            numElements = 1;
-            pairReturn.first = iterator(root);
-            pairReturn.second = true;
-            return pairReturn;
-         }
-
-         BNode* node = root;
-         bool done = false;
-         while (!done)
-         {
-            if (keepUnique && t == node->data)
-            {
-               pairReturn.first = iterator(node);
-               pairReturn.second = false;
-               return pairReturn;
-            }
-
-            if (t < node->data)
-            {
-               if (node->pLeft)
-               {
-                  node = node->pLeft;
-               }
-               else
-               {
-                  node->addLeft(t);
-                  done = true;
-                  pairReturn.first = iterator(node->pLeft);
-                  pairReturn.second = true;
-               }
-            }
-            else
-            {
-               if (node->pRight)
-               {
-                  node = node->pRight;
-               }
-               else
-               {
-                  node->addRight(t);
-                  done = true;
-                  pairReturn.first = iterator(node->pRight);
-                  pairReturn.second = true;
-               }
-            }
-
-         }
-         assert(root != nullptr);
-         numElements++;
+         pairReturn.first = iterator(pParent, this);
+         return pairReturn;
+      }
 
-         while (root->pParent != nullptr)
-         {
-            root = root->pParent;
-         }
+      BNode* pNew = newNode(t);
 
-      }
-      catch (const std::exception&)
-      {
-         throw "Error: Unable to allocate a node";
-      }
+      pairReturn.first = insertNode(pNew, pParent, isLeft);
+      pairReturn.second = true;
       return pairReturn;
    }
 
-
-
-   template <typename T>
-   std::pair<typename BST <T> ::iterator, bool> BST <T> ::insert(T&& t, bool keepUnique)
+   /*****************************************************
+    * BST :: INSERT
+    * Move a value into a new node in the tree
+    ****************************************************/
+   template <typename T, typename Balance, typename Compare, typename Allocator>
+   std::pair<typename BST <T, Balance, Compare, Allocator> ::iterator, bool> BST <T, Balance, Compare, Allocator> ::insert(T&& t, bool keepUnique)
    {
       std::pair<iterator, bool> pairReturn(end(), false);
 
-      try
+      // find where the new node goes, or the duplicate if we keep unique
+      BNode* pParent = nullptr;
+      bool isLeft = false;
+      if (!findInsertPosition(t, keepUnique, pParent, isLeft))
       {
-         if (root == nullptr)
-         {
-            assert(numElements == 0);
-            root = new BNode(t);
-            numElements = 1;
-            pairReturn.first = iterator(root);
-            pairReturn.second = true;
-            return pairReturn;
-         }
-
-         BNode* node = root;
-         bool done = false;
-         while (!done)
-         {
-            if (keepUnique && t == node->data)
-            {
-               pairReturn.first = iterator(node);
-               pairReturn.second = false;
-               return pairReturn;
-            }
-
-            if (t < node->data)
-            {
-               if (node->pLeft)
-               {
-                  node = node->pLeft;
-               }
-               else
-               {
-                  node->addLeft(t);
-                  done = true;
-                  pairReturn.first = iterator(node->pLeft);
-                  pairReturn.second = true;
-               }
-            }
-            else
-            {
-               if (node->pRight)
-               {
-                  node = node->pRight;
-               }
-               else
-               {
-                  node->addRight(t);
-                  done = true;
-                  pairReturn.first = iterator(node->pRight);
-                  pairReturn.second = true;
-               }
-            }
+         pairReturn.first = iterator(pParent, this);
+         return pairReturn;
+      }
 
-         }
-         assert(root != nullptr);
-         numElements++;
+      BNode* pNew = newNode(std::move(t));
 
-         while (root->pParent != nullptr)
-         {
-            root = root->pParent;
-         }
+      pairReturn.first = insertNode(pNew, pParent, isLeft);
+      pairReturn.second = true;
+      return pairReturn;
+   }
 
-      }
-      catch (const std::exception&)
+   /*****************************************************
+    * BST :: INSERT with HINT
+    * Insert a value next to hint when it belongs there, which saves
+    * the walk down from the root. Returns the new node, or the
+    * duplicate if we keep unique
+    ****************************************************/
+   template <typename T, typename Balance, typename Compare, typename Allocator>
+   typename BST <T, Balance, Compare, Allocator> ::iterator BST <T, Balance, Compare, Allocator> ::insert(iterator hint, const T& t, bool keepUnique)
+   {
+      BNode* pParent = nullptr;
+      bool isLeft = false;
+      if (!findHintPosition(hint, t, keepUnique, pParent, isLeft))
       {
-         throw "Error: Unable to allocate a node";
+         return iterator(pParent, this);
       }
-      return pairReturn;
+
+      BNode* pNew = newNode(t);
+
+      return insertNode(pNew, pParent, isLeft);
    }
 
-   /*************************************************
-    * BST :: ERASE
-    * Remove a given node as specified by the iterator
-    ************************************************/
-   template <typename T>
-   typename BST <T> ::iterator BST <T> ::erase(iterator& it)
+   /*****************************************************
+    * BST :: INSERT with HINT
+    * Move a value into a new node next to hint
+    ****************************************************/
+   template <typename T, typename Balance, typename Compare, typename Allocator>
+   typename BST <T, Balance, Compare, Allocator> ::iterator BST <T, Balance, Compare, Allocator> ::insert(iterator hint, T&& t, bool keepUnique)
    {
-      if (it == end())
+      BNode* pParent = nullptr;
+      bool isLeft = false;
+      if (!findHintPosition(hint, t, keepUnique, pParent, isLeft))
       {
-         return end();
+         return iterator(pParent, this);
       }
 
-      iterator itNext = it;
-      BNode* pDelete = it.pNode;
+      BNode* pNew = newNode(std::move(t));
 
-      if (pDelete->pLeft == nullptr)
+      return insertNode(pNew, pParent, isLeft);
+   }
+
+   /*****************************************************
+    * BST :: FIND HINT POSITION
+    * If t belongs between the node before hint and hint itself (or
+    * between hint and the node after it) the new node goes on whichever
+    * of the two has a free child on that side. Otherwise walk down from
+    * the root like any other insert
+    ****************************************************/
+   template <typename T, typename Balance, typename Compare, typename Allocator>
+   bool BST <T, Balance, Compare, Allocator> ::findHintPosition(iterator hint, const T& t, bool keepUnique, BNode*& pParent, bool& isLeft)
+   {
+      // is a before t? Duplicates may sit beside each other unless we keep unique
+      auto before = [this, keepUnique](const T& a, const T& t)
       {
-         ++itNext;
-         deleteNode(pDelete, true);
-      }
-      else if (pDelete->pRight == nullptr)
+         return keepUnique ? isLess(a, t) : !isLess(t, a);
+      };
+
+      BNode* pHint = hint.pNode;
+
+      // t goes at the very end: the usual case for sorted input
+      if (pHint == nullptr)
       {
-         ++itNext;
-         deleteNode(pDelete, false);
+         if (pRightmost && before(pRightmost->data, t))
+         {
+            pParent = pRightmost;
+            isLeft = false;
+            return true;
+         }
       }
 
-      else
+      // t goes just before hint
+      else if (isLess(t, pHint->data))
       {
-         BNode* pIOS = pDelete->pRight;
-         while (pIOS->pLeft != nullptr)
+         BNode* pPrev = (pHint == pLeftmost ? nullptr : (--iterator(pHint, this)).pNode);
+         if (pPrev == nullptr || before(pPrev->data, t))
          {
-            pIOS = pIOS->pLeft;
+            // the node before hint is the rightmost of hint's left subtree,
+            // so one of the two is always free on the side we need
+            isLeft = (pHint->pLeft == nullptr);
+            pParent = (isLeft ? pHint : pPrev);
+            return true;
          }
-         pIOS->pLeft = pDelete->pLeft;
-         if (pDelete->pLeft)
-         {
-            pDelete->pLeft->pParent = pIOS;
+      }
+
+      // t is a duplicate of hint
+      else if (keepUnique && !isLess(pHint->data, t))
+      {
+         pParent = pHint;
+         return false;
+      }
+
+      // t goes just after hint
+      else
+      {
+         BNode* pNext = (pHint == pRightmost ? nullptr : (++iterator(pHint, this)).pNode);
+         if (pNext == nullptr || isLess(t, pNext->data))
+         {
+            isLeft = (pHint->pRight != nullptr);
+            pParent = (isLeft ? pNext : pHint);
+            return true;
+         }
+      }
+
+      return findInsertPosition(t, keepUnique, pParent, isLeft);
+   }
+
+   /*****************************************************
+    * BST :: FIND INSERT POSITION
+    * Walk down the tree to the parent of a new node holding t. Returns
+    * false, with pParent set to the match, if keepUnique finds a duplicate
+    ****************************************************/
+   template <typename T, typename Balance, typename Compare, typename Allocator>
+   bool BST <T, Balance, Compare, Allocator> ::findInsertPosition(const T& t, bool keepUnique, BNode*& pParent, bool& isLeft)
+   {
+      pParent = nullptr;
+      isLeft = false;
+
+      // one three-way comparison per level
+      if constexpr (isThreeWayOK)
+      {
+         for (BNode* p = root; p != nullptr; p = (isLeft ? p->pLeft : p->pRight))
+         {
+            int order = keyOf(t).compare(keyOf(p->data));
+            if (keepUnique && order == 0)
+            {
+               pParent = p;
+               return false;
+            }
+
+            pParent = p;
+            isLeft = order < 0;
+         }
+         return true;
+      }
+
+      // one operator< per level. A duplicate is the last node we went right of
+      else
+      {
+         BNode* pNotGreater = nullptr;
+         for (BNode* p = root; p != nullptr; p = (isLeft ? p->pLeft : p->pRight))
+         {
+            pParent = p;
+            isLeft = isLess(t, p->data);
+            if (!isLeft)
+            {
+               pNotGreater = p;
+            }
+         }
+
+         if (keepUnique && pNotGreater && !isLess(pNotGreater->data, t))
+         {
+            pParent = pNotGreater;
+            return false;
+         }
+         return true;
+      }
+   }
+
+   /*****************************************************
+    * BST :: NEW NODE
+    * Get a node from the allocator and build the element inside it
+    * from args. If the element cannot be built the node goes back
+    ****************************************************/
+   template <typename T, typename Balance, typename Compare, typename Allocator>
+   template <class ... Args>
+   typename BST <T, Balance, Compare, Allocator> ::BNode* BST <T, Balance, Compare, Allocator> ::newNode(Args&& ... args) const
+   {
+      NodeAllocator nodeAllocator(alloc());
+      BNode* pNode = nullptr;
+      try
+      {
+         pNode = NodeTraits::allocate(nodeAllocator, 1);
+         NodeTraits::construct(nodeAllocator, pNode, std::in_place, std::forward<Args>(args)...);
+         return pNode;
+      }
+      catch (const std::exception&)
+      {
+         if (pNode)
+         {
+            NodeTraits::deallocate(nodeAllocator, pNode, 1);
+         }
+         throw "Error: Unable to allocate a node";
+      }
+   }
+
+   /*****************************************************
+    * BST :: DELETE NODE
+    * Destroy the element and hand the node back to the allocator
+    ****************************************************/
+   template <typename T, typename Balance, typename Compare, typename Allocator>
+   void BST <T, Balance, Compare, Allocator> ::deleteNode(const Allocator& allocator, BNode* pNode) noexcept
+   {
+      NodeAllocator nodeAllocator(allocator);
+      NodeTraits::destroy(nodeAllocator, pNode);
+      NodeTraits::deallocate(nodeAllocator, pNode, 1);
+   }
+
+   /*****************************************************
+    * BST :: EMPLACE NODE
+    * Build the element in its node first, since there is nothing to
+    * compare until it exists. A duplicate under keepUnique is freed
+    ****************************************************/
+   template <typename T, typename Balance, typename Compare, typename Allocator>
+   template <class ... Args>
+   std::pair<typename BST <T, Balance, Compare, Allocator> ::iterator, bool> BST <T, Balance, Compare, Allocator> ::emplaceNode(bool keepUnique, Args&& ... args)
+   {
+      BNode* pNew = newNode(std::forward<Args>(args)...);
+
+      BNode* pParent = nullptr;
+      bool isLeft = false;
+      if (!findInsertPosition(pNew->data, keepUnique, pParent, isLeft))
+      {
+         deleteNode(alloc(), pNew);
+         return std::make_pair(iterator(pParent, this), false);
+      }
+      return std::make_pair(insertNode(pNew, pParent, isLeft), true);
+   }
+
+   /*****************************************************
+    * BST :: EMPLACE HINT NODE
+    * As emplaceNode(), starting the search from the hint
+    ****************************************************/
+   template <typename T, typename Balance, typename Compare, typename Allocator>
+   template <class ... Args>
+   typename BST <T, Balance, Compare, Allocator> ::iterator BST <T, Balance, Compare, Allocator> ::emplaceHintNode(iterator hint, bool keepUnique, Args&& ... args)
+   {
+      BNode* pNew = newNode(std::forward<Args>(args)...);
+
+      BNode* pParent = nullptr;
+      bool isLeft = false;
+      if (!findHintPosition(hint, pNew->data, keepUnique, pParent, isLeft))
+      {
+         deleteNode(alloc(), pNew);
+         return iterator(pParent, this);
+      }
+      return insertNode(pNew, pParent, isLeft);
+   }
+
+   /*****************************************************
+    * BST :: INSERT NODE
+    * Hook a new node under pParent and rebalance the tree
+    ****************************************************/
+   template <typename T, typename Balance, typename Compare, typename Allocator>
+   typename BST <T, Balance, Compare, Allocator> ::iterator BST <T, Balance, Compare, Allocator> ::insertNode(BNode* pNew, BNode* pParent, bool isLeft)
+   {
+      assert(pNew != nullptr);
+
+      if (pParent == nullptr)
+      {
+         assert(root == nullptr && numElements == 0);
+         root = pLeftmost = pRightmost = pNew;
+      }
+      else if (isLeft)
+      {
+         assert(pParent->pLeft == nullptr);
+         pParent->addLeft(pNew);
+         if (pParent == pLeftmost)
+         {
+            pLeftmost = pNew;
+         }
+      }
+      else
+      {
+         assert(pParent->pRight == nullptr);
+         pParent->addRight(pNew);
+         if (pParent == pRightmost)
+         {
+            pRightmost = pNew;
+         }
+      }
+
+      // the new node falls between its parent and the parent's old neighbor
+      if constexpr (balance::isThreaded<Balance>::value)
+      {
+         if (pParent == nullptr)
+         {
+            thread(nullptr, pNew);
+            thread(pNew, nullptr);
+         }
+         else if (isLeft)
+         {
+            thread(pParent->pPrev, pNew);
+            thread(pNew, pParent);
+         }
+         else
+         {
+            thread(pNew, pParent->pNext);
+            thread(pParent, pNew);
+         }
+      }
+
+      numElements++;
+      Balance::afterInsert(*this, pNew);
+      return iterator(pNew, this);
+   }
+
+   /*************************************************
+    * BST :: ERASE
+    * Remove a given node as specified by the iterator
+    ************************************************/
+   template <typename T, typename Balance, typename Compare, typename Allocator>
+   typename BST <T, Balance, Compare, Allocator> ::iterator BST <T, Balance, Compare, Allocator> ::erase(iterator& it)
+   {
+      if (it == end())
+      {
+         return end();
+      }
+
+      iterator itNext(it.pNode, this);
+      ++itNext;
+      BNode* pDelete = it.pNode;
+      unlink(pDelete);
+      deleteNode(alloc(), pDelete);
+      return itNext;
+   }
+
+   /*************************************************
+    * BST :: ERASE
+    * Remove [first, last). The range is cut out whole with two splits,
+    * its nodes freed in one pass, and the two ends joined back together,
+    * so it costs O(log n + k) and balance is restored only by the joins
+    ************************************************/
+   template <typename T, typename Balance, typename Compare, typename Allocator>
+   typename BST <T, Balance, Compare, Allocator> ::iterator BST <T, Balance, Compare, Allocator> ::erase(iterator first, iterator last)
+   {
+      if (first == last)
+      {
+         return last;
+      }
+      if (first == begin() && last == end())
+      {
+         clear();
+         return end();
+      }
+
+      // [begin, last) and [last, end)
+      Subtree rest{ nullptr, 0, 0 };
+      Subtree less{ root, Balance::rank(root), 0 };
+      if (last.pNode)
+      {
+         Pieces pieces = splitBefore(last.pNode);
+         less = Subtree{ pieces.pLess, pieces.rankLess, 0 };
+         rest = Subtree{ pieces.pRest, pieces.rankRest, 0 };
+      }
+
+      // [begin, first) and [first, last)
+      Pieces pieces = splitBefore(first.pNode);
+      less = Subtree{ pieces.pLess, pieces.rankLess, 0 };
+      numElements -= deleteBinaryTree(pieces.pRest);
+
+      threadSubtrees(less.pRoot, rest.pRoot);
+      root = joinNodes(less, rest).pRoot;
+      updateExtremes();
+      return iterator(last.pNode, this);
+   }
+
+   /*************************************************
+    * BST :: EXTRACT
+    * Take a node out of the tree and hand it over, element and all
+    ************************************************/
+   template <typename T, typename Balance, typename Compare, typename Allocator>
+   typename BST <T, Balance, Compare, Allocator> ::node_type BST <T, Balance, Compare, Allocator> ::extract(iterator it)
+   {
+      if (it == end())
+      {
+         return node_type();
+      }
+
+      unlink(it.pNode);
+      return node_type(it.pNode, alloc());
+   }
+
+   /*************************************************
+    * BST :: EXTRACT
+    * Take the node holding k out of the tree, if there is one
+    ************************************************/
+   template <typename T, typename Balance, typename Compare, typename Allocator>
+   template <class Key>
+   typename BST <T, Balance, Compare, Allocator> ::node_type BST <T, Balance, Compare, Allocator> ::extract(const Key& k)
+   {
+      return extract(find(k));
+   }
+
+   /*************************************************
+    * BST :: INSERT
+    * Hook the node in a handle into this tree. If keepUnique finds a
+    * duplicate, the node stays in the handle that comes back. As with
+    * the standard containers, the handle must come from a tree whose
+    * allocator is equal to ours, or we could not free the node
+    ************************************************/
+   template <typename T, typename Balance, typename Compare, typename Allocator>
+   typename BST <T, Balance, Compare, Allocator> ::insert_return_type BST <T, Balance, Compare, Allocator> ::insert(node_type&& nh, bool keepUnique)
+   {
+      if (nh.empty())
+      {
+         return insert_return_type{ end(), false, node_type() };
+      }
+      assert(alloc() == nh.get_allocator());
+
+      BNode* pParent;
+      bool isLeft;
+      if (!findInsertPosition(nh.pNode->data, keepUnique, pParent, isLeft))
+      {
+         return insert_return_type{ iterator(pParent, this), false, std::move(nh) };
+      }
+
+      BNode* pNode = nh.pNode;
+      nh.pNode = nullptr;
+      return insert_return_type{ relinkNode(pNode, pParent, isLeft), true, node_type() };
+   }
+
+   /*************************************************
+    * BST :: MERGE
+    * Move every node of rhs into this tree. With keepUnique, the ones
+    * that would be duplicates are left behind in rhs. When the two
+    * allocators are not equal ours could not free those nodes, so each
+    * element is moved into a node of our own instead
+    ************************************************/
+   template <typename T, typename Balance, typename Compare, typename Allocator>
+   void BST <T, Balance, Compare, Allocator> ::merge(BST& rhs, bool keepUnique)
+   {
+      if (&rhs == this)
+      {
+         return;
+      }
+
+      bool isSameAllocator = (alloc() == rhs.alloc());
+      for (iterator it = rhs.begin(); it != rhs.end(); )
+      {
+         BNode* pNode = it.pNode;
+         ++it;
+
+         BNode* pParent;
+         bool isLeft;
+         if (findInsertPosition(pNode->data, keepUnique, pParent, isLeft))
+         {
+            if (isSameAllocator)
+            {
+               rhs.unlink(pNode);
+               relinkNode(pNode, pParent, isLeft);
+            }
+            else
+            {
+               insertNode(newNode(std::move(pNode->data)), pParent, isLeft);
+               rhs.unlink(pNode);
+               deleteNode(rhs.alloc(), pNode);
+            }
+         }
+      }
+   }
+
+   /*************************************************
+    * BST :: RELINK NODE
+    * Hook in a node that came out of another tree. Whatever the policy
+    * kept in it there means nothing here, so it starts over
+    ************************************************/
+   template <typename T, typename Balance, typename Compare, typename Allocator>
+   typename BST <T, Balance, Compare, Allocator> ::iterator BST <T, Balance, Compare, Allocator> ::relinkNode(BNode* pNode, BNode* pParent, bool isLeft)
+   {
+      static_cast<typename Balance::NodeData&>(*pNode) = typename Balance::NodeData();
+      return insertNode(pNode, pParent, isLeft);
+   }
+
+   /*************************************************
+    * BST :: UNLINK
+    * Take a node out of the tree and rebalance, without freeing it
+    ************************************************/
+   template <typename T, typename Balance, typename Compare, typename Allocator>
+   void BST <T, Balance, Compare, Allocator> ::unlink(BNode* pDelete)
+   {
+      assert(pDelete != nullptr);
+      BNode* pNext = (pDelete == pRightmost ? nullptr : (++iterator(pDelete, this)).pNode);
+
+      // keep the cached ends of the tree up to date
+      if (pDelete == pLeftmost)
+      {
+         pLeftmost = pNext;
+      }
+      if (pDelete == pRightmost)
+      {
+         pRightmost = (--iterator(pDelete, this)).pNode;
+      }
+      if constexpr (balance::isThreaded<Balance>::value)
+      {
+         thread(pDelete->pPrev, pDelete->pNext);
+         pDelete->pPrev = pDelete->pNext = nullptr;
+      }
+
+      Balance::beforeErase(*this, pDelete);
+
+      // the node that takes the place of the one physically removed from
+      // the tree, and its parent
+      BNode* pChild;
+      BNode* pParent;
+
+      if (pDelete->pLeft == nullptr || pDelete->pRight == nullptr)
+      {
+         pChild = (pDelete->pLeft ? pDelete->pLeft : pDelete->pRight);
+         pParent = pDelete->pParent;
+         replaceChild(pDelete, pChild);
+      }
+
+      // two children: the in-order successor takes pDelete's place. It also
+      // takes pDelete's balance data, leaving pDelete with the data of the
+      // spot that was physically emptied
+      else
+      {
+         BNode* pIOS = pNext;
+         assert(pIOS != nullptr && pIOS->pLeft == nullptr);
+         pChild = pIOS->pRight;
+
+         if (pIOS->pParent == pDelete)
+         {
+            pParent = pIOS;
+         }
+         else
+         {
+            pParent = pIOS->pParent;
+            pParent->addLeft(pChild);
+            pIOS->addRight(pDelete->pRight);
+         }
+         pIOS->addLeft(pDelete->pLeft);
+         replaceChild(pDelete, pIOS);
+         std::swap(static_cast<typename Balance::NodeData&>(*pIOS),
+                   static_cast<typename Balance::NodeData&>(*pDelete));
+      }
+
+      Balance::afterErase(*this, pChild, pParent, pDelete);
+
+      numElements--;
+      pDelete->pLeft = pDelete->pRight = pDelete->pParent = nullptr;
+   }
+
+   /*****************************************************
+    * BST :: SPLIT
+    * Move the elements less than k into the first tree and the rest into
+    * the second, leaving this one empty. Each join on the way back up
+    * costs the difference in rank of the pieces, so the whole split is
+    * O(log n). Without sized<> counts, the sizes of the pieces are found
+    * by stepping through both until the smaller ends
+    ****************************************************/
+   template <typename T, typename Balance, typename Compare, typename Allocator>
+   template <class Key>
+   std::pair<BST <T, Balance, Compare, Allocator>, BST <T, Balance, Compare, Allocator>> BST <T, Balance, Compare, Allocator> ::split(const Key& k)
+   {
+      Pieces pieces = splitNodes(root, Balance::rank(root), keyOf(k), false /*isThreeWay*/);
+
+      std::pair<BST, BST> pairReturn{ BST(comp(), alloc()), BST(comp(), alloc()) };
+      BST& lhs = pairReturn.first;
+      BST& rhs = pairReturn.second;
+      lhs.root = pieces.pLess;
+      rhs.root = pieces.pRest;
+      lhs.updateExtremes();
+      rhs.updateExtremes();
+      lhs.threadEnds();
+      rhs.threadEnds();
+
+      if constexpr (balance::isSized<Balance>::value)
+      {
+         lhs.numElements = Balance::size(lhs.root);
+      }
+      else
+      {
+         size_t num = 0;
+         iterator itLess = lhs.begin();
+         iterator itRest = rhs.begin();
+         for (; itLess != lhs.end() && itRest != rhs.end(); ++itLess, ++itRest)
+         {
+            num++;
+         }
+         lhs.numElements = (itLess == lhs.end() ? num : numElements - num);
+      }
+      rhs.numElements = numElements - lhs.numElements;
+
+      root = pLeftmost = pRightmost = nullptr;
+      numElements = 0;
+      return pairReturn;
+   }
+
+   /*****************************************************
+    * BST :: SET UNION
+    * Every element in either tree. Where both have an element, the
+    * one from lhs is kept
+    ****************************************************/
+   template <typename T, typename Balance, typename Compare, typename Allocator>
+   BST <T, Balance, Compare, Allocator> BST <T, Balance, Compare, Allocator> ::setUnion(BST& lhs, BST& rhs)
+   {
+      return combine(SetOp::UNION, lhs, rhs);
+   }
+
+   /*****************************************************
+    * BST :: SET INTERSECTION
+    * The elements of lhs that are also in rhs
+    ****************************************************/
+   template <typename T, typename Balance, typename Compare, typename Allocator>
+   BST <T, Balance, Compare, Allocator> BST <T, Balance, Compare, Allocator> ::setIntersection(BST& lhs, BST& rhs)
+   {
+      return combine(SetOp::INTERSECTION, lhs, rhs);
+   }
+
+   /*****************************************************
+    * BST :: SET DIFFERENCE
+    * The elements of lhs that are not in rhs
+    ****************************************************/
+   template <typename T, typename Balance, typename Compare, typename Allocator>
+   BST <T, Balance, Compare, Allocator> BST <T, Balance, Compare, Allocator> ::setDifference(BST& lhs, BST& rhs)
+   {
+      return combine(SetOp::DIFFERENCE, lhs, rhs);
+   }
+
+   /*****************************************************
+    * BST :: COMBINE
+    * Run a set operation on the whole of two trees, leaving both empty.
+    * Threads are spawned a few levels deep, enough to keep every core
+    * busy even when the halves are not quite even. Freed nodes go back
+    * to the allocator from those threads, so only std::allocator, which
+    * is known to be thread safe, gets more than one
+    ****************************************************/
+   template <typename T, typename Balance, typename Compare, typename Allocator>
+   BST <T, Balance, Compare, Allocator> BST <T, Balance, Compare, Allocator> ::combine(SetOp op, BST& lhs, BST& rhs)
+   {
+      int numSpawn = 0;
+      if constexpr (std::is_same<Allocator, std::allocator<T>>::value)
+      {
+         numSpawn = 1;
+         for (unsigned int numCores = std::thread::hardware_concurrency(); numCores > 1; numCores >>= 1)
+         {
+            numSpawn++;
+         }
+      }
+
+      // every node has to be one the allocator of lhs can free
+      BST other = lhs.adopt(rhs);
+      Subtree subtree = lhs.combineNodes(op, lhs.root, Balance::rank(lhs.root),
+                                         other.root, Balance::rank(other.root),
+                                         lhs.numElements + other.numElements, numSpawn);
+
+      BST bst(lhs.comp(), lhs.alloc());
+      bst.root = subtree.pRoot;
+      bst.numElements = lhs.numElements + other.numElements - subtree.numFreed;
+      bst.updateExtremes();
+      bst.threadEnds();
+
+      lhs.root = lhs.pLeftmost = lhs.pRightmost = nullptr;
+      lhs.numElements = 0;
+      other.root = other.pLeftmost = other.pRightmost = nullptr;
+      other.numElements = 0;
+      return bst;
+   }
+
+   /*****************************************************
+    * BST :: COMBINE NODES
+    * Take the root of rhs and cut lhs around it. The pieces on either
+    * side are combined independently, in parallel when there are enough
+    * nodes, and joined back on either side of the root when it is kept.
+    * O(m log(n/m + 1)) work for trees of size m <= n
+    ****************************************************/
+   template <typename T, typename Balance, typename Compare, typename Allocator>
+   typename BST <T, Balance, Compare, Allocator> ::Subtree BST <T, Balance, Compare, Allocator> ::combineNodes(SetOp op,
+                                                                    BNode* pLhs, int rankLhs,
+                                                                    BNode* pRhs, int rankRhs,
+                                                                    size_t num, int numSpawn) const
+   {
+      if (pLhs == nullptr || pRhs == nullptr)
+      {
+         switch (op)
+         {
+         case SetOp::UNION:
+            return (pLhs ? Subtree{ pLhs, rankLhs, 0 } : Subtree{ pRhs, rankRhs, 0 });
+         case SetOp::INTERSECTION:
+            return Subtree{ nullptr, 0, deleteBinaryTree(pLhs) + deleteBinaryTree(pRhs) };
+         case SetOp::DIFFERENCE:
+            return Subtree{ pLhs, rankLhs, deleteBinaryTree(pRhs) };
+         }
+      }
+
+      // take the root off rhs
+      BNode* pMid = pRhs;
+      BNode* pLeft = pMid->pLeft;
+      BNode* pRight = pMid->pRight;
+      int rankLeft = Balance::childRank(pMid, rankRhs, pLeft);
+      int rankRight = Balance::childRank(pMid, rankRhs, pRight);
+      if (pLeft)
+      {
+         pLeft->pParent = nullptr;
+      }
+      if (pRight)
+      {
+         pRight->pParent = nullptr;
+      }
+      pMid->pLeft = pMid->pRight = nullptr;
+
+      // and cut lhs around it
+      Pieces pieces = splitNodes(pLhs, rankLhs, pMid->data, true /*isThreeWay*/);
+
+      // how big the halves are, exactly if we count subtrees
+      size_t numLess = num / 2;
+      size_t numRest = num / 2;
+      if constexpr (balance::isSized<Balance>::value)
+      {
+         numLess = Balance::size(pieces.pLess) + Balance::size(pLeft);
+         numRest = Balance::size(pieces.pRest) + Balance::size(pRight);
+      }
+
+      auto combineLess = [&]()
+      {
+         return combineNodes(op, pieces.pLess, pieces.rankLess, pLeft, rankLeft, numLess, numSpawn - 1);
+      };
+
+      Subtree less;
+      Subtree rest;
+      std::future<Subtree> futureLess;
+      if (numSpawn > 0 && num >= numParallelCutoff)
+      {
+         try
+         {
+            futureLess = std::async(std::launch::async, combineLess);
+         }
+         catch (const std::system_error&)
+         {
+            // out of threads: just do it here
+         }
+      }
+      rest = combineNodes(op, pieces.pRest, pieces.rankRest, pRight, rankRight, numRest, numSpawn - 1);
+      less = (futureLess.valid() ? futureLess.get() : combineLess());
+
+      // decide which of the two matching nodes, if any, stays
+      size_t numFreed = less.numFreed + rest.numFreed;
+      BNode* pKeep = nullptr;
+      switch (op)
+      {
+      case SetOp::UNION:
+         pKeep = (pieces.pEqual ? pieces.pEqual : pMid);
+         break;
+      case SetOp::INTERSECTION:
+         pKeep = pieces.pEqual;
+         break;
+      case SetOp::DIFFERENCE:
+         break;
+      }
+      if (pMid != pKeep)
+      {
+         deleteNode(alloc(), pMid);
+         numFreed++;
+      }
+      if (pieces.pEqual && pieces.pEqual != pKeep)
+      {
+         deleteNode(alloc(), pieces.pEqual);
+         numFreed++;
+      }
+
+      // everything within each piece is still threaded, but not across
+      // the pieces
+      if (pKeep)
+      {
+         threadSubtrees(less.pRoot, pKeep);
+         threadSubtrees(pKeep, rest.pRoot);
+      }
+      else
+      {
+         threadSubtrees(less.pRoot, rest.pRoot);
+      }
+
+      Subtree subtree = (pKeep ? joinNodes(less, pKeep, rest) : joinNodes(less, rest));
+      subtree.numFreed = numFreed;
+      return subtree;
+   }
+
+   /*****************************************************
+    * BST :: JOIN NODES
+    * Join two subtrees from the set algebra on either side of pMid
+    ****************************************************/
+   template <typename T, typename Balance, typename Compare, typename Allocator>
+   typename BST <T, Balance, Compare, Allocator> ::Subtree BST <T, Balance, Compare, Allocator> ::joinNodes(const Subtree& left, BNode* pMid, const Subtree& right) const
+   {
+      Subtree subtree{ nullptr, 0, 0 };
+      subtree.pRoot = joinNodes(left.pRoot, left.rank, pMid, right.pRoot, right.rank, subtree.rank);
+      return subtree;
+   }
+
+   /*****************************************************
+    * BST :: JOIN NODES
+    * Join two subtrees from the set algebra with nothing between them.
+    * The last node of the left one is cut off its right spine and used
+    * as the middle
+    ****************************************************/
+   template <typename T, typename Balance, typename Compare, typename Allocator>
+   typename BST <T, Balance, Compare, Allocator> ::Subtree BST <T, Balance, Compare, Allocator> ::joinNodes(const Subtree& left, const Subtree& right) const
+   {
+      if (left.pRoot == nullptr || right.pRoot == nullptr)
+      {
+         return (left.pRoot ? Subtree{ left.pRoot, left.rank, 0 } : Subtree{ right.pRoot, right.rank, 0 });
+      }
+
+      // down the right spine to the last node
+      std::vector<std::pair<BNode*, int>> spine;
+      int rank = left.rank;
+      BNode* pLast = left.pRoot;
+      for (; pLast->pRight; pLast = pLast->pRight)
+      {
+         spine.push_back({ pLast, rank });
+         rank = Balance::childRank(pLast, rank, pLast->pRight);
+      }
+
+      // what is left of the last node is all that remains of its subtree
+      Subtree rest{ pLast->pLeft, Balance::childRank(pLast, rank, pLast->pLeft), 0 };
+      if (rest.pRoot)
+      {
+         rest.pRoot->pParent = nullptr;
+      }
+      pLast->pLeft = pLast->pParent = nullptr;
+
+      // and back up, joining each node of the spine with its left subtree
+      for (auto it = spine.rbegin(); it != spine.rend(); ++it)
+      {
+         BNode* p = it->first;
+         Subtree other{ p->pLeft, Balance::childRank(p, it->second, p->pLeft), 0 };
+         if (other.pRoot)
+         {
+            other.pRoot->pParent = nullptr;
+         }
+         p->pLeft = p->pRight = p->pParent = nullptr;
+         rest = joinNodes(other, p, rest);
+      }
+
+      return joinNodes(rest, pLast, right);
+   }
+
+   /*****************************************************
+    * BST :: SPLIT NODES
+    * Cut a detached subtree into the nodes less than key and the rest.
+    * Walk down to where key would go, then come back up joining each
+    * node onto the piece on its side of key. When isThreeWay, a node
+    * equal to key is set aside in pEqual and the walk stops there
+    ****************************************************/
+   template <typename T, typename Balance, typename Compare, typename Allocator>
+   template <class Key>
+   typename BST <T, Balance, Compare, Allocator> ::Pieces BST <T, Balance, Compare, Allocator> ::splitNodes(BNode* pRoot, int rank, const Key& key, bool isThreeWay) const
+   {
+      std::vector<Step> path;
+      Pieces pieces;
+
+      for (BNode* p = pRoot; p != nullptr; )
+      {
+         bool isLess = BST::isLess(p->data, key);
+         if (isThreeWay && !isLess && !BST::isLess(key, p->data))
+         {
+            // everything left of the match is less, everything right is not
+            pieces.pEqual = p;
+            pieces.pLess = p->pLeft;
+            pieces.rankLess = Balance::childRank(p, rank, p->pLeft);
+            pieces.pRest = p->pRight;
+            pieces.rankRest = Balance::childRank(p, rank, p->pRight);
+            if (pieces.pLess)
+            {
+               pieces.pLess->pParent = nullptr;
+            }
+            if (pieces.pRest)
+            {
+               pieces.pRest->pParent = nullptr;
+            }
+            p->pLeft = p->pRight = p->pParent = nullptr;
+            break;
+         }
+
+         BNode* pNext = (isLess ? p->pRight : p->pLeft);
+         path.push_back({ p, rank, isLess });
+         rank = Balance::childRank(p, rank, pNext);
+         p = pNext;
+      }
+
+      joinPath(path, pieces);
+      return pieces;
+   }
+
+   /*****************************************************
+    * BST :: SPLIT BEFORE
+    * Cut the detached subtree holding pNode into the nodes before it
+    * and the rest, by position rather than by value so that a run of
+    * duplicates can be cut anywhere. The path is found by climbing from
+    * pNode, and then joined back up the same way splitNodes() does
+    ****************************************************/
+   template <typename T, typename Balance, typename Compare, typename Allocator>
+   typename BST <T, Balance, Compare, Allocator> ::Pieces BST <T, Balance, Compare, Allocator> ::splitBefore(BNode* pNode) const
+   {
+      assert(pNode != nullptr);
+      std::vector<BNode*> ancestors;
+      for (BNode* p = pNode; p != nullptr; p = p->pParent)
+      {
+         ancestors.push_back(p);
+      }
+
+      // back down from the top, each node going to the side pNode is not on
+      std::vector<Step> path;
+      int rank = Balance::rank(ancestors.back());
+      for (size_t i = ancestors.size() - 1; i > 0; i--)
+      {
+         BNode* p = ancestors[i];
+         BNode* pNext = ancestors[i - 1];
+         path.push_back({ p, rank, p->pRight == pNext });
+         rank = Balance::childRank(p, rank, pNext);
+      }
+
+      // pNode and everything right of it are the rest, all left of it less
+      Pieces pieces;
+      pieces.pLess = pNode->pLeft;
+      pieces.rankLess = Balance::childRank(pNode, rank, pNode->pLeft);
+      if (pieces.pLess)
+      {
+         pieces.pLess->pParent = nullptr;
+      }
+      pNode->pLeft = nullptr;
+      path.push_back({ pNode, rank, false /*isLess*/ });
+
+      joinPath(path, pieces);
+      return pieces;
+   }
+
+   /*****************************************************
+    * BST :: JOIN PATH
+    * Come back up a path from a split, joining each node onto the piece
+    * on its side along with its child off the path
+    ****************************************************/
+   template <typename T, typename Balance, typename Compare, typename Allocator>
+   void BST <T, Balance, Compare, Allocator> ::joinPath(const std::vector<Step>& path, Pieces& pieces) const
+   {
+      for (auto it = path.rbegin(); it != path.rend(); ++it)
+      {
+         // the child off the path goes with the node, on the same side of t
+         BNode* p = it->pNode;
+         BNode* pOther = (it->isLess ? p->pLeft : p->pRight);
+         int rankOther = Balance::childRank(p, it->rank, pOther);
+         if (pOther)
+         {
+            pOther->pParent = nullptr;
+         }
+         p->pLeft = p->pRight = p->pParent = nullptr;
+
+         if (it->isLess)
+         {
+            pieces.pLess = joinNodes(pOther, rankOther, p, pieces.pLess, pieces.rankLess, pieces.rankLess);
+         }
+         else
+         {
+            pieces.pRest = joinNodes(pieces.pRest, pieces.rankRest, p, pOther, rankOther, pieces.rankRest);
+         }
+      }
+   }
+
+   /*****************************************************
+    * BST :: ADOPT
+    * Empty rhs into a tree with our allocator: its nodes when the two
+    * allocators are equal, and otherwise its elements moved into nodes
+    * of our own, since our allocator could not free the ones of rhs
+    ****************************************************/
+   template <typename T, typename Balance, typename Compare, typename Allocator>
+   BST <T, Balance, Compare, Allocator> BST <T, Balance, Compare, Allocator> ::adopt(BST& rhs) const
+   {
+      BST bst(comp(), alloc());
+      if (alloc() == rhs.alloc())
+      {
+         bst.swap(rhs);
+      }
+      else
+      {
+         for (BNode* p = rhs.pLeftmost; p != nullptr; p = (++iterator(p, &rhs)).pNode)
+         {
+            bst.emplace_hint(bst.end(), std::move(p->data));
+         }
+         rhs.clear();
+      }
+      return bst;
+   }
+
+   /*****************************************************
+    * BST :: JOIN
+    * Move every element of lhs and rhs into one tree, leaving both empty.
+    * Nothing in rhs may be less than anything in lhs. The last node of
+    * lhs is taken out and used to join the two in O(log n)
+    ****************************************************/
+   template <typename T, typename Balance, typename Compare, typename Allocator>
+   BST <T, Balance, Compare, Allocator> BST <T, Balance, Compare, Allocator> ::join(BST& lhs, BST& rhs)
+   {
+      BST bst(lhs.comp(), lhs.alloc());
+      BST other = lhs.adopt(rhs);
+      if (lhs.empty() || other.empty())
+      {
+         bst.swap(lhs.empty() ? other : lhs);
+         return bst;
+      }
+      assert(!lhs.isLess(other.pLeftmost->data, lhs.pRightmost->data));
+
+      BNode* pMid = lhs.pRightmost;
+      lhs.unlink(pMid);
+
+      int rank;
+      bst.root = bst.joinNodes(lhs.root, Balance::rank(lhs.root), pMid,
+                               other.root, Balance::rank(other.root), rank);
+      bst.pLeftmost = (lhs.empty() ? pMid : lhs.pLeftmost);
+      bst.pRightmost = other.pRightmost;
+      thread(lhs.pRightmost, pMid);
+      thread(pMid, other.pLeftmost);
+      bst.numElements = lhs.numElements + 1 + other.numElements;
+
+      lhs.root = lhs.pLeftmost = lhs.pRightmost = nullptr;
+      lhs.numElements = 0;
+      other.root = other.pLeftmost = other.pRightmost = nullptr;
+      other.numElements = 0;
+      return bst;
+   }
+
+   /*****************************************************
+    * BST :: JOIN NODES
+    * Let the balancing policy hang pLeft and pRight, two detached
+    * subtrees, on either side of the detached node pMid. Returns the
+    * new top, and its rank through the last parameter
+    ****************************************************/
+   template <typename T, typename Balance, typename Compare, typename Allocator>
+   typename BST <T, Balance, Compare, Allocator> ::BNode* BST <T, Balance, Compare, Allocator> ::joinNodes(BNode* pLeft, int rankLeft, BNode* pMid,
+                                                                 BNode* pRight, int rankRight, int& rank) const
+   {
+      // a tree of our own so the policy can rotate, given back empty
+      BST tree(comp(), alloc());
+      rank = Balance::join(tree, pLeft, rankLeft, pMid, pRight, rankRight);
+      BNode* pTop = tree.root;
+      tree.root = nullptr;
+      return pTop;
+   }
+
+   /*****************************************************
+    * BST :: CLEAR
+    * Removes all the BNodes from a tree. When there is nothing to
+    * destroy and the allocator holds no node but ours, it takes them all
+    * back at once in O(slabs)
+    ****************************************************/
+   template <typename T, typename Balance, typename Compare, typename Allocator>
+   void BST <T, Balance, Compare, Allocator> ::clear() noexcept
+   {
+      if constexpr (std::is_trivially_destructible<BNode>::value &&
+                    canRelease<NodeAllocator>::value)
+      {
+         NodeAllocator nodeAllocator(alloc());
+         if (root && nodeAllocator.release(numElements))
+         {
+            root = nullptr;
+            numElements = 0;
+            pLeftmost = pRightmost = nullptr;
+            return;
+         }
+      }
+
+      if (root)
+      {
+         deleteBinaryTree(root);
+         numElements = 0;
+      }
+      pLeftmost = pRightmost = nullptr;
+   }
+
+   /*****************************************************
+    * BST :: BUILD
+    * Replace the contents of the tree with [first, last). Every node is
+    * allocated before the old tree is touched, the nodes are sorted
+    * unless they already are, and the tree is linked up perfectly
+    * balanced in one pass. O(n) on sorted input, O(n log n) otherwise
+    ****************************************************/
+   template <typename T, typename Balance, typename Compare, typename Allocator>
+   template <class Iterator>
+   void BST <T, Balance, Compare, Allocator> ::build(Iterator first, Iterator last, bool keepUnique)
+   {
+      std::vector<BNode*> nodes;
+      if constexpr (std::is_base_of<std::forward_iterator_tag,
+                    typename std::iterator_traits<Iterator>::iterator_category>::value)
+      {
+         nodes.reserve(std::distance(first, last));
+      }
+
+      try
+      {
+         for (auto it = first; it != last; ++it)
+         {
+            nodes.push_back(newNode(*it));
+         }
+      }
+      catch (...)
+      {
+         for (BNode* pNode : nodes)
+         {
+            deleteNode(alloc(), pNode);
+         }
+         throw "Error: Unable to allocate a node";
+      }
+
+      // input that is already in order needs one comparison per element.
+      // Otherwise sort the nodes rather than the values so nothing is
+      // copied, stable so that the first of several duplicates comes first
+      auto less = [this](const BNode* pLHS, const BNode* pRHS)
+      {
+         return isLess(pLHS->data, pRHS->data);
+      };
+      auto notLess = [&less](const BNode* pLHS, const BNode* pRHS)
+      {
+         return !less(pLHS, pRHS);
+      };
+      bool isReady = (keepUnique ?
+         std::adjacent_find(nodes.begin(), nodes.end(), notLess) == nodes.end() :
+         std::is_sorted(nodes.begin(), nodes.end(), less));
+      if (!isReady)
+      {
+         std::stable_sort(nodes.begin(), nodes.end(), less);
+      }
+
+      // keep only the first of each run of duplicates
+      if (keepUnique && !isReady && !nodes.empty())
+      {
+         size_t numKept = 1;
+         for (size_t i = 1; i < nodes.size(); i++)
+         {
+            if (less(nodes[numKept - 1], nodes[i]))
+            {
+               nodes[numKept++] = nodes[i];
+            }
+            else
+            {
+               deleteNode(alloc(), nodes[i]);
+            }
+         }
+         nodes.resize(numKept);
+      }
+
+      clear();
+      if (nodes.empty())
+      {
+         return;
+      }
+
+      // the number of levels in a perfectly balanced tree of this size
+      int levels = 0;
+      for (size_t num = nodes.size(); num; num >>= 1)
+      {
+         levels++;
+      }
+
+      root = buildBalanced(nodes.data(), nodes.size(), 0, levels);
+      pLeftmost = nodes.front();
+      pRightmost = nodes.back();
+      numElements = nodes.size();
+
+      if constexpr (balance::isThreaded<Balance>::value)
+      {
+         for (size_t i = 0; i <= nodes.size(); i++)
+         {
+            thread(i ? nodes[i - 1] : nullptr, i < nodes.size() ? nodes[i] : nullptr);
+         }
+      }
+   }
+
+   /*****************************************************
+    * BST :: BUILD BALANCED
+    * Hang the middle node over the two halves on either side of it.
+    * The recursion is only as deep as the tree being built
+    ****************************************************/
+   template <typename T, typename Balance, typename Compare, typename Allocator>
+   typename BST <T, Balance, Compare, Allocator> ::BNode* BST <T, Balance, Compare, Allocator> ::buildBalanced(BNode** pNodes, size_t num, int depth, int levels)
+   {
+      if (num == 0)
+      {
+         return nullptr;
+      }
+
+      size_t middle = num / 2;
+      BNode* pNode = pNodes[middle];
+      pNode->addLeft(buildBalanced(pNodes, middle, depth + 1, levels));
+      pNode->addRight(buildBalanced(pNodes + middle + 1, num - middle - 1, depth + 1, levels));
+      Balance::afterBuild(pNode, depth, levels);
+      return pNode;
+   }
+
+   /*****************************************************
+    * BST :: UPDATE EXTREMES
+    * Find the first and last nodes again after the whole tree changed
+    ****************************************************/
+   template <typename T, typename Balance, typename Compare, typename Allocator>
+   void BST <T, Balance, Compare, Allocator> ::updateExtremes() noexcept
+   {
+      pLeftmost = pRightmost = root;
+      if (root == nullptr)
+      {
+         return;
+      }
+
+      while (pLeftmost->pLeft)
+      {
+         pLeftmost = pLeftmost->pLeft;
+      }
+      while (pRightmost->pRight)
+      {
+         pRightmost = pRightmost->pRight;
+      }
+   }
+
+   /*****************************************************
+    * BST :: THREAD NODES
+    * Thread every node onto its neighbors again after the whole tree
+    * changed, in one walk down the tree in order
+    ****************************************************/
+   template <typename T, typename Balance, typename Compare, typename Allocator>
+   void BST <T, Balance, Compare, Allocator> ::threadNodes() noexcept
+   {
+      if constexpr (balance::isThreaded<Balance>::value)
+      {
+         BNode* pPrev = nullptr;
+         BNode* p = pLeftmost;
+         while (p)
+         {
+            thread(pPrev, p);
+            pPrev = p;
+
+            // over to the next node by the shape of the tree
+            if (p->pRight)
+            {
+               for (p = p->pRight; p->pLeft; p = p->pLeft)
+               {
+               }
+            }
+            else
+            {
+               while (p->pParent && p->pParent->pRight == p)
+               {
+                  p = p->pParent;
+               }
+               p = p->pParent;
+            }
          }
+         thread(pPrev, nullptr);
+      }
+   }
+
+   /*****************************************************
+    * BST :: THREAD ENDS
+    * Nothing comes before the first node or after the last one
+    ****************************************************/
+   template <typename T, typename Balance, typename Compare, typename Allocator>
+   void BST <T, Balance, Compare, Allocator> ::threadEnds() noexcept
+   {
+      thread(nullptr, pLeftmost);
+      thread(pRightmost, nullptr);
+   }
 
-         if (pDelete->pRight != pIOS)
+   /*****************************************************
+    * BST :: THREAD
+    * pNext comes right after pPrev. Either may be NULL
+    ****************************************************/
+   template <typename T, typename Balance, typename Compare, typename Allocator>
+   void BST <T, Balance, Compare, Allocator> ::thread(BNode* pPrev, BNode* pNext) noexcept
+   {
+      if constexpr (balance::isThreaded<Balance>::value)
+      {
+         if (pPrev)
          {
-            if (pIOS->pRight)
-            {
-               pIOS->pRight->pParent = pIOS->pParent;
-            }
-            pIOS->pParent->pLeft = pIOS->pRight;
+            pPrev->pNext = pNext;
+         }
+         if (pNext)
+         {
+            pNext->pPrev = pPrev;
+         }
+      }
+   }
 
-            pIOS->pRight = pDelete->pRight;
-            pDelete->pRight->pParent = pIOS;
+   /*****************************************************
+    * BST :: THREAD SUBTREES
+    * The first node under pRight comes right after the last node
+    * under pLeft. O(log n) to find them
+    ****************************************************/
+   template <typename T, typename Balance, typename Compare, typename Allocator>
+   void BST <T, Balance, Compare, Allocator> ::threadSubtrees(BNode* pLeft, BNode* pRight) noexcept
+   {
+      if constexpr (balance::isThreaded<Balance>::value)
+      {
+         while (pLeft && pLeft->pRight)
+         {
+            pLeft = pLeft->pRight;
+         }
+         while (pRight && pRight->pLeft)
+         {
+            pRight = pRight->pLeft;
          }
+         thread(pLeft, pRight);
+      }
+   }
+
+   /****************************************************
+    * BST :: FIND
+    * Return the node whose key matches k
+    ****************************************************/
+   template <typename T, typename Balance, typename Compare, typename Allocator>
+   template <class Key>
+   typename BST <T, Balance, Compare, Allocator> ::iterator BST<T, Balance, Compare, Allocator> ::find(const Key& k)
+   {
+      const auto& key = keyOf(k);
 
-         pIOS->pParent = pDelete->pParent;
-         if (pDelete->pParent && pDelete->pParent->pLeft == pDelete)
+      // one three-way comparison per level
+      if constexpr (isThreeWayOK &&
+                    std::is_same<std::decay_t<decltype(key)>, key_type>::value)
+      {
+         BNode* p = root;
+         while (p != nullptr)
          {
-            pDelete->pParent->pLeft = pIOS;
+            int order = key.compare(keyOf(p->data));
+            if (order == 0)
+            {
+               return iterator(p, this);
+            }
+            p = (order < 0 ? p->pLeft : p->pRight);
          }
-         if (pDelete->pParent && pDelete->pParent->pRight == pDelete)
+         return end();
+      }
+
+      // one operator< per level down to a leaf, then a single check
+      // that the last node not greater than k is not less than k either
+      else
+      {
+         BNode* pNotGreater = nullptr;
+         for (BNode* p = root; p != nullptr; )
          {
-            pDelete->pParent->pRight = pIOS;
+            if (isLess(key, p->data))
+            {
+               p = p->pLeft;
+            }
+            else
+            {
+               pNotGreater = p;
+               p = p->pRight;
+            }
          }
 
-         if (root == pDelete)
+         if (pNotGreater && !isLess(pNotGreater->data, key))
          {
-            root = pIOS;
+            return iterator(pNotGreater, this);
          }
-         itNext = iterator(pIOS);
+         return end();
       }
+   }
 
-      numElements--;
-      delete pDelete;
-      return itNext;
+   /****************************************************
+    * BST :: LOWER BOUND
+    * The first element not less than k, or end()
+    ****************************************************/
+   template <typename T, typename Balance, typename Compare, typename Allocator>
+   template <class Key>
+   typename BST <T, Balance, Compare, Allocator> ::iterator BST <T, Balance, Compare, Allocator> ::lower_bound(const Key& k) const
+   {
+      const auto& key = keyOf(k);
+      BNode* pLower = nullptr;
+      for (BNode* p = root; p != nullptr; )
+      {
+         if (isLess(p->data, key))
+         {
+            p = p->pRight;
+         }
+         else
+         {
+            pLower = p;
+            p = p->pLeft;
+         }
+      }
+      return iterator(pLower, this);
    }
 
-   /*****************************************************
-    * BST :: CLEAR
-    * Removes all the BNodes from a tree
+   /****************************************************
+    * BST :: FIND BATCH
+    * Look up many keys a level at a time, calling found(i, p) with the
+    * node holding keys[i], or nullptr. Each round compares every search
+    * with the node it asked for the round before, then asks for the
+    * next one, so the misses of the whole batch overlap instead of
+    * following one another. Sorted keys go down as one run that splits
+    * where they part ways, so the nodes their paths share are read once
     ****************************************************/
-   template <typename T>
-   void BST <T> ::clear() noexcept
+   template <typename T, typename Balance, typename Compare, typename Allocator>
+   template <class Keys, class Found>
+   void BST <T, Balance, Compare, Allocator> ::findBatch(const Keys& keys, Found found) const
    {
-      if (root)
+      // a run of keys looking under p
+      struct Search
       {
-         deleteBinaryTree(root);
-         numElements = 0;
+         BNode* p;
+         size_t first;
+         size_t last;
+      };
+
+      size_t num = keys.size();
+      std::vector<Search> searches;
+      std::vector<Search> searchesNext;
+      searches.reserve(num);
+      searchesNext.reserve(num);
+
+      bool isSorted = true;
+      for (size_t i = 1; i < num && isSorted; i++)
+         isSorted = !isLess(keys[i], keys[i - 1]);
+      if (isSorted && num > 0)
+         searches.push_back(Search{ root, 0, num });
+      else if (!isSorted)
+         for (size_t i = 0; i < num; i++)
+            searches.push_back(Search{ root, i, i + 1 });
+
+      // the run goes on to p next round, or is done if there is no p
+      auto goDown = [&](BNode* p, size_t first, size_t last)
+      {
+         if (p == nullptr)
+         {
+            for (size_t i = first; i < last; i++)
+               found(i, p);
+            return;
+         }
+         CUSTOM_PREFETCH(p);
+         searchesNext.push_back(Search{ p, first, last });
+      };
+
+      while (!searches.empty())
+      {
+         for (const Search& search : searches)
+         {
+            if (search.p == nullptr)
+            {
+               goDown(nullptr, search.first, search.last);
+               continue;
+            }
+
+            // most runs go all one way
+            const T& data = search.p->data;
+            if (isLess(keys[search.last - 1], data))
+            {
+               goDown(search.p->pLeft, search.first, search.last);
+               continue;
+            }
+            if (isLess(data, keys[search.first]))
+            {
+               goDown(search.p->pRight, search.first, search.last);
+               continue;
+            }
+
+            // the rest split: less than the node, equal to it, greater
+            size_t lo = search.first;
+            size_t hi = search.last;
+            while (lo < hi)
+            {
+               size_t mid = lo + (hi - lo) / 2;
+               if (isLess(keys[mid], data))
+                  lo = mid + 1;
+               else
+                  hi = mid;
+            }
+            size_t equalFirst = lo;
+            hi = search.last;
+            while (lo < hi)
+            {
+               size_t mid = lo + (hi - lo) / 2;
+               if (isLess(data, keys[mid]))
+                  hi = mid;
+               else
+                  lo = mid + 1;
+            }
+            size_t equalLast = lo;
+
+            if (search.first < equalFirst)
+               goDown(search.p->pLeft, search.first, equalFirst);
+            for (size_t i = equalFirst; i < equalLast; i++)
+               found(i, search.p);
+            if (equalLast < search.last)
+               goDown(search.p->pRight, equalLast, search.last);
+         }
+         searches.swap(searchesNext);
+         searchesNext.clear();
       }
    }
 
-   /*****************************************************
-    * BST :: BEGIN
-    * Return the first node (left-most) in a binary search tree
+   /****************************************************
+    * BST :: UPPER BOUND
+    * The first element greater than k, or end()
     ****************************************************/
-   template <typename T>
-   typename BST <T> ::iterator custom::BST <T> ::begin() const noexcept
+   template <typename T, typename Balance, typename Compare, typename Allocator>
+   template <class Key>
+   typename BST <T, Balance, Compare, Allocator> ::iterator BST <T, Balance, Compare, Allocator> ::upper_bound(const Key& k) const
    {
-      if (root == nullptr)
+      const auto& key = keyOf(k);
+      BNode* pUpper = nullptr;
+      for (BNode* p = root; p != nullptr; )
       {
-         return end();
+         if (isLess(key, p->data))
+         {
+            pUpper = p;
+            p = p->pLeft;
+         }
+         else
+         {
+            p = p->pRight;
+         }
       }
+      return iterator(pUpper, this);
+   }
 
+   /****************************************************
+    * BST :: EQUAL RANGE
+    * [lower_bound(k), upper_bound(k)) in one descent. The two bounds
+    * share a path down to the first element equal to k, then one goes
+    * on through its left subtree and the other through its right
+    ****************************************************/
+   template <typename T, typename Balance, typename Compare, typename Allocator>
+   template <class Key>
+   std::pair<typename BST <T, Balance, Compare, Allocator> ::iterator, typename BST <T, Balance, Compare, Allocator> ::iterator>
+      BST <T, Balance, Compare, Allocator> ::equal_range(const Key& k) const
+   {
+      const auto& key = keyOf(k);
+      BNode* pLower = nullptr;
+      BNode* pUpper = nullptr;
       BNode* p = root;
-      while (p->pLeft)
+      while (p != nullptr)
       {
-         p = p->pLeft;
+         if (isLess(key, p->data))
+         {
+            pLower = pUpper = p;
+            p = p->pLeft;
+         }
+         else if (isLess(p->data, key))
+         {
+            p = p->pRight;
+         }
+         else
+         {
+            break;
+         }
+      }
+
+      if (p != nullptr)
+      {
+         pLower = p;
+         for (BNode* pLeft = p->pLeft; pLeft != nullptr; )
+         {
+            if (isLess(pLeft->data, key))
+            {
+               pLeft = pLeft->pRight;
+            }
+            else
+            {
+               pLower = pLeft;
+               pLeft = pLeft->pLeft;
+            }
+         }
+         for (BNode* pRight = p->pRight; pRight != nullptr; )
+         {
+            if (isLess(key, pRight->data))
+            {
+               pUpper = pRight;
+               pRight = pRight->pLeft;
+            }
+            else
+            {
+               pRight = pRight->pRight;
+            }
+         }
       }
-      return iterator(p);
-   }
 
+      return std::make_pair(iterator(pLower, this), iterator(pUpper, this));
+   }
 
    /****************************************************
-    * BST :: FIND
-    * Return the node corresponding to a given value
+    * BST :: RANK
+    * How many elements are less than k, which is also the position
+    * k has or would have in order
     ****************************************************/
-   template <typename T>
-   typename BST <T> ::iterator BST<T> ::find(const T& t)
+   template <typename T, typename Balance, typename Compare, typename Allocator>
+   template <class Key>
+   size_t BST <T, Balance, Compare, Allocator> ::rank(const Key& k) const
    {
-      for (BNode* p = root; p != nullptr; p = (t < p->data ? p->pLeft : p->pRight))
+      static_assert(balance::isSized<Balance>::value, "rank() needs a sized<> Balance policy");
+      const auto& key = keyOf(k);
+
+      size_t numLess = 0;
+      for (BNode* p = root; p != nullptr; )
       {
-         if (p->data == t)
+         if (isLess(p->data, key))
+         {
+            numLess += Balance::size(p->pLeft) + 1;
+            p = p->pRight;
+         }
+         else
          {
-            return iterator(p);
+            p = p->pLeft;
          }
       }
+      return numLess;
+   }
 
+   /****************************************************
+    * BST :: SELECT
+    * The element at position k in order, counting from 0, or end()
+    * if there are not that many
+    ****************************************************/
+   template <typename T, typename Balance, typename Compare, typename Allocator>
+   typename BST <T, Balance, Compare, Allocator> ::iterator BST <T, Balance, Compare, Allocator> ::select(size_t k) const
+   {
+      static_assert(balance::isSized<Balance>::value, "select() needs a sized<> Balance policy");
 
+      BNode* p = root;
+      while (p != nullptr)
+      {
+         size_t numLeft = Balance::size(p->pLeft);
+         if (k == numLeft)
+         {
+            return iterator(p, this);
+         }
+         if (k < numLeft)
+         {
+            p = p->pLeft;
+         }
+         else
+         {
+            k -= numLeft + 1;
+            p = p->pRight;
+         }
+      }
       return end();
    }
 
+   /****************************************************
+    * BST :: COUNT
+    * How many elements are in [lo, hi)
+    ****************************************************/
+   template <typename T, typename Balance, typename Compare, typename Allocator>
+   template <class Key>
+   size_t BST <T, Balance, Compare, Allocator> ::count(const Key& lo, const Key& hi) const
+   {
+      if (!isLess(lo, hi))
+      {
+         return 0;
+      }
+      return rank(hi) - rank(lo);
+   }
+
+   /****************************************************
+    * BST :: INDEX OF
+    * The position of a node in order, found by climbing to the root
+    * and counting everything to its left. end() is at size()
+    ****************************************************/
+   template <typename T, typename Balance, typename Compare, typename Allocator>
+   size_t BST <T, Balance, Compare, Allocator> ::indexOf(const BNode* pNode) const
+   {
+      static_assert(balance::isSized<Balance>::value, "iterator += needs a sized<> Balance policy");
+
+      if (pNode == nullptr)
+      {
+         return numElements;
+      }
+
+      size_t index = Balance::size(pNode->pLeft);
+      for (; pNode->pParent; pNode = pNode->pParent)
+      {
+         if (pNode->pParent->pRight == pNode)
+         {
+            index += Balance::size(pNode->pParent->pLeft) + 1;
+         }
+      }
+      return index;
+   }
+
    /******************************************************
     ******************************************************
     ******************************************************
@@ -669,8 +2596,8 @@ namespace custom
      * BINARY NODE :: ADD LEFT
      * Add a node to the left of the current node
      ******************************************************/
-   template <typename T>
-   void BST <T> ::BNode::addLeft(BNode* pNode)
+   template <typename T, typename Balance, typename Compare, typename Allocator>
+   void BST <T, Balance, Compare, Allocator> ::BNode::addLeft(BNode* pNode)
    {
       pLeft = pNode;
       if (pNode)
@@ -681,8 +2608,8 @@ namespace custom
     * BINARY NODE :: ADD RIGHT
     * Add a node to the right of the current node
     ******************************************************/
-   template <typename T>
-   void BST <T> ::BNode::addRight(BNode* pNode)
+   template <typename T, typename Balance, typename Compare, typename Allocator>
+   void BST <T, Balance, Compare, Allocator> ::BNode::addRight(BNode* pNode)
    {
       pRight = pNode;
       if (pNode)
@@ -693,8 +2620,8 @@ namespace custom
     * BINARY NODE :: ADD LEFT
     * Add a node to the left of the current node
     ******************************************************/
-   template <typename T>
-   void BST<T> ::BNode::addLeft(const T& t)
+   template <typename T, typename Balance, typename Compare, typename Allocator>
+   void BST<T, Balance, Compare, Allocator> ::BNode::addLeft(const T& t)
    {
       BNode* pNode = new BNode(t);
       addLeft(pNode);
@@ -704,30 +2631,30 @@ namespace custom
     * BINARY NODE :: ADD LEFT
     * Add a node to the left of the current node
     ******************************************************/
-   template <typename T>
-   void BST<T> ::BNode::addLeft(T&& t)
+   template <typename T, typename Balance, typename Compare, typename Allocator>
+   void BST<T, Balance, Compare, Allocator> ::BNode::addLeft(T&& t)
    {
-      BNode* pNode = new BNode(t);
-      addRight(pNode);
+      BNode* pNode = new BNode(std::move(t));
+      addLeft(pNode);
    }
 
    /******************************************************
     * BINARY NODE :: ADD RIGHT
     * Add a node to the right of the current node
     ******************************************************/
-   template <typename T>
-   void BST <T> ::BNode::addRight(const T& t)
+   template <typename T, typename Balance, typename Compare, typename Allocator>
+   void BST <T, Balance, Compare, Allocator> ::BNode::addRight(const T& t)
    {
-      BNode* pNode = new BNode(std::move(t));
-      addLeft(pNode);
+      BNode* pNode = new BNode(t);
+      addRight(pNode);
    }
 
    /******************************************************
     * BINARY NODE :: ADD RIGHT
     * Add a node to the right of the current node
     ******************************************************/
-   template <typename T>
-   void BST <T> ::BNode::addRight(T&& t)
+   template <typename T, typename Balance, typename Compare, typename Allocator>
+   void BST <T, Balance, Compare, Allocator> ::BNode::addRight(T&& t)
    {
       BNode* pNode = new BNode(std::move(t));
       addRight(pNode);
@@ -747,13 +2674,18 @@ namespace custom
      * BST ITERATOR :: INCREMENT PREFIX
      * advance by one
      *************************************************/
-   template <typename T>
-   typename BST <T> ::iterator& BST <T> ::iterator :: operator ++ ()
+   template <typename T, typename Balance, typename Compare, typename Allocator>
+   typename BST <T, Balance, Compare, Allocator> ::iterator& BST <T, Balance, Compare, Allocator> ::iterator :: operator ++ ()
    {
       if (this->pNode == nullptr)
       {
          return *this;
       }
+      if constexpr (balance::isThreaded<Balance>::value)
+      {
+         this->pNode = this->pNode->pNext;
+         return *this;
+      }
       BST::BNode* pCurrent = this->pNode;
       if (pCurrent->pRight)
       {
@@ -767,14 +2699,14 @@ namespace custom
 
       }
 
-      if (pCurrent->pRight == nullptr && pCurrent->pParent->pLeft == pCurrent)
+      if (pCurrent->pParent && pCurrent->pParent->pLeft == pCurrent)
       {
          pCurrent = pCurrent->pParent;
          this->pNode = pCurrent;
          return *this;
       }
 
-      if (pCurrent->pRight == nullptr && pCurrent->pParent->pRight == pCurrent)
+      if (pCurrent->pParent && pCurrent->pParent->pRight == pCurrent)
       {
          while (pCurrent->pParent && pCurrent->pParent->pRight == pCurrent)
          {
@@ -795,12 +2727,21 @@ namespace custom
     * BST ITERATOR :: DECREMENT PREFIX
     * advance by one
     *************************************************/
-   template <typename T>
-   typename BST <T> ::iterator& BST <T> ::iterator :: operator -- ()
+   template <typename T, typename Balance, typename Compare, typename Allocator>
+   typename BST <T, Balance, Compare, Allocator> ::iterator& BST <T, Balance, Compare, Allocator> ::iterator :: operator -- ()
    {
-
+      // back up from end() to the last node
       if (this->pNode == nullptr)
       {
+         if (pBST)
+         {
+            this->pNode = pBST->pRightmost;
+         }
+         return *this;
+      }
+      if constexpr (balance::isThreaded<Balance>::value)
+      {
+         this->pNode = this->pNode->pPrev;
          return *this;
       }
       BST::BNode* pCurrent = this->pNode;
@@ -816,14 +2757,14 @@ namespace custom
 
       }
 
-      if (pCurrent->pLeft == nullptr && pCurrent->pParent->pRight == pCurrent)
+      if (pCurrent->pParent && pCurrent->pParent->pRight == pCurrent)
       {
          pCurrent = pCurrent->pParent;
          this->pNode = pCurrent;
          return *this;
       }
 
-      if (pCurrent->pLeft == nullptr && pCurrent->pParent->pLeft == pCurrent)
+      if (pCurrent->pParent && pCurrent->pParent->pLeft == pCurrent)
       {
          while (pCurrent->pParent && pCurrent->pParent->pLeft == pCurrent)
          {
@@ -833,93 +2774,210 @@ namespace custom
          this->pNode = pCurrent;
          return *this;
       }
-      return *this;
 
+      // the root was the first node, so there is nothing before it
+      this->pNode = nullptr;
+      return *this;
    }
 
 
-   template <typename T>
-   void BST <T> ::deleteNode(BNode*& pDelete, bool toRight)
-   {
-      BNode* pNext = (toRight ? pDelete->pRight : pDelete->pLeft);
+   /*************************************************
+    *************************************************
+    *************************************************
+    **************** ROTATION **********************
+    *************************************************
+    *************************************************
+    *************************************************/
 
-      if (pDelete != root)
+    /**************************************************
+     * BST :: REPLACE CHILD
+     * Put pNew where pOld hangs in the tree. pNew may be NULL
+     *************************************************/
+   template <typename T, typename Balance, typename Compare, typename Allocator>
+   void BST <T, Balance, Compare, Allocator> ::replaceChild(BNode* pOld, BNode* pNew)
+   {
+      BNode* pParent = pOld->pParent;
+      if (pNew)
       {
-         if (pDelete->pParent->pLeft == pDelete)
-         {
-            pDelete->pParent->pLeft = nullptr;
-            pDelete->pParent->addLeft(pNext);
-         }
-         else
-         {
-            pDelete->pParent->pRight = nullptr;
-            pDelete->pParent->addRight(pNext);
-         }
+         pNew->pParent = pParent;
       }
 
+      if (pParent == nullptr)
+      {
+         root = pNew;
+      }
+      else if (pParent->pLeft == pOld)
+      {
+         pParent->pLeft = pNew;
+      }
       else
       {
-         root = pNext;
-         pNext->pParent = nullptr;
+         pParent->pRight = pNew;
       }
    }
 
-   template <typename T>
-   void BST <T> ::deleteBinaryTree(BNode*& pDelete) noexcept
+   /**************************************************
+    * BST :: ROTATE LEFT
+    *        (a)               (b)
+    *       /   \             /   \
+    *     ...   (b)    ->   (a)   ...
+    *           /             \
+    *         (c)             (c)
+    *************************************************/
+   template <typename T, typename Balance, typename Compare, typename Allocator>
+   void BST <T, Balance, Compare, Allocator> ::rotateLeft(BNode* pNode)
    {
-      if (pDelete == nullptr)
-         return;
-      deleteBinaryTree(pDelete->pLeft);
-      deleteBinaryTree(pDelete->pRight);
+      BNode* pPivot = pNode->pRight;
+      assert(pPivot != nullptr);
 
-      delete pDelete;
-      pDelete = nullptr;
+      pNode->addRight(pPivot->pLeft);
+      replaceChild(pNode, pPivot);
+      pPivot->addLeft(pNode);
+      Balance::afterRotate(pNode, pPivot);
    }
 
-   template <typename T>
-   void BST <T> ::copyBinaryTree(const BNode* pSrc, BNode*& pDest)
+   /**************************************************
+    * BST :: ROTATE RIGHT
+    *          (a)          (b)
+    *         /   \        /   \
+    *       (b)   ...  -> ...   (a)
+    *         \                 /
+    *         (c)             (c)
+    *************************************************/
+   template <typename T, typename Balance, typename Compare, typename Allocator>
+   void BST <T, Balance, Compare, Allocator> ::rotateRight(BNode* pNode)
    {
-      if (nullptr == pSrc)
+      BNode* pPivot = pNode->pLeft;
+      assert(pPivot != nullptr);
+
+      pNode->addLeft(pPivot->pRight);
+      replaceChild(pNode, pPivot);
+      pPivot->addRight(pNode);
+      Balance::afterRotate(pNode, pPivot);
+   }
+
+   /*****************************************************
+    * BST :: DELETE BINARY TREE
+    * Free every node of a subtree. Rather than recursing once per level,
+    * rotate left children up until the current node has none, then free
+    * it and move to its right. Constant extra space and O(n), no matter
+    * how deep the tree is
+    ****************************************************/
+   template <typename T, typename Balance, typename Compare, typename Allocator>
+   size_t BST <T, Balance, Compare, Allocator> ::deleteBinaryTree(BNode*& pDelete) const noexcept
+   {
+      size_t numFreed = 0;
+      BNode* p = pDelete;
+      while (p != nullptr)
       {
-         deleteBinaryTree(pDest);
-         return;
+         if (p->pLeft)
+         {
+            BNode* pLeft = p->pLeft;
+            p->pLeft = pLeft->pRight;
+            pLeft->pRight = p;
+            p = pLeft;
+         }
+         else
+         {
+            BNode* pRight = p->pRight;
+            deleteNode(alloc(), p);
+            numFreed++;
+            p = pRight;
+         }
       }
+      pDelete = nullptr;
+      return numFreed;
+   }
 
-      assert(pSrc);
-
+   /*****************************************************
+    * BST :: COPY NODE
+    * Fill pDest with a copy of pSrc, allocating it if there is no
+    * node to reuse
+    ****************************************************/
+   template <typename T, typename Balance, typename Compare, typename Allocator>
+   void BST <T, Balance, Compare, Allocator> ::copyNode(const BNode* pSrc, BNode*& pDest)
+   {
       try
       {
          if (nullptr == pDest)
          {
-            pDest = new BST::BNode(pSrc->data);
+            pDest = newNode(pSrc->data);
          }
          else
          {
             pDest->data = pSrc->data;
          }
+         static_cast<typename Balance::NodeData&>(*pDest) = *pSrc;
       }
       catch (...)
       {
          throw "ERROR: Unable to allocate a node";
       }
-      assert(pDest != nullptr);
-
-      copyBinaryTree(pSrc->pLeft, pDest->pLeft);
-      if (pSrc->pLeft)
-      {
-         pDest->pLeft->pParent = pDest;
-      }
+   }
 
-      copyBinaryTree(pSrc->pRight, pDest->pRight);
-      if (pSrc->pRight)
+   /*****************************************************
+    * BST :: COPY BINARY TREE
+    * Make pDest a copy of pSrc, reusing the nodes already in pDest.
+    * Both trees are walked in lockstep in one pre-order pass, climbing
+    * back up with the parent pointers instead of recursing
+    ****************************************************/
+   template <typename T, typename Balance, typename Compare, typename Allocator>
+   void BST <T, Balance, Compare, Allocator> ::copyBinaryTree(const BNode* pSrc, BNode*& pDest)
+   {
+      if (nullptr == pSrc)
       {
-         pDest->pRight->pParent = pDest;
+         deleteBinaryTree(pDest);
+         return;
       }
 
-   }
+      copyNode(pSrc, pDest);
+      assert(pDest != nullptr);
 
+      const BNode* s = pSrc;        // the node being copied
+      BNode* d = pDest;             // where it is being copied to
+      const BNode* sFrom = nullptr; // the child of s we just came up from
+      while (true)
+      {
+         // first time here: copy the left subtree
+         if (sFrom == nullptr)
+         {
+            if (s->pLeft)
+            {
+               copyNode(s->pLeft, d->pLeft);
+               d->pLeft->pParent = d;
+               s = s->pLeft;
+               d = d->pLeft;
+               continue;
+            }
+            deleteBinaryTree(d->pLeft);
+            sFrom = s->pLeft;
+         }
 
+         // left subtree done: copy the right subtree
+         if (sFrom == s->pLeft)
+         {
+            if (s->pRight)
+            {
+               copyNode(s->pRight, d->pRight);
+               d->pRight->pParent = d;
+               s = s->pRight;
+               d = d->pRight;
+               sFrom = nullptr;
+               continue;
+            }
+            deleteBinaryTree(d->pRight);
+         }
 
+         // both subtrees done: go back up
+         if (s == pSrc)
+         {
+            break;
+         }
+         sFrom = s;
+         s = s->pParent;
+         d = d->pParent;
+      }
+   }
 
 } // namespace custom
 
@@ -0,0 +1,1387 @@
+/***********************************************************************
+ * Header:
+ *    BTREE
+ * Summary:
+ *    A B+-tree to hold the pairs of a map, picked through the Balance
+ *    parameter of the map:
+ *        custom::map<K, V, custom::balance::btree<>>
+ *      __       ____       ____         __
+ *     /  |    .'    '.   .'    '.   _  / /
+ *     `| |   |  .--.  | |  .--.  | (_)/ /
+ *      | |   | |    | | | |    | |   / / _
+ *     _| |_  |  `--'  | |  `--'  |  / / (_)
+ *    |_____|  '.____.'   '.____.'  /_/
+ *
+ *    This will contain the class definition of:
+ *        balance::btree      : Asks map for a B+-tree with nodes of about
+ *                              nodeBytes each: 256 is four cache lines,
+ *                              4096 is a page
+ *        BTree               : The tree. The pairs are in the leaves, in
+ *                              order and linked end to end; the inner
+ *                              nodes hold only keys to steer by
+ *        BTree::iterator     : A leaf and a place in it
+ *        map<K, V, btree>    : The map interface over a BTree
+ *
+ *    One node holds dozens of keys side by side, so a lookup touches one
+ *    node per level instead of one per key compared, and a scan walks
+ *    whole leaves. As in any B-tree, elements move between nodes as the
+ *    tree changes: an insert or erase invalidates every iterator, and
+ *    erase(it) hands back one that is good again
+ * Author
+ *    Sam Heaven, Abram Hansen
+ ************************************************************************/
+
+#pragma once
+
+#include "map.h"      // for map, pair, frozenMap and Holder
+#include <cassert>
+#include <cstdint>    // for uint16_t
+#include <memory>     // for std::allocator_traits
+#include <new>        // for std::launder
+#include <stdexcept>  // for std::out_of_range
+#include <iterator>   // for std::reverse_iterator
+#include <algorithm>  // for std::max
+#include <utility>    // for std::move
+
+class TestMap; // forward declaration for unit tests
+class BenchBST; // forward declaration for benchmarks
+
+namespace custom
+{
+namespace balance
+{
+
+   /*****************************************************************
+    * BTREE
+    * Not a policy for the BST: given to a map, it trades the BST for a
+    * BTree whose nodes are about nodeBytes each
+    *****************************************************************/
+   template <size_t nodeBytes = 256>
+   struct btree
+   {
+      static const size_t bytes = nodeBytes;
+   };
+
+} // namespace balance
+
+   /*****************************************************************
+    * BTREE
+    * A B+-tree of pair<K, V> with unique keys. Every leaf is at the same
+    * depth, and every node but the root is at least half full
+    *****************************************************************/
+   template <class K, class V, class Compare, class Allocator, size_t nodeBytes>
+   class BTree : private Holder<Compare, 0>, private Holder<Allocator, 1>
+   {
+      friend class ::TestMap; // give unit tests access to the privates
+      friend class ::BenchBST;
+      template <class KK, class VV, class BB, class CC, class AA>
+      friend class map;
+      using CompareHolder = Holder<Compare, 0>;
+      using AllocatorHolder = Holder<Allocator, 1>;
+      struct Node;
+      struct Leaf;
+      struct Inner;
+   public:
+      using Pairs = custom::pair<K, V>;
+
+      // as many as fit in nodeBytes, and never fewer than four
+      static constexpr size_t leafMax = std::max<size_t>(4,
+         (nodeBytes - 3 * sizeof(void*)) / sizeof(Pairs));
+      static constexpr size_t innerMax = std::max<size_t>(4,
+         (nodeBytes - 2 * sizeof(void*)) / (sizeof(K) + sizeof(void*)));
+      static constexpr size_t leafMin = leafMax / 2;
+      static constexpr size_t innerMin = innerMax / 2;
+      static_assert(leafMax < 65536 && innerMax < 65536, "a node counts its keys in 16 bits");
+
+      //
+      // Construct
+      //
+
+      BTree() : root(nullptr), pFirst(nullptr), pLast(nullptr), numElements(0)
+      {
+      }
+      explicit BTree(const Compare& compare, const Allocator& allocator = Allocator())
+         : CompareHolder(compare), AllocatorHolder(allocator),
+           root(nullptr), pFirst(nullptr), pLast(nullptr), numElements(0)
+      {
+      }
+      BTree(const BTree& rhs);
+      BTree(BTree&& rhs) noexcept : BTree(rhs.comp(), rhs.alloc())
+      {
+         swap(rhs);
+      }
+      ~BTree()
+      {
+         clear();
+      }
+
+      //
+      // Assign
+      //
+
+      BTree& operator = (const BTree& rhs)
+      {
+         if (this != &rhs)
+         {
+            BTree copy(rhs);
+            swap(copy);
+         }
+         return *this;
+      }
+      BTree& operator = (BTree&& rhs) noexcept
+      {
+         clear();
+         swap(rhs);
+         return *this;
+      }
+      void swap(BTree& rhs) noexcept;
+
+      //
+      // Iterator
+      //
+
+      class iterator;
+      iterator begin() const { return iterator(this, pFirst, 0); }
+      iterator end()   const { return iterator(this, nullptr, 0); }
+
+      //
+      // Access
+      //
+
+      Compare key_comp() const { return comp(); }
+      Allocator get_allocator() const noexcept { return alloc(); }
+
+      template <class KK>
+      iterator find(const KK& k) const;
+      template <class KK>
+      iterator lower_bound(const KK& k) const;
+      template <class KK>
+      iterator upper_bound(const KK& k) const;
+
+      //
+      // Insert
+      //
+
+      // look for k, and only if it is missing build a pair from args
+      template <class KK, class ... Args>
+      std::pair<iterator, bool> tryEmplace(const KK& k, Args&& ... args);
+
+      //
+      // Remove
+      //
+
+      void clear() noexcept;
+      iterator erase(iterator it);
+
+      //
+      // Status
+      //
+
+      bool empty() const noexcept { return numElements == 0; }
+      size_t size() const noexcept { return numElements; }
+
+   private:
+      // a tree of n elements is at most about log(n) / log(innerMin + 1)
+      // deep, so this holds any tree that fits in memory
+      static constexpr int maxDepth = 48;
+
+      // the inner nodes on the way down to a leaf, and the child taken
+      struct Path
+      {
+         Inner* nodes[maxDepth];
+         size_t indices[maxDepth];
+         int depth;           // index of the last inner node, -1 if none
+      };
+
+      using LeafAllocator = typename std::allocator_traits<Allocator>::template rebind_alloc<Leaf>;
+      using InnerAllocator = typename std::allocator_traits<Allocator>::template rebind_alloc<Inner>;
+
+      const Compare& comp() const noexcept { return CompareHolder::get(); }
+      const Allocator& alloc() const noexcept { return AllocatorHolder::get(); }
+
+      //
+      // Search
+      //
+
+      template <class KK>
+      size_t childIndex(const Inner* pInner, const KK& k) const;
+      template <class KK>
+      size_t lowerIndex(const Leaf* pLeaf, const KK& k) const;
+      template <class KK>
+      Leaf* descend(const KK& k, Path* pPath) const;
+      iterator normalize(Leaf* pLeaf, size_t index) const;
+
+      //
+      // Grow and shrink
+      //
+
+      template <class ... Args>
+      iterator insertAt(Leaf* pLeaf, size_t index, Path& path, Args&& ... args);
+      void insertSeparator(Path& path, K&& key, Node* pChild, Inner** pSpares);
+      void insertKey(Inner* pInner, size_t index, K&& key, Node* pChild);
+      void rebalanceLeaf(Leaf*& pLeaf, size_t& index, Path& path);
+      void rebalanceInner(Path& path);
+
+      //
+      // Nodes
+      //
+
+      Leaf* newLeaf() const;
+      Inner* newInner() const;
+      void deleteLeaf(Leaf* pLeaf) const noexcept;
+      void deleteInner(Inner* pInner) const noexcept;
+      void deleteNodes(Node* pNode) noexcept;
+      Node* copyNodes(const Node* pSrc, Leaf*& pPrev);
+      void unlinkLeaf(Leaf* pLeaf) noexcept;
+
+      // move num things from pSrc to pDest, which does not overlap it
+      template <class T>
+      static void moveRange(T* pDest, T* pSrc, size_t num);
+      // open a hole at index in an array of num things
+      template <class T>
+      static void openHole(T* p, size_t num, size_t index);
+      // and close one
+      template <class T>
+      static void closeHole(T* p, size_t num, size_t index);
+
+      Node* root;             // top of the tree, or nullptr
+      Leaf* pFirst;           // leaf with the smallest keys
+      Leaf* pLast;            // leaf with the largest keys
+      size_t numElements;     // pairs in the tree
+   };
+
+   /*****************************************************************
+    * BTREE :: NODE
+    * What a leaf and an inner node have in common: how many keys
+    *****************************************************************/
+   template <class K, class V, class Compare, class Allocator, size_t nodeBytes>
+   struct BTree <K, V, Compare, Allocator, nodeBytes> ::Node
+   {
+      uint16_t num;           // pairs in a leaf, keys in an inner node
+      bool isLeaf;
+   };
+
+   /*****************************************************************
+    * BTREE :: LEAF
+    * Up to leafMax pairs in order, and the leaves on either side.
+    * Only the first num slots have a pair built in them
+    *****************************************************************/
+   template <class K, class V, class Compare, class Allocator, size_t nodeBytes>
+   struct BTree <K, V, Compare, Allocator, nodeBytes> ::Leaf : public Node
+   {
+      Leaf() : Node{ 0, true }, pPrev(nullptr), pNext(nullptr) {}
+
+      Pairs* slots() { return std::launder(reinterpret_cast<Pairs*>(buffer)); }
+      const Pairs* slots() const { return std::launder(reinterpret_cast<const Pairs*>(buffer)); }
+
+      Leaf* pPrev;
+      Leaf* pNext;
+      alignas(Pairs) unsigned char buffer[sizeof(Pairs) * leafMax];
+   };
+
+   /*****************************************************************
+    * BTREE :: INNER
+    * num keys and num + 1 children. Every key in children[i] is at least
+    * keys[i - 1] and less than keys[i]
+    *****************************************************************/
+   template <class K, class V, class Compare, class Allocator, size_t nodeBytes>
+   struct BTree <K, V, Compare, Allocator, nodeBytes> ::Inner : public Node
+   {
+      Inner() : Node{ 0, false } {}
+
+      K* keys() { return std::launder(reinterpret_cast<K*>(buffer)); }
+      const K* keys() const { return std::launder(reinterpret_cast<const K*>(buffer)); }
+
+      alignas(K) unsigned char buffer[sizeof(K) * innerMax];
+      Node* children[innerMax + 1];
+   };
+
+   /**********************************************************
+    * BTREE ITERATOR
+    * A leaf and the index of a pair in it. Stepping off the end
+    * of a leaf goes on to the next; end() has no leaf
+    *********************************************************/
+   template <class K, class V, class Compare, class Allocator, size_t nodeBytes>
+   class BTree <K, V, Compare, Allocator, nodeBytes> ::iterator
+   {
+      friend class ::TestMap; // give unit tests access to the privates
+      friend class BTree;
+      template <class KK, class VV, class BB, class CC, class AA>
+      friend class map;
+   public:
+      using iterator_category = std::bidirectional_iterator_tag;
+      using value_type        = pair <K, V>;
+      using difference_type   = std::ptrdiff_t;
+      using pointer           = const pair <K, V> *;
+      using reference         = const pair <K, V> &;
+
+      //
+      // Construct
+      //
+      iterator() : pTree(nullptr), pLeaf(nullptr), index(0)
+      {
+      }
+
+      //
+      // Compare
+      //
+      bool operator == (const iterator& rhs) const { return pLeaf == rhs.pLeaf && index == rhs.index; }
+      bool operator != (const iterator& rhs) const { return !(*this == rhs); }
+
+      //
+      // Access
+      //
+      const pair <K, V>& operator * () const
+      {
+         return pLeaf->slots()[index];
+      }
+      const pair <K, V>* operator -> () const
+      {
+         return pLeaf->slots() + index;
+      }
+
+      //
+      // Increment
+      //
+      iterator& operator ++ ()
+      {
+         if (++index == pLeaf->num)
+         {
+            pLeaf = pLeaf->pNext;
+            index = 0;
+         }
+         return *this;
+      }
+      iterator operator ++ (int postfix)
+      {
+         iterator itReturn = *this;
+         ++(*this);
+         return itReturn;
+      }
+      iterator& operator -- ()
+      {
+         if (pLeaf == nullptr || index == 0)
+         {
+            pLeaf = (pLeaf ? pLeaf->pPrev : pTree->pLast);
+            index = pLeaf->num;
+         }
+         index--;
+         return *this;
+      }
+      iterator operator -- (int postfix)
+      {
+         iterator itReturn = *this;
+         --(*this);
+         return itReturn;
+      }
+
+   private:
+      iterator(const BTree* pTree, Leaf* pLeaf, size_t index) : pTree(pTree), pLeaf(pLeaf), index(index)
+      {
+      }
+
+      const BTree* pTree;     // the tree, for the last leaf when stepping back from end()
+      Leaf* pLeaf;            // leaf holding the pair, or nullptr at the end
+      size_t index;           // place of the pair in the leaf
+   };
+
+   /*****************************************************
+    * BTREE :: COPY CONSTRUCTOR
+    * Copy node for node, so no key is compared
+    ****************************************************/
+   template <class K, class V, class Compare, class Allocator, size_t nodeBytes>
+   BTree <K, V, Compare, Allocator, nodeBytes> ::BTree(const BTree& rhs)
+      : CompareHolder(rhs.comp()),
+        AllocatorHolder(std::allocator_traits<Allocator>::select_on_container_copy_construction(rhs.alloc())),
+        root(nullptr), pFirst(nullptr), pLast(nullptr), numElements(0)
+   {
+      Leaf* pPrev = nullptr;
+      root = copyNodes(rhs.root, pPrev);
+      pLast = pPrev;
+      numElements = rhs.numElements;
+   }
+
+   /*****************************************************
+    * BTREE :: SWAP
+    * Trade nodes, comparators and allocators
+    ****************************************************/
+   template <class K, class V, class Compare, class Allocator, size_t nodeBytes>
+   void BTree <K, V, Compare, Allocator, nodeBytes> ::swap(BTree& rhs) noexcept
+   {
+      using std::swap;
+      swap(CompareHolder::get(), rhs.CompareHolder::get());
+      swap(AllocatorHolder::get(), rhs.AllocatorHolder::get());
+      swap(root, rhs.root);
+      swap(pFirst, rhs.pFirst);
+      swap(pLast, rhs.pLast);
+      swap(numElements, rhs.numElements);
+   }
+
+   /*****************************************************
+    * BTREE :: CHILD INDEX
+    * Which child of an inner node k is under: the number of keys that
+    * are not greater than k, by binary search
+    ****************************************************/
+   template <class K, class V, class Compare, class Allocator, size_t nodeBytes>
+   template <class KK>
+   size_t BTree <K, V, Compare, Allocator, nodeBytes> ::childIndex(const Inner* pInner, const KK& k) const
+   {
+      const K* keys = pInner->keys();
+      size_t lo = 0;
+      size_t hi = pInner->num;
+      while (lo < hi)
+      {
+         size_t mid = (lo + hi) / 2;
+         if (comp()(k, keys[mid]))
+            hi = mid;
+         else
+            lo = mid + 1;
+      }
+      return lo;
+   }
+
+   /*****************************************************
+    * BTREE :: LOWER INDEX
+    * The first pair in a leaf whose key is not less than k
+    ****************************************************/
+   template <class K, class V, class Compare, class Allocator, size_t nodeBytes>
+   template <class KK>
+   size_t BTree <K, V, Compare, Allocator, nodeBytes> ::lowerIndex(const Leaf* pLeaf, const KK& k) const
+   {
+      const Pairs* slots = pLeaf->slots();
+      size_t lo = 0;
+      size_t hi = pLeaf->num;
+      while (lo < hi)
+      {
+         size_t mid = (lo + hi) / 2;
+         if (comp()(slots[mid].first, k))
+            lo = mid + 1;
+         else
+            hi = mid;
+      }
+      return lo;
+   }
+
+   /*****************************************************
+    * BTREE :: DESCEND
+    * The leaf where k is or would be, remembering the way down in pPath
+    * if asked. The tree is not empty
+    ****************************************************/
+   template <class K, class V, class Compare, class Allocator, size_t nodeBytes>
+   template <class KK>
+   typename BTree <K, V, Compare, Allocator, nodeBytes> ::Leaf* BTree <K, V, Compare, Allocator, nodeBytes> ::descend(const KK& k, Path* pPath) const
+   {
+      if (pPath)
+         pPath->depth = -1;
+      Node* pNode = root;
+      while (!pNode->isLeaf)
+      {
+         Inner* pInner = static_cast<Inner*>(pNode);
+         size_t index = childIndex(pInner, k);
+         if (pPath)
+         {
+            pPath->depth++;
+            pPath->nodes[pPath->depth] = pInner;
+            pPath->indices[pPath->depth] = index;
+         }
+         pNode = pInner->children[index];
+      }
+      return static_cast<Leaf*>(pNode);
+   }
+
+   /*****************************************************
+    * BTREE :: NORMALIZE
+    * An iterator to a place in a leaf, which may be one past its last
+    * pair, meaning the first pair of the next leaf
+    ****************************************************/
+   template <class K, class V, class Compare, class Allocator, size_t nodeBytes>
+   typename BTree <K, V, Compare, Allocator, nodeBytes> ::iterator BTree <K, V, Compare, Allocator, nodeBytes> ::normalize(Leaf* pLeaf, size_t index) const
+   {
+      if (pLeaf && index == pLeaf->num)
+         return iterator(this, pLeaf->pNext, 0);
+      return iterator(this, pLeaf, index);
+   }
+
+   /*****************************************************
+    * BTREE :: FIND
+    ****************************************************/
+   template <class K, class V, class Compare, class Allocator, size_t nodeBytes>
+   template <class KK>
+   typename BTree <K, V, Compare, Allocator, nodeBytes> ::iterator BTree <K, V, Compare, Allocator, nodeBytes> ::find(const KK& k) const
+   {
+      if (root == nullptr)
+         return end();
+      Leaf* pLeaf = descend(k, nullptr);
+      size_t index = lowerIndex(pLeaf, k);
+      if (index < pLeaf->num && !comp()(k, pLeaf->slots()[index].first))
+         return iterator(this, pLeaf, index);
+      return end();
+   }
+
+   /*****************************************************
+    * BTREE :: LOWER BOUND
+    * The first pair whose key is not less than k. An inner key equal
+    * to k sends us right, to the leaf that starts with k
+    ****************************************************/
+   template <class K, class V, class Compare, class Allocator, size_t nodeBytes>
+   template <class KK>
+   typename BTree <K, V, Compare, Allocator, nodeBytes> ::iterator BTree <K, V, Compare, Allocator, nodeBytes> ::lower_bound(const KK& k) const
+   {
+      if (root == nullptr)
+         return end();
+      Leaf* pLeaf = descend(k, nullptr);
+      return normalize(pLeaf, lowerIndex(pLeaf, k));
+   }
+
+   /*****************************************************
+    * BTREE :: UPPER BOUND
+    * The first pair whose key is greater than k
+    ****************************************************/
+   template <class K, class V, class Compare, class Allocator, size_t nodeBytes>
+   template <class KK>
+   typename BTree <K, V, Compare, Allocator, nodeBytes> ::iterator BTree <K, V, Compare, Allocator, nodeBytes> ::upper_bound(const KK& k) const
+   {
+      if (root == nullptr)
+         return end();
+      Leaf* pLeaf = descend(k, nullptr);
+      size_t index = lowerIndex(pLeaf, k);
+      if (index < pLeaf->num && !comp()(k, pLeaf->slots()[index].first))
+         index++;
+      return normalize(pLeaf, index);
+   }
+
+   /*****************************************************
+    * BTREE :: TRY EMPLACE
+    * Look for k, and only if it is missing build a pair from args in
+    * the leaf where it belongs. The first leaf of an empty tree goes
+    * again if the pair cannot be built in it
+    ****************************************************/
+   template <class K, class V, class Compare, class Allocator, size_t nodeBytes>
+   template <class KK, class ... Args>
+   std::pair<typename BTree <K, V, Compare, Allocator, nodeBytes> ::iterator, bool> BTree <K, V, Compare, Allocator, nodeBytes> ::tryEmplace(const KK& k, Args&& ... args)
+   {
+      if (root == nullptr)
+      {
+         Path path;
+         path.depth = -1;
+         root = pFirst = pLast = newLeaf();
+         try
+         {
+            return std::pair<iterator, bool>(insertAt(pFirst, 0, path, std::forward<Args>(args)...), true);
+         }
+         catch (...)
+         {
+            deleteLeaf(pFirst);
+            root = pFirst = pLast = nullptr;
+            throw;
+         }
+      }
+
+      Path path;
+      Leaf* pLeaf = descend(k, &path);
+      size_t index = lowerIndex(pLeaf, k);
+      if (index < pLeaf->num && !comp()(k, pLeaf->slots()[index].first))
+         return std::pair<iterator, bool>(iterator(this, pLeaf, index), false);
+
+      return std::pair<iterator, bool>(insertAt(pLeaf, index, path, std::forward<Args>(args)...), true);
+   }
+
+   /*****************************************************
+    * BTREE :: INSERT AT
+    * Build a pair at index in a leaf. A full leaf is split in two first,
+    * and the split carried up the path as far as it goes. Every node the
+    * splits need is allocated before anything moves, so running out of
+    * memory leaves the tree as it was
+    ****************************************************/
+   template <class K, class V, class Compare, class Allocator, size_t nodeBytes>
+   template <class ... Args>
+   typename BTree <K, V, Compare, Allocator, nodeBytes> ::iterator BTree <K, V, Compare, Allocator, nodeBytes> ::insertAt(Leaf* pLeaf, size_t index, Path& path, Args&& ... args)
+   {
+      if (pLeaf->num == leafMax)
+      {
+         // one inner node for every full one on the path, and a new root
+         // if they are all full
+         int depth = path.depth;
+         while (depth >= 0 && path.nodes[depth]->num == innerMax)
+            depth--;
+         int numSpares = path.depth - depth + (depth < 0 ? 1 : 0);
+         Inner* pSpares[maxDepth + 1];
+         Leaf* pRight = nullptr;
+         int i = 0;
+         try
+         {
+            pRight = newLeaf();
+            for (; i < numSpares; i++)
+               pSpares[i] = newInner();
+         }
+         catch (...)
+         {
+            if (pRight)
+               deleteLeaf(pRight);
+            while (i > 0)
+               deleteInner(pSpares[--i]);
+            throw;
+         }
+
+         // the upper half goes to a new leaf to the right
+         size_t mid = (leafMax + 1) / 2;
+         moveRange(pRight->slots(), pLeaf->slots() + mid, leafMax - mid);
+         pRight->num = uint16_t(leafMax - mid);
+         pLeaf->num = uint16_t(mid);
+         pRight->pPrev = pLeaf;
+         pRight->pNext = pLeaf->pNext;
+         if (pLeaf->pNext)
+            pLeaf->pNext->pPrev = pRight;
+         else
+            pLast = pRight;
+         pLeaf->pNext = pRight;
+
+         insertSeparator(path, K(pRight->slots()[0].first), pRight, pSpares);
+
+         if (index > mid)
+         {
+            index -= mid;
+            pLeaf = pRight;
+         }
+      }
+
+      // build the pair off to the side if it has to go in the middle,
+      // so a throw leaves no hole
+      Pairs* slots = pLeaf->slots();
+      if (index == pLeaf->num)
+         new (slots + index) Pairs(std::forward<Args>(args)...);
+      else
+      {
+         Pairs pair(std::forward<Args>(args)...);
+         openHole(slots, pLeaf->num, index);
+         new (slots + index) Pairs(std::move(pair));
+      }
+      pLeaf->num++;
+      numElements++;
+      return iterator(this, pLeaf, index);
+   }
+
+   /*****************************************************
+    * BTREE :: INSERT SEPARATOR
+    * Hang pChild right of the child the path took at its bottom, with key
+    * between them. A full inner node splits in half around the middle of
+    * its keys and the new one, and sends that middle key up. The nodes
+    * for the splits and the new root come from pSpares
+    ****************************************************/
+   template <class K, class V, class Compare, class Allocator, size_t nodeBytes>
+   void BTree <K, V, Compare, Allocator, nodeBytes> ::insertSeparator(Path& path, K&& key, Node* pChild, Inner** pSpares)
+   {
+      K keyUp(std::move(key));
+      for (int depth = path.depth; ; depth--)
+      {
+         // the tree grows at the top
+         if (depth < 0)
+         {
+            Inner* pRoot = *pSpares;
+            new (pRoot->keys()) K(std::move(keyUp));
+            pRoot->children[0] = root;
+            pRoot->children[1] = pChild;
+            pRoot->num = 1;
+            root = pRoot;
+            return;
+         }
+
+         // room here: this is as far as it goes
+         Inner* pInner = path.nodes[depth];
+         size_t index = path.indices[depth];
+         if (pInner->num < innerMax)
+         {
+            insertKey(pInner, index, std::move(keyUp), pChild);
+            return;
+         }
+
+         // of the innerMax + 1 keys, the one at up goes up
+         size_t up = (innerMax + 1) / 2;
+         Inner* pRight = *pSpares++;
+         if (index == up)
+         {
+            // the new key itself, with pChild first on the right
+            moveRange(pRight->keys(), pInner->keys() + up, innerMax - up);
+            pRight->children[0] = pChild;
+            for (size_t i = up + 1; i <= innerMax; i++)
+               pRight->children[i - up] = pInner->children[i];
+            pRight->num = uint16_t(innerMax - up);
+            pInner->num = uint16_t(up);
+         }
+         else
+         {
+            // an old key, keys[split], and the new one goes on its side
+            size_t split = (index < up ? up - 1 : up);
+            moveRange(pRight->keys(), pInner->keys() + split + 1, innerMax - split - 1);
+            for (size_t i = split + 1; i <= innerMax; i++)
+               pRight->children[i - split - 1] = pInner->children[i];
+            pRight->num = uint16_t(innerMax - split - 1);
+            K keyMid(std::move(pInner->keys()[split]));
+            pInner->keys()[split].~K();
+            pInner->num = uint16_t(split);
+
+            if (index < up)
+               insertKey(pInner, index, std::move(keyUp), pChild);
+            else
+               insertKey(pRight, index - split - 1, std::move(keyUp), pChild);
+            keyUp = std::move(keyMid);
+         }
+         pChild = pRight;
+      }
+   }
+
+   /*****************************************************
+    * BTREE :: INSERT KEY
+    * Put a key at index in an inner node with room, and the child after
+    * it to its right
+    ****************************************************/
+   template <class K, class V, class Compare, class Allocator, size_t nodeBytes>
+   void BTree <K, V, Compare, Allocator, nodeBytes> ::insertKey(Inner* pInner, size_t index, K&& key, Node* pChild)
+   {
+      openHole(pInner->keys(), pInner->num, index);
+      new (pInner->keys() + index) K(std::move(key));
+      for (size_t i = pInner->num + 1; i > index + 1; i--)
+         pInner->children[i] = pInner->children[i - 1];
+      pInner->children[index + 1] = pChild;
+      pInner->num++;
+   }
+
+   /*****************************************************
+    * BTREE :: CLEAR
+    * Delete every node
+    ****************************************************/
+   template <class K, class V, class Compare, class Allocator, size_t nodeBytes>
+   void BTree <K, V, Compare, Allocator, nodeBytes> ::clear() noexcept
+   {
+      deleteNodes(root);
+      root = nullptr;
+      pFirst = pLast = nullptr;
+      numElements = 0;
+   }
+
+   /*****************************************************
+    * BTREE :: ERASE
+    * Take one pair out of its leaf. A leaf left less than half full
+    * borrows from or merges with a neighbor, and so on up the path.
+    * Nothing moves out of the leaves but the pairs that are shuffled
+    * along, so the place of the next pair is followed through it
+    ****************************************************/
+   template <class K, class V, class Compare, class Allocator, size_t nodeBytes>
+   typename BTree <K, V, Compare, Allocator, nodeBytes> ::iterator BTree <K, V, Compare, Allocator, nodeBytes> ::erase(iterator it)
+   {
+      Path path;
+      Leaf* pLeaf = descend(it->first, &path);
+      size_t index = it.index;
+      assert(pLeaf == it.pLeaf);
+
+      closeHole(pLeaf->slots(), pLeaf->num, index);
+      pLeaf->num--;
+      numElements--;
+
+      if (pLeaf == root)
+      {
+         if (pLeaf->num == 0)
+         {
+            deleteLeaf(pLeaf);
+            root = nullptr;
+            pFirst = pLast = nullptr;
+            return end();
+         }
+         return normalize(pLeaf, index);
+      }
+
+      if (pLeaf->num < leafMin)
+         rebalanceLeaf(pLeaf, index, path);
+      return normalize(pLeaf, index);
+   }
+
+   /*****************************************************
+    * BTREE :: REBALANCE LEAF
+    * Bring a leaf one short of half full back up: borrow a pair from a
+    * neighbor that can spare one, else merge with a neighbor. pLeaf and
+    * index follow the pair that was after the one erased
+    ****************************************************/
+   template <class K, class V, class Compare, class Allocator, size_t nodeBytes>
+   void BTree <K, V, Compare, Allocator, nodeBytes> ::rebalanceLeaf(Leaf*& pLeaf, size_t& index, Path& path)
+   {
+      Inner* pParent = path.nodes[path.depth];
+      size_t iChild = path.indices[path.depth];
+      Leaf* pLeft = (iChild > 0 ? static_cast<Leaf*>(pParent->children[iChild - 1]) : nullptr);
+      Leaf* pRight = (iChild < pParent->num ? static_cast<Leaf*>(pParent->children[iChild + 1]) : nullptr);
+
+      if (pLeft && pLeft->num > leafMin)
+      {
+         // the last pair of the left leaf becomes our first
+         openHole(pLeaf->slots(), pLeaf->num, 0);
+         new (pLeaf->slots()) Pairs(std::move(pLeft->slots()[pLeft->num - 1]));
+         pLeft->slots()[pLeft->num - 1].~Pairs();
+         pLeft->num--;
+         pLeaf->num++;
+         pParent->keys()[iChild - 1] = pLeaf->slots()[0].first;
+         index++;
+         return;
+      }
+
+      if (pRight && pRight->num > leafMin)
+      {
+         // the first pair of the right leaf becomes our last
+         new (pLeaf->slots() + pLeaf->num) Pairs(std::move(pRight->slots()[0]));
+         closeHole(pRight->slots(), pRight->num, 0);
+         pRight->num--;
+         pLeaf->num++;
+         pParent->keys()[iChild] = pRight->slots()[0].first;
+         return;
+      }
+
+      // merge: the left one of the two takes in the right one
+      if (pLeft)
+      {
+         index += pLeft->num;
+         moveRange(pLeft->slots() + pLeft->num, pLeaf->slots(), pLeaf->num);
+         pLeft->num += pLeaf->num;
+         pLeaf->num = 0;
+         unlinkLeaf(pLeaf);
+         deleteLeaf(pLeaf);
+         pLeaf = pLeft;
+         iChild--;
+      }
+      else
+      {
+         moveRange(pLeaf->slots() + pLeaf->num, pRight->slots(), pRight->num);
+         pLeaf->num += pRight->num;
+         pRight->num = 0;
+         unlinkLeaf(pRight);
+         deleteLeaf(pRight);
+      }
+
+      // the parent loses the key and child between them
+      closeHole(pParent->keys(), pParent->num, iChild);
+      for (size_t i = iChild + 1; i < pParent->num; i++)
+         pParent->children[i] = pParent->children[i + 1];
+      pParent->num--;
+      rebalanceInner(path);
+   }
+
+   /*****************************************************
+    * BTREE :: REBALANCE INNER
+    * Work up the path from the inner node at the bottom of it, which
+    * just lost a child: borrow through the parent, or merge, until a node
+    * is at least half full. A root left with one child is replaced by it
+    ****************************************************/
+   template <class K, class V, class Compare, class Allocator, size_t nodeBytes>
+   void BTree <K, V, Compare, Allocator, nodeBytes> ::rebalanceInner(Path& path)
+   {
+      for (int depth = path.depth; depth >= 0; depth--)
+      {
+         Inner* pInner = path.nodes[depth];
+         if (depth == 0)
+         {
+            if (pInner->num == 0)
+            {
+               root = pInner->children[0];
+               deleteInner(pInner);
+            }
+            return;
+         }
+         if (pInner->num >= innerMin)
+            return;
+
+         Inner* pParent = path.nodes[depth - 1];
+         size_t iChild = path.indices[depth - 1];
+         Inner* pLeft = (iChild > 0 ? static_cast<Inner*>(pParent->children[iChild - 1]) : nullptr);
+         Inner* pRight = (iChild < pParent->num ? static_cast<Inner*>(pParent->children[iChild + 1]) : nullptr);
+
+         if (pLeft && pLeft->num > innerMin)
+         {
+            // the parent key comes down in front, the last key of the
+            // left one goes up in its place
+            openHole(pInner->keys(), pInner->num, 0);
+            new (pInner->keys()) K(std::move(pParent->keys()[iChild - 1]));
+            for (size_t i = pInner->num + 1; i > 0; i--)
+               pInner->children[i] = pInner->children[i - 1];
+            pInner->children[0] = pLeft->children[pLeft->num];
+            pInner->num++;
+            pParent->keys()[iChild - 1] = std::move(pLeft->keys()[pLeft->num - 1]);
+            pLeft->keys()[pLeft->num - 1].~K();
+            pLeft->num--;
+            return;
+         }
+
+         if (pRight && pRight->num > innerMin)
+         {
+            // the parent key comes down at the end, the first key of the
+            // right one goes up in its place
+            new (pInner->keys() + pInner->num) K(std::move(pParent->keys()[iChild]));
+            pInner->children[pInner->num + 1] = pRight->children[0];
+            pInner->num++;
+            pParent->keys()[iChild] = std::move(pRight->keys()[0]);
+            closeHole(pRight->keys(), pRight->num, 0);
+            for (size_t i = 0; i < pRight->num; i++)
+               pRight->children[i] = pRight->children[i + 1];
+            pRight->num--;
+            return;
+         }
+
+         // merge the left of the two with the parent key and the right
+         Inner* pInto = (pLeft ? pLeft : pInner);
+         Inner* pFrom = (pLeft ? pInner : pRight);
+         size_t iKey = (pLeft ? iChild - 1 : iChild);
+         new (pInto->keys() + pInto->num) K(std::move(pParent->keys()[iKey]));
+         moveRange(pInto->keys() + pInto->num + 1, pFrom->keys(), pFrom->num);
+         for (size_t i = 0; i <= pFrom->num; i++)
+            pInto->children[pInto->num + 1 + i] = pFrom->children[i];
+         pInto->num += 1 + pFrom->num;
+         pFrom->num = 0;
+         deleteInner(pFrom);
+
+         closeHole(pParent->keys(), pParent->num, iKey);
+         for (size_t i = iKey + 1; i < pParent->num; i++)
+            pParent->children[i] = pParent->children[i + 1];
+         pParent->num--;
+      }
+   }
+
+   /*****************************************************
+    * BTREE :: NEW LEAF, NEW INNER
+    * An empty node from the allocator
+    ****************************************************/
+   template <class K, class V, class Compare, class Allocator, size_t nodeBytes>
+   typename BTree <K, V, Compare, Allocator, nodeBytes> ::Leaf* BTree <K, V, Compare, Allocator, nodeBytes> ::newLeaf() const
+   {
+      LeafAllocator leafAllocator(alloc());
+      try
+      {
+         return new (std::allocator_traits<LeafAllocator>::allocate(leafAllocator, 1)) Leaf;
+      }
+      catch (...)
+      {
+         throw "Error: Unable to allocate a node";
+      }
+   }
+
+   template <class K, class V, class Compare, class Allocator, size_t nodeBytes>
+   typename BTree <K, V, Compare, Allocator, nodeBytes> ::Inner* BTree <K, V, Compare, Allocator, nodeBytes> ::newInner() const
+   {
+      InnerAllocator innerAllocator(alloc());
+      try
+      {
+         return new (std::allocator_traits<InnerAllocator>::allocate(innerAllocator, 1)) Inner;
+      }
+      catch (...)
+      {
+         throw "Error: Unable to allocate a node";
+      }
+   }
+
+   /*****************************************************
+    * BTREE :: DELETE LEAF, DELETE INNER
+    * Destroy what is built in a node and give it back
+    ****************************************************/
+   template <class K, class V, class Compare, class Allocator, size_t nodeBytes>
+   void BTree <K, V, Compare, Allocator, nodeBytes> ::deleteLeaf(Leaf* pLeaf) const noexcept
+   {
+      for (size_t i = 0; i < pLeaf->num; i++)
+         pLeaf->slots()[i].~Pairs();
+      pLeaf->~Leaf();
+      LeafAllocator leafAllocator(alloc());
+      std::allocator_traits<LeafAllocator>::deallocate(leafAllocator, pLeaf, 1);
+   }
+
+   template <class K, class V, class Compare, class Allocator, size_t nodeBytes>
+   void BTree <K, V, Compare, Allocator, nodeBytes> ::deleteInner(Inner* pInner) const noexcept
+   {
+      for (size_t i = 0; i < pInner->num; i++)
+         pInner->keys()[i].~K();
+      pInner->~Inner();
+      InnerAllocator innerAllocator(alloc());
+      std::allocator_traits<InnerAllocator>::deallocate(innerAllocator, pInner, 1);
+   }
+
+   /*****************************************************
+    * BTREE :: DELETE NODES
+    * Delete a subtree. It is only a few levels deep
+    ****************************************************/
+   template <class K, class V, class Compare, class Allocator, size_t nodeBytes>
+   void BTree <K, V, Compare, Allocator, nodeBytes> ::deleteNodes(Node* pNode) noexcept
+   {
+      if (pNode == nullptr)
+         return;
+      if (pNode->isLeaf)
+      {
+         deleteLeaf(static_cast<Leaf*>(pNode));
+         return;
+      }
+      Inner* pInner = static_cast<Inner*>(pNode);
+      for (size_t i = 0; i <= pInner->num; i++)
+         deleteNodes(pInner->children[i]);
+      deleteInner(pInner);
+   }
+
+   /*****************************************************
+    * BTREE :: COPY NODES
+    * Copy a subtree, linking each leaf after pPrev as it is made
+    ****************************************************/
+   template <class K, class V, class Compare, class Allocator, size_t nodeBytes>
+   typename BTree <K, V, Compare, Allocator, nodeBytes> ::Node* BTree <K, V, Compare, Allocator, nodeBytes> ::copyNodes(const Node* pSrc, Leaf*& pPrev)
+   {
+      if (pSrc == nullptr)
+         return nullptr;
+
+      if (pSrc->isLeaf)
+      {
+         const Leaf* pFrom = static_cast<const Leaf*>(pSrc);
+         Leaf* pLeaf = newLeaf();
+         // link it first, so a throw leaves it where clear() can find it
+         pLeaf->pPrev = pPrev;
+         if (pPrev)
+            pPrev->pNext = pLeaf;
+         else
+            pFirst = pLeaf;
+         pPrev = pLeaf;
+         for (; pLeaf->num < pFrom->num; pLeaf->num++)
+            new (pLeaf->slots() + pLeaf->num) Pairs(pFrom->slots()[pLeaf->num]);
+         return pLeaf;
+      }
+
+      const Inner* pFrom = static_cast<const Inner*>(pSrc);
+      Inner* pInner = newInner();
+      try
+      {
+         for (; pInner->num < pFrom->num; pInner->num++)
+            new (pInner->keys() + pInner->num) K(pFrom->keys()[pInner->num]);
+         for (size_t i = 0; i <= pFrom->num; i++)
+            pInner->children[i] = copyNodes(pFrom->children[i], pPrev);
+      }
+      catch (...)
+      {
+         // the leaves made so far are freed by walking them
+         while (pFirst)
+         {
+            Leaf* pNext = pFirst->pNext;
+            deleteLeaf(pFirst);
+            pFirst = pNext;
+         }
+         pPrev = nullptr;
+         deleteInner(pInner);
+         throw;
+      }
+      return pInner;
+   }
+
+   /*****************************************************
+    * BTREE :: UNLINK LEAF
+    * Take a leaf out of the chain of leaves
+    ****************************************************/
+   template <class K, class V, class Compare, class Allocator, size_t nodeBytes>
+   void BTree <K, V, Compare, Allocator, nodeBytes> ::unlinkLeaf(Leaf* pLeaf) noexcept
+   {
+      if (pLeaf->pPrev)
+         pLeaf->pPrev->pNext = pLeaf->pNext;
+      else
+         pFirst = pLeaf->pNext;
+      if (pLeaf->pNext)
+         pLeaf->pNext->pPrev = pLeaf->pPrev;
+      else
+         pLast = pLeaf->pPrev;
+   }
+
+   /*****************************************************
+    * BTREE :: MOVE RANGE, OPEN HOLE, CLOSE HOLE
+    * Shuffle the things built in the slots of a node
+    ****************************************************/
+   template <class K, class V, class Compare, class Allocator, size_t nodeBytes>
+   template <class T>
+   void BTree <K, V, Compare, Allocator, nodeBytes> ::moveRange(T* pDest, T* pSrc, size_t num)
+   {
+      for (size_t i = 0; i < num; i++)
+      {
+         new (pDest + i) T(std::move(pSrc[i]));
+         pSrc[i].~T();
+      }
+   }
+
+   // afterwards p[index] is not built, and p[num] is
+   template <class K, class V, class Compare, class Allocator, size_t nodeBytes>
+   template <class T>
+   void BTree <K, V, Compare, Allocator, nodeBytes> ::openHole(T* p, size_t num, size_t index)
+   {
+      for (size_t i = num; i > index; i--)
+      {
+         new (p + i) T(std::move(p[i - 1]));
+         p[i - 1].~T();
+      }
+   }
+
+   // destroy p[index] and slide the ones after it down
+   template <class K, class V, class Compare, class Allocator, size_t nodeBytes>
+   template <class T>
+   void BTree <K, V, Compare, Allocator, nodeBytes> ::closeHole(T* p, size_t num, size_t index)
+   {
+      p[index].~T();
+      for (size_t i = index + 1; i < num; i++)
+      {
+         new (p + i - 1) T(std::move(p[i]));
+         p[i].~T();
+      }
+   }
+
+   /*****************************************************************
+    * MAP over a BTREE
+    * The same map, with the pairs in a BTree instead of a BST. There
+    * is no node to hand out, so no node handles, split or join
+    *****************************************************************/
+   template <class K, class V, size_t nodeBytes, class Compare, class Allocator>
+   class map <K, V, balance::btree<nodeBytes>, Compare, Allocator>
+   {
+      friend ::TestMap; // give unit tests access to the privates
+      friend class ::BenchBST;
+      using Tree = BTree<K, V, Compare, Allocator, nodeBytes>;
+   public:
+      using Pairs = custom::pair<K, V>;
+
+      //
+      // Construct
+      //
+      map()
+      {
+      }
+      explicit map(const Compare& compare, const Allocator& allocator = Allocator())
+         : tree(compare, allocator)
+      {
+      }
+      explicit map(const Allocator& allocator) : tree(Compare(), allocator)
+      {
+      }
+      map(const map& rhs) : tree(rhs.tree)
+      {
+      }
+      map(map&& rhs) : tree(std::move(rhs.tree))
+      {
+      }
+      template <class Iterator>
+      map(Iterator first, Iterator last)
+      {
+         insert(first, last);
+      }
+      map(const std::initializer_list <Pairs>& il)
+      {
+         insert(il);
+      }
+
+      //
+      // Assign
+      //
+      map& operator = (const map& rhs)
+      {
+         tree = rhs.tree;
+         return *this;
+      }
+      map& operator = (map&& rhs)
+      {
+         tree = std::move(rhs.tree);
+         return *this;
+      }
+      map& operator = (const std::initializer_list <Pairs>& il)
+      {
+         clear();
+         insert(il);
+         return *this;
+      }
+
+      //
+      // Iterator
+      //
+      using iterator = typename Tree::iterator;
+      using reverse_iterator = std::reverse_iterator<iterator>;
+      iterator begin() const { return tree.begin(); }
+      iterator end()   const { return tree.end(); }
+      reverse_iterator rbegin() const { return reverse_iterator(end()); }
+      reverse_iterator rend()   const { return reverse_iterator(begin()); }
+
+      //
+      // Access
+      //
+      const V& operator [] (const K& k) const
+      {
+         return at(k);
+      }
+      V& operator [] (const K& k)
+      {
+         iterator it = try_emplace(k).first;
+         return it.pLeaf->slots()[it.index].second;
+      }
+      const V& at(const K& k) const
+      {
+         return const_cast<map&>(*this).at(k);
+      }
+      V& at(const K& k)
+      {
+         iterator it = tree.find(k);
+         if (it == end())
+            throw std::out_of_range("invalid map<K, T> key");
+         return it.pLeaf->slots()[it.index].second;
+      }
+
+      using key_compare = Compare;
+      key_compare key_comp() const { return tree.comp(); }
+      using allocator_type = Allocator;
+      allocator_type get_allocator() const noexcept { return tree.alloc(); }
+
+      template <class KK>
+      iterator find(const KK& k) const
+      {
+         return tree.find(k);
+      }
+      template <class KK>
+      iterator lower_bound(const KK& k) const
+      {
+         return tree.lower_bound(k);
+      }
+      template <class KK>
+      iterator upper_bound(const KK& k) const
+      {
+         return tree.upper_bound(k);
+      }
+      template <class KK>
+      std::pair<iterator, iterator> equal_range(const KK& k) const
+      {
+         return std::pair<iterator, iterator>(lower_bound(k), upper_bound(k));
+      }
+
+      //
+      // Insert
+      //
+      custom::pair<iterator, bool> insert(const Pairs& rhs)
+      {
+         auto pairTree = tree.tryEmplace(rhs.first, rhs);
+         return custom::pair<iterator, bool>(pairTree.first, pairTree.second);
+      }
+      custom::pair<iterator, bool> insert(Pairs&& rhs)
+      {
+         auto pairTree = tree.tryEmplace(rhs.first, std::move(rhs));
+         return custom::pair<iterator, bool>(pairTree.first, pairTree.second);
+      }
+      iterator insert(iterator hint, const Pairs& rhs)
+      {
+         return insert(rhs).first;
+      }
+      iterator insert(iterator hint, Pairs&& rhs)
+      {
+         return insert(std::move(rhs)).first;
+      }
+      template <class Iterator>
+      void insert(Iterator first, Iterator last)
+      {
+         for (auto it = first; it != last; ++it)
+            insert(*it);
+      }
+      void insert(const std::initializer_list <Pairs>& il)
+      {
+         for (auto&& element : il)
+            insert(element);
+      }
+
+      // the key is somewhere in the arguments, so the pair is built first
+      template <class ... Args>
+      custom::pair<iterator, bool> emplace(Args&& ... args)
+      {
+         return insert(Pairs(std::forward<Args>(args)...));
+      }
+      template <class ... Args>
+      iterator emplace_hint(iterator hint, Args&& ... args)
+      {
+         return emplace(std::forward<Args>(args)...).first;
+      }
+
+      // and the value is not built at all if the key is taken
+      template <class ... Args>
+      custom::pair<iterator, bool> try_emplace(const K& k, Args&& ... args)
+      {
+         auto pairTree = tree.tryEmplace(k, std::in_place, k, std::forward<Args>(args)...);
+         return custom::pair<iterator, bool>(pairTree.first, pairTree.second);
+      }
+      template <class ... Args>
+      custom::pair<iterator, bool> try_emplace(K&& k, Args&& ... args)
+      {
+         auto pairTree = tree.tryEmplace(k, std::in_place, std::move(k), std::forward<Args>(args)...);
+         return custom::pair<iterator, bool>(pairTree.first, pairTree.second);
+      }
+
+      //
+      // Remove
+      //
+      void clear() noexcept
+      {
+         tree.clear();
+      }
+      size_t erase(const K& k)
+      {
+         iterator it = tree.find(k);
+         if (it == end())
+            return size_t(0);
+         tree.erase(it);
+         return size_t(1);
+      }
+      iterator erase(iterator it)
+      {
+         return tree.erase(it);
+      }
+      iterator erase(iterator first, iterator last);
+
+      //
+      // Snapshot, for when the map is done changing
+      //
+      frozenMap<K, V, Compare> freeze() const
+      {
+         return frozenMap<K, V, Compare>(begin(), end(), size(), key_comp());
+      }
+
+      //
+      // Status
+      //
+      bool empty() const noexcept { return tree.empty(); }
+      size_t size() const noexcept { return tree.size(); }
+
+      void swap(map& rhs) noexcept
+      {
+         tree.swap(rhs.tree);
+      }
+
+   private:
+      Tree tree;
+   };
+
+   /*****************************************************
+    * MAP over a BTREE :: ERASE
+    * Erase [first, last). Every erase moves pairs around, so last is
+    * found again by its key each time
+    ****************************************************/
+   template <class K, class V, size_t nodeBytes, class Compare, class Allocator>
+   typename map <K, V, balance::btree<nodeBytes>, Compare, Allocator> ::iterator
+      map <K, V, balance::btree<nodeBytes>, Compare, Allocator> ::erase(iterator first, iterator last)
+   {
+      if (last == end())
+      {
+         while (first != end())
+            first = tree.erase(first);
+         return end();
+      }
+
+      K keyLast = last->first;
+      while (first != end() && tree.comp()(first->first, keyLast))
+         first = tree.erase(first);
+      return first;
+   }
+
+   /*****************************************************
+    * SWAP
+    * Swap two maps over B-trees
+    ****************************************************/
+   template <class K, class V, size_t nodeBytes, class Compare, class Allocator>
+   void swap(map <K, V, balance::btree<nodeBytes>, Compare, Allocator>& lhs,
+             map <K, V, balance::btree<nodeBytes>, Compare, Allocator>& rhs)
+   {
+      lhs.swap(rhs);
+   }
+
+}
@@ -0,0 +1,1095 @@
+/***********************************************************************
+ * Header:
+ *    COMPACT
+ * Summary:
+ *    A map with the iterators of custom::map whose nodes are packed in
+ *    one array and linked by 32-bit indices instead of pointers:
+ *        custom::compactMap<K, V>
+ *      __       ____       ____         __
+ *     /  |    .'    '.   .'    '.   _  / /
+ *     `| |   |  .--.  | |  .--.  | (_)/ /
+ *      | |   | |    | | | |    | |   / / _
+ *     _| |_  |  `--'  | |  `--'  |  / / (_)
+ *    |_____|  '.____.'   '.____.'  /_/
+ *
+ *    This will contain the class definition of:
+ *        compactMap          : A red-black map whose nodes are 12 bytes of
+ *                              links plus the pair. The color is the top
+ *                              bit of the parent index, so a map holds up
+ *                              to 2^31 - 1 elements
+ *        compactMap::iterator : An iterator through a compactMap
+ *
+ *    A node of a compactMap<int, int> is 20 bytes where a node of a
+ *    map<int, int> is 40. An erased node goes on a free list and is the
+ *    next one filled, so iterators are never invalidated by an insert and
+ *    only an iterator to the erased element by an erase. References to
+ *    elements, like those into a std::vector, move when the array grows
+ * Author
+ *    Sam Heaven, Abram Hansen
+ ************************************************************************/
+
+#pragma once
+
+#include "pair.h"     // for pair
+#include "bst.h"      // for Holder
+#include <cstdint>    // for uint32_t
+#include <memory>     // for std::allocator
+#include <new>        // for std::launder
+#include <stdexcept>  // for std::out_of_range
+#include <iterator>   // for std::reverse_iterator
+#include <functional> // for std::less
+#include <algorithm>  // for std::min
+#include <type_traits> // for std::is_trivially_destructible
+
+class TestMap; // forward declaration for unit tests
+class BenchBST; // forward declaration for benchmarks
+
+namespace custom
+{
+
+   /*****************************************************************
+    * COMPACT MAP
+    * A map in one array of nodes. Each node links to its children and
+    * parent by their place in the array, 31 bits each, and keeps its
+    * color in the bit left over
+    *****************************************************************/
+   template <class K, class V, class Compare = std::less<K>>
+   class compactMap : private Holder<Compare, 0>
+   {
+      friend class ::TestMap; // give unit tests access to the privates
+      friend class ::BenchBST;
+      template <class KK, class VV, class CC>
+      friend void swap(compactMap<KK, VV, CC>& lhs, compactMap<KK, VV, CC>& rhs);
+      using CompareHolder = Holder<Compare, 0>;
+   public:
+      using Pairs = custom::pair<K, V>;
+
+      //
+      // Construct
+      //
+
+      compactMap() : nodes(nullptr), numSlots(0), numCapacity(0), numElements(0),
+                     root(nil), freeHead(nil)
+      {
+      }
+      explicit compactMap(const Compare& compare) : CompareHolder(compare),
+                     nodes(nullptr), numSlots(0), numCapacity(0), numElements(0),
+                     root(nil), freeHead(nil)
+      {
+      }
+      compactMap(const compactMap& rhs);
+      compactMap(compactMap&& rhs) noexcept : compactMap(rhs.comp())
+      {
+         swap(rhs);
+      }
+      template <class Iterator>
+      compactMap(Iterator first, Iterator last) : compactMap()
+      {
+         insert(first, last);
+      }
+      compactMap(const std::initializer_list <Pairs>& il) : compactMap()
+      {
+         insert(il);
+      }
+      ~compactMap()
+      {
+         clear();
+         deallocate(nodes, numCapacity);
+      }
+
+      //
+      // Assign
+      //
+
+      compactMap& operator = (const compactMap& rhs)
+      {
+         if (this != &rhs)
+         {
+            compactMap copy(rhs);
+            swap(copy);
+         }
+         return *this;
+      }
+      compactMap& operator = (compactMap&& rhs) noexcept
+      {
+         clear();
+         swap(rhs);
+         return *this;
+      }
+      compactMap& operator = (const std::initializer_list <Pairs>& il)
+      {
+         clear();
+         insert(il);
+         return *this;
+      }
+      void swap(compactMap& rhs) noexcept;
+
+      //
+      // Iterator
+      //
+
+      class iterator;
+      using reverse_iterator = std::reverse_iterator<iterator>;
+      iterator begin() const
+      {
+         return iterator(this, leftmost(root));
+      }
+      iterator end() const
+      {
+         return iterator(this, nil);
+      }
+      reverse_iterator rbegin() const
+      {
+         return reverse_iterator(end());
+      }
+      reverse_iterator rend() const
+      {
+         return reverse_iterator(begin());
+      }
+
+      //
+      // Access
+      //
+
+      const V& operator [] (const K& k) const
+      {
+         return at(k);
+      }
+      V& operator [] (const K& k)
+      {
+         // the insert may move the array, so it comes first
+         uint32_t i = try_emplace(k).first.i;
+         return nodes[i].data().second;
+      }
+      const V& at(const K& k) const
+      {
+         return const_cast<compactMap&>(*this).at(k);
+      }
+      V& at(const K& k);
+
+      using key_compare = Compare;
+      key_compare key_comp() const { return comp(); }
+
+      template <class KK>
+      iterator find(const KK& k) const
+      {
+         uint32_t i = lowerBound(k);
+         return iterator(this, (i != nil && !comp()(k, nodes[i].data().first)) ? i : nil);
+      }
+      template <class KK>
+      iterator lower_bound(const KK& k) const
+      {
+         return iterator(this, lowerBound(k));
+      }
+      template <class KK>
+      iterator upper_bound(const KK& k) const;
+      template <class KK>
+      std::pair<iterator, iterator> equal_range(const KK& k) const
+      {
+         return std::pair<iterator, iterator>(lower_bound(k), upper_bound(k));
+      }
+
+      //
+      // Insert
+      //
+
+      custom::pair<iterator, bool> insert(const Pairs& rhs)
+      {
+         return tryEmplace(rhs.first, rhs);
+      }
+      custom::pair<iterator, bool> insert(Pairs&& rhs)
+      {
+         return tryEmplace(rhs.first, std::move(rhs));
+      }
+
+      // the array makes a descent cheap enough that a hint is not needed
+      iterator insert(iterator hint, const Pairs& rhs)
+      {
+         return insert(rhs).first;
+      }
+      iterator insert(iterator hint, Pairs&& rhs)
+      {
+         return insert(std::move(rhs)).first;
+      }
+
+      template <class Iterator>
+      void insert(Iterator first, Iterator last)
+      {
+         for (auto it = first; it != last; ++it)
+            insert(*it);
+      }
+      void insert(const std::initializer_list <Pairs>& il)
+      {
+         for (auto&& element : il)
+            insert(element);
+      }
+
+      // build the pair in its node rather than copying one in
+      template <class ... Args>
+      custom::pair<iterator, bool> emplace(Args&& ... args);
+      template <class ... Args>
+      iterator emplace_hint(iterator hint, Args&& ... args)
+      {
+         return emplace(std::forward<Args>(args)...).first;
+      }
+
+      // and do not build the value at all if the key is taken
+      template <class ... Args>
+      custom::pair<iterator, bool> try_emplace(const K& k, Args&& ... args)
+      {
+         return tryEmplace(k, std::in_place, k, std::forward<Args>(args)...);
+      }
+      template <class ... Args>
+      custom::pair<iterator, bool> try_emplace(K&& k, Args&& ... args)
+      {
+         uint32_t iParent = nil;
+         bool isLeft = false;
+         uint32_t i = search(k, iParent, isLeft);
+         if (i != nil)
+            return custom::pair<iterator, bool>(iterator(this, i), false);
+         return custom::pair<iterator, bool>(iterator(this,
+            hookUp(newSlot(std::in_place, std::move(k), std::forward<Args>(args)...), iParent, isLeft)), true);
+      }
+
+      //
+      // Remove
+      //
+
+      void clear() noexcept;
+      size_t erase(const K& k);
+      iterator erase(iterator it);
+      iterator erase(iterator first, iterator last);
+
+      //
+      // Status
+      //
+
+      bool empty() const noexcept { return numElements == 0; }
+      size_t size() const noexcept { return numElements; }
+      size_t capacity() const noexcept { return numCapacity; }
+      size_t max_size() const noexcept { return nil; }
+      void reserve(size_t num);
+
+   private:
+      struct Node;
+
+      static constexpr uint32_t nil = 0x7FFFFFFF;        // no node, and one past the last index
+      static constexpr uint32_t redBit = 0x80000000;     // the color in the top bit of a parent index
+      static constexpr uint32_t freeMark = 0xFFFFFFFF;   // the parent index of a node on the free list
+
+      const Compare& comp() const noexcept { return CompareHolder::get(); }
+
+      //
+      // The links of a node
+      //
+
+      uint32_t parent(uint32_t i) const { return nodes[i].parentColor & ~redBit; }
+      bool isRed(uint32_t i) const { return i != nil && (nodes[i].parentColor & redBit); }
+      void setParent(uint32_t i, uint32_t iParent)
+      {
+         nodes[i].parentColor = (nodes[i].parentColor & redBit) | iParent;
+      }
+      void setRed(uint32_t i, bool red)
+      {
+         nodes[i].parentColor = red ? (nodes[i].parentColor | redBit) : (nodes[i].parentColor & ~redBit);
+      }
+      uint32_t leftmost(uint32_t i) const;
+      uint32_t rightmost(uint32_t i) const;
+      uint32_t next(uint32_t i) const;
+      uint32_t prev(uint32_t i) const;
+
+      //
+      // Search and balance
+      //
+
+      template <class KK>
+      uint32_t lowerBound(const KK& k) const;
+      template <class KK>
+      uint32_t search(const KK& k, uint32_t& iParent, bool& isLeft) const;
+      template <class KK, class ... Args>
+      custom::pair<iterator, bool> tryEmplace(const KK& k, Args&& ... args);
+      uint32_t hookUp(uint32_t i, uint32_t iParent, bool isLeft);
+      void unhook(uint32_t i);
+      void replace(uint32_t iOld, uint32_t iNew);
+      void rotateLeft(uint32_t i);
+      void rotateRight(uint32_t i);
+      void repairInsert(uint32_t i);
+      void repairErase(uint32_t i, uint32_t iParent);
+
+      //
+      // The array
+      //
+
+      template <class ... Args>
+      uint32_t newSlot(Args&& ... args);
+      void freeSlot(uint32_t i) noexcept;
+      void moveTo(Node* pNew, uint32_t numNew);
+      static Node* allocate(uint32_t num);
+      static void deallocate(Node* p, uint32_t num) noexcept
+      {
+         if (p)
+            std::allocator<Node>().deallocate(p, num);
+      }
+
+      Node* nodes;            // every node, in use or free
+      uint32_t numSlots;      // nodes handed out so far, in use or free
+      uint32_t numCapacity;   // nodes the array has room for
+      uint32_t numElements;   // nodes in the tree
+      uint32_t root;          // index of the root, or nil
+      uint32_t freeHead;      // index of the last node freed, or nil
+   };
+
+   /*****************************************************************
+    * COMPACT MAP :: NODE
+    * Three links and room for a pair. The pair is only built while
+    * the node is in the tree; on the free list, pRight is the next free
+    *****************************************************************/
+   template <class K, class V, class Compare>
+   struct compactMap <K, V, Compare> ::Node
+   {
+      uint32_t left;          // index of the left child, or nil
+      uint32_t right;         // index of the right child, or nil
+      uint32_t parentColor;   // index of the parent, red in the top bit
+      alignas(Pairs) unsigned char buffer[sizeof(Pairs)];
+
+            Pairs& data()       { return *std::launder(reinterpret_cast<      Pairs*>(buffer)); }
+      const Pairs& data() const { return *std::launder(reinterpret_cast<const Pairs*>(buffer)); }
+   };
+
+   /**********************************************************
+    * COMPACT MAP ITERATOR
+    * The map and the index of the element, nil at the end. The
+    * index stays good while the array grows under it
+    *********************************************************/
+   template <class K, class V, class Compare>
+   class compactMap <K, V, Compare> ::iterator
+   {
+      friend class ::TestMap; // give unit tests access to the privates
+      friend class compactMap;
+   public:
+      using iterator_category = std::bidirectional_iterator_tag;
+      using value_type        = pair <K, V>;
+      using difference_type   = std::ptrdiff_t;
+      using pointer           = const pair <K, V> *;
+      using reference         = const pair <K, V> &;
+
+      //
+      // Construct
+      //
+      iterator() : pMap(nullptr), i(nil)
+      {
+      }
+
+      //
+      // Compare
+      //
+      bool operator == (const iterator& rhs) const { return i == rhs.i; }
+      bool operator != (const iterator& rhs) const { return i != rhs.i; }
+
+      //
+      // Access
+      //
+      const pair <K, V>& operator * () const
+      {
+         return pMap->nodes[i].data();
+      }
+      const pair <K, V>* operator -> () const
+      {
+         return &pMap->nodes[i].data();
+      }
+
+      //
+      // Increment
+      //
+      iterator& operator ++ ()
+      {
+         i = pMap->next(i);
+         return *this;
+      }
+      iterator operator ++ (int postfix)
+      {
+         iterator itReturn = *this;
+         i = pMap->next(i);
+         return itReturn;
+      }
+      iterator& operator -- ()
+      {
+         i = (i == nil ? pMap->rightmost(pMap->root) : pMap->prev(i));
+         return *this;
+      }
+      iterator operator -- (int postfix)
+      {
+         iterator itReturn = *this;
+         --(*this);
+         return itReturn;
+      }
+
+   private:
+      iterator(const compactMap* pMap, uint32_t i) : pMap(pMap), i(i)
+      {
+      }
+
+      const compactMap* pMap;   // the map, for its array
+      uint32_t i;               // index of the element, or nil
+   };
+
+   /*****************************************************
+    * COMPACT MAP :: COPY CONSTRUCTOR
+    * Copy the array slot for slot, links and free list and all, so no
+    * comparison is made and the copy has the same shape
+    ****************************************************/
+   template <class K, class V, class Compare>
+   compactMap <K, V, Compare> ::compactMap(const compactMap& rhs) : CompareHolder(rhs.comp()),
+      nodes(nullptr), numSlots(0), numCapacity(0), numElements(0), root(nil), freeHead(nil)
+   {
+      if (rhs.numSlots == 0)
+         return;
+
+      nodes = allocate(rhs.numSlots);
+      numCapacity = rhs.numSlots;
+      for (; numSlots < rhs.numSlots; numSlots++)
+      {
+         const Node& nodeFrom = rhs.nodes[numSlots];
+         Node& nodeTo = nodes[numSlots];
+         nodeTo.left = nodeFrom.left;
+         nodeTo.right = nodeFrom.right;
+         // a free node until its pair is built, so a throw leaves us clean
+         nodeTo.parentColor = freeMark;
+         if (nodeFrom.parentColor != freeMark)
+         {
+            try
+            {
+               new (nodeTo.buffer) Pairs(nodeFrom.data());
+            }
+            catch (...)
+            {
+               root = nil;
+               clear();
+               deallocate(nodes, numCapacity);
+               throw;
+            }
+            nodeTo.parentColor = nodeFrom.parentColor;
+         }
+      }
+      numElements = rhs.numElements;
+      root = rhs.root;
+      freeHead = rhs.freeHead;
+   }
+
+   /*****************************************************
+    * COMPACT MAP :: SWAP
+    * Trade arrays, and comparators
+    ****************************************************/
+   template <class K, class V, class Compare>
+   void compactMap <K, V, Compare> ::swap(compactMap& rhs) noexcept
+   {
+      using std::swap;
+      swap(CompareHolder::get(), rhs.CompareHolder::get());
+      swap(nodes, rhs.nodes);
+      swap(numSlots, rhs.numSlots);
+      swap(numCapacity, rhs.numCapacity);
+      swap(numElements, rhs.numElements);
+      swap(root, rhs.root);
+      swap(freeHead, rhs.freeHead);
+   }
+
+   /*****************************************************
+    * SWAP
+    * Swap two compact maps
+    ****************************************************/
+   template <class K, class V, class Compare>
+   void swap(compactMap <K, V, Compare>& lhs, compactMap <K, V, Compare>& rhs)
+   {
+      lhs.swap(rhs);
+   }
+
+   /*****************************************************
+    * COMPACT MAP :: AT
+    * Retrieve an element from the map
+    ****************************************************/
+   template <class K, class V, class Compare>
+   V& compactMap <K, V, Compare> ::at(const K& k)
+   {
+      iterator it = find(k);
+      if (it == end())
+         throw std::out_of_range("invalid map<K, T> key");
+      return nodes[it.i].data().second;
+   }
+
+   /*****************************************************
+    * COMPACT MAP :: LOWER BOUND
+    * Index of the first element not less than k, or nil
+    ****************************************************/
+   template <class K, class V, class Compare>
+   template <class KK>
+   uint32_t compactMap <K, V, Compare> ::lowerBound(const KK& k) const
+   {
+      uint32_t iFound = nil;
+      for (uint32_t i = root; i != nil; )
+      {
+         if (comp()(nodes[i].data().first, k))
+            i = nodes[i].right;
+         else
+         {
+            iFound = i;
+            i = nodes[i].left;
+         }
+      }
+      return iFound;
+   }
+
+   /*****************************************************
+    * COMPACT MAP :: UPPER BOUND
+    * The first element greater than k
+    ****************************************************/
+   template <class K, class V, class Compare>
+   template <class KK>
+   typename compactMap <K, V, Compare> ::iterator compactMap <K, V, Compare> ::upper_bound(const KK& k) const
+   {
+      uint32_t iFound = nil;
+      for (uint32_t i = root; i != nil; )
+      {
+         if (comp()(k, nodes[i].data().first))
+         {
+            iFound = i;
+            i = nodes[i].left;
+         }
+         else
+            i = nodes[i].right;
+      }
+      return iterator(this, iFound);
+   }
+
+   /*****************************************************
+    * COMPACT MAP :: SEARCH
+    * One comparison per level. The index of the element with key k, or
+    * nil with the parent and side where it would hang
+    ****************************************************/
+   template <class K, class V, class Compare>
+   template <class KK>
+   uint32_t compactMap <K, V, Compare> ::search(const KK& k, uint32_t& iParent, bool& isLeft) const
+   {
+      uint32_t iNotGreater = nil;
+      for (uint32_t i = root; i != nil; i = (isLeft ? nodes[i].left : nodes[i].right))
+      {
+         iParent = i;
+         isLeft = comp()(k, nodes[i].data().first);
+         if (!isLeft)
+            iNotGreater = i;
+      }
+
+      if (iNotGreater != nil && !comp()(nodes[iNotGreater].data().first, k))
+         return iNotGreater;
+      return nil;
+   }
+
+   /*****************************************************
+    * COMPACT MAP :: TRY EMPLACE
+    * Look for k, and only if it is missing build a pair from args
+    ****************************************************/
+   template <class K, class V, class Compare>
+   template <class KK, class ... Args>
+   custom::pair<typename compactMap <K, V, Compare> ::iterator, bool> compactMap <K, V, Compare> ::tryEmplace(const KK& k, Args&& ... args)
+   {
+      uint32_t iParent = nil;
+      bool isLeft = false;
+      uint32_t i = search(k, iParent, isLeft);
+      if (i != nil)
+         return custom::pair<iterator, bool>(iterator(this, i), false);
+      return custom::pair<iterator, bool>(iterator(this,
+         hookUp(newSlot(std::forward<Args>(args)...), iParent, isLeft)), true);
+   }
+
+   /*****************************************************
+    * COMPACT MAP :: EMPLACE
+    * Build the pair first, since its key is in the arguments somewhere,
+    * and give the node back if the key is taken
+    ****************************************************/
+   template <class K, class V, class Compare>
+   template <class ... Args>
+   custom::pair<typename compactMap <K, V, Compare> ::iterator, bool> compactMap <K, V, Compare> ::emplace(Args&& ... args)
+   {
+      uint32_t i = newSlot(std::forward<Args>(args)...);
+      uint32_t iParent = nil;
+      bool isLeft = false;
+      uint32_t iFound = search(nodes[i].data().first, iParent, isLeft);
+      if (iFound != nil)
+      {
+         freeSlot(i);
+         return custom::pair<iterator, bool>(iterator(this, iFound), false);
+      }
+      return custom::pair<iterator, bool>(iterator(this, hookUp(i, iParent, isLeft)), true);
+   }
+
+   /*****************************************************
+    * COMPACT MAP :: HOOK UP
+    * Hang a new red node under iParent and restore the balance
+    ****************************************************/
+   template <class K, class V, class Compare>
+   uint32_t compactMap <K, V, Compare> ::hookUp(uint32_t i, uint32_t iParent, bool isLeft)
+   {
+      nodes[i].left = nodes[i].right = nil;
+      nodes[i].parentColor = iParent | redBit;
+      if (iParent == nil)
+         root = i;
+      else if (isLeft)
+         nodes[iParent].left = i;
+      else
+         nodes[iParent].right = i;
+      numElements++;
+      repairInsert(i);
+      return i;
+   }
+
+   /*****************************************************
+    * COMPACT MAP :: REPAIR INSERT
+    * Red-black fixup after a red node i is hung: recolor up the tree
+    * while the uncle is red, then at most two rotations
+    ****************************************************/
+   template <class K, class V, class Compare>
+   void compactMap <K, V, Compare> ::repairInsert(uint32_t i)
+   {
+      while (i != root && isRed(parent(i)))
+      {
+         uint32_t iParent = parent(i);
+         uint32_t iGranny = parent(iParent);
+         if (iParent == nodes[iGranny].left)
+         {
+            uint32_t iAunt = nodes[iGranny].right;
+            if (isRed(iAunt))
+            {
+               setRed(iParent, false);
+               setRed(iAunt, false);
+               setRed(iGranny, true);
+               i = iGranny;
+               continue;
+            }
+            if (i == nodes[iParent].right)
+            {
+               rotateLeft(iParent);
+               i = iParent;
+               iParent = parent(i);
+            }
+            setRed(iParent, false);
+            setRed(iGranny, true);
+            rotateRight(iGranny);
+         }
+         else
+         {
+            uint32_t iAunt = nodes[iGranny].left;
+            if (isRed(iAunt))
+            {
+               setRed(iParent, false);
+               setRed(iAunt, false);
+               setRed(iGranny, true);
+               i = iGranny;
+               continue;
+            }
+            if (i == nodes[iParent].left)
+            {
+               rotateRight(iParent);
+               i = iParent;
+               iParent = parent(i);
+            }
+            setRed(iParent, false);
+            setRed(iGranny, true);
+            rotateLeft(iGranny);
+         }
+      }
+      setRed(root, false);
+   }
+
+   /*****************************************************
+    * COMPACT MAP :: ROTATE LEFT
+    * The right child of i takes its place, with i as its left child
+    ****************************************************/
+   template <class K, class V, class Compare>
+   void compactMap <K, V, Compare> ::rotateLeft(uint32_t i)
+   {
+      uint32_t iUp = nodes[i].right;
+      nodes[i].right = nodes[iUp].left;
+      if (nodes[iUp].left != nil)
+         setParent(nodes[iUp].left, i);
+      replace(i, iUp);
+      nodes[iUp].left = i;
+      setParent(i, iUp);
+   }
+
+   /*****************************************************
+    * COMPACT MAP :: ROTATE RIGHT
+    * The left child of i takes its place, with i as its right child
+    ****************************************************/
+   template <class K, class V, class Compare>
+   void compactMap <K, V, Compare> ::rotateRight(uint32_t i)
+   {
+      uint32_t iUp = nodes[i].left;
+      nodes[i].left = nodes[iUp].right;
+      if (nodes[iUp].right != nil)
+         setParent(nodes[iUp].right, i);
+      replace(i, iUp);
+      nodes[iUp].right = i;
+      setParent(i, iUp);
+   }
+
+   /*****************************************************
+    * COMPACT MAP :: REPLACE
+    * Hang iNew, which may be nil, where iOld hangs from its parent
+    ****************************************************/
+   template <class K, class V, class Compare>
+   void compactMap <K, V, Compare> ::replace(uint32_t iOld, uint32_t iNew)
+   {
+      uint32_t iParent = parent(iOld);
+      if (iParent == nil)
+         root = iNew;
+      else if (iOld == nodes[iParent].left)
+         nodes[iParent].left = iNew;
+      else
+         nodes[iParent].right = iNew;
+      if (iNew != nil)
+         setParent(iNew, iParent);
+   }
+
+   /*****************************************************
+    * COMPACT MAP :: UNHOOK
+    * Take node i out of the tree. A node with two children trades
+    * places with the next one in order, which has at most one
+    ****************************************************/
+   template <class K, class V, class Compare>
+   void compactMap <K, V, Compare> ::unhook(uint32_t i)
+   {
+      uint32_t iChild;          // what moves up into the hole
+      uint32_t iChildParent;    // and where that hole is
+      bool wasRed = isRed(i);
+
+      if (nodes[i].left == nil || nodes[i].right == nil)
+      {
+         iChild = (nodes[i].left == nil ? nodes[i].right : nodes[i].left);
+         iChildParent = parent(i);
+         replace(i, iChild);
+      }
+      else
+      {
+         uint32_t iNext = leftmost(nodes[i].right);
+         wasRed = isRed(iNext);
+         iChild = nodes[iNext].right;
+         if (parent(iNext) == i)
+            iChildParent = iNext;
+         else
+         {
+            iChildParent = parent(iNext);
+            replace(iNext, iChild);
+            nodes[iNext].right = nodes[i].right;
+            setParent(nodes[iNext].right, iNext);
+         }
+         replace(i, iNext);
+         nodes[iNext].left = nodes[i].left;
+         setParent(nodes[iNext].left, iNext);
+         setRed(iNext, isRed(i));
+      }
+
+      numElements--;
+      if (!wasRed)
+         repairErase(iChild, iChildParent);
+   }
+
+   /*****************************************************
+    * COMPACT MAP :: REPAIR ERASE
+    * Red-black fixup after a black node is taken out from over i, which
+    * may be nil: i carries an extra black up the tree until a red node or
+    * a rotation can absorb it
+    ****************************************************/
+   template <class K, class V, class Compare>
+   void compactMap <K, V, Compare> ::repairErase(uint32_t i, uint32_t iParent)
+   {
+      while (i != root && !isRed(i))
+      {
+         if (i == nodes[iParent].left)
+         {
+            uint32_t iSibling = nodes[iParent].right;
+            if (isRed(iSibling))
+            {
+               setRed(iSibling, false);
+               setRed(iParent, true);
+               rotateLeft(iParent);
+               iSibling = nodes[iParent].right;
+            }
+            if (!isRed(nodes[iSibling].left) && !isRed(nodes[iSibling].right))
+            {
+               setRed(iSibling, true);
+               i = iParent;
+               iParent = parent(i);
+               continue;
+            }
+            if (!isRed(nodes[iSibling].right))
+            {
+               setRed(nodes[iSibling].left, false);
+               setRed(iSibling, true);
+               rotateRight(iSibling);
+               iSibling = nodes[iParent].right;
+            }
+            setRed(iSibling, isRed(iParent));
+            setRed(iParent, false);
+            setRed(nodes[iSibling].right, false);
+            rotateLeft(iParent);
+         }
+         else
+         {
+            uint32_t iSibling = nodes[iParent].left;
+            if (isRed(iSibling))
+            {
+               setRed(iSibling, false);
+               setRed(iParent, true);
+               rotateRight(iParent);
+               iSibling = nodes[iParent].left;
+            }
+            if (!isRed(nodes[iSibling].left) && !isRed(nodes[iSibling].right))
+            {
+               setRed(iSibling, true);
+               i = iParent;
+               iParent = parent(i);
+               continue;
+            }
+            if (!isRed(nodes[iSibling].left))
+            {
+               setRed(nodes[iSibling].right, false);
+               setRed(iSibling, true);
+               rotateLeft(iSibling);
+               iSibling = nodes[iParent].left;
+            }
+            setRed(iSibling, isRed(iParent));
+            setRed(iParent, false);
+            setRed(nodes[iSibling].left, false);
+            rotateRight(iParent);
+         }
+         i = root;
+      }
+      if (i != nil)
+         setRed(i, false);
+   }
+
+   /*****************************************************
+    * COMPACT MAP :: LEFTMOST, RIGHTMOST
+    * The first and last node under i, or nil if i is
+    ****************************************************/
+   template <class K, class V, class Compare>
+   uint32_t compactMap <K, V, Compare> ::leftmost(uint32_t i) const
+   {
+      if (i != nil)
+         while (nodes[i].left != nil)
+            i = nodes[i].left;
+      return i;
+   }
+
+   template <class K, class V, class Compare>
+   uint32_t compactMap <K, V, Compare> ::rightmost(uint32_t i) const
+   {
+      if (i != nil)
+         while (nodes[i].right != nil)
+            i = nodes[i].right;
+      return i;
+   }
+
+   /*****************************************************
+    * COMPACT MAP :: NEXT, PREV
+    * The node after or before i in order, or nil
+    ****************************************************/
+   template <class K, class V, class Compare>
+   uint32_t compactMap <K, V, Compare> ::next(uint32_t i) const
+   {
+      if (nodes[i].right != nil)
+         return leftmost(nodes[i].right);
+      uint32_t iParent = parent(i);
+      while (iParent != nil && i == nodes[iParent].right)
+      {
+         i = iParent;
+         iParent = parent(i);
+      }
+      return iParent;
+   }
+
+   template <class K, class V, class Compare>
+   uint32_t compactMap <K, V, Compare> ::prev(uint32_t i) const
+   {
+      if (nodes[i].left != nil)
+         return rightmost(nodes[i].left);
+      uint32_t iParent = parent(i);
+      while (iParent != nil && i == nodes[iParent].left)
+      {
+         i = iParent;
+         iParent = parent(i);
+      }
+      return iParent;
+   }
+
+   /*****************************************************
+    * COMPACT MAP :: CLEAR
+    * Destroy every pair and forget every node. The array is kept
+    ****************************************************/
+   template <class K, class V, class Compare>
+   void compactMap <K, V, Compare> ::clear() noexcept
+   {
+      if constexpr (!std::is_trivially_destructible<Pairs>::value)
+      {
+         for (uint32_t i = 0; i < numSlots; i++)
+            if (nodes[i].parentColor != freeMark)
+               nodes[i].data().~Pairs();
+      }
+      numSlots = 0;
+      numElements = 0;
+      root = freeHead = nil;
+   }
+
+   /*****************************************************
+    * COMPACT MAP :: ERASE
+    * Erase the element with key k, if there is one
+    ****************************************************/
+   template <class K, class V, class Compare>
+   size_t compactMap <K, V, Compare> ::erase(const K& k)
+   {
+      iterator it = find(k);
+      if (it == end())
+         return size_t(0);
+      erase(it);
+      return size_t(1);
+   }
+
+   /*****************************************************
+    * COMPACT MAP :: ERASE
+    * Erase one element. No node moves, so the next one is found first
+    ****************************************************/
+   template <class K, class V, class Compare>
+   typename compactMap <K, V, Compare> ::iterator compactMap <K, V, Compare> ::erase(iterator it)
+   {
+      uint32_t iNext = next(it.i);
+      unhook(it.i);
+      freeSlot(it.i);
+      return iterator(this, iNext);
+   }
+
+   /*****************************************************
+    * COMPACT MAP :: ERASE
+    * Erase the elements in [first, last)
+    ****************************************************/
+   template <class K, class V, class Compare>
+   typename compactMap <K, V, Compare> ::iterator compactMap <K, V, Compare> ::erase(iterator first, iterator last)
+   {
+      while (first != last)
+         first = erase(first);
+      return last;
+   }
+
+   /*****************************************************
+    * COMPACT MAP :: RESERVE
+    * Make room for num nodes, so the array does not move as they come
+    ****************************************************/
+   template <class K, class V, class Compare>
+   void compactMap <K, V, Compare> ::reserve(size_t num)
+   {
+      if (num > max_size())
+         throw "Error: compactMap holds at most 2^31 - 1 elements";
+      if (num > numCapacity)
+      {
+         Node* pNew = allocate(uint32_t(num));
+         moveTo(pNew, uint32_t(num));
+      }
+   }
+
+   /*****************************************************
+    * COMPACT MAP :: NEW SLOT
+    * Build a pair from args in a node that is not in the tree: the last
+    * one freed, else the next one in the array. A full array doubles,
+    * and the pair is built in the new one before the old is let go, in
+    * case args refers to an element
+    ****************************************************/
+   template <class K, class V, class Compare>
+   template <class ... Args>
+   uint32_t compactMap <K, V, Compare> ::newSlot(Args&& ... args)
+   {
+      if (freeHead != nil)
+      {
+         uint32_t i = freeHead;
+         new (nodes[i].buffer) Pairs(std::forward<Args>(args)...);
+         freeHead = nodes[i].right;
+         nodes[i].parentColor = nil;
+         return i;
+      }
+
+      if (numSlots < numCapacity)
+         new (nodes[numSlots].buffer) Pairs(std::forward<Args>(args)...);
+      else
+      {
+         if (numCapacity == nil)
+            throw "Error: compactMap holds at most 2^31 - 1 elements";
+         uint32_t numNew = (numCapacity ? uint32_t(std::min<size_t>(size_t(numCapacity) * 2, nil)) : 8);
+         Node* pNew = allocate(numNew);
+         try
+         {
+            new (pNew[numSlots].buffer) Pairs(std::forward<Args>(args)...);
+         }
+         catch (...)
+         {
+            deallocate(pNew, numNew);
+            throw;
+         }
+         moveTo(pNew, numNew);
+      }
+      nodes[numSlots].parentColor = nil;
+      return numSlots++;
+   }
+
+   /*****************************************************
+    * COMPACT MAP :: FREE SLOT
+    * Destroy the pair of a node that is out of the tree and put the
+    * node on the free list
+    ****************************************************/
+   template <class K, class V, class Compare>
+   void compactMap <K, V, Compare> ::freeSlot(uint32_t i) noexcept
+   {
+      nodes[i].data().~Pairs();
+      nodes[i].parentColor = freeMark;
+      nodes[i].right = freeHead;
+      freeHead = i;
+   }
+
+   /*****************************************************
+    * COMPACT MAP :: MOVE TO
+    * Move every node into a bigger array. The links are indices, so
+    * they come along as they are
+    ****************************************************/
+   template <class K, class V, class Compare>
+   void compactMap <K, V, Compare> ::moveTo(Node* pNew, uint32_t numNew)
+   {
+      for (uint32_t i = 0; i < numSlots; i++)
+      {
+         pNew[i].left = nodes[i].left;
+         pNew[i].right = nodes[i].right;
+         pNew[i].parentColor = nodes[i].parentColor;
+         if (nodes[i].parentColor != freeMark)
+         {
+            new (pNew[i].buffer) Pairs(std::move(nodes[i].data()));
+            nodes[i].data().~Pairs();
+         }
+      }
+      deallocate(nodes, numCapacity);
+      nodes = pNew;
+      numCapacity = numNew;
+   }
+
+   /*****************************************************
+    * COMPACT MAP :: ALLOCATE
+    * Room for num nodes, none of them built
+    ****************************************************/
+   template <class K, class V, class Compare>
+   typename compactMap <K, V, Compare> ::Node* compactMap <K, V, Compare> ::allocate(uint32_t num)
+   {
+      try
+      {
+         return std::allocator<Node>().allocate(num);
+      }
+      catch (...)
+      {
+         throw "Error: Unable to allocate a node";
+      }
+   }
+
+}
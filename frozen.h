@@ -0,0 +1,683 @@
+/***********************************************************************
+ * Header:
+ *    FROZEN
+ * Summary:
+ *    A read-only snapshot of a map for when it is built once and then
+ *    only searched:
+ *        custom::frozenMap<K, V> frozen = m.freeze();
+ *      __       ____       ____         __
+ *     /  |    .'    '.   .'    '.   _  / /
+ *     `| |   |  .--.  | |  .--.  | (_)/ /
+ *      | |   | |    | | | |    | |   / / _
+ *     _| |_  |  `--'  | |  `--'  |  / / (_)
+ *    |_____|  '.____.'   '.____.'  /_/
+ *
+ *    This will contain the class definition of:
+ *        frozenIterator      : Walks a snapshot in key order
+ *        frozenMap           : The keys in one array in Eytzinger order,
+ *                              the order a breadth first walk of a full
+ *                              tree would visit them, and the values in
+ *                              a second array beside it
+ *        frozenMap<..., true> : For int32_t and int64_t keys: the keys
+ *                              sorted in cache lines, and above them a
+ *                              line for every line of first keys, each
+ *                              searched with the kernels of simd.h
+ *
+ *    The children of the key at i are at 2i and 2i + 1, so a search is
+ *    a loop with no pointers to chase and no branch to mispredict, and
+ *    the keys four levels down from i sit in one cache line, which is
+ *    asked for while the levels above it are compared. Integer keys do
+ *    better still by comparing a whole line at every level
+ * Author
+ *    Sam Heaven, Abram Hansen
+ ************************************************************************/
+
+#pragma once
+
+#include "bst.h"      // for Holder and CUSTOM_PREFETCH
+#include "simd.h"     // for the line search kernels
+#include <cassert>
+#include <cstddef>    // for size_t
+#include <new>        // for std::align_val_t
+#include <iterator>   // for std::reverse_iterator
+#include <algorithm>  // for std::min
+#include <stdexcept>  // for std::out_of_range
+#include <limits>     // for std::numeric_limits
+#include <utility>    // for std::pair
+
+class TestMap; // forward declaration for unit tests
+class BenchBST; // forward declaration for benchmarks
+
+namespace custom
+{
+
+   /**********************************************************
+    * FROZEN ITERATOR
+    * An index into the arrays of a snapshot, moved along by the
+    * snapshot. There is no pair in memory to point to, so the iterator
+    * hands out a pair of references instead
+    *********************************************************/
+   template <class K, class V, class Map>
+   class frozenIterator
+   {
+      friend class ::TestMap; // give unit tests access to the privates
+      friend Map;
+   public:
+      using iterator_category = std::bidirectional_iterator_tag;
+      using value_type        = std::pair <K, V>;
+      using difference_type   = std::ptrdiff_t;
+      using reference         = std::pair <const K &, const V &>;
+      struct pointer
+      {
+         reference ref;
+         const reference* operator -> () const { return &ref; }
+      };
+
+      //
+      // Construct
+      //
+      frozenIterator() : pMap(nullptr), i(0)
+      {
+      }
+
+      //
+      // Compare
+      //
+      bool operator == (const frozenIterator& rhs) const { return i == rhs.i; }
+      bool operator != (const frozenIterator& rhs) const { return i != rhs.i; }
+
+      //
+      // Access
+      //
+      reference operator * () const
+      {
+         return reference(pMap->keys[i], pMap->values[i]);
+      }
+      pointer operator -> () const
+      {
+         return pointer{ **this };
+      }
+
+      //
+      // Increment
+      //
+      frozenIterator& operator ++ ()
+      {
+         i = pMap->next(i);
+         return *this;
+      }
+      frozenIterator operator ++ (int postfix)
+      {
+         frozenIterator itReturn = *this;
+         ++(*this);
+         return itReturn;
+      }
+      frozenIterator& operator -- ()
+      {
+         i = pMap->prev(i);
+         return *this;
+      }
+      frozenIterator operator -- (int postfix)
+      {
+         frozenIterator itReturn = *this;
+         --(*this);
+         return itReturn;
+      }
+
+   private:
+      frozenIterator(const Map* pMap, size_t i) : pMap(pMap), i(i)
+      {
+      }
+
+      const Map* pMap;        // the snapshot walked
+      size_t i;               // index of the pair in its arrays
+   };
+
+   /*****************************************************************
+    * FROZEN MAP
+    * Unique keys, sorted by Compare, that never change. keys[0] and
+    * values[0] are not used, so the root is at 1 and 0 can mean end()
+    *****************************************************************/
+   template <class K, class V, class Compare = std::less<K>,
+             bool isBlocked = simd::canSearch<K, Compare>::value>
+   class frozenMap : private Holder<Compare, 0>
+   {
+      friend class ::TestMap; // give unit tests access to the privates
+      friend class ::BenchBST;
+      friend class frozenIterator<K, V, frozenMap>;
+      using CompareHolder = Holder<Compare, 0>;
+   public:
+      //
+      // Construct
+      //
+
+      frozenMap() : keys(nullptr), values(nullptr), num(0)
+      {
+      }
+      // from num pairs already in order with no key twice, such as
+      // begin() to end() of a map
+      template <class Iterator>
+      frozenMap(Iterator first, Iterator last, size_t num, const Compare& compare = Compare());
+      frozenMap(const frozenMap& rhs) : frozenMap(rhs.begin(), rhs.end(), rhs.num, rhs.comp())
+      {
+      }
+      frozenMap(frozenMap&& rhs) noexcept
+         : CompareHolder(rhs.comp()), keys(rhs.keys), values(rhs.values), num(rhs.num)
+      {
+         rhs.keys = nullptr;
+         rhs.values = nullptr;
+         rhs.num = 0;
+      }
+      ~frozenMap()
+      {
+         destroy(num);
+      }
+
+      //
+      // Assign
+      //
+
+      frozenMap& operator = (frozenMap rhs) noexcept
+      {
+         swap(rhs);
+         return *this;
+      }
+      void swap(frozenMap& rhs) noexcept
+      {
+         using std::swap;
+         swap(CompareHolder::get(), rhs.CompareHolder::get());
+         swap(keys, rhs.keys);
+         swap(values, rhs.values);
+         swap(num, rhs.num);
+      }
+
+      //
+      // Iterator
+      //
+
+      using iterator = frozenIterator<K, V, frozenMap>;
+      using reverse_iterator = std::reverse_iterator<iterator>;
+      iterator begin() const { return iterator(this, first()); }
+      iterator end()   const { return iterator(this, 0); }
+      reverse_iterator rbegin() const { return reverse_iterator(end()); }
+      reverse_iterator rend()   const { return reverse_iterator(begin()); }
+
+      //
+      // Access
+      //
+
+      template <class KK>
+      iterator find(const KK& k) const
+      {
+         size_t i = lowerIndex(k);
+         return iterator(this, (i != 0 && !comp()(k, keys[i])) ? i : 0);
+      }
+      template <class KK>
+      iterator lower_bound(const KK& k) const
+      {
+         return iterator(this, lowerIndex(k));
+      }
+      template <class KK>
+      iterator upper_bound(const KK& k) const
+      {
+         return iterator(this, search([&](const K& key) { return !comp()(k, key); }));
+      }
+      const V& at(const K& k) const
+      {
+         iterator it = find(k);
+         if (it == end())
+            throw std::out_of_range("invalid map<K, T> key");
+         return values[it.i];
+      }
+
+      using key_compare = Compare;
+      key_compare key_comp() const { return comp(); }
+
+      //
+      // Status
+      //
+
+      bool empty() const noexcept { return num == 0; }
+      size_t size() const noexcept { return num; }
+
+   private:
+      // how many keys share a cache line, and so how far down to prefetch
+      static constexpr size_t lineSize = 64;
+      static constexpr size_t keysPerLine = (sizeof(K) < lineSize ? lineSize / sizeof(K) : 1);
+      static constexpr size_t keyAlign = (alignof(K) > lineSize ? alignof(K) : lineSize);
+
+      const Compare& comp() const noexcept { return CompareHolder::get(); }
+
+      template <class KK>
+      size_t lowerIndex(const KK& k) const
+      {
+         return search([&](const K& key) { return comp()(key, k); });
+      }
+      template <class GoRight>
+      size_t search(GoRight goRight) const;
+
+      // walking the implicit tree in order
+      size_t first() const noexcept;
+      size_t last() const noexcept;
+      size_t next(size_t i) const noexcept;
+      size_t prev(size_t i) const noexcept;
+
+      void destroy(size_t numBuilt) noexcept;
+
+      K* keys;                // num + 1 keys, the root at 1
+      V* values;              // the value of keys[i] at values[i]
+      size_t num;             // pairs in the snapshot
+   };
+
+   /*****************************************************
+    * FROZEN MAP :: CONSTRUCTOR
+    * Place the pairs in order at the indices an in-order walk of the
+    * implicit tree visits, so the array is built in one pass
+    ****************************************************/
+   template <class K, class V, class Compare, bool isBlocked>
+   template <class Iterator>
+   frozenMap <K, V, Compare, isBlocked> ::frozenMap(Iterator itFirst, Iterator itLast, size_t num, const Compare& compare)
+      : CompareHolder(compare), keys(nullptr), values(nullptr), num(num)
+   {
+      if (num == 0)
+         return;
+      try
+      {
+         keys = static_cast<K*>(::operator new(sizeof(K) * (num + 1), std::align_val_t(keyAlign)));
+         values = static_cast<V*>(::operator new(sizeof(V) * (num + 1), std::align_val_t(alignof(V))));
+      }
+      catch (...)
+      {
+         if (keys)
+            ::operator delete(keys, std::align_val_t(keyAlign));
+         throw "Error: Unable to allocate a snapshot";
+      }
+
+      size_t numBuilt = 0;
+      try
+      {
+         size_t i = first();
+         for (Iterator it = itFirst; it != itLast && numBuilt < num; ++it, ++numBuilt, i = next(i))
+         {
+            new (keys + i) K((*it).first);
+            try
+            {
+               new (values + i) V((*it).second);
+            }
+            catch (...)
+            {
+               keys[i].~K();
+               throw;
+            }
+         }
+         assert(numBuilt == num);
+      }
+      catch (...)
+      {
+         destroy(numBuilt);
+         throw;
+      }
+   }
+
+   /*****************************************************
+    * FROZEN MAP :: SEARCH
+    * Go down from the root, right wherever goRight(key) and left
+    * otherwise, until falling off the bottom. The answer is the last
+    * node we went left at: strip the right turns after it, then that
+    * left turn, off the end of the index. The keys some levels down are
+    * fetched while the ones above them are compared
+    ****************************************************/
+   template <class K, class V, class Compare, bool isBlocked>
+   template <class GoRight>
+   size_t frozenMap <K, V, Compare, isBlocked> ::search(GoRight goRight) const
+   {
+      size_t i = 1;
+      while (i <= num)
+      {
+         CUSTOM_PREFETCH(keys + std::min(i * keysPerLine, num));
+         i = 2 * i + size_t(goRight(keys[i]));
+      }
+#if defined(__GNUC__) || defined(__clang__)
+      return i >> __builtin_ffsll((long long)~i);
+#else
+      while (i & 1)
+         i >>= 1;
+      return i >> 1;
+#endif
+   }
+
+   /*****************************************************
+    * FROZEN MAP :: FIRST, LAST
+    * All the way left, or right, from the root
+    ****************************************************/
+   template <class K, class V, class Compare, bool isBlocked>
+   size_t frozenMap <K, V, Compare, isBlocked> ::first() const noexcept
+   {
+      if (num == 0)
+         return 0;
+      size_t i = 1;
+      while (2 * i <= num)
+         i = 2 * i;
+      return i;
+   }
+
+   template <class K, class V, class Compare, bool isBlocked>
+   size_t frozenMap <K, V, Compare, isBlocked> ::last() const noexcept
+   {
+      if (num == 0)
+         return 0;
+      size_t i = 1;
+      while (2 * i + 1 <= num)
+         i = 2 * i + 1;
+      return i;
+   }
+
+   /*****************************************************
+    * FROZEN MAP :: NEXT
+    * The leftmost of the right child, or else up past every right
+    * child to the first parent we came to from the left
+    ****************************************************/
+   template <class K, class V, class Compare, bool isBlocked>
+   size_t frozenMap <K, V, Compare, isBlocked> ::next(size_t i) const noexcept
+   {
+      if (2 * i + 1 <= num)
+      {
+         i = 2 * i + 1;
+         while (2 * i <= num)
+            i = 2 * i;
+         return i;
+      }
+      while (i & 1)
+         i >>= 1;
+      return i >> 1;
+   }
+
+   /*****************************************************
+    * FROZEN MAP :: PREV
+    * The mirror of next(), and the last pair from end()
+    ****************************************************/
+   template <class K, class V, class Compare, bool isBlocked>
+   size_t frozenMap <K, V, Compare, isBlocked> ::prev(size_t i) const noexcept
+   {
+      if (i == 0)
+         return last();
+      if (2 * i <= num)
+      {
+         i = 2 * i;
+         while (2 * i + 1 <= num)
+            i = 2 * i + 1;
+         return i;
+      }
+      while (i > 1 && !(i & 1))
+         i >>= 1;
+      return i >> 1;
+   }
+
+   /*****************************************************
+    * FROZEN MAP :: DESTROY
+    * Destroy the first numBuilt pairs in order and free the arrays
+    ****************************************************/
+   template <class K, class V, class Compare, bool isBlocked>
+   void frozenMap <K, V, Compare, isBlocked> ::destroy(size_t numBuilt) noexcept
+   {
+      if (keys == nullptr)
+         return;
+      for (size_t i = first(); numBuilt > 0; numBuilt--, i = next(i))
+      {
+         keys[i].~K();
+         values[i].~V();
+      }
+      ::operator delete(keys, std::align_val_t(keyAlign));
+      ::operator delete(values, std::align_val_t(alignof(V)));
+      keys = nullptr;
+      values = nullptr;
+   }
+
+   /*****************************************************************
+    * FROZEN MAP, BLOCKED
+    * For int32_t and int64_t keys under std::less. The keys are sorted
+    * in lines of lineKeys, the last one filled out with the largest key
+    * there is. Above them is a level holding the first key of every
+    * line, in lines of its own, and so on up to a level of one line.
+    * A search counts, with one kernel call a level, how many of the
+    * first keys in a line are below the key, and goes down into the
+    * line before that. The pairs are at 0 .. num - 1, and end() is num
+    *****************************************************************/
+   template <class K, class V, class Compare>
+   class frozenMap <K, V, Compare, true> : private Holder<Compare, 0>
+   {
+      friend class ::TestMap; // give unit tests access to the privates
+      friend class ::BenchBST;
+      friend class frozenIterator<K, V, frozenMap>;
+      using CompareHolder = Holder<Compare, 0>;
+   public:
+      //
+      // Construct
+      //
+
+      frozenMap() : keys(nullptr), values(nullptr), num(0), numLevels(0)
+      {
+      }
+      // from num pairs already in order with no key twice, such as
+      // begin() to end() of a map
+      template <class Iterator>
+      frozenMap(Iterator first, Iterator last, size_t num, const Compare& compare = Compare());
+      frozenMap(const frozenMap& rhs) : frozenMap(rhs.begin(), rhs.end(), rhs.num, rhs.comp())
+      {
+      }
+      frozenMap(frozenMap&& rhs) noexcept : frozenMap()
+      {
+         swap(rhs);
+      }
+      ~frozenMap()
+      {
+         destroy(num);
+      }
+
+      //
+      // Assign
+      //
+
+      frozenMap& operator = (frozenMap rhs) noexcept
+      {
+         swap(rhs);
+         return *this;
+      }
+      void swap(frozenMap& rhs) noexcept
+      {
+         using std::swap;
+         swap(CompareHolder::get(), rhs.CompareHolder::get());
+         swap(keys, rhs.keys);
+         swap(values, rhs.values);
+         swap(num, rhs.num);
+         swap(levels, rhs.levels);
+         swap(levelSizes, rhs.levelSizes);
+         swap(numLevels, rhs.numLevels);
+      }
+
+      //
+      // Iterator
+      //
+
+      using iterator = frozenIterator<K, V, frozenMap>;
+      using reverse_iterator = std::reverse_iterator<iterator>;
+      iterator begin() const { return iterator(this, 0); }
+      iterator end()   const { return iterator(this, num); }
+      reverse_iterator rbegin() const { return reverse_iterator(end()); }
+      reverse_iterator rend()   const { return reverse_iterator(begin()); }
+
+      //
+      // Access
+      //
+
+      iterator find(const K& k) const
+      {
+         size_t i = search(k, simd::best<K>().countLess);
+         return iterator(this, (i != num && !(k < keys[i])) ? i : num);
+      }
+      iterator lower_bound(const K& k) const
+      {
+         return iterator(this, search(k, simd::best<K>().countLess));
+      }
+      iterator upper_bound(const K& k) const
+      {
+         return iterator(this, search(k, simd::best<K>().countLessEqual));
+      }
+      const V& at(const K& k) const
+      {
+         iterator it = find(k);
+         if (it == end())
+            throw std::out_of_range("invalid map<K, T> key");
+         return values[it.i];
+      }
+
+      using key_compare = Compare;
+      key_compare key_comp() const { return comp(); }
+
+      //
+      // Status
+      //
+
+      bool empty() const noexcept { return num == 0; }
+      size_t size() const noexcept { return num; }
+
+   private:
+      static constexpr size_t lineKeys = simd::lineSize / sizeof(K);
+      // sixteen levels of sixteen or more lines is more keys than memory
+      static constexpr size_t maxLevels = 16;
+
+      const Compare& comp() const noexcept { return CompareHolder::get(); }
+
+      // the first index whose key count() does not count, or num
+      size_t search(K k, size_t (*count)(const K* line, K k)) const;
+
+      size_t next(size_t i) const noexcept { return i + 1; }
+      size_t prev(size_t i) const noexcept { return i - 1; }
+
+      static size_t roundUp(size_t num) { return (num + lineKeys - 1) / lineKeys * lineKeys; }
+      void destroy(size_t numBuilt) noexcept;
+
+      K* keys;                      // level 0, and the one allocation for every level
+      V* values;                    // the value of keys[i] at values[i]
+      size_t num;                   // pairs in the snapshot
+      K* levels[maxLevels];         // levels[0] is keys, the last one is a line
+      size_t levelSizes[maxLevels]; // keys in each level, not counting the fill
+      size_t numLevels;
+   };
+
+   /*****************************************************
+    * FROZEN MAP, BLOCKED :: CONSTRUCTOR
+    * Copy the pairs in, then build each level from the one below
+    ****************************************************/
+   template <class K, class V, class Compare>
+   template <class Iterator>
+   frozenMap <K, V, Compare, true> ::frozenMap(Iterator itFirst, Iterator itLast, size_t num, const Compare& compare)
+      : CompareHolder(compare), keys(nullptr), values(nullptr), num(num), numLevels(0)
+   {
+      if (num == 0)
+         return;
+
+      // how big each level is, and all of them together
+      size_t numSlots = 0;
+      for (size_t size = num; ; size = (size + lineKeys - 1) / lineKeys)
+      {
+         levelSizes[numLevels++] = size;
+         numSlots += roundUp(size);
+         if (size <= lineKeys)
+            break;
+      }
+      assert(numLevels <= maxLevels);
+
+      try
+      {
+         keys = static_cast<K*>(::operator new(sizeof(K) * numSlots, std::align_val_t(simd::lineSize)));
+         values = static_cast<V*>(::operator new(sizeof(V) * num, std::align_val_t(alignof(V))));
+      }
+      catch (...)
+      {
+         if (keys)
+            ::operator delete(keys, std::align_val_t(simd::lineSize));
+         throw "Error: Unable to allocate a snapshot";
+      }
+
+      size_t numBuilt = 0;
+      try
+      {
+         for (Iterator it = itFirst; it != itLast && numBuilt < num; ++it, ++numBuilt)
+         {
+            new (values + numBuilt) V((*it).second);
+            keys[numBuilt] = (*it).first;
+         }
+         assert(numBuilt == num);
+      }
+      catch (...)
+      {
+         destroy(numBuilt);
+         throw;
+      }
+
+      // fill out each level and build the next from its first keys
+      K* pLevel = keys;
+      for (size_t level = 0; level < numLevels; level++)
+      {
+         levels[level] = pLevel;
+         if (level > 0)
+            for (size_t i = 0; i < levelSizes[level]; i++)
+               pLevel[i] = levels[level - 1][i * lineKeys];
+         for (size_t i = levelSizes[level]; i < roundUp(levelSizes[level]); i++)
+            pLevel[i] = std::numeric_limits<K>::max();
+         pLevel += roundUp(levelSizes[level]);
+      }
+   }
+
+   /*****************************************************
+    * FROZEN MAP, BLOCKED :: SEARCH
+    * In each line on the way down, count the first keys of the lines
+    * below that count() counts and go into the last of those, where the
+    * answer is or else just after it. The fill is the largest key, so
+    * only a search for that key counts it, and the count is kept to the
+    * lines that are there
+    ****************************************************/
+   template <class K, class V, class Compare>
+   size_t frozenMap <K, V, Compare, true> ::search(K k, size_t (*count)(const K* line, K k)) const
+   {
+      if (num == 0)
+         return 0;
+      size_t line = 0;
+      for (size_t level = numLevels - 1; level > 0; level--)
+      {
+         size_t numBelow = std::min(count(levels[level] + line * lineKeys, k),
+                                    levelSizes[level] - line * lineKeys);
+         line = line * lineKeys + (numBelow ? numBelow - 1 : 0);
+      }
+      return std::min(line * lineKeys + count(keys + line * lineKeys, k), num);
+   }
+
+   /*****************************************************
+    * FROZEN MAP, BLOCKED :: DESTROY
+    * Destroy the first numBuilt values and free the arrays
+    ****************************************************/
+   template <class K, class V, class Compare>
+   void frozenMap <K, V, Compare, true> ::destroy(size_t numBuilt) noexcept
+   {
+      if (keys == nullptr)
+         return;
+      for (size_t i = 0; i < numBuilt; i++)
+         values[i].~V();
+      ::operator delete(keys, std::align_val_t(simd::lineSize));
+      ::operator delete(values, std::align_val_t(alignof(V)));
+      keys = nullptr;
+      values = nullptr;
+   }
+
+   /*****************************************************
+    * SWAP
+    * Swap two snapshots
+    ****************************************************/
+   template <class K, class V, class Compare, bool isBlocked>
+   void swap(frozenMap <K, V, Compare, isBlocked>& lhs, frozenMap <K, V, Compare, isBlocked>& rhs)
+   {
+      lhs.swap(rhs);
+   }
+
+}
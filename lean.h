@@ -0,0 +1,959 @@
+/***********************************************************************
+ * Header:
+ *    LEAN
+ * Summary:
+ *    A map with the interface of custom::map whose nodes have no parent
+ *    pointer. The way back up the tree is kept on a stack instead:
+ *        custom::leanMap<K, V>
+ *      __       ____       ____         __
+ *     /  |    .'    '.   .'    '.   _  / /
+ *     `| |   |  .--.  | |  .--.  | (_)/ /
+ *      | |   | |    | | | |    | |   / / _
+ *     _| |_  |  `--'  | |  `--'  |  / / (_)
+ *    |_____|  '.____.'   '.____.'  /_/
+ *
+ *    This will contain the class definition of:
+ *        leanMap             : A red-black map whose nodes hold two child
+ *                              pointers, the color and the pair. Insert
+ *                              and erase rebalance along the path they
+ *                              came down
+ *        leanMap::iterator   : An iterator through a leanMap, carrying the
+ *                              ancestors of its element
+ *
+ *    A node of a leanMap<int, int> is 32 bytes where a node of a
+ *    map<int, int> is 40. The price is paid by the iterators: each holds
+ *    up to maxDepth ancestors, and any insert or erase may rotate them
+ *    out from under it, so an iterator is only good until the map
+ *    changes. erase(it) hands back one that is good again
+ * Author
+ *    Sam Heaven, Abram Hansen
+ ************************************************************************/
+
+#pragma once
+
+#include "pair.h"     // for pair
+#include "bst.h"      // for Holder
+#include <stdexcept>  // for std::out_of_range
+#include <iterator>   // for std::reverse_iterator
+#include <functional> // for std::less
+
+class TestMap; // forward declaration for unit tests
+class BenchBST; // forward declaration for benchmarks
+
+namespace custom
+{
+
+   /*****************************************************************
+    * LEAN MAP
+    * A red-black map without parent pointers. A red-black tree of n
+    * nodes is at most 2 log(n + 1) deep, so a path of maxDepth nodes
+    * reaches the bottom of any leanMap of up to 2^32 - 1 elements
+    *****************************************************************/
+   template <class K, class V, class Compare = std::less<K>>
+   class leanMap : private Holder<Compare, 0>
+   {
+      friend class ::TestMap; // give unit tests access to the privates
+      friend class ::BenchBST;
+      template <class KK, class VV, class CC>
+      friend void swap(leanMap<KK, VV, CC>& lhs, leanMap<KK, VV, CC>& rhs);
+      using CompareHolder = Holder<Compare, 0>;
+   public:
+      using Pairs = custom::pair<K, V>;
+      static constexpr int maxDepth = 64;
+
+      //
+      // Construct
+      //
+
+      leanMap() : root(nullptr), numElements(0)
+      {
+      }
+      explicit leanMap(const Compare& compare) : CompareHolder(compare), root(nullptr), numElements(0)
+      {
+      }
+      leanMap(const leanMap& rhs) : CompareHolder(rhs.comp()), root(nullptr), numElements(0)
+      {
+         root = copyNodes(rhs.root);
+         numElements = rhs.numElements;
+      }
+      leanMap(leanMap&& rhs) noexcept : leanMap(rhs.comp())
+      {
+         swap(rhs);
+      }
+      template <class Iterator>
+      leanMap(Iterator first, Iterator last) : leanMap()
+      {
+         insert(first, last);
+      }
+      leanMap(const std::initializer_list <Pairs>& il) : leanMap()
+      {
+         insert(il);
+      }
+      ~leanMap()
+      {
+         clear();
+      }
+
+      //
+      // Assign
+      //
+
+      leanMap& operator = (const leanMap& rhs)
+      {
+         if (this != &rhs)
+         {
+            leanMap copy(rhs);
+            swap(copy);
+         }
+         return *this;
+      }
+      leanMap& operator = (leanMap&& rhs) noexcept
+      {
+         clear();
+         swap(rhs);
+         return *this;
+      }
+      leanMap& operator = (const std::initializer_list <Pairs>& il)
+      {
+         clear();
+         insert(il);
+         return *this;
+      }
+      void swap(leanMap& rhs) noexcept
+      {
+         using std::swap;
+         swap(CompareHolder::get(), rhs.CompareHolder::get());
+         swap(root, rhs.root);
+         swap(numElements, rhs.numElements);
+      }
+
+      //
+      // Iterator
+      //
+
+      class iterator;
+      using reverse_iterator = std::reverse_iterator<iterator>;
+      iterator begin() const;
+      iterator end() const
+      {
+         return iterator(this);
+      }
+      reverse_iterator rbegin() const
+      {
+         return reverse_iterator(end());
+      }
+      reverse_iterator rend() const
+      {
+         return reverse_iterator(begin());
+      }
+
+      //
+      // Access
+      //
+
+      const V& operator [] (const K& k) const
+      {
+         return at(k);
+      }
+      V& operator [] (const K& k)
+      {
+         return const_cast<V&>((*try_emplace(k).first).second);
+      }
+      const V& at(const K& k) const
+      {
+         return const_cast<leanMap&>(*this).at(k);
+      }
+      V& at(const K& k);
+
+      using key_compare = Compare;
+      key_compare key_comp() const { return comp(); }
+
+      template <class KK>
+      iterator find(const KK& k) const;
+      template <class KK>
+      iterator lower_bound(const KK& k) const;
+      template <class KK>
+      iterator upper_bound(const KK& k) const;
+      template <class KK>
+      std::pair<iterator, iterator> equal_range(const KK& k) const
+      {
+         return std::pair<iterator, iterator>(lower_bound(k), upper_bound(k));
+      }
+
+      //
+      // Insert
+      //
+
+      custom::pair<iterator, bool> insert(const Pairs& rhs)
+      {
+         return tryEmplace(rhs.first, rhs);
+      }
+      custom::pair<iterator, bool> insert(Pairs&& rhs)
+      {
+         return tryEmplace(rhs.first, std::move(rhs));
+      }
+      iterator insert(iterator hint, const Pairs& rhs)
+      {
+         return insert(rhs).first;
+      }
+      iterator insert(iterator hint, Pairs&& rhs)
+      {
+         return insert(std::move(rhs)).first;
+      }
+      template <class Iterator>
+      void insert(Iterator first, Iterator last)
+      {
+         for (auto it = first; it != last; ++it)
+            insert(*it);
+      }
+      void insert(const std::initializer_list <Pairs>& il)
+      {
+         for (auto&& element : il)
+            insert(element);
+      }
+
+      // build the pair in its node rather than copying one in
+      template <class ... Args>
+      custom::pair<iterator, bool> emplace(Args&& ... args);
+      template <class ... Args>
+      iterator emplace_hint(iterator hint, Args&& ... args)
+      {
+         return emplace(std::forward<Args>(args)...).first;
+      }
+
+      // and do not build the value at all if the key is taken
+      template <class ... Args>
+      custom::pair<iterator, bool> try_emplace(const K& k, Args&& ... args)
+      {
+         return tryEmplace(k, std::in_place, k, std::forward<Args>(args)...);
+      }
+      template <class ... Args>
+      custom::pair<iterator, bool> try_emplace(K&& k, Args&& ... args)
+      {
+         // the search is done with k before the node takes it
+         return tryEmplace(k, std::in_place, std::move(k), std::forward<Args>(args)...);
+      }
+
+      //
+      // Remove
+      //
+
+      void clear() noexcept
+      {
+         deleteNodes(root);
+         root = nullptr;
+         numElements = 0;
+      }
+      size_t erase(const K& k);
+      iterator erase(iterator it);
+      iterator erase(iterator first, iterator last);
+
+      //
+      // Status
+      //
+
+      bool empty() const noexcept { return numElements == 0; }
+      size_t size() const noexcept { return numElements; }
+      size_t max_size() const noexcept { return 0xFFFFFFFF; }
+
+   private:
+      struct Node;
+
+      // the nodes from the root down to where a search stopped
+      struct Path
+      {
+         Node* nodes[maxDepth];
+         int depth;              // index of the last node, -1 if none
+      };
+
+      const Compare& comp() const noexcept { return CompareHolder::get(); }
+      static bool isRed(const Node* p) { return p != nullptr && p->isRed; }
+
+      template <class KK>
+      bool search(const KK& k, Path& path) const;
+      template <class KK, class ... Args>
+      custom::pair<iterator, bool> tryEmplace(const KK& k, Args&& ... args);
+      iterator hookUp(Node* pNew, Path& path);
+      void unhook(Path& path);
+      Node*& linkTo(const Path& path, int depth);
+      static void rotateLeft(Node*& pLink);
+      static void rotateRight(Node*& pLink);
+      void repairInsert(Path& path);
+      void repairErase(Path& path, bool isLeft);
+      static Node* copyNodes(const Node* pSrc);
+      static void deleteNodes(Node* p) noexcept;
+
+      Node* root;             // root of the tree, or nullptr
+      size_t numElements;     // nodes in the tree
+   };
+
+   /*****************************************************************
+    * LEAN MAP :: NODE
+    * The pair, its children and its color. No parent
+    *****************************************************************/
+   template <class K, class V, class Compare>
+   struct leanMap <K, V, Compare> ::Node
+   {
+      template <class ... Args>
+      Node(Args&& ... args) : data(std::forward<Args>(args)...), pLeft(nullptr), pRight(nullptr), isRed(true)
+      {
+      }
+
+      Pairs data;
+      Node* pLeft;
+      Node* pRight;
+      bool isRed;
+   };
+
+   /**********************************************************
+    * LEAN MAP ITERATOR
+    * The element and every node above it, root first. Stepping
+    * climbs the stack the way a BST iterator climbs pParent
+    *********************************************************/
+   template <class K, class V, class Compare>
+   class leanMap <K, V, Compare> ::iterator
+   {
+      friend class ::TestMap; // give unit tests access to the privates
+      friend class leanMap;
+   public:
+      using iterator_category = std::bidirectional_iterator_tag;
+      using value_type        = pair <K, V>;
+      using difference_type   = std::ptrdiff_t;
+      using pointer           = const pair <K, V> *;
+      using reference         = const pair <K, V> &;
+
+      //
+      // Construct
+      //
+      iterator() : pMap(nullptr)
+      {
+         path.depth = -1;
+      }
+
+      //
+      // Compare
+      //
+      bool operator == (const iterator& rhs) const { return current() == rhs.current(); }
+      bool operator != (const iterator& rhs) const { return current() != rhs.current(); }
+
+      //
+      // Access
+      //
+      const pair <K, V>& operator * () const
+      {
+         return current()->data;
+      }
+      const pair <K, V>* operator -> () const
+      {
+         return &current()->data;
+      }
+
+      //
+      // Increment
+      //
+      iterator& operator ++ ();
+      iterator operator ++ (int postfix)
+      {
+         iterator itReturn = *this;
+         ++(*this);
+         return itReturn;
+      }
+      iterator& operator -- ();
+      iterator operator -- (int postfix)
+      {
+         iterator itReturn = *this;
+         --(*this);
+         return itReturn;
+      }
+
+   private:
+      explicit iterator(const leanMap* pMap) : pMap(pMap)
+      {
+         path.depth = -1;
+      }
+      Node* current() const { return path.depth < 0 ? nullptr : path.nodes[path.depth]; }
+
+      // push p and everything down its left or right edge
+      void pushLeftmost(Node* p)
+      {
+         for (; p; p = p->pLeft)
+            path.nodes[++path.depth] = p;
+      }
+      void pushRightmost(Node* p)
+      {
+         for (; p; p = p->pRight)
+            path.nodes[++path.depth] = p;
+      }
+
+      const leanMap* pMap;    // the map, for the root when stepping back from end()
+      Path path;              // the element on top, end() when empty
+   };
+
+   /*****************************************************
+    * LEAN MAP ITERATOR :: INCREMENT
+    * Down the right subtree if there is one, else up the stack past
+    * every node we are the right child of
+    ****************************************************/
+   template <class K, class V, class Compare>
+   typename leanMap <K, V, Compare> ::iterator& leanMap <K, V, Compare> ::iterator::operator ++ ()
+   {
+      Node* p = path.nodes[path.depth];
+      if (p->pRight)
+         pushLeftmost(p->pRight);
+      else
+      {
+         do
+         {
+            p = path.nodes[path.depth--];
+         } while (path.depth >= 0 && path.nodes[path.depth]->pRight == p);
+      }
+      return *this;
+   }
+
+   /*****************************************************
+    * LEAN MAP ITERATOR :: DECREMENT
+    * The mirror image, and from end() the rightmost node
+    ****************************************************/
+   template <class K, class V, class Compare>
+   typename leanMap <K, V, Compare> ::iterator& leanMap <K, V, Compare> ::iterator::operator -- ()
+   {
+      if (path.depth < 0)
+      {
+         pushRightmost(pMap->root);
+         return *this;
+      }
+
+      Node* p = path.nodes[path.depth];
+      if (p->pLeft)
+         pushRightmost(p->pLeft);
+      else
+      {
+         do
+         {
+            p = path.nodes[path.depth--];
+         } while (path.depth >= 0 && path.nodes[path.depth]->pLeft == p);
+      }
+      return *this;
+   }
+
+   /*****************************************************
+    * LEAN MAP :: BEGIN
+    ****************************************************/
+   template <class K, class V, class Compare>
+   typename leanMap <K, V, Compare> ::iterator leanMap <K, V, Compare> ::begin() const
+   {
+      iterator it(this);
+      it.pushLeftmost(root);
+      return it;
+   }
+
+   /*****************************************************
+    * LEAN MAP :: AT
+    * Retrieve an element from the map
+    ****************************************************/
+   template <class K, class V, class Compare>
+   V& leanMap <K, V, Compare> ::at(const K& k)
+   {
+      iterator it = find(k);
+      if (it == end())
+         throw std::out_of_range("invalid map<K, T> key");
+      return it.current()->data.second;
+   }
+
+   /*****************************************************
+    * LEAN MAP :: SEARCH
+    * Record the way down to k, one comparison per level. True with k on
+    * top if it is there; false with the node it would hang under on top
+    ****************************************************/
+   template <class K, class V, class Compare>
+   template <class KK>
+   bool leanMap <K, V, Compare> ::search(const KK& k, Path& path) const
+   {
+      path.depth = -1;
+      int depthNotGreater = -1;
+      for (Node* p = root; p; )
+      {
+         path.nodes[++path.depth] = p;
+         if (comp()(k, p->data.first))
+            p = p->pLeft;
+         else
+         {
+            depthNotGreater = path.depth;
+            p = p->pRight;
+         }
+      }
+
+      if (depthNotGreater >= 0 && !comp()(path.nodes[depthNotGreater]->data.first, k))
+      {
+         path.depth = depthNotGreater;
+         return true;
+      }
+      return false;
+   }
+
+   /*****************************************************
+    * LEAN MAP :: FIND
+    ****************************************************/
+   template <class K, class V, class Compare>
+   template <class KK>
+   typename leanMap <K, V, Compare> ::iterator leanMap <K, V, Compare> ::find(const KK& k) const
+   {
+      iterator it(this);
+      if (!search(k, it.path))
+         it.path.depth = -1;
+      return it;
+   }
+
+   /*****************************************************
+    * LEAN MAP :: LOWER BOUND
+    * The path down to the first element not less than k
+    ****************************************************/
+   template <class K, class V, class Compare>
+   template <class KK>
+   typename leanMap <K, V, Compare> ::iterator leanMap <K, V, Compare> ::lower_bound(const KK& k) const
+   {
+      iterator it(this);
+      int depthFound = -1;
+      for (Node* p = root; p; )
+      {
+         it.path.nodes[++it.path.depth] = p;
+         if (comp()(p->data.first, k))
+            p = p->pRight;
+         else
+         {
+            depthFound = it.path.depth;
+            p = p->pLeft;
+         }
+      }
+      it.path.depth = depthFound;
+      return it;
+   }
+
+   /*****************************************************
+    * LEAN MAP :: UPPER BOUND
+    * The path down to the first element greater than k
+    ****************************************************/
+   template <class K, class V, class Compare>
+   template <class KK>
+   typename leanMap <K, V, Compare> ::iterator leanMap <K, V, Compare> ::upper_bound(const KK& k) const
+   {
+      iterator it(this);
+      int depthFound = -1;
+      for (Node* p = root; p; )
+      {
+         it.path.nodes[++it.path.depth] = p;
+         if (comp()(k, p->data.first))
+         {
+            depthFound = it.path.depth;
+            p = p->pLeft;
+         }
+         else
+            p = p->pRight;
+      }
+      it.path.depth = depthFound;
+      return it;
+   }
+
+   /*****************************************************
+    * LEAN MAP :: TRY EMPLACE
+    * Look for k, and only if it is missing build a pair from args
+    ****************************************************/
+   template <class K, class V, class Compare>
+   template <class KK, class ... Args>
+   custom::pair<typename leanMap <K, V, Compare> ::iterator, bool> leanMap <K, V, Compare> ::tryEmplace(const KK& k, Args&& ... args)
+   {
+      iterator it(this);
+      if (search(k, it.path))
+         return custom::pair<iterator, bool>(it, false);
+      if (numElements == max_size())
+         throw "Error: leanMap holds at most 2^32 - 1 elements";
+
+      Node* pNew = nullptr;
+      try
+      {
+         pNew = new Node(std::forward<Args>(args)...);
+      }
+      catch (const std::bad_alloc&)
+      {
+         throw "Error: Unable to allocate a node";
+      }
+      return custom::pair<iterator, bool>(hookUp(pNew, it.path), true);
+   }
+
+   /*****************************************************
+    * LEAN MAP :: EMPLACE
+    * Build the pair first, since its key is in the arguments somewhere,
+    * and throw it away if the key is taken
+    ****************************************************/
+   template <class K, class V, class Compare>
+   template <class ... Args>
+   custom::pair<typename leanMap <K, V, Compare> ::iterator, bool> leanMap <K, V, Compare> ::emplace(Args&& ... args)
+   {
+      Node* pNew = nullptr;
+      try
+      {
+         pNew = new Node(std::forward<Args>(args)...);
+      }
+      catch (const std::bad_alloc&)
+      {
+         throw "Error: Unable to allocate a node";
+      }
+
+      iterator it(this);
+      if (search(pNew->data.first, it.path))
+      {
+         delete pNew;
+         return custom::pair<iterator, bool>(it, false);
+      }
+      if (numElements == max_size())
+      {
+         delete pNew;
+         throw "Error: leanMap holds at most 2^32 - 1 elements";
+      }
+      return custom::pair<iterator, bool>(hookUp(pNew, it.path), true);
+   }
+
+   /*****************************************************
+    * LEAN MAP :: HOOK UP
+    * Hang a new red node under the top of the path and restore the
+    * balance. Hand back the way down to it
+    ****************************************************/
+   template <class K, class V, class Compare>
+   typename leanMap <K, V, Compare> ::iterator leanMap <K, V, Compare> ::hookUp(Node* pNew, Path& path)
+   {
+      if (path.depth < 0)
+         root = pNew;
+      else if (comp()(pNew->data.first, path.nodes[path.depth]->data.first))
+         path.nodes[path.depth]->pLeft = pNew;
+      else
+         path.nodes[path.depth]->pRight = pNew;
+      path.nodes[++path.depth] = pNew;
+      numElements++;
+
+      repairInsert(path);
+
+      // the rotations reshaped the path, so come down to the node again
+      iterator it(this);
+      search(pNew->data.first, it.path);
+      return it;
+   }
+
+   /*****************************************************
+    * LEAN MAP :: LINK TO
+    * The pointer that holds the node at depth: the root, or the left or
+    * right of the node above it
+    ****************************************************/
+   template <class K, class V, class Compare>
+   typename leanMap <K, V, Compare> ::Node*& leanMap <K, V, Compare> ::linkTo(const Path& path, int depth)
+   {
+      if (depth == 0)
+         return root;
+      Node* pParent = path.nodes[depth - 1];
+      return (pParent->pLeft == path.nodes[depth] ? pParent->pLeft : pParent->pRight);
+   }
+
+   /*****************************************************
+    * LEAN MAP :: ROTATE LEFT, ROTATE RIGHT
+    * The child takes the place of the node held by pLink
+    ****************************************************/
+   template <class K, class V, class Compare>
+   void leanMap <K, V, Compare> ::rotateLeft(Node*& pLink)
+   {
+      Node* pDown = pLink;
+      Node* pUp = pDown->pRight;
+      pDown->pRight = pUp->pLeft;
+      pUp->pLeft = pDown;
+      pLink = pUp;
+   }
+
+   template <class K, class V, class Compare>
+   void leanMap <K, V, Compare> ::rotateRight(Node*& pLink)
+   {
+      Node* pDown = pLink;
+      Node* pUp = pDown->pLeft;
+      pDown->pLeft = pUp->pRight;
+      pUp->pRight = pDown;
+      pLink = pUp;
+   }
+
+   /*****************************************************
+    * LEAN MAP :: REPAIR INSERT
+    * Red-black fixup after the red node on top of the path is hung: the
+    * parent and grandparent come off the path where pParent would be
+    ****************************************************/
+   template <class K, class V, class Compare>
+   void leanMap <K, V, Compare> ::repairInsert(Path& path)
+   {
+      int depth = path.depth;
+      while (depth > 0 && isRed(path.nodes[depth - 1]))
+      {
+         // a red parent is never the root, so there is a grandparent
+         Node* pNode = path.nodes[depth];
+         Node* pParent = path.nodes[depth - 1];
+         Node* pGranny = path.nodes[depth - 2];
+         if (pParent == pGranny->pLeft)
+         {
+            Node* pAunt = pGranny->pRight;
+            if (isRed(pAunt))
+            {
+               pParent->isRed = pAunt->isRed = false;
+               pGranny->isRed = true;
+               depth -= 2;
+               continue;
+            }
+            if (pNode == pParent->pRight)
+            {
+               rotateLeft(pGranny->pLeft);
+               pParent = pNode;
+            }
+            pParent->isRed = false;
+            pGranny->isRed = true;
+            rotateRight(linkTo(path, depth - 2));
+         }
+         else
+         {
+            Node* pAunt = pGranny->pLeft;
+            if (isRed(pAunt))
+            {
+               pParent->isRed = pAunt->isRed = false;
+               pGranny->isRed = true;
+               depth -= 2;
+               continue;
+            }
+            if (pNode == pParent->pLeft)
+            {
+               rotateRight(pGranny->pRight);
+               pParent = pNode;
+            }
+            pParent->isRed = false;
+            pGranny->isRed = true;
+            rotateLeft(linkTo(path, depth - 2));
+         }
+         break;
+      }
+      root->isRed = false;
+   }
+
+   /*****************************************************
+    * LEAN MAP :: ERASE
+    * Erase the element with key k, if there is one
+    ****************************************************/
+   template <class K, class V, class Compare>
+   size_t leanMap <K, V, Compare> ::erase(const K& k)
+   {
+      Path path;
+      if (!search(k, path))
+         return size_t(0);
+      unhook(path);
+      return size_t(1);
+   }
+
+   /*****************************************************
+    * LEAN MAP :: ERASE
+    * Erase one element, using the path the iterator already has, and
+    * come down again to the element after it
+    ****************************************************/
+   template <class K, class V, class Compare>
+   typename leanMap <K, V, Compare> ::iterator leanMap <K, V, Compare> ::erase(iterator it)
+   {
+      iterator itNext = it;
+      ++itNext;
+      Node* pNext = itNext.current();
+      unhook(it.path);
+
+      iterator itReturn(this);
+      if (pNext)
+         search(pNext->data.first, itReturn.path);
+      return itReturn;
+   }
+
+   /*****************************************************
+    * LEAN MAP :: ERASE
+    * Erase [first, last) one at a time. Rebalancing can rotate the nodes
+    * on the path last holds, so hand back the one erase() came down to
+    ****************************************************/
+   template <class K, class V, class Compare>
+   typename leanMap <K, V, Compare> ::iterator leanMap <K, V, Compare> ::erase(iterator first, iterator last)
+   {
+      while (first != last)
+         first = erase(first);
+      return first;
+   }
+
+   /*****************************************************
+    * LEAN MAP :: UNHOOK
+    * Take the node on top of the path out of the tree and delete it. A
+    * node with two children trades places with the next one in order,
+    * which has no left child; the path follows it down
+    ****************************************************/
+   template <class K, class V, class Compare>
+   void leanMap <K, V, Compare> ::unhook(Path& path)
+   {
+      int depthErase = path.depth;
+      Node* pErase = path.nodes[depthErase];
+      bool wasRed = pErase->isRed;
+      bool isLeft;              // which side of the node above the hole is
+
+      if (pErase->pLeft == nullptr || pErase->pRight == nullptr)
+      {
+         Node* pChild = (pErase->pLeft ? pErase->pLeft : pErase->pRight);
+         isLeft = (depthErase > 0 && path.nodes[depthErase - 1]->pLeft == pErase);
+         linkTo(path, depthErase) = pChild;
+         path.depth = depthErase - 1;
+      }
+      else
+      {
+         // down to the next node, keeping the way
+         Node*& pLinkErase = linkTo(path, depthErase);
+         for (Node* p = pErase->pRight; p; p = p->pLeft)
+            path.nodes[++path.depth] = p;
+         Node* pNext = path.nodes[path.depth];
+         wasRed = pNext->isRed;
+
+         if (path.depth == depthErase + 1)
+         {
+            // the next node is the right child: the hole is on its right
+            isLeft = false;
+            path.depth = depthErase;
+         }
+         else
+         {
+            isLeft = true;
+            path.nodes[path.depth - 1]->pLeft = pNext->pRight;
+            pNext->pRight = pErase->pRight;
+            path.depth--;
+         }
+         pNext->pLeft = pErase->pLeft;
+         pNext->isRed = pErase->isRed;
+         pLinkErase = pNext;
+         path.nodes[depthErase] = pNext;
+      }
+
+      delete pErase;
+      numElements--;
+      if (!wasRed)
+         repairErase(path, isLeft);
+   }
+
+   /*****************************************************
+    * LEAN MAP :: REPAIR ERASE
+    * Red-black fixup after a black node is taken out from the isLeft
+    * side of the node on top of the path. What took its place carries
+    * an extra black up the path until a red node or a rotation absorbs it
+    ****************************************************/
+   template <class K, class V, class Compare>
+   void leanMap <K, V, Compare> ::repairErase(Path& path, bool isLeft)
+   {
+      while (path.depth >= 0)
+      {
+         Node* pParent = path.nodes[path.depth];
+         Node* pNode = (isLeft ? pParent->pLeft : pParent->pRight);
+         if (isRed(pNode))
+         {
+            pNode->isRed = false;
+            return;
+         }
+
+         Node* pSibling = (isLeft ? pParent->pRight : pParent->pLeft);
+         if (pSibling->isRed)
+         {
+            // make the sibling black: it moves up and the parent down
+            pSibling->isRed = false;
+            pParent->isRed = true;
+            if (isLeft)
+               rotateLeft(linkTo(path, path.depth));
+            else
+               rotateRight(linkTo(path, path.depth));
+            path.nodes[path.depth] = pSibling;
+            path.nodes[++path.depth] = pParent;
+            pSibling = (isLeft ? pParent->pRight : pParent->pLeft);
+         }
+
+         Node* pNear = (isLeft ? pSibling->pLeft : pSibling->pRight);
+         Node* pFar = (isLeft ? pSibling->pRight : pSibling->pLeft);
+         if (!isRed(pNear) && !isRed(pFar))
+         {
+            // push the missing black up a level
+            pSibling->isRed = true;
+            path.depth--;
+            isLeft = (path.depth >= 0 && path.nodes[path.depth]->pLeft == pParent);
+            continue;
+         }
+
+         if (!isRed(pFar))
+         {
+            pNear->isRed = false;
+            pSibling->isRed = true;
+            if (isLeft)
+               rotateRight(pParent->pRight);
+            else
+               rotateLeft(pParent->pLeft);
+            pFar = pSibling;
+            pSibling = pNear;
+         }
+         pSibling->isRed = pParent->isRed;
+         pParent->isRed = false;
+         pFar->isRed = false;
+         if (isLeft)
+            rotateLeft(linkTo(path, path.depth));
+         else
+            rotateRight(linkTo(path, path.depth));
+         return;
+      }
+
+      // the extra black reached the root, which absorbs it
+      if (root)
+         root->isRed = false;
+   }
+
+   /*****************************************************
+    * LEAN MAP :: COPY NODES
+    * Copy a subtree, shape and colors and all
+    ****************************************************/
+   template <class K, class V, class Compare>
+   typename leanMap <K, V, Compare> ::Node* leanMap <K, V, Compare> ::copyNodes(const Node* pSrc)
+   {
+      if (pSrc == nullptr)
+         return nullptr;
+
+      Node* pDest = nullptr;
+      try
+      {
+         pDest = new Node(pSrc->data);
+         pDest->isRed = pSrc->isRed;
+         pDest->pLeft = copyNodes(pSrc->pLeft);
+         pDest->pRight = copyNodes(pSrc->pRight);
+      }
+      catch (...)
+      {
+         deleteNodes(pDest);
+         throw;
+      }
+      return pDest;
+   }
+
+   /*****************************************************
+    * LEAN MAP :: DELETE NODES
+    * Delete a subtree. Its depth is bounded, so recursion is safe
+    ****************************************************/
+   template <class K, class V, class Compare>
+   void leanMap <K, V, Compare> ::deleteNodes(Node* p) noexcept
+   {
+      if (p == nullptr)
+         return;
+      deleteNodes(p->pLeft);
+      deleteNodes(p->pRight);
+      delete p;
+   }
+
+   /*****************************************************
+    * SWAP
+    * Swap two lean maps
+    ****************************************************/
+   template <class K, class V, class Compare>
+   void swap(leanMap <K, V, Compare>& lhs, leanMap <K, V, Compare>& rhs)
+   {
+      lhs.swap(rhs);
+   }
+
+}
@@ -13,6 +13,7 @@
  *    This will contain the class definition of:
  *        map                 : A class that represents a map
  *        map::iterator       : An iterator through a map
+ *        map::reverse_iterator : A backwards iterator through a map
  * Author
  *    Sam Heaven, Abram Hansen
  ************************************************************************/
@@ -21,6 +22,9 @@
 
 #include "pair.h"     // for pair
 #include "bst.h"      // no nested class necessary for this assignment
+#include "frozen.h"   // for frozenMap
+#include <stdexcept>  // for std::out_of_range
+#include <iterator>   // for std::reverse_iterator
 
 #ifndef debug
 #ifdef DEBUG
@@ -35,16 +39,32 @@ class TestMap; // forward declaration for unit tests
 namespace custom
 {
 
+/*****************************************************************
+ * KEY OF PAIR
+ * The BST under a map searches by the key of each pair alone, so
+ * a lookup never has to build a pair, and with it a value
+ *****************************************************************/
+template <class K, class V, class C>
+struct KeyOf <pair <K, V, C>>
+{
+   using type = K;
+   static const K& get(const pair <K, V, C>& p) { return p.first; }
+};
+
 /*****************************************************************
  * MAP
- * Create a Map, similar to a Binary Search Tree
+ * Create a Map, similar to a Binary Search Tree. The Balance policy
+ * from balance.h, the Compare on the keys and the Allocator of the
+ * pairs are handed straight to the underlying BST, which keeps the one
+ * comparator for every pair and gets its nodes from the allocator
  *****************************************************************/
-template <class K, class V>
+template <class K, class V, class Balance = balance::redBlack, class Compare = std::less<K>,
+          class Allocator = std::allocator<custom::pair<K, V>>>
 class map
 {
    friend ::TestMap; // give unit tests access to the privates
-   template <class KK, class VV>
-   friend void swap(map<KK, VV>& lhs, map<KK, VV>& rhs);
+   template <class KK, class VV, class BB, class CC, class AA>
+   friend void swap(map<KK, VV, BB, CC, AA>& lhs, map<KK, VV, BB, CC, AA>& rhs);
 public:
    using Pairs = custom::pair<K, V>;
 
@@ -53,21 +73,28 @@ public:
    //
    map() 
    {
-      //custom::BST bst();
    }
-   map(const map &  rhs) 
+   explicit map(const Compare & compare, const Allocator & allocator = Allocator())
+      : bst(compare, allocator)
+   {
+   }
+   explicit map(const Allocator & allocator) : bst(allocator)
+   {
+   }
+   map(const map &  rhs) : bst(rhs.bst)
    { 
-      //BST(std::move(rhs)); 
    }
-   map(map && rhs) 
+   map(map && rhs) : bst(std::move(rhs.bst))
    { 
    }
    template <class Iterator>
    map(Iterator first, Iterator last) 
    {
+      bst.build(first, last, true /*keepUnique*/);
    }
    map(const std::initializer_list <Pairs>& il) 
    {
+      bst.build(il.begin(), il.end(), true /*keepUnique*/);
    }
   ~map()         
    {
@@ -78,14 +105,17 @@ public:
    //
    map & operator = (const map & rhs) 
    {
+      bst = rhs.bst;
       return *this;
    }
    map & operator = (map && rhs)
    {
+      bst = std::move(rhs.bst);
       return *this;
    }
    map & operator = (const std::initializer_list <Pairs> & il)
    {
+      bst.build(il.begin(), il.end(), true /*keepUnique*/);
       return *this;
    }
    
@@ -93,13 +123,22 @@ public:
    // Iterator
    //
    class iterator;
+   using reverse_iterator = std::reverse_iterator<iterator>;
    iterator begin() 
    { 
-      return iterator();
+      return iterator(bst.begin());
    }
    iterator end() 
    { 
-      return iterator();    
+      return iterator(bst.end());
+   }
+   reverse_iterator rbegin()
+   {
+      return reverse_iterator(end());
+   }
+   reverse_iterator rend()
+   {
+      return reverse_iterator(begin());
    }
 
    // 
@@ -109,9 +148,67 @@ public:
          V & operator [] (const K & k);
    const V & at (const K& k) const;
          V & at (const K& k);
-   iterator    find(const K & k)
+
+   using key_compare = Compare;
+   key_compare key_comp() const { return bst.key_comp(); }
+   using allocator_type = Allocator;
+   allocator_type get_allocator() const noexcept { return bst.get_allocator(); }
+
+   // by the key, or anything that compares with it
+   template <class KK>
+   iterator    find(const KK & k)
+   {
+      return iterator(bst.find(k));
+   }
+
+   //
+   // Ordered search, one descent each
+   //
+   class Range;
+   template <class KK>
+   iterator lower_bound(const KK & k) const
+   {
+      return iterator(bst.lower_bound(k));
+   }
+   template <class KK>
+   iterator upper_bound(const KK & k) const
+   {
+      return iterator(bst.upper_bound(k));
+   }
+   template <class KK>
+   std::pair<iterator, iterator> equal_range(const KK & k) const
+   {
+      auto pairBST = bst.equal_range(k);
+      return std::pair<iterator, iterator>(iterator(pairBST.first), iterator(pairBST.second));
+   }
+   Range range(const K & lo, const K & hi) const;
+
+   // look up every key in keys together, a level at a time, and set
+   // out[i] to the pair with keys[i], or end(). Sorted keys share the
+   // top of their paths
+   template <class Keys, class Out>
+   void find_batch(const Keys & keys, Out & out) const
+   {
+      bst.findBatch(keys, [&](size_t i, auto * p)
+         {
+            out[i] = iterator(typename BST < pair <K, V >, Balance, Compare, Allocator > ::iterator(p, &bst));
+         });
+   }
+
+   //
+   // Order statistics, when Balance is balance::sized<>
+   //
+   size_t rank(const K & k) const
+   {
+      return bst.rank(k);
+   }
+   iterator select(size_t index) const
+   {
+      return iterator(bst.select(index));
+   }
+   size_t count(const K & lo, const K & hi) const
    {
-      return iterator ();
+      return bst.count(lo, hi);
    }
 
    //
@@ -119,19 +216,59 @@ public:
    //
    custom::pair<typename map::iterator, bool> insert(Pairs && rhs)
    {
-      return make_pair(iterator(), false);
+      auto pairBST = bst.insert(std::move(rhs), true /*keepUnique*/);
+      return custom::pair<iterator, bool>(iterator(pairBST.first), pairBST.second);
    }
    custom::pair<typename map::iterator, bool> insert(const Pairs & rhs)
    {
-      return make_pair(iterator(), false);
+      auto pairBST = bst.insert(rhs, true /*keepUnique*/);
+      return custom::pair<iterator, bool>(iterator(pairBST.first), pairBST.second);
+   }
+
+   iterator insert(iterator hint, Pairs && rhs)
+   {
+      return iterator(bst.insert(hint.it, std::move(rhs), true /*keepUnique*/));
+   }
+   iterator insert(iterator hint, const Pairs & rhs)
+   {
+      return iterator(bst.insert(hint.it, rhs, true /*keepUnique*/));
+   }
+
+   // build the pair inside its node rather than copying one in
+   template <class ... Args>
+   custom::pair<typename map::iterator, bool> emplace(Args && ... args)
+   {
+      auto pairBST = bst.emplaceNode(true /*keepUnique*/, std::forward<Args>(args)...);
+      return custom::pair<iterator, bool>(iterator(pairBST.first), pairBST.second);
+   }
+   template <class ... Args>
+   iterator emplace_hint(iterator hint, Args && ... args)
+   {
+      return iterator(bst.emplaceHintNode(hint.it, true /*keepUnique*/, std::forward<Args>(args)...));
+   }
+
+   // and do not build the value at all if the key is taken
+   template <class ... Args>
+   custom::pair<typename map::iterator, bool> try_emplace(const K & k, Args && ... args)
+   {
+      return tryEmplace(k, std::forward<Args>(args)...);
+   }
+   template <class ... Args>
+   custom::pair<typename map::iterator, bool> try_emplace(K && k, Args && ... args)
+   {
+      return tryEmplace(std::move(k), std::forward<Args>(args)...);
    }
 
    template <class Iterator>
    void insert(Iterator first, Iterator last)
    {
+      for (auto it = first; it != last; ++it)
+         bst.insert(*it, true /*keepUnique*/);
    }
    void insert(const std::initializer_list <Pairs>& il)
    {
+      for (auto&& element : il)
+         bst.insert(element, true /*keepUnique*/);
    }
 
    //
@@ -145,6 +282,52 @@ public:
    iterator erase(iterator it);
    iterator erase(iterator first, iterator last);
 
+   //
+   // Node handles, moving elements between maps without allocating
+   // or copying them
+   //
+   class node_type;
+   struct insert_return_type;
+   node_type extract(iterator it)
+   {
+      return node_type(bst.extract(it.it));
+   }
+   node_type extract(const K & k)
+   {
+      return node_type(bst.extract(k));
+   }
+   insert_return_type insert(node_type && nh);
+   void merge(map & rhs)
+   {
+      bst.merge(rhs.bst, true /*keepUnique*/);
+   }
+
+   //
+   // Split and join, moving the nodes rather than copying them
+   //
+   std::pair<map, map> split(const K & k)
+   {
+      auto pieces = bst.split(k);
+      std::pair<map, map> pairReturn{ map(key_comp(), get_allocator()), map(key_comp(), get_allocator()) };
+      pairReturn.first.bst = std::move(pieces.first);
+      pairReturn.second.bst = std::move(pieces.second);
+      return pairReturn;
+   }
+   static map join(map & lhs, map & rhs)
+   {
+      map m(lhs.key_comp(), lhs.get_allocator());
+      m.bst = BST < pair <K, V >, Balance, Compare, Allocator > ::join(lhs.bst, rhs.bst);
+      return m;
+   }
+
+   //
+   // Snapshot, for when the map is done changing
+   //
+   frozenMap<K, V, Compare> freeze() const
+   {
+      return frozenMap<K, V, Compare>(bst.begin(), bst.end(), size(), key_comp());
+   }
+
    //
    // Status
    //
@@ -154,8 +337,11 @@ public:
 
 private:
 
+   template <class KK, class ... Args>
+   custom::pair<typename map::iterator, bool> tryEmplace(KK && k, Args && ... args);
+
    // the students DO NOT need to use a nested class
-   BST < pair <K, V >> bst;
+   BST < pair <K, V >, Balance, Compare, Allocator > bst;
 };
 
 
@@ -164,23 +350,29 @@ private:
  * Forward and reverse iterator through a Map, just call
  * through to BSTIterator
  *********************************************************/
-template <typename K, typename V>
-class map <K, V> :: iterator
+template <typename K, typename V, typename Balance, typename Compare, typename Allocator>
+class map <K, V, Balance, Compare, Allocator> :: iterator
 {
    friend class ::TestMap; // give unit tests access to the privates
-   template <class KK, class VV>
+   template <class KK, class VV, class BB, class CC, class AA>
    friend class custom::map;
 public:
+   using iterator_category = std::bidirectional_iterator_tag;
+   using value_type        = pair <K, V>;
+   using difference_type   = std::ptrdiff_t;
+   using pointer           = const pair <K, V> *;
+   using reference         = const pair <K, V> &;
+
    //
    // Construct
    //
    iterator()
    {
    }
-   iterator(const typename BST < pair <K, V> > :: iterator & rhs)
+   iterator(const typename BST < pair <K, V>, Balance, Compare, Allocator > :: iterator & rhs) : it(rhs)
    { 
    }
-   iterator(const iterator & rhs) 
+   iterator(const iterator & rhs) : it(rhs.it)
    { 
    }
 
@@ -189,21 +381,22 @@ public:
    //
    iterator & operator = (const iterator & rhs)
    {
+      it = rhs.it;
       return *this;
    }
 
    //
    // Compare
    //
-   bool operator == (const iterator & rhs) const { return false; }
-   bool operator != (const iterator & rhs) const { return false; }
+   bool operator == (const iterator & rhs) const { return it == rhs.it; }
+   bool operator != (const iterator & rhs) const { return it != rhs.it; }
 
    // 
    // Access
    //
    const pair <K, V> & operator * () const
    {
-      return *(new pair<K,V>);
+      return *it;
    }
 
    //
@@ -211,75 +404,206 @@ public:
    //
    iterator & operator ++ ()
    {
+      ++it;
       return *this;
    }
    iterator operator ++ (int postfix)
    {
-      return *this;
+      iterator itReturn = *this;
+      ++it;
+      return itReturn;
    }
    iterator & operator -- ()
    {
+      --it;
       return *this;
    }
    iterator  operator -- (int postfix)
    {
+      iterator itReturn = *this;
+      --it;
+      return itReturn;
+   }
+
+   //
+   // Jump, when Balance is balance::sized<>
+   //
+   iterator & operator += (difference_type n)
+   {
+      it += n;
+      return *this;
+   }
+   iterator & operator -= (difference_type n)
+   {
+      it -= n;
       return *this;
    }
 
 private:
 
    // Member variable
-   typename BST < pair <K, V >>  :: iterator it;   
+   typename BST < pair <K, V >, Balance, Compare, Allocator >  :: iterator it;   
 };
 
+/**********************************************************
+ * MAP RANGE
+ * The elements with keys in [lo, hi), walked in place in the
+ * tree. Nothing is copied and nothing is visited up front
+ *********************************************************/
+template <typename K, typename V, typename Balance, typename Compare, typename Allocator>
+class map <K, V, Balance, Compare, Allocator> :: Range
+{
+public:
+   Range(const iterator & itBegin, const iterator & itEnd) : itBegin(itBegin), itEnd(itEnd)
+   {
+   }
+
+   iterator begin() const { return itBegin; }
+   iterator end()   const { return itEnd;   }
+   bool empty()     const { return itBegin == itEnd; }
+
+private:
+   iterator itBegin;    // first element in the range
+   iterator itEnd;      // first element past the range
+};
+
+/**********************************************************
+ * MAP NODE HANDLE
+ * The BST node handle, with the key and value reached
+ * separately the way std::map has them
+ *********************************************************/
+template <typename K, typename V, typename Balance, typename Compare, typename Allocator>
+class map <K, V, Balance, Compare, Allocator> :: node_type : public BST < pair <K, V>, Balance, Compare, Allocator > :: node_type
+{
+public:
+   node_type()
+   {
+   }
+   node_type(typename BST < pair <K, V>, Balance, Compare, Allocator > :: node_type && rhs)
+      : BST < pair <K, V>, Balance, Compare, Allocator > :: node_type(std::move(rhs))
+   {
+   }
+
+   K & key()    const { return this->value().first;  }
+   V & mapped() const { return this->value().second; }
+};
+
+/**********************************************************
+ * MAP INSERT RETURN TYPE
+ * Where a node handle went, or the handle back if the key
+ * was already there
+ *********************************************************/
+template <typename K, typename V, typename Balance, typename Compare, typename Allocator>
+struct map <K, V, Balance, Compare, Allocator> :: insert_return_type
+{
+   iterator position;
+   bool inserted;
+   node_type node;
+};
+
+/*****************************************************
+ * MAP :: INSERT
+ * Hook the node in a handle into the map, unless the key is taken
+ ****************************************************/
+template <typename K, typename V, typename Balance, typename Compare, typename Allocator>
+typename map <K, V, Balance, Compare, Allocator> :: insert_return_type map <K, V, Balance, Compare, Allocator> :: insert(node_type && nh)
+{
+   auto returnBST = bst.insert(std::move(nh), true /*keepUnique*/);
+   return insert_return_type{ iterator(returnBST.position), returnBST.inserted, std::move(returnBST.node) };
+}
+
+/*****************************************************
+ * MAP :: TRY EMPLACE
+ * Look for the key alone, one comparison per level, and only if it is
+ * missing build the value in a new node from args
+ ****************************************************/
+template <typename K, typename V, typename Balance, typename Compare, typename Allocator>
+template <class KK, class ... Args>
+custom::pair<typename map <K, V, Balance, Compare, Allocator> :: iterator, bool> map <K, V, Balance, Compare, Allocator> :: tryEmplace(KK && k, Args && ... args)
+{
+   using BNode = typename BST < pair <K, V>, Balance, Compare, Allocator > :: BNode;
+   BNode* pParent = nullptr;
+   BNode* pNotGreater = nullptr;
+   bool isLeft = false;
+   for (BNode* p = bst.root; p != nullptr; p = (isLeft ? p->pLeft : p->pRight))
+   {
+      pParent = p;
+      isLeft = bst.comp()(k, p->data.first);
+      if (!isLeft)
+         pNotGreater = p;
+   }
+
+   if (pNotGreater && !bst.comp()(pNotGreater->data.first, k))
+      return custom::pair<iterator, bool>(iterator(typename BST < pair <K, V>, Balance, Compare, Allocator > :: iterator(pNotGreater, &bst)), false);
+
+   BNode* pNew = bst.newNode(std::in_place, std::forward<KK>(k), std::forward<Args>(args)...);
+   return custom::pair<iterator, bool>(iterator(bst.insertNode(pNew, pParent, isLeft)), true);
+}
+
+/*****************************************************
+ * MAP :: RANGE
+ * The elements from lo up to but not including hi, in O(log n) and
+ * then O(1) per element walked
+ ****************************************************/
+template <typename K, typename V, typename Balance, typename Compare, typename Allocator>
+typename map <K, V, Balance, Compare, Allocator> :: Range map <K, V, Balance, Compare, Allocator> :: range(const K & lo, const K & hi) const
+{
+   iterator itBegin = lower_bound(lo);
+   return Range(itBegin, (bst.comp()(lo, hi) ? lower_bound(hi) : itBegin));
+}
+
 
 /*****************************************************
  * MAP :: SUBSCRIPT
- * Retrieve an element from the map
+ * Retrieve an element from the map, adding it if it is missing
  ****************************************************/
-template <typename K, typename V>
-V& map <K, V> :: operator [] (const K& key)
+template <typename K, typename V, typename Balance, typename Compare, typename Allocator>
+V& map <K, V, Balance, Compare, Allocator> :: operator [] (const K& key)
 {
-   return *(new V);
-   
+   // the value is only built when the key is missing
+   auto pairReturn = tryEmplace(key);
+   return pairReturn.first.it.pNode->data.second;
 }
 
 /*****************************************************
  * MAP :: SUBSCRIPT
  * Retrieve an element from the map
  ****************************************************/
-template <typename K, typename V>
-const V& map <K, V> :: operator [] (const K& key) const
+template <typename K, typename V, typename Balance, typename Compare, typename Allocator>
+const V& map <K, V, Balance, Compare, Allocator> :: operator [] (const K& key) const
 {
-   return *(new V);
+   return at(key);
 }
 
 /*****************************************************
  * MAP :: AT
  * Retrieve an element from the map
  ****************************************************/
-template <typename K, typename V>
-V& map <K, V> ::at(const K& key)
+template <typename K, typename V, typename Balance, typename Compare, typename Allocator>
+V& map <K, V, Balance, Compare, Allocator> ::at(const K& key)
 {
-   return *(new V);
+   auto it = bst.find(key);
+   if (it == bst.end())
+      throw std::out_of_range("invalid map<K, T> key");
+   return it.pNode->data.second;
 }
 
 /*****************************************************
  * MAP :: AT
  * Retrieve an element from the map
  ****************************************************/
-template <typename K, typename V>
-const V& map <K, V> ::at(const K& key) const
+template <typename K, typename V, typename Balance, typename Compare, typename Allocator>
+const V& map <K, V, Balance, Compare, Allocator> ::at(const K& key) const
 {
-   return *(new V);
+   return const_cast<map&>(*this).at(key);
 }
 
 /*****************************************************
  * SWAP
  * Swap two maps
  ****************************************************/
-template <typename K, typename V>
-void swap(map <K, V>& lhs, map <K, V>& rhs)
+template <typename K, typename V, typename Balance, typename Compare, typename Allocator>
+void swap(map <K, V, Balance, Compare, Allocator>& lhs, map <K, V, Balance, Compare, Allocator>& rhs)
 {
    lhs.bst.swap(rhs.bst); 
 }
@@ -288,30 +612,34 @@ void swap(map <K, V>& lhs, map <K, V>& rhs)
  * ERASE
  * Erase one element
  ****************************************************/
-template <typename K, typename V>
-size_t map<K, V>::erase(const K& k)
+template <typename K, typename V, typename Balance, typename Compare, typename Allocator>
+size_t map<K, V, Balance, Compare, Allocator>::erase(const K& k)
 {
-   return size_t(99);
+   auto it = bst.find(k);
+   if (it == bst.end())
+      return size_t(0);
+   bst.erase(it);
+   return size_t(1);
 }
 
 /*****************************************************
  * ERASE
- * Erase several elements
+ * Erase several elements, cut out of the tree all at once
  ****************************************************/
-template <typename K, typename V>
-typename map<K, V>::iterator map<K, V>::erase(map<K, V>::iterator first, map<K, V>::iterator last)
+template <typename K, typename V, typename Balance, typename Compare, typename Allocator>
+typename map<K, V, Balance, Compare, Allocator>::iterator map<K, V, Balance, Compare, Allocator>::erase(map<K, V, Balance, Compare, Allocator>::iterator first, map<K, V, Balance, Compare, Allocator>::iterator last)
 {
-   return iterator();
+   return iterator(bst.erase(first.it, last.it));
 }
 
 /*****************************************************
  * ERASE
  * Erase one element
  ****************************************************/
-template <typename K, typename V>
-typename map<K, V>::iterator map<K, V>::erase(map<K, V>::iterator it)
+template <typename K, typename V, typename Balance, typename Compare, typename Allocator>
+typename map<K, V, Balance, Compare, Allocator>::iterator map<K, V, Balance, Compare, Allocator>::erase(map<K, V, Balance, Compare, Allocator>::iterator it)
 {
-   return iterator();
+   return iterator(bst.erase(it.it));
 }
 
 }; //  namespace custom
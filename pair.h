@@ -10,6 +10,7 @@
 #pragma once
 
 #include <iostream>  // for ISTREAM and OSTREAM
+#include <utility>   // for std::in_place_t and std::forward
 
 namespace custom
 {
@@ -21,7 +22,8 @@ namespace custom
  * accessed through its public members first and second.
  *
  * Additionally, when compairing two pairs, only T1 is compared. This
- * is a key in a name-value pair.
+ * is a key in a name-value pair. C is only a type: a pair holds no
+ * comparator, the map keeps the one it orders every pair by
  ***********************************************/
 template <class T1, class T2, typename C = std::less<T1>>
 class pair
@@ -32,24 +34,28 @@ public:
    //
    
    // Default Constructor: call the T1, T2 default constructors
-   pair(const C& c = C())
-       : first(     ), second(      ), compare(c) {}
+   pair()
+       : first(     ), second(      ) {}
    // Non-Default Constructor: call the T1, T2 copy constructors
-   pair(const T1 & first, const T2 & second, const C& c = C())
-       : first(first), second(second), compare(c) {}
-   pair(const T1& first, T2 && second, const C& c = C())
-      : first(first), second(std::move(second)), compare(c) {}
-   pair(const T1& first, const C& c = C())
-      : first(first), second(), compare(c) {}
+   pair(const T1 & first, const T2 & second)
+       : first(first), second(second) {}
+   pair(const T1& first, T2 && second)
+      : first(first), second(std::move(second)) {}
+   pair(const T1& first)
+      : first(first), second() {}
    // Copy Constructor: call the T1, T2 copy constructors
-   pair(const pair <T1, T2> & rhs, const C& c = C())
-       : first(rhs.first), second(rhs.second), compare(c) {}
+   pair(const pair <T1, T2> & rhs)
+       : first(rhs.first), second(rhs.second) {}
    // Non-Default Move Constructor: call the T1, T2 move constructors
-   pair(T1 && first, T2 && second, const C& c = C())
-       : first(std::move(first)), second(std::move(second)), compare(c) {}
+   pair(T1 && first, T2 && second)
+       : first(std::move(first)), second(std::move(second)) {}
    // Move Constructor: call the T1, T2 move constructors
-   pair(pair <T1, T2> && rhs, const C& c = C())
-       : first(std::move(rhs.first)), second(std::move(rhs.second)), compare(c) {}
+   pair(pair <T1, T2> && rhs)
+       : first(std::move(rhs.first)), second(std::move(rhs.second)) {}
+   // In-place Constructor: build T2 straight from the arguments
+   template <class K, class ... Args>
+   pair(std::in_place_t, K && first, Args && ... args)
+       : first(std::forward<K>(first)), second(std::forward<Args>(args)...) {}
 
    //
    // Assignment Operators
@@ -81,10 +87,10 @@ public:
    // Relative: only the first will be compared
    //
 
-   bool operator <  (const pair & rhs) const { return compare(first, rhs.first); }
-   bool operator >  (const pair & rhs) const { return compare(rhs.first, first);        }
-   bool operator >= (const pair & rhs) const { return !(compare(first, rhs.first));     }
-   bool operator <= (const pair & rhs) const { return !(compare(rhs.first, first));     }
+   bool operator <  (const pair & rhs) const { return C()(first, rhs.first);    }
+   bool operator >  (const pair & rhs) const { return C()(rhs.first, first);    }
+   bool operator >= (const pair & rhs) const { return !(C()(first, rhs.first)); }
+   bool operator <= (const pair & rhs) const { return !(C()(rhs.first, first)); }
    
    //
    // Swap: swap the places
@@ -101,13 +107,6 @@ public:
    // Member Variables: direct access to the two member variables
    //
    
-   //
-   // Get: retrieve a value
-   //
-   
-   C    compare;              // comparision operator
-
-   
    // these are public. We cannot validate because we know nothing about T
    T1 first;
    T2 second;
@@ -0,0 +1,323 @@
+/***********************************************************************
+ * Header:
+ *    POOL
+ * Summary:
+ *    A node pool for our custom BST. Given as the Allocator of a BST or
+ *    a map, every node comes out of a 64 KiB slab instead of its own
+ *    call to new:
+ *        custom::map<K, V, balance::redBlack, std::less<K>,
+ *                    custom::pool<custom::pair<K, V>>>
+ *      __       ____       ____         __
+ *     /  |    .'    '.   .'    '.   _  / /
+ *     `| |   |  .--.  | |  .--.  | (_)/ /
+ *      | |   | |    | | | |    | |   / / _
+ *     _| |_  |  `--'  | |  `--'  |  / / (_)
+ *    |_____|  '.____.'   '.____.'  /_/
+ *
+ *    This will contain the class definition of:
+ *        SlabPool            : The slabs, the free list threaded through
+ *                              the blocks given back, and how many share
+ *                              them
+ *        pool                : An allocator handing out the blocks of a
+ *                              SlabPool. A tree gets a pool of its own;
+ *                              whatever is split or extracted from it
+ *                              shares it, and the slabs are freed together
+ *                              when the last of them goes away
+ *
+ *    Two pools are only equal when they share a SlabPool, so two trees
+ *    built apart have pools that are not. A node handle can only go into
+ *    a tree whose pool is equal to the one it came from; merge, join and
+ *    the set algebra move the elements into new nodes when they are not
+ *
+ *    A pool is not thread safe. The BST only works on a tree from more
+ *    than one thread with std::allocator
+ * Author
+ *    Sam Heaven, Abram Hansen
+ ************************************************************************/
+
+#pragma once
+
+#include <cassert>
+#include <cstddef>     // for size_t and std::max_align_t
+#include <new>         // for operator new
+#include <algorithm>   // for std::max
+#include <type_traits> // for std::true_type
+#include <utility>     // for std::swap
+
+namespace custom
+{
+
+   /*****************************************************************
+    * SLAB POOL
+    * Blocks of one size carved from 64 KiB slabs. A block given back goes
+    * on a free list kept inside the blocks themselves, and is the next
+    * one handed out. Slabs are only given back all at once
+    *****************************************************************/
+   class SlabPool
+   {
+   public:
+      static const size_t slabSize = 65536;   // bytes in each slab
+
+      SlabPool() : numOwners(1), pSlabs(nullptr), pFree(nullptr), pNext(nullptr), pEnd(nullptr),
+                   objectSize(0), blockSize(0), blockAlign(0), numInUse(0) {}
+      SlabPool(const SlabPool& rhs) = delete;
+      SlabPool& operator = (const SlabPool& rhs) = delete;
+      ~SlabPool() { freeSlabs(); }
+
+      //
+      // Blocks
+      //
+
+      void* allocate(size_t size, size_t align);
+      void  deallocate(void* p) noexcept;
+      bool  isFor(size_t size) const noexcept { return blockSize != 0 && size == objectSize; }
+      bool  owns(const void* p) const noexcept;
+      bool  release(size_t numLive) noexcept;
+
+      //
+      // Status
+      //
+
+      size_t numSlabs() const noexcept;
+      size_t numBlocks() const noexcept { return numInUse; }
+
+      size_t numOwners;             // allocators sharing this pool
+
+   private:
+      // the first bytes of a slab link it to the next
+      struct Slab
+      {
+         Slab* pNext;
+      };
+
+      // and the first bytes of a block given back link it to the next
+      struct FreeBlock
+      {
+         FreeBlock* pNext;
+      };
+
+      static size_t roundUp(size_t size, size_t align) { return (size + align - 1) / align * align; }
+      void freeSlabs() noexcept;
+
+      Slab* pSlabs;                 // every slab, the newest first
+      FreeBlock* pFree;             // blocks given back, the last first
+      char* pNext;                  // first block never handed out in the newest slab
+      char* pEnd;                   // end of the newest slab
+      size_t objectSize;            // size asked for, set by the first allocate()
+      size_t blockSize;             // and what is carved for it
+      size_t blockAlign;
+      size_t numInUse;              // blocks handed out and not given back
+   };
+
+   /*****************************************************************
+    * POOL
+    * An allocator that gets single objects from a SlabPool. Copies and
+    * rebinds share the SlabPool. A container that is copied gets a new
+    * one, and one that is moved or swapped takes its pool along
+    *****************************************************************/
+   template <class T>
+   class pool
+   {
+      template <class U>
+      friend class pool;
+   public:
+      using value_type = T;
+      using propagate_on_container_copy_assignment = std::false_type;
+      using propagate_on_container_move_assignment = std::true_type;
+      using propagate_on_container_swap = std::true_type;
+      using is_always_equal = std::false_type;
+
+      //
+      // Construct
+      //
+
+      pool() : pPool(new SlabPool) {}
+      pool(const pool& rhs) noexcept : pPool(rhs.pPool) { pPool->numOwners++; }
+      template <class U>
+      pool(const pool<U>& rhs) noexcept : pPool(rhs.pPool) { pPool->numOwners++; }
+      ~pool() { letGo(); }
+      pool& operator = (const pool& rhs) noexcept
+      {
+         rhs.pPool->numOwners++;
+         letGo();
+         pPool = rhs.pPool;
+         return *this;
+      }
+      pool select_on_container_copy_construction() const { return pool(); }
+      friend void swap(pool& lhs, pool& rhs) noexcept { std::swap(lhs.pPool, rhs.pPool); }
+
+      //
+      // Allocate: one object at a time from the slabs, anything else
+      // from operator new
+      //
+
+      T* allocate(size_t num)
+      {
+         void* p = (num == 1 ? pPool->allocate(sizeof(T), alignof(T)) : nullptr);
+         return static_cast<T*>(p ? p : ::operator new(num * sizeof(T)));
+      }
+      void deallocate(T* p, size_t num) noexcept
+      {
+         if (num == 1 && pPool->isFor(sizeof(T)))
+         {
+            assert(pPool->owns(p));
+            pPool->deallocate(p);
+         }
+         else
+            ::operator delete(p);
+      }
+
+      // take back every block at once, if the numLive blocks of the
+      // caller are all that are out
+      bool release(size_t numLive) noexcept { return pPool->release(numLive); }
+
+      size_t numSlabs() const noexcept { return pPool->numSlabs(); }
+
+      bool operator == (const pool& rhs) const noexcept { return pPool == rhs.pPool; }
+      bool operator != (const pool& rhs) const noexcept { return pPool != rhs.pPool; }
+
+   private:
+      void letGo() noexcept
+      {
+         if (--pPool->numOwners == 0)
+            delete pPool;
+      }
+
+      SlabPool* pPool;
+   };
+
+   /*****************************************************
+    * SLAB POOL :: ALLOCATE
+    * The last block given back, or else the next one in the newest slab,
+    * starting a slab when that one is full. nullptr if the size is not
+    * the one this pool is for, so the caller can go elsewhere
+    ****************************************************/
+   inline void* SlabPool::allocate(size_t size, size_t align)
+   {
+      // the first request decides the size of every block
+      if (blockSize == 0)
+      {
+         size_t block = roundUp(std::max(size, sizeof(FreeBlock)), align);
+         if (align > alignof(std::max_align_t) ||
+             roundUp(sizeof(Slab), align) + block > slabSize)
+         {
+            return nullptr;
+         }
+         objectSize = size;
+         blockSize = block;
+         blockAlign = align;
+      }
+      else if (size != objectSize)
+      {
+         return nullptr;
+      }
+
+      numInUse++;
+      if (pFree)
+      {
+         FreeBlock* pBlock = pFree;
+         pFree = pBlock->pNext;
+         return pBlock;
+      }
+
+      if (size_t(pEnd - pNext) < blockSize)
+      {
+         Slab* pSlab = nullptr;
+         try
+         {
+            pSlab = static_cast<Slab*>(::operator new(slabSize));
+         }
+         catch (...)
+         {
+            numInUse--;
+            throw;
+         }
+         pSlab->pNext = pSlabs;
+         pSlabs = pSlab;
+         pNext = reinterpret_cast<char*>(pSlab) + roundUp(sizeof(Slab), blockAlign);
+         pEnd = reinterpret_cast<char*>(pSlab) + slabSize;
+      }
+
+      void* p = pNext;
+      pNext += blockSize;
+      return p;
+   }
+
+   /*****************************************************
+    * SLAB POOL :: DEALLOCATE
+    * Put a block on the free list. Its slab is kept
+    ****************************************************/
+   inline void SlabPool::deallocate(void* p) noexcept
+   {
+      assert(numInUse > 0);
+      FreeBlock* pBlock = static_cast<FreeBlock*>(p);
+      pBlock->pNext = pFree;
+      pFree = pBlock;
+      numInUse--;
+   }
+
+   /*****************************************************
+    * SLAB POOL :: OWNS
+    * Is p a block in one of our slabs? O(slabs), so it is only asked
+    * when checking that a block came back to the pool it came from
+    ****************************************************/
+   inline bool SlabPool::owns(const void* p) const noexcept
+   {
+      const char* pBlock = static_cast<const char*>(p);
+      for (const Slab* pSlab = pSlabs; pSlab; pSlab = pSlab->pNext)
+      {
+         const char* pBegin = reinterpret_cast<const char*>(pSlab) + roundUp(sizeof(Slab), blockAlign);
+         const char* pEnd = reinterpret_cast<const char*>(pSlab) + slabSize;
+         if (pBegin <= pBlock && pBlock < pEnd)
+         {
+            return size_t(pBlock - pBegin) % blockSize == 0;
+         }
+      }
+      return false;
+   }
+
+   /*****************************************************
+    * SLAB POOL :: RELEASE
+    * If the caller holds every block that is out, it is done with all of
+    * them: free the slabs in one pass, O(slabs), without visiting a block
+    ****************************************************/
+   inline bool SlabPool::release(size_t numLive) noexcept
+   {
+      if (numLive != numInUse)
+      {
+         return false;
+      }
+      freeSlabs();
+      return true;
+   }
+
+   /*****************************************************
+    * SLAB POOL :: FREE SLABS
+    ****************************************************/
+   inline void SlabPool::freeSlabs() noexcept
+   {
+      while (pSlabs)
+      {
+         Slab* pSlab = pSlabs;
+         pSlabs = pSlab->pNext;
+         ::operator delete(pSlab);
+      }
+      pFree = nullptr;
+      pNext = pEnd = nullptr;
+      numInUse = 0;
+   }
+
+   /*****************************************************
+    * SLAB POOL :: NUM SLABS
+    ****************************************************/
+   inline size_t SlabPool::numSlabs() const noexcept
+   {
+      size_t num = 0;
+      for (const Slab* pSlab = pSlabs; pSlab; pSlab = pSlab->pNext)
+      {
+         num++;
+      }
+      return num;
+   }
+
+}
@@ -0,0 +1,261 @@
+/***********************************************************************
+ * Header:
+ *    SIMD
+ * Summary:
+ *    Compare a whole cache line of integer keys against one key at
+ *    once. A frozen map of int32_t or int64_t keys searches with these
+ *      __       ____       ____         __
+ *     /  |    .'    '.   .'    '.   _  / /
+ *     `| |   |  .--.  | |  .--.  | (_)/ /
+ *      | |   | |    | | | |    | |   / / _
+ *     _| |_  |  `--'  | |  `--'  |  / / (_)
+ *    |_____|  '.____.'   '.____.'  /_/
+ *
+ *    This will contain the class definition of:
+ *        simd::canSearch     : Whether a key and comparator can use the
+ *                              kernels: int32_t or int64_t with std::less
+ *        simd::Kernels       : Count the keys in a line that are less than,
+ *                              or not greater than, a key
+ *        simd::kernels       : The kernels for one instruction set
+ *        simd::best          : The kernels for the best instruction set
+ *                              this CPU has, found the first time asked
+ *
+ *    The vector kernels are built for x86 with GCC or Clang, each with
+ *    its own target, so the rest of the program needs no -mavx2 and
+ *    still runs on a CPU without it. Anywhere else every level is the
+ *    scalar loop
+ * Author
+ *    Sam Heaven, Abram Hansen
+ ************************************************************************/
+
+#pragma once
+
+#include <cstddef>      // for size_t
+#include <cstdint>      // for int32_t and int64_t
+#include <functional>   // for std::less
+#include <type_traits>  // for std::integral_constant
+
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define SIMD_X86
+#include <immintrin.h>
+#endif
+
+namespace custom
+{
+namespace simd
+{
+
+   // a line is one cache line of keys
+   static const size_t lineSize = 64;
+
+   /*****************************************************************
+    * CAN SEARCH
+    * The kernels compare signed integers by value, so they stand in for
+    * std::less on int32_t and int64_t and nothing else
+    *****************************************************************/
+   template <class K, class Compare>
+   struct canSearch : std::integral_constant<bool,
+      (std::is_same<K, int32_t>::value || std::is_same<K, int64_t>::value) &&
+      std::is_same<Compare, std::less<K>>::value>
+   {
+   };
+
+   /*****************************************************************
+    * LEVEL
+    * The instruction sets there are kernels for, worst to best
+    *****************************************************************/
+   enum Level { scalar, sse42, avx2 };
+
+   /*****************************************************************
+    * KERNELS
+    * Given the lineSize / sizeof(T) keys at line, in any order, how many
+    * are less than k, and how many are not greater than k
+    *****************************************************************/
+   template <class T>
+   struct Kernels
+   {
+      size_t (*countLess)(const T* line, T k);
+      size_t (*countLessEqual)(const T* line, T k);
+   };
+
+   /*****************************************************
+    * SCALAR
+    * One key at a time, which the compiler may vectorize anyway
+    ****************************************************/
+   template <class T>
+   size_t countLessScalar(const T* line, T k)
+   {
+      size_t count = 0;
+      for (size_t i = 0; i < lineSize / sizeof(T); i++)
+         count += (line[i] < k);
+      return count;
+   }
+
+   template <class T>
+   size_t countLessEqualScalar(const T* line, T k)
+   {
+      size_t count = 0;
+      for (size_t i = 0; i < lineSize / sizeof(T); i++)
+         count += !(k < line[i]);
+      return count;
+   }
+
+#ifdef SIMD_X86
+
+   /*****************************************************
+    * SSE 4.2
+    * Four 16 byte compares to the line. pcmpgtq, for the
+    * 64 bit keys, came with SSE 4.2
+    ****************************************************/
+   __attribute__((target("sse4.2,popcnt")))
+   inline unsigned maskGreater32Sse(const int32_t* line, int32_t k, bool keyFirst)
+   {
+      __m128i key = _mm_set1_epi32(k);
+      unsigned mask = 0;
+      for (int i = 0; i < 4; i++)
+      {
+         __m128i keys = _mm_loadu_si128(reinterpret_cast<const __m128i*>(line + 4 * i));
+         __m128i greater = keyFirst ? _mm_cmpgt_epi32(key, keys) : _mm_cmpgt_epi32(keys, key);
+         mask |= unsigned(_mm_movemask_ps(_mm_castsi128_ps(greater))) << (4 * i);
+      }
+      return mask;
+   }
+
+   __attribute__((target("sse4.2,popcnt")))
+   inline unsigned maskGreater64Sse(const int64_t* line, int64_t k, bool keyFirst)
+   {
+      __m128i key = _mm_set1_epi64x(k);
+      unsigned mask = 0;
+      for (int i = 0; i < 4; i++)
+      {
+         __m128i keys = _mm_loadu_si128(reinterpret_cast<const __m128i*>(line + 2 * i));
+         __m128i greater = keyFirst ? _mm_cmpgt_epi64(key, keys) : _mm_cmpgt_epi64(keys, key);
+         mask |= unsigned(_mm_movemask_pd(_mm_castsi128_pd(greater))) << (2 * i);
+      }
+      return mask;
+   }
+
+   __attribute__((target("sse4.2,popcnt")))
+   inline size_t countLessSse(const int32_t* line, int32_t k)
+   {
+      return __builtin_popcount(maskGreater32Sse(line, k, true));
+   }
+   __attribute__((target("sse4.2,popcnt")))
+   inline size_t countLessEqualSse(const int32_t* line, int32_t k)
+   {
+      return 16 - __builtin_popcount(maskGreater32Sse(line, k, false));
+   }
+   __attribute__((target("sse4.2,popcnt")))
+   inline size_t countLessSse(const int64_t* line, int64_t k)
+   {
+      return __builtin_popcount(maskGreater64Sse(line, k, true));
+   }
+   __attribute__((target("sse4.2,popcnt")))
+   inline size_t countLessEqualSse(const int64_t* line, int64_t k)
+   {
+      return 8 - __builtin_popcount(maskGreater64Sse(line, k, false));
+   }
+
+   /*****************************************************
+    * AVX2
+    * Two 32 byte compares to the line
+    ****************************************************/
+   __attribute__((target("avx2,popcnt")))
+   inline unsigned maskGreater32Avx2(const int32_t* line, int32_t k, bool keyFirst)
+   {
+      __m256i key = _mm256_set1_epi32(k);
+      __m256i keysLow = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(line));
+      __m256i keysHigh = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(line + 8));
+      __m256i greaterLow = keyFirst ? _mm256_cmpgt_epi32(key, keysLow) : _mm256_cmpgt_epi32(keysLow, key);
+      __m256i greaterHigh = keyFirst ? _mm256_cmpgt_epi32(key, keysHigh) : _mm256_cmpgt_epi32(keysHigh, key);
+      return unsigned(_mm256_movemask_ps(_mm256_castsi256_ps(greaterLow))) |
+             unsigned(_mm256_movemask_ps(_mm256_castsi256_ps(greaterHigh))) << 8;
+   }
+
+   __attribute__((target("avx2,popcnt")))
+   inline unsigned maskGreater64Avx2(const int64_t* line, int64_t k, bool keyFirst)
+   {
+      __m256i key = _mm256_set1_epi64x(k);
+      __m256i keysLow = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(line));
+      __m256i keysHigh = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(line + 4));
+      __m256i greaterLow = keyFirst ? _mm256_cmpgt_epi64(key, keysLow) : _mm256_cmpgt_epi64(keysLow, key);
+      __m256i greaterHigh = keyFirst ? _mm256_cmpgt_epi64(key, keysHigh) : _mm256_cmpgt_epi64(keysHigh, key);
+      return unsigned(_mm256_movemask_pd(_mm256_castsi256_pd(greaterLow))) |
+             unsigned(_mm256_movemask_pd(_mm256_castsi256_pd(greaterHigh))) << 4;
+   }
+
+   __attribute__((target("avx2,popcnt")))
+   inline size_t countLessAvx2(const int32_t* line, int32_t k)
+   {
+      return __builtin_popcount(maskGreater32Avx2(line, k, true));
+   }
+   __attribute__((target("avx2,popcnt")))
+   inline size_t countLessEqualAvx2(const int32_t* line, int32_t k)
+   {
+      return 16 - __builtin_popcount(maskGreater32Avx2(line, k, false));
+   }
+   __attribute__((target("avx2,popcnt")))
+   inline size_t countLessAvx2(const int64_t* line, int64_t k)
+   {
+      return __builtin_popcount(maskGreater64Avx2(line, k, true));
+   }
+   __attribute__((target("avx2,popcnt")))
+   inline size_t countLessEqualAvx2(const int64_t* line, int64_t k)
+   {
+      return 8 - __builtin_popcount(maskGreater64Avx2(line, k, false));
+   }
+
+#endif // SIMD_X86
+
+   /*****************************************************
+    * DETECT
+    * The best level this CPU can run
+    ****************************************************/
+   inline Level detect() noexcept
+   {
+#ifdef SIMD_X86
+      __builtin_cpu_init();
+      if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("popcnt"))
+         return avx2;
+      if (__builtin_cpu_supports("sse4.2") && __builtin_cpu_supports("popcnt"))
+         return sse42;
+#endif
+      return scalar;
+   }
+
+   /*****************************************************
+    * KERNELS
+    * The kernels for a level, which the caller knows the CPU can run.
+    * Where there are no vector kernels, that is the scalar ones
+    ****************************************************/
+   template <class T>
+   Kernels<T> kernels(Level level) noexcept
+   {
+      static_assert(canSearch<T, std::less<T>>::value, "the kernels are for int32_t and int64_t");
+#ifdef SIMD_X86
+      switch (level)
+      {
+      case avx2:
+         return Kernels<T>{ &countLessAvx2, &countLessEqualAvx2 };
+      case sse42:
+         return Kernels<T>{ &countLessSse, &countLessEqualSse };
+      default:
+         break;
+      }
+#endif
+      return Kernels<T>{ &countLessScalar<T>, &countLessEqualScalar<T> };
+   }
+
+   /*****************************************************
+    * BEST
+    * The kernels for the best level, chosen once
+    ****************************************************/
+   template <class T>
+   const Kernels<T>& best() noexcept
+   {
+      static const Kernels<T> kernelsBest = kernels<T>(detect());
+      return kernelsBest;
+   }
+
+} // namespace simd
+}
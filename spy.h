@@ -10,6 +10,9 @@
 #pragma once
 
 #include <cassert>
+#include <cstddef>     // for size_t
+#include <new>         // for operator new
+#include <type_traits> // for std::bool_constant
 
 enum { ALLOC,      // allocations, number of times NEW is called
        DELETE,     // deletions, number of times DELETE is called
@@ -148,6 +151,21 @@ public:
          return false;
    }
    
+   // three-way compare: negative, zero, or positive. Since it decides
+   // everything with a single comparison, it counts as one less-than
+   int compare(const Spy & rhs) const
+   {
+      counters[LESSTHAN]++;
+      if (rhs.empty() && empty())
+         return 0;
+      if (!rhs.empty() && !empty())
+         return (get() < rhs.get() ? -1 : (rhs.get() < get() ? 1 : 0));
+      if (empty())
+         return -1;
+      else
+         return 1;
+   }
+   
    // reset the counters for a new test
    static void reset()
    {
@@ -189,3 +207,54 @@ private:
    }
    
 };
+
+/*************************************************************
+ * SPY LEDGER
+ * What a family of spy allocators handed out and took back
+ *************************************************************/
+struct SpyLedger
+{
+   int numAllocate = 0;    // calls to allocate()
+   int numDeallocate = 0;  // calls to deallocate()
+   size_t numBytes = 0;    // bytes handed out and not yet back
+};
+
+/*************************************************************
+ * SPY ALLOCATOR
+ * A mock allocator that writes what it does into a ledger. Copies
+ * and rebinds share the ledger, and two are equal when they do.
+ * When isPropagating it follows its container on copy, move and swap
+ *************************************************************/
+template <class T, bool isPropagating = false>
+class SpyAllocator
+{
+public:
+   using value_type = T;
+   using propagate_on_container_copy_assignment = std::bool_constant<isPropagating>;
+   using propagate_on_container_move_assignment = std::bool_constant<isPropagating>;
+   using propagate_on_container_swap = std::bool_constant<isPropagating>;
+   template <class U>
+   struct rebind { using other = SpyAllocator<U, isPropagating>; };
+
+   SpyAllocator(SpyLedger * pLedger) : pLedger(pLedger) {}
+   template <class U>
+   SpyAllocator(const SpyAllocator<U, isPropagating> & rhs) : pLedger(rhs.pLedger) {}
+
+   T * allocate(size_t num)
+   {
+      pLedger->numAllocate++;
+      pLedger->numBytes += num * sizeof(T);
+      return static_cast<T *>(::operator new(num * sizeof(T)));
+   }
+   void deallocate(T * p, size_t num)
+   {
+      pLedger->numDeallocate++;
+      pLedger->numBytes -= num * sizeof(T);
+      ::operator delete(p);
+   }
+
+   bool operator == (const SpyAllocator & rhs) const { return pLedger == rhs.pLedger; }
+   bool operator != (const SpyAllocator & rhs) const { return pLedger != rhs.pLedger; }
+
+   SpyLedger * pLedger;
+};
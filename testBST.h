@@ -14,12 +14,18 @@
 #include "bst.h"
 #include "unitTest.h"
 #include "spy.h"
+#include "pool.h"
 
 #include <cassert>
 #include <memory>
 #include <iostream>
 #include <string>
 #include <functional> // for std::less and std::greater
+#include <cmath>      // for std::log2
+#include <algorithm>  // for std::max
+#include <vector>     // for std::vector
+#include <iterator>   // for std::back_inserter
+#include <optional>   // for std::optional
 
  /***********************************************
   * TEST BST
@@ -27,6 +33,13 @@
   ***********************************************/
 class TestBST : public UnitTest
 {
+   // a Spy that can only be ordered with operator<
+   struct LessOnly
+   {
+      LessOnly(int value) : s(value) {}
+      bool operator < (const LessOnly& rhs) const { return s < rhs.s; }
+      Spy s;
+   };
 
 public:
    void run()
@@ -43,6 +56,8 @@ public:
       test_constructMove_standard();
       test_constructInitializer_empty();
       test_constructInitializer_standard();
+      test_constructInitializer_sorted();
+      test_constructInitializer_duplicates();
 
       // Assign
       test_assign_emptyToEmpty();
@@ -59,6 +74,7 @@ public:
       test_assignMove_standardToStandard();
       test_assignInitializer_oneToStandard();
       test_assignInitializer_standardToEmpty();
+      test_assignInitializer_sortedBalanced();
       test_swap_emptyToEmpty();
       test_swap_standardToEmpty();
       test_swap_emptyToStandard();
@@ -68,6 +84,9 @@ public:
       test_begin_empty();
       test_begin_standard();
       test_end_standard();
+      test_end_decrementStandard();
+      test_rbegin_standard();
+      test_begin_followsInsertErase();
       test_iterator_increment_standardToParent();
       test_iterator_increment_standardToChild();
       test_iterator_increment_standardToGrandma();
@@ -81,6 +100,14 @@ public:
       test_find_standardBegin();
       test_find_standardLast();
       test_find_standardMissing();
+      test_find_onePerLevel();
+      test_find_lessThanOnly();
+      test_find_batchUnsorted();
+      test_find_batchSorted();
+      test_compare_greater();
+      test_compare_emptyBase();
+      test_bounds_standard();
+      test_equalRange_duplicates();
 
       // Insert
       test_insert_oneLeft();
@@ -91,6 +118,17 @@ public:
       test_insertMove_oneRight();
       test_insertMove_duplicate();
       test_insertMove_keepUnique();
+      test_insert_colorsStandard();
+      test_insert_sortedHeight();
+      test_insert_reverseSortedHeight();
+      test_insertHint_sortedAtEnd();
+      test_insertHint_reverseAtBegin();
+      test_insertHint_afterHint();
+      test_insertHint_wrongHint();
+      test_insertHint_keepUnique();
+      test_emplaceHint_standard();
+      test_emplace_inPlace();
+      test_emplace_duplicate();
 
       // Remove
       test_erase_empty();
@@ -98,8 +136,64 @@ public:
       test_erase_noChildren();
       test_erase_oneChild();
       test_erase_twoChildren();
+      test_erase_keepsBalance();
+      test_erase_rangeStandard();
+      test_erase_rangeEveryPolicy();
+      test_erase_keyDuplicates();
       test_clear_empty();
       test_clear_standard();
+      test_clear_deepVine();
+      test_constructCopy_rightVine();
+      test_constructCopy_leftVine();
+      test_assign_zigZagOntoVine();
+
+      // Node handles
+      test_extract_standard();
+      test_insert_nodeHandle();
+      test_merge_standard();
+
+      // Allocator
+      test_allocator_everyNode();
+      test_allocator_copyMove();
+      test_allocator_propagate();
+      test_allocator_unequalSetOps();
+
+      // Pool
+      test_pool_reuse();
+      test_pool_clear();
+      test_pool_shared();
+
+      // Balancing policies
+      test_balanceNone_sortedShape();
+      test_balanceAVL_sortedHeight();
+      test_balanceAVL_eraseKeepsBalance();
+      test_balanceTreap_sortedHeight();
+      test_balanceTreap_eraseKeepsHeap();
+
+      // Order statistics
+      test_sized_keepsCounts();
+      test_rank_standard();
+      test_select_standard();
+      test_count_standard();
+      test_iterator_jump();
+
+      // Threaded nodes
+      test_threaded_insertErase();
+      test_threaded_buildCopy();
+      test_threaded_iterate();
+
+      // Split and join
+      test_split_standard();
+      test_split_everyPolicy();
+      test_join_standard();
+      test_join_empty();
+
+      // Set algebra
+      test_setUnion_standard();
+      test_setIntersection_standard();
+      test_setDifference_standard();
+      test_setOps_everyPolicy();
+      test_setOps_parallel();
 
       // Status
       test_empty_empty();
@@ -122,6 +216,7 @@ public:
       custom::BST<Spy> bst;
       bst.numElements = 99;
       bst.root = (custom::BST<Spy>::BNode*)0xBAADF00D;
+      bst.pLeftmost = bst.pRightmost = (custom::BST<Spy>::BNode*)0xBAADF00D;
       Spy::reset();
       // exercise
       alloc.construct(&bst);  // just call the constructor by itself
@@ -147,6 +242,7 @@ public:
       std::allocator<custom::BST<Spy>> alloc;
       bstDest.numElements = 99;
       bstDest.root = (custom::BST<Spy>::BNode*)0xBAADF00D;
+      bstDest.pLeftmost = bstDest.pRightmost = (custom::BST<Spy>::BNode*)0xBAADF00D;
       Spy::reset();
       // exercise
       alloc.construct(&bstDest, bstSrc);  // just call the constructor by itself
@@ -170,6 +266,7 @@ public:
       custom::BST<Spy>::BNode* p50 = new custom::BST<Spy>::BNode(Spy(50));
       bstSrc.root = p50;
       bstSrc.numElements = 1;
+      bstSrc.pLeftmost = bstSrc.pRightmost = p50;
       Spy::reset();
       // exercise
       custom::BST <Spy> bstDest(bstSrc);
@@ -207,10 +304,12 @@ public:
          delete bstSrc.root;
       bstSrc.root = nullptr;
       bstSrc.numElements = 0;
+      bstSrc.pLeftmost = bstSrc.pRightmost = nullptr;
       if (bstDest.root)
          delete bstDest.root;
       bstDest.root = nullptr;
       bstDest.numElements = 0;
+      bstDest.pLeftmost = bstDest.pRightmost = nullptr;
    }
 
    // copy the standard fixture
@@ -290,6 +389,7 @@ public:
       custom::BST<Spy>::BNode* p50 = new custom::BST<Spy>::BNode(Spy(50));
       bstSrc.root = p50;
       bstSrc.numElements = 1;
+      bstSrc.pLeftmost = bstSrc.pRightmost = p50;
       Spy::reset();
       // exercise
       custom::BST <Spy> bstDest(std::move(bstSrc));
@@ -325,6 +425,7 @@ public:
          delete bstDest.root;
       bstDest.root = nullptr;
       bstDest.numElements = 0;
+      bstDest.pLeftmost = bstDest.pRightmost = nullptr;
    }
 
    // move the standard fixture
@@ -405,12 +506,46 @@ public:
       assertUnit(Spy::numAssign() == 0);
       assertUnit(Spy::numAssignMove() == 0);
       assertUnit(Spy::numEquals() == 0);
-      assertUnit(Spy::numLessthan() == 10);
+      assertUnit(Spy::numLessthan() <= 7 * 3);   // sorted first, O(n log n)
+      assertStandardFixture(bstDest);
+      // teardown
+      teardownStandardFixture(bstDest);
+   }
+
+   // sorted input is checked once and built without sorting
+   void test_constructInitializer_sorted()
+   {  // setup
+      //                (50b)
+      //          +-------+-------+
+      //        (30b)           (70b)
+      //     +----+----+     +----+----+
+      //   (20r)     (40r) (60r)     (80r)
+      std::initializer_list<Spy> ilSrc{ Spy(20), Spy(30), Spy(40), Spy(50), Spy(60), Spy(70), Spy(80) };
+      Spy::reset();
+      // exercise
+      custom::BST <Spy> bstDest(ilSrc);
+      // verify
+      assertUnit(Spy::numCopy() == 7);
+      assertUnit(Spy::numAlloc() == 7);
+      assertUnit(Spy::numLessthan() == 6);
+      assertUnit(blackHeight(bstDest.root) == 3);
       assertStandardFixture(bstDest);
       // teardown
       teardownStandardFixture(bstDest);
    }
 
+   // duplicates are kept, in the order they were given
+   void test_constructInitializer_duplicates()
+   {  // setup
+      std::initializer_list<int> ilSrc{ 3, 1, 2, 1, 3 };
+      // exercise
+      custom::BST <int> bst(ilSrc);
+      // verify
+      assertUnit(bst.size() == 5);
+      assertUnit(std::vector<int>(bst.begin(), bst.end()) == std::vector<int>({ 1, 1, 2, 3, 3 }));
+      assertUnit(blackHeight(bst.root) > 0);
+   }  // teardown
+
    /***************************************
     * EMPTY and SIZE
     ***************************************/
@@ -635,6 +770,7 @@ public:
       custom::BST <Spy>::BNode* p99 = new custom::BST<Spy>::BNode(Spy(99));
       bstDest.root = p99;
       bstDest.numElements = 1;
+      bstDest.pLeftmost = bstDest.pRightmost = p99;
       Spy::reset();
       // exercise
       bstDest = bstSrc;
@@ -676,6 +812,7 @@ public:
       custom::BST <Spy>::BNode* p99 = new custom::BST<Spy>::BNode(Spy(99));
       bstSrc.root = p99;
       bstSrc.numElements = 1;
+      bstSrc.pLeftmost = bstSrc.pRightmost = p99;
       //                (50) = bstDest
       //          +-------+-------+
       //        (30)            (70)
@@ -877,6 +1014,7 @@ public:
       custom::BST <Spy>::BNode* p99 = new custom::BST<Spy>::BNode(Spy(99));
       bstDest.root = p99;
       bstDest.numElements = 1;
+      bstDest.pLeftmost = bstDest.pRightmost = p99;
       Spy::reset();
       // exercise
       bstDest = std::move(bstSrc);
@@ -911,6 +1049,7 @@ public:
       custom::BST <Spy>::BNode* p99 = new custom::BST<Spy>::BNode(Spy(99));
       bstSrc.root = p99;
       bstSrc.numElements = 1;
+      bstSrc.pLeftmost = bstSrc.pRightmost = p99;
       //                (50) = bstDest
       //          +-------+-------+
       //        (30)            (70)
@@ -1028,6 +1167,7 @@ public:
       custom::BST <Spy>::BNode* p99 = new custom::BST<Spy>::BNode(Spy(99));
       bstDest.root = p99;
       bstDest.numElements = 1;
+      bstDest.pLeftmost = bstDest.pRightmost = p99;
       Spy::reset();
       // exercise
       bstDest = ilSrc;
@@ -1041,7 +1181,7 @@ public:
       assertUnit(Spy::numAssign() == 0);
       assertUnit(Spy::numAssignMove() == 0);
       assertUnit(Spy::numEquals() == 0);
-      assertUnit(Spy::numLessthan() == 10);
+      assertUnit(Spy::numLessthan() <= 7 * 3);   // sorted first, O(n log n)
       //                (50) = bstDest
       //          +-------+-------+
       //        (30)            (70)
@@ -1052,6 +1192,40 @@ public:
       teardownStandardFixture(bstDest);
    }
 
+   // a large sorted list makes a perfectly balanced tree for every policy
+   void test_assignInitializer_sortedBalanced()
+   {  // setup
+      std::vector<int> values(100000);
+      for (int i = 0; i < (int)values.size(); i++)
+         values[i] = i;
+      custom::BST <int, custom::balance::none>     bstNone     = { 99 };
+      custom::BST <int, custom::balance::redBlack> bstRedBlack = { 99 };
+      custom::BST <int, custom::balance::avl>      bstAVL      = { 99 };
+      custom::BST <int, custom::balance::treap>    bstTreap    = { 99 };
+      // exercise
+      bstNone.build(values.begin(), values.end(), false /*keepUnique*/);
+      bstRedBlack.build(values.begin(), values.end(), false /*keepUnique*/);
+      bstAVL.build(values.begin(), values.end(), false /*keepUnique*/);
+      bstTreap.build(values.begin(), values.end(), false /*keepUnique*/);
+      // verify
+      assertUnit(height(bstNone.root) == 17);
+      assertUnit(height(bstRedBlack.root) == 17);
+      assertUnit(height(bstAVL.root) == 17);
+      assertUnit(height(bstTreap.root) == 17);
+      assertUnit(blackHeight(bstRedBlack.root) > 0);
+      assertUnit(avlHeight(bstAVL.root) == 17);
+      assertUnit(isHeap(bstTreap.root));
+      assertUnit(bstRedBlack.size() == values.size());
+      assertUnit(*bstRedBlack.begin() == 0);
+      assertUnit(*(--bstRedBlack.end()) == 99999);
+      // exercise
+      bstRedBlack.insert(100000);
+      auto it = bstRedBlack.find(500);
+      bstRedBlack.erase(it);
+      // verify
+      assertUnit(blackHeight(bstRedBlack.root) > 0);
+   }  // teardown
+
 
    /***************************************
     * Swap
@@ -1346,6 +1520,87 @@ public:
       teardownStandardFixture(bst);
    }
 
+   // --end() from the standard fixture lands on the last node
+   void test_end_decrementStandard()
+   {  // setup
+      //                 50 
+      //          +-------+-------+
+      //         30              70  
+      //     +----+----+     +----+----+
+      //    20        40    60        80  
+      custom::BST <Spy> bst;
+      setupStandardFixture(bst);
+      custom::BST<Spy>::iterator it;
+      Spy::reset();
+      // exercise
+      it = bst.end();
+      --it;
+      // verify
+      assertUnit(Spy::numLessthan() == 0);    // does not look at any element
+      assertUnit(Spy::numEquals() == 0);      // does not look at any element
+      assertUnit(Spy::numCopy() == 0);
+      assertUnit(Spy::numAlloc() == 0);
+      assertUnit(it.pNode == bst.root->pRight->pRight);
+      if (it.pNode)
+         assertUnit(it.pNode->data == Spy(80));
+      assertStandardFixture(bst);
+      // teardown
+      teardownStandardFixture(bst);
+   }
+
+   // rbegin() to rend() visits the standard fixture backwards
+   void test_rbegin_standard()
+   {  // setup
+      //                 50 
+      //          +-------+-------+
+      //         30              70  
+      //     +----+----+     +----+----+
+      //    20        40    60        80  
+      custom::BST <Spy> bst;
+      setupStandardFixture(bst);
+      std::vector<int> values;
+      // exercise
+      for (auto it = bst.rbegin(); it != bst.rend(); ++it)
+         values.push_back((*it).get());
+      // verify
+      assertUnit(values == std::vector<int>({ 80, 70, 60, 50, 40, 30, 20 }));
+      assertStandardFixture(bst);
+      // teardown
+      teardownStandardFixture(bst);
+   }
+
+   // the cached first and last nodes follow a new minimum and maximum
+   // in and back out again
+   void test_begin_followsInsertErase()
+   {  // setup
+      custom::BST <int> bst = { 50, 30, 70 };
+      // exercise
+      bst.insert(10);
+      bst.insert(90);
+      // verify
+      assertUnit(*bst.begin() == 10);
+      assertUnit(*(--bst.end()) == 90);
+      // exercise
+      auto itMin = bst.begin();
+      bst.erase(itMin);
+      auto itMax = --bst.end();
+      bst.erase(itMax);
+      // verify
+      assertUnit(*bst.begin() == 30);
+      assertUnit(*(--bst.end()) == 70);
+      assertUnit(bst.pLeftmost->pLeft == nullptr);
+      assertUnit(bst.pRightmost->pRight == nullptr);
+      // exercise
+      bst.clear();
+      bst.insert(50);
+      auto itOnly = bst.begin();
+      bst.erase(itOnly);
+      // verify
+      assertUnit(bst.begin() == bst.end());
+      assertUnit(bst.pLeftmost == nullptr);
+      assertUnit(bst.pRightmost == nullptr);
+   }   // teardown
+
    // increment where the next node is the parent
    void test_iterator_increment_standardToParent()
    {  // setup
@@ -1674,8 +1929,8 @@ public:
       // exercise
       it = bst.find(s);
       // verify
-      assertUnit(Spy::numEquals() == 3);      // check [50][30][20]
-      assertUnit(Spy::numLessthan() == 2);    // compare [50][30]
+      assertUnit(Spy::numEquals() == 0);
+      assertUnit(Spy::numLessthan() == 3);    // compare [50][30][20]
       assertUnit(Spy::numDestructor() == 0);
       assertUnit(Spy::numDelete() == 0);
       assertUnit(Spy::numAssign() == 0);
@@ -1717,8 +1972,8 @@ public:
       // exercise
       it = bst.find(s);
       // verify
-      assertUnit(Spy::numEquals() == 3);      // check [50][70][80]
-      assertUnit(Spy::numLessthan() == 2);    // compare [50][70]
+      assertUnit(Spy::numEquals() == 0);
+      assertUnit(Spy::numLessthan() == 3);    // compare [50][70][80]
       assertUnit(Spy::numDestructor() == 0);
       assertUnit(Spy::numDelete() == 0);
       assertUnit(Spy::numAssign() == 0);
@@ -1760,7 +2015,7 @@ public:
       // exercise
       it = bst.find(s);
       // verify
-      assertUnit(Spy::numEquals() == 3);      // check [50][30][40]
+      assertUnit(Spy::numEquals() == 0);
       assertUnit(Spy::numLessthan() == 3);    // compare [50][30][40]
       assertUnit(Spy::numDestructor() == 0);
       assertUnit(Spy::numDelete() == 0);
@@ -1777,6 +2032,219 @@ public:
       teardownStandardFixture(bst);
    }
 
+   // a three-way compare decides each level with a single comparison
+   void test_find_onePerLevel()
+   {  // setup
+      //                 50             level 1
+      //          +-------+-------+
+      //         30              70     level 2
+      //     +----+----+     +----+----+
+      //    20        40    60        80  level 3
+      custom::BST <Spy> bst;
+      setupStandardFixture(bst);
+      int keys[]   = { 50, 30, 70, 20, 40, 60, 80, 10, 45, 99 };
+      int levels[] = {  1,  2,  2,  3,  3,  3,  3,  3,  3,  3 };
+      for (int i = 0; i < 10; i++)
+      {
+         Spy s(keys[i]);
+         Spy::reset();
+         // exercise
+         custom::BST<Spy>::iterator it = bst.find(s);
+         // verify
+         assertUnit(Spy::numLessthan() + Spy::numEquals() <= levels[i]);
+         assertUnit((it != bst.end()) == (i < 7));
+      }
+      // teardown
+      teardownStandardFixture(bst);
+   }
+
+   // with only operator< there is one comparison per level plus one more
+   // to rule out the last candidate being larger
+   void test_find_lessThanOnly()
+   {  // setup
+      //                 50             level 1
+      //          +-------+-------+
+      //         30              70     level 2
+      //     +----+----+     +----+----+
+      //    20        40    60        80  level 3
+      custom::BST <LessOnly> bst;
+      for (int key : { 50, 30, 70, 20, 40, 60, 80 })
+         bst.insert(LessOnly(key));
+      int keys[] = { 50, 30, 70, 20, 40, 60, 80, 10, 45, 99 };
+      for (int i = 0; i < 10; i++)
+      {
+         LessOnly l(keys[i]);
+         Spy::reset();
+         // exercise
+         custom::BST<LessOnly>::iterator it = bst.find(l);
+         // verify
+         assertUnit(Spy::numEquals() == 0);
+         assertUnit(Spy::numLessthan() <= 3 + 1);
+         assertUnit((it != bst.end()) == (i < 7));
+         if (it != bst.end())
+            assertUnit((*it).s.get() == keys[i]);
+      }
+   }  // teardown
+
+   // each key of a batch is found, or not, the same as by find()
+   void test_find_batchUnsorted()
+   {  // setup
+      //                 50
+      //          +-------+-------+
+      //         30              70
+      //     +----+----+     +----+----+
+      //    20        40    60        80
+      custom::BST <Spy> bst;
+      setupStandardFixture(bst);
+      std::vector<Spy> keys = { Spy(80), Spy(10), Spy(50), Spy(45), Spy(20), Spy(50) };
+      std::vector<custom::BST<Spy>::iterator> out(keys.size());
+      // exercise
+      bst.find_batch(keys, out);
+      // verify
+      for (size_t i = 0; i < keys.size(); i++)
+         assertUnit(out[i] == bst.find(keys[i]));
+      assertUnit(out[0] != bst.end() && (*out[0]).get() == 80);
+      assertUnit(out[1] == bst.end());
+      assertUnit(out[3] == bst.end());
+      assertUnit(out[2] == out[5]);
+      // teardown
+      teardownStandardFixture(bst);
+   }
+
+   // a sorted batch goes down the path its keys share once, not once
+   // for every key
+   void test_find_batchSorted()
+   {  // setup
+      custom::BST <Spy> bst;
+      for (int i = 1; i <= 127; i++)
+         bst.insert(Spy(i * 2));
+      std::vector<Spy> keys;
+      for (int key = 200; key < 216; key++)
+         keys.push_back(Spy(key));
+      std::vector<custom::BST<Spy>::iterator> out(keys.size());
+      Spy::reset();
+      for (const Spy& key : keys)
+         bst.find(key);
+      size_t numCompareLoop = Spy::numLessthan() + Spy::numEquals();
+      Spy::reset();
+      // exercise
+      bst.find_batch(keys, out);
+      // verify
+      size_t numCompareBatch = Spy::numLessthan() + Spy::numEquals();
+      assertUnit(numCompareBatch < numCompareLoop);
+      for (size_t i = 0; i < keys.size(); i++)
+      {
+         assertUnit((out[i] != bst.end()) == (i % 2 == 0));
+         if (out[i] != bst.end())
+            assertUnit((*out[i]).get() == keys[i].get());
+      }
+   }  // teardown
+
+   // a tree ordered by std::greater keeps the largest first
+   void test_compare_greater()
+   {  // setup
+      custom::BST <int, custom::balance::avl, std::greater<int>> bst;
+      for (int i = 0; i < 20; i++)
+         bst.insert((i * 7) % 20);
+      // exercise
+      size_t numErased = bst.erase(5);
+      // verify
+      assertUnit(numErased == 1);
+      assertUnit(bst.size() == 19);
+      int expected = 19;
+      for (int value : bst)
+      {
+         if (expected == 5)
+            expected--;
+         assertUnit(value == expected);
+         expected--;
+      }
+      assertUnit(expected == -1);
+      assertUnit(bst.find(12) != bst.end());
+      assertUnit(bst.find(5) == bst.end());
+      assertUnit(*bst.lower_bound(5) == 4);
+   }  // teardown
+
+   // an empty comparator takes no room in the tree, a stateful one is
+   // kept once per tree rather than once per element
+   void test_compare_emptyBase()
+   {  // setup
+      struct Modulo
+      {
+         int modulus;
+         bool operator () (int lhs, int rhs) const { return lhs % modulus < rhs % modulus; }
+      };
+      custom::BST <int, custom::balance::redBlack, Modulo> bst(Modulo{ 10 });
+      // exercise
+      for (int value : { 13, 21, 9, 35 })
+         bst.insert(value, true /*keepUnique*/);
+      auto bstCopy(bst);
+      bstCopy.insert(44, true /*keepUnique*/);
+      bstCopy.insert(43, true /*keepUnique*/);
+      // verify
+      assertUnit(sizeof(custom::BST <int>) == 3 * sizeof(void*) + sizeof(size_t));
+      assertUnit(sizeof(bst) == sizeof(custom::BST <int>) + sizeof(void*));
+      std::vector<int> values(bstCopy.begin(), bstCopy.end());
+      assertUnit(values.size() == 5);
+      assertUnit(values[0] == 21 && values[1] == 13 && values[2] == 44);
+      assertUnit(values[3] == 35 && values[4] == 9);
+      assertUnit(bstCopy.key_comp().modulus == 10);
+   }  // teardown
+
+   // each bound is one comparison per level of the standard fixture
+   void test_bounds_standard()
+   {  // setup
+      //                 50 
+      //          +-------+-------+
+      //         30              70  
+      //     +----+----+     +----+----+
+      //    20        40    60        80  
+      custom::BST <Spy> bst;
+      setupStandardFixture(bst);
+      Spy s45(45);
+      Spy s50(50);
+      Spy::reset();
+      // exercise
+      auto itLower45 = bst.lower_bound(s45);
+      auto itUpper50 = bst.upper_bound(s50);
+      // verify
+      assertUnit(Spy::numLessthan() == 3 + 3);
+      assertUnit(Spy::numAlloc() == 0);
+      assertUnit(Spy::numCopy() == 0);
+      assertUnit(itLower45->get() == 50);
+      assertUnit(itUpper50->get() == 60);
+      assertUnit(bst.lower_bound(Spy(50))->get() == 50);
+      assertUnit(bst.upper_bound(Spy(80)) == bst.end());
+      assertUnit(bst.lower_bound(Spy(10)) == bst.begin());
+      assertStandardFixture(bst);
+   }  // teardown
+
+   // the range of a run of duplicates, checked against the standard
+   // library for every key in and around the tree
+   void test_equalRange_duplicates()
+   {  // setup
+      custom::BST <int> bst;
+      std::vector<int> values;
+      for (int i = 0; i < 300; i++)
+      {
+         int key = (i * 7919) % 100 / 3;
+         bst.insert(key);
+         values.push_back(key);
+      }
+      std::sort(values.begin(), values.end());
+      for (int key = -1; key <= 35; key++)
+      {
+         // exercise
+         auto range = bst.equal_range(key);
+         // verify
+         auto rangeStd = std::equal_range(values.begin(), values.end(), key);
+         assertUnit(std::distance(bst.begin(), range.first) == rangeStd.first - values.begin());
+         assertUnit(std::distance(bst.begin(), range.second) == rangeStd.second - values.begin());
+         assertUnit(range.first == bst.lower_bound(key));
+         assertUnit(range.second == bst.upper_bound(key));
+      }
+   }  // teardown
+
 
 
    /***************************************
@@ -1792,6 +2260,7 @@ public:
       custom::BST<Spy>::BNode* p50 = new custom::BST<Spy>::BNode(Spy(50));
       bst.root = p50;
       bst.numElements = 1;
+      bst.pLeftmost = bst.pRightmost = p50;
       Spy s(60);
       Spy::reset();
       // exercise
@@ -1841,6 +2310,7 @@ public:
          delete p50;
       bst.root = nullptr;
       bst.numElements = 0;
+      bst.pLeftmost = bst.pRightmost = nullptr;
    }
 
    // insert an element to the left of a single-element tree
@@ -1851,6 +2321,7 @@ public:
       custom::BST<Spy>::BNode* p50 = new custom::BST<Spy>::BNode(Spy(50));
       bst.root = p50;
       bst.numElements = 1;
+      bst.pLeftmost = bst.pRightmost = p50;
       Spy s(40);
       Spy::reset();
       // exercise
@@ -1903,6 +2374,7 @@ public:
          delete p50;
       bst.root = nullptr;
       bst.numElements = 0;
+      bst.pLeftmost = bst.pRightmost = nullptr;
    }
 
    // insert a duplicate item in a BST
@@ -1913,6 +2385,7 @@ public:
       custom::BST<Spy>::BNode* p50 = new custom::BST<Spy>::BNode(Spy(50));
       bst.root = p50;
       bst.numElements = 1;
+      bst.pLeftmost = bst.pRightmost = p50;
       Spy s(50);
       Spy::reset();
       // exercise
@@ -1964,6 +2437,7 @@ public:
          delete p50;
       bst.root = nullptr;
       bst.numElements = 0;
+      bst.pLeftmost = bst.pRightmost = nullptr;
    }
 
    // insert an item when it already exists
@@ -1981,8 +2455,8 @@ public:
       // exercise
       auto pairBST = bst.insert(s, true /* keepUnique */);
       // verify
-      assertUnit(Spy::numLessthan() == 2);    // compare [50][30]
-      assertUnit(Spy::numEquals() == 3);      // compare [50][30][40]
+      assertUnit(Spy::numLessthan() == 3);    // compare [50][30][40]
+      assertUnit(Spy::numEquals() == 0);
       assertUnit(Spy::numCopy() == 0);
       assertUnit(Spy::numAlloc() == 0);
       assertUnit(Spy::numDestructor() == 0);
@@ -2022,6 +2496,7 @@ public:
       custom::BST<Spy>::BNode* p50 = new custom::BST<Spy>::BNode(Spy(50));
       bst.root = p50;
       bst.numElements = 1;
+      bst.pLeftmost = bst.pRightmost = p50;
       Spy s(60);
       Spy::reset();
       // exercise
@@ -2071,6 +2546,7 @@ public:
          delete p50;
       bst.root = nullptr;
       bst.numElements = 0;
+      bst.pLeftmost = bst.pRightmost = nullptr;
    }
 
    // insert an element to the left of a single-element tree
@@ -2081,6 +2557,7 @@ public:
       custom::BST<Spy>::BNode* p50 = new custom::BST<Spy>::BNode(Spy(50));
       bst.root = p50;
       bst.numElements = 1;
+      bst.pLeftmost = bst.pRightmost = p50;
       Spy s(40);
       Spy::reset();
       // exercise
@@ -2134,6 +2611,7 @@ public:
          delete p50;
       bst.root = nullptr;
       bst.numElements = 0;
+      bst.pLeftmost = bst.pRightmost = nullptr;
    }
 
    // insert a duplicate item in a BST
@@ -2144,6 +2622,7 @@ public:
       custom::BST<Spy>::BNode* p50 = new custom::BST<Spy>::BNode(Spy(50));
       bst.root = p50;
       bst.numElements = 1;
+      bst.pLeftmost = bst.pRightmost = p50;
       Spy s(50);
       Spy::reset();
       // exercise
@@ -2196,6 +2675,7 @@ public:
          delete p50;
       bst.root = nullptr;
       bst.numElements = 0;
+      bst.pLeftmost = bst.pRightmost = nullptr;
    }
 
    // insert an item when it already exists
@@ -2213,8 +2693,8 @@ public:
       // exercise
       auto pairBST = bst.insert(std::move(s), true /* keepUnique */);
       // verify
-      assertUnit(Spy::numLessthan() == 2);    // compare [50][30]
-      assertUnit(Spy::numEquals() == 3);      // compare [50][30][40]
+      assertUnit(Spy::numLessthan() == 3);    // compare [50][30][40]
+      assertUnit(Spy::numEquals() == 0);
       assertUnit(Spy::numCopy() == 0);
       assertUnit(Spy::numAlloc() == 0);
       assertUnit(Spy::numDestructor() == 0);
@@ -2241,36 +2721,112 @@ public:
 
 
    /***************************************
-    * Erase
-    *    BST::erase(it)
+    * Red-Black Insert
+    *    BST::insert(T &&)
     ***************************************/
 
-   // erase from an empty BST
-   void test_erase_empty()
+   // inserting the standard fixture in order gives the expected colors
+   void test_insert_colorsStandard()
    {  // setup
       custom::BST <Spy> bst;
-      auto it = bst.end();
+      // exercise
+      bst = { Spy(50), Spy(30), Spy(70), Spy(20), Spy(40), Spy(60), Spy(80) };
+      // verify
+      //                (50b)
+      //          +-------+-------+
+      //        (30b)           (70b)
+      //     +----+----+     +----+----+
+      //   (20r)     (40r) (60r)     (80r)
+      assertStandardFixture(bst);
+      if (bst.root && bst.root->pLeft && bst.root->pRight)
+      {
+         assertUnit(bst.root->isRed == false);
+         assertUnit(bst.root->pLeft->isRed == false);
+         assertUnit(bst.root->pRight->isRed == false);
+         if (bst.root->pLeft->pLeft && bst.root->pLeft->pRight)
+         {
+            assertUnit(bst.root->pLeft->pLeft->isRed == true);
+            assertUnit(bst.root->pLeft->pRight->isRed == true);
+         }
+         if (bst.root->pRight->pLeft && bst.root->pRight->pRight)
+         {
+            assertUnit(bst.root->pRight->pLeft->isRed == true);
+            assertUnit(bst.root->pRight->pRight->isRed == true);
+         }
+      }
+      assertUnit(blackHeight(bst.root) > 0);
+   }  // teardown
+
+   // a million sorted keys stays within the red-black height bound
+   void test_insert_sortedHeight()
+   {  // setup
+      custom::BST <int> bst;
+      const int num = 1000000;
+      // exercise
+      for (int i = 0; i < num; i++)
+         bst.insert(i);
+      // verify
+      assertUnit(bst.size() == num);
+      assertUnit(height(bst.root) <= 2.0 * std::log2(num + 1.0));
+      assertUnit(blackHeight(bst.root) > 0);
+      assertUnit(bst.root->pParent == nullptr);
+      assertUnit(*bst.begin() == 0);
+   }  // teardown
+
+   // a million reverse-sorted keys stays within the red-black height bound
+   void test_insert_reverseSortedHeight()
+   {  // setup
+      custom::BST <int> bst;
+      const int num = 1000000;
+      // exercise
+      for (int i = num; i > 0; i--)
+         bst.insert(i);
+      // verify
+      assertUnit(bst.size() == num);
+      assertUnit(height(bst.root) <= 2.0 * std::log2(num + 1.0));
+      assertUnit(blackHeight(bst.root) > 0);
+      assertUnit(*bst.begin() == 1);
+   }  // teardown
+
+   // sorted keys with end() as the hint cost one comparison each
+   void test_insertHint_sortedAtEnd()
+   {  // setup
+      custom::BST <Spy> bst;
+      const int num = 1000;
       Spy::reset();
       // exercise
-      auto itReturn = bst.erase(it);
+      for (int i = 0; i < num; i++)
+         bst.insert(bst.end(), Spy(i), true /*keepUnique*/);
       // verify
-      assertUnit(Spy::numLessthan() == 0);   
-      assertUnit(Spy::numCopy() == 0);       
-      assertUnit(Spy::numAlloc() == 0);      
-      assertUnit(Spy::numEquals() == 0);
-      assertUnit(Spy::numDestructor() == 0);
-      assertUnit(Spy::numDelete() == 0);
-      assertUnit(Spy::numAssign() == 0);
-      assertUnit(Spy::numDefault() == 0);
-      assertUnit(Spy::numNondefault() == 0);
-      assertUnit(Spy::numCopyMove() == 0);
-      assertUnit(Spy::numAssignMove() == 0);
-      assertUnit(itReturn == bst.end());
-      assertEmptyFixture(bst);
+      assertUnit(Spy::numLessthan() == num - 1);
+      assertUnit(Spy::numAlloc() == num);
+      assertUnit(bst.size() == num);
+      assertUnit(blackHeight(bst.root) > 0);
+      assertUnit(height(bst.root) <= 2.0 * std::log2(num + 1.0));
+      assertUnit(std::is_sorted(bst.begin(), bst.end()));
+      assertUnit(bst.begin()->get() == 0);
+      assertUnit((--bst.end())->get() == num - 1);
    }  // teardown
 
-   // erase with an empty iterator
-   void test_erase_standardMissing()
+   // reverse-sorted keys with begin() as the hint cost one comparison each
+   void test_insertHint_reverseAtBegin()
+   {  // setup
+      custom::BST <Spy> bst;
+      const int num = 1000;
+      Spy::reset();
+      // exercise
+      for (int i = num; i > 0; i--)
+         bst.insert(bst.begin(), Spy(i));
+      // verify
+      assertUnit(Spy::numLessthan() == num - 1);
+      assertUnit(bst.size() == num);
+      assertUnit(blackHeight(bst.root) > 0);
+      assertUnit(std::is_sorted(bst.begin(), bst.end()));
+      assertUnit(bst.begin()->get() == 1);
+   }  // teardown
+
+   // the hint is the node just before the new one
+   void test_insertHint_afterHint()
    {  // setup
       //                 50 
       //          +-------+-------+
@@ -2279,39 +2835,198 @@ public:
       //    20        40    60        80  
       custom::BST <Spy> bst;
       setupStandardFixture(bst);
-      auto it = bst.end();
+      custom::BST <Spy>::iterator itHint = bst.find(Spy(40));
       Spy::reset();
       // exercise
-      auto itReturn = bst.erase(it);
+      auto it = bst.insert(itHint, Spy(45), true /*keepUnique*/);
       // verify
-      assertUnit(Spy::numLessthan() == 0);
-      assertUnit(Spy::numCopy() == 0);
-      assertUnit(Spy::numAlloc() == 0);
-      assertUnit(Spy::numEquals() == 0);
-      assertUnit(Spy::numDestructor() == 0);
-      assertUnit(Spy::numDelete() == 0);
-      assertUnit(Spy::numAssign() == 0);
-      assertUnit(Spy::numDefault() == 0);
-      assertUnit(Spy::numNondefault() == 0);
-      assertUnit(Spy::numCopyMove() == 0);
-      assertUnit(Spy::numAssignMove() == 0);
-      assertUnit(itReturn == bst.end());
-      assertStandardFixture(bst);
+      assertUnit(Spy::numLessthan() == 3);    // 45 < 40, 40 < 45, 45 < 50
+      assertUnit(Spy::numAlloc() == 1);
+      assertUnit(it != bst.end());
+      assertUnit(it.pNode->pParent == bst.root->pLeft->pRight);
+      assertUnit(*it == Spy(45));
+      assertUnit(bst.size() == 8);
+      assertUnit(std::is_sorted(bst.begin(), bst.end()));
       // teardown
-      teardownStandardFixture(bst);
+      bst.clear();
+   }
+
+   // a hint in the wrong place still inserts in order
+   void test_insertHint_wrongHint()
+   {  // setup
+      custom::BST <int> bst = { 50, 30, 70, 20, 40, 60, 80 };
+      // exercise
+      auto it1 = bst.insert(bst.begin(), 65);
+      auto it2 = bst.insert(bst.end(), 10);
+      auto it3 = bst.insert(bst.find(70), 35);
+      // verify
+      assertUnit(*it1 == 65);
+      assertUnit(*it2 == 10);
+      assertUnit(*it3 == 35);
+      assertUnit(bst.size() == 10);
+      assertUnit(std::is_sorted(bst.begin(), bst.end()));
+      assertUnit(*bst.begin() == 10);
+      assertUnit(blackHeight(bst.root) > 0);
    }  // teardown
 
-   // remove a leaf node from the standard fixture
-   void test_erase_noChildren()
+   // a duplicate next to the hint is found rather than inserted
+   void test_insertHint_keepUnique()
    {  // setup
       //                 50 
       //          +-------+-------+
       //         30              70  
       //     +----+----+     +----+----+
-      //    20        40  [[60]]      80  
+      //    20        40    60        80  
       custom::BST <Spy> bst;
       setupStandardFixture(bst);
-      auto it = custom::BST <Spy> :: iterator(bst.root->pRight->pLeft);
+      Spy s(60);
+      custom::BST <Spy>::iterator itHint = bst.find(s);
+      Spy::reset();
+      // exercise
+      auto it = bst.insert(itHint, s, true /*keepUnique*/);
+      // verify
+      assertUnit(Spy::numAlloc() == 0);
+      assertUnit(Spy::numCopy() == 0);
+      assertUnit(it.pNode == bst.root->pRight->pLeft);
+      assertStandardFixture(bst);
+      // teardown
+      teardownStandardFixture(bst);
+   }
+
+   // emplace next to a hint from the constructor arguments
+   void test_emplaceHint_standard()
+   {  // setup
+      custom::BST <std::string> bst = { "b", "d" };
+      // exercise
+      auto it = bst.emplace_hint(bst.end(), 3, 'e');
+      // verify
+      assertUnit(*it == std::string("eee"));
+      assertUnit(bst.size() == 3);
+      assertUnit(bst.pRightmost == it.pNode);
+      assertUnit(std::is_sorted(bst.begin(), bst.end()));
+   }  // teardown
+
+   // emplace builds the element inside the node, never copying it
+   void test_emplace_inPlace()
+   {  // setup
+      //                 50 
+      //          +-------+-------+
+      //         30              70  
+      //     +----+----+     +----+----+
+      //    20        40    60        80  
+      custom::BST <Spy> bst;
+      setupStandardFixture(bst);
+      Spy::reset();
+      // exercise
+      auto pairReturn = bst.emplace(45);
+      // verify
+      assertUnit(Spy::numNondefault() == 1);
+      assertUnit(Spy::numAlloc() == 1);
+      assertUnit(Spy::numCopy() == 0);
+      assertUnit(Spy::numCopyMove() == 0);
+      assertUnit(Spy::numAssign() == 0);
+      assertUnit(Spy::numAssignMove() == 0);
+      assertUnit(pairReturn.second);
+      assertUnit(pairReturn.first->get() == 45);
+      assertUnit(pairReturn.first.pNode->pParent->data.get() == 40);
+      assertUnit(bst.size() == 8);
+      assertUnit(blackHeight(bst.root) > 0);
+   }  // teardown
+
+   // a duplicate that is not kept is freed again
+   void test_emplace_duplicate()
+   {  // setup
+      custom::BST <Spy> bst;
+      setupStandardFixture(bst);
+      Spy::reset();
+      // exercise
+      auto pairReturn = bst.emplaceNode(true /*keepUnique*/, 40);
+      // verify
+      assertUnit(!pairReturn.second);
+      assertUnit(pairReturn.first->get() == 40);
+      assertUnit(Spy::numDelete() == 1);
+      assertUnit(Spy::numCopy() == 0);
+      assertUnit(bst.size() == 7);
+      // exercise
+      pairReturn = bst.emplace(40);
+      // verify
+      assertUnit(pairReturn.second);
+      assertUnit(bst.size() == 8);
+      assertUnit(std::is_sorted(bst.begin(), bst.end()));
+   }  // teardown
+
+   /***************************************
+    * Erase
+    *    BST::erase(it)
+    ***************************************/
+
+   // erase from an empty BST
+   void test_erase_empty()
+   {  // setup
+      custom::BST <Spy> bst;
+      auto it = bst.end();
+      Spy::reset();
+      // exercise
+      auto itReturn = bst.erase(it);
+      // verify
+      assertUnit(Spy::numLessthan() == 0);   
+      assertUnit(Spy::numCopy() == 0);       
+      assertUnit(Spy::numAlloc() == 0);      
+      assertUnit(Spy::numEquals() == 0);
+      assertUnit(Spy::numDestructor() == 0);
+      assertUnit(Spy::numDelete() == 0);
+      assertUnit(Spy::numAssign() == 0);
+      assertUnit(Spy::numDefault() == 0);
+      assertUnit(Spy::numNondefault() == 0);
+      assertUnit(Spy::numCopyMove() == 0);
+      assertUnit(Spy::numAssignMove() == 0);
+      assertUnit(itReturn == bst.end());
+      assertEmptyFixture(bst);
+   }  // teardown
+
+   // erase with an empty iterator
+   void test_erase_standardMissing()
+   {  // setup
+      //                 50 
+      //          +-------+-------+
+      //         30              70  
+      //     +----+----+     +----+----+
+      //    20        40    60        80  
+      custom::BST <Spy> bst;
+      setupStandardFixture(bst);
+      auto it = bst.end();
+      Spy::reset();
+      // exercise
+      auto itReturn = bst.erase(it);
+      // verify
+      assertUnit(Spy::numLessthan() == 0);
+      assertUnit(Spy::numCopy() == 0);
+      assertUnit(Spy::numAlloc() == 0);
+      assertUnit(Spy::numEquals() == 0);
+      assertUnit(Spy::numDestructor() == 0);
+      assertUnit(Spy::numDelete() == 0);
+      assertUnit(Spy::numAssign() == 0);
+      assertUnit(Spy::numDefault() == 0);
+      assertUnit(Spy::numNondefault() == 0);
+      assertUnit(Spy::numCopyMove() == 0);
+      assertUnit(Spy::numAssignMove() == 0);
+      assertUnit(itReturn == bst.end());
+      assertStandardFixture(bst);
+      // teardown
+      teardownStandardFixture(bst);
+   }  // teardown
+
+   // remove a leaf node from the standard fixture
+   void test_erase_noChildren()
+   {  // setup
+      //                 50 
+      //          +-------+-------+
+      //         30              70  
+      //     +----+----+     +----+----+
+      //    20        40  [[60]]      80  
+      custom::BST <Spy> bst;
+      setupStandardFixture(bst);
+      auto it = custom::BST <Spy> :: iterator(bst.root->pRight->pLeft);
       Spy::reset();
       // exercise
       auto itReturn = bst.erase(it);
@@ -2475,6 +3190,1296 @@ public:
       bst.root = nullptr;
    }
 
+   // erasing most of a sorted tree keeps it a valid red-black tree
+   void test_erase_keepsBalance()
+   {  // setup
+      custom::BST <int> bst;
+      const int num = 100000;
+      for (int i = 0; i < num; i++)
+         bst.insert(i);
+      // exercise
+      size_t numLeft = num;
+      for (int i = 0; i < num; i++)
+         if (i % 4 != 0)
+         {
+            auto it = bst.find(i);
+            bst.erase(it);
+            numLeft--;
+         }
+      // verify
+      assertUnit(bst.size() == numLeft);
+      assertUnit(height(bst.root) <= 2.0 * std::log2(numLeft + 1.0));
+      assertUnit(blackHeight(bst.root) > 0);
+      int expected = 0;
+      bool inOrder = true;
+      for (auto it = bst.begin(); it != bst.end(); ++it, expected += 4)
+         inOrder = inOrder && (*it == expected);
+      assertUnit(inOrder);
+      assertUnit(expected == num);
+   }  // teardown
+
+   // erase a range from the middle of the standard fixture without
+   // comparing anything
+   void test_erase_rangeStandard()
+   {  // setup
+      //                 50 
+      //          +-------+-------+
+      //         30              70  
+      //     +----+----+     +----+----+
+      //    20        40    60        80  
+      custom::BST <Spy> bst;
+      setupStandardFixture(bst);
+      auto itFirst = bst.begin();
+      ++itFirst;
+      auto itLast = itFirst;
+      for (int i = 0; i < 4; i++)
+         ++itLast;
+      Spy::reset();
+      // exercise
+      auto itReturn = bst.erase(itFirst, itLast);
+      // verify
+      assertUnit(Spy::numLessthan() == 0);
+      assertUnit(Spy::numAlloc() == 0);
+      assertUnit(Spy::numDelete() == 4);
+      assertUnit(itReturn->get() == 70);
+      assertUnit(bst.size() == 3);
+      assertUnit(blackHeight(bst.root) > 0);
+      std::vector<Spy> values(bst.begin(), bst.end());
+      assertUnit(values.size() == 3);
+      assertUnit(values[0].get() == 20 && values[1].get() == 70 && values[2].get() == 80);
+      assertUnit(bst.pLeftmost->data.get() == 20);
+      assertUnit(bst.pRightmost->data.get() == 80);
+   }  // teardown
+
+   // erase ranges at the front, back, middle and within runs of
+   // duplicates, for every policy
+   void test_erase_rangeEveryPolicy()
+   {
+      assertUnit(eraseRangeOK<custom::balance::none>());
+      assertUnit(eraseRangeOK<custom::balance::redBlack>());
+      assertUnit(eraseRangeOK<custom::balance::avl>());
+      assertUnit(eraseRangeOK<custom::balance::treap>());
+      assertUnit(eraseRangeOK<custom::balance::sized<custom::balance::redBlack>>());
+      assertUnit(eraseRangeOK<custom::balance::threaded<custom::balance::avl>>());
+   }
+
+   // erase by key takes out every copy and says how many there were
+   void test_erase_keyDuplicates()
+   {  // setup
+      custom::BST <int> bst;
+      for (int i = 0; i < 20; i++)
+         bst.insert(i % 5);
+      // exercise
+      size_t numErased = bst.erase(3);
+      size_t numMissing = bst.erase(7);
+      // verify
+      assertUnit(numErased == 4);
+      assertUnit(numMissing == 0);
+      assertUnit(bst.size() == 16);
+      assertUnit(bst.find(3) == bst.end());
+      assertUnit(blackHeight(bst.root) > 0);
+   }  // teardown
+
+   /***************************************
+    * NODE HANDLES
+    *    BST::extract(it)
+    *    BST::extract(t)
+    *    BST::insert(node_type&&)
+    *    BST::merge(rhs)
+    ***************************************/
+
+   // take a node with two children out of the standard fixture
+   void test_extract_standard()
+   {  // setup
+      //                 50 
+      //          +-------+-------+
+      //         30              70  
+      //     +----+----+     +----+----+
+      //    20        40    60        80  
+      custom::BST <Spy> bst;
+      setupStandardFixture(bst);
+      Spy s30(30);
+      auto it = bst.find(s30);
+      Spy::reset();
+      // exercise
+      auto nh = bst.extract(it);
+      // verify
+      assertUnit(Spy::numAlloc() == 0);
+      assertUnit(Spy::numCopy() == 0);
+      assertUnit(Spy::numCopyMove() == 0);
+      assertUnit(Spy::numDelete() == 0);
+      assertUnit(!nh.empty());
+      assertUnit(nh.value().get() == 30);
+      assertUnit(nh.pNode->pLeft == nullptr && nh.pNode->pRight == nullptr && nh.pNode->pParent == nullptr);
+      assertUnit(bst.size() == 6);
+      assertUnit(bst.find(s30) == bst.end());
+      assertUnit(blackHeight(bst.root) > 0);
+      // exercise
+      auto nhMissing = bst.extract(s30);
+      // verify
+      assertUnit(nhMissing.empty());
+   }  // teardown
+
+   // move a node from one tree to another without touching the element
+   void test_insert_nodeHandle()
+   {  // setup
+      custom::BST <Spy> bstFrom;
+      custom::BST <Spy> bstTo;
+      for (int i = 0; i < 10; i++)
+      {
+         bstFrom.insert(Spy(i));
+         bstTo.insert(Spy(i * 2 + 1));
+      }
+      Spy s4(4);
+      Spy s5(5);
+      auto nh4 = bstFrom.extract(s4);
+      auto nh5 = bstFrom.extract(s5);
+      Spy::reset();
+      // exercise
+      auto result4 = bstTo.insert(std::move(nh4), true /*keepUnique*/);
+      auto result5 = bstTo.insert(std::move(nh5), true /*keepUnique*/);
+      // verify
+      assertUnit(Spy::numAlloc() == 0);
+      assertUnit(Spy::numCopy() == 0);
+      assertUnit(Spy::numCopyMove() == 0);
+      assertUnit(Spy::numAssign() == 0);
+      assertUnit(Spy::numAssignMove() == 0);
+      assertUnit(Spy::numDelete() == 0);
+      assertUnit(result4.inserted);
+      assertUnit(result4.position->get() == 4);
+      assertUnit(result4.node.empty());
+      assertUnit(nh4.empty());
+      assertUnit(!result5.inserted);
+      assertUnit(result5.position->get() == 5);
+      assertUnit(result5.node.value().get() == 5);
+      assertUnit(bstTo.size() == 11);
+      assertUnit(bstFrom.size() == 8);
+      assertUnit(blackHeight(bstTo.root) > 0);
+      assertUnit(std::is_sorted(bstTo.begin(), bstTo.end()));
+   }  // teardown
+
+   // merge two overlapping trees, leaving the duplicates behind
+   void test_merge_standard()
+   {  // setup
+      custom::BST <Spy, custom::balance::sized<custom::balance::avl>> bst;
+      custom::BST <Spy, custom::balance::sized<custom::balance::avl>> bstOther;
+      for (int i = 0; i < 100; i++)
+      {
+         bst.insert(Spy(i * 2));
+         bstOther.insert(Spy(i * 3));
+      }
+      Spy::reset();
+      // exercise
+      bst.merge(bstOther, true /*keepUnique*/);
+      // verify
+      assertUnit(Spy::numAlloc() == 0);
+      assertUnit(Spy::numCopy() == 0);
+      assertUnit(Spy::numCopyMove() == 0);
+      assertUnit(Spy::numDelete() == 0);
+      assertUnit(bst.size() == 166);
+      assertUnit(bstOther.size() == 34);
+      assertUnit(isBalanced(bst.root, custom::balance::sized<custom::balance::avl>()));
+      assertUnit(isBalanced(bstOther.root, custom::balance::sized<custom::balance::avl>()));
+      assertUnit(std::is_sorted(bst.begin(), bst.end()));
+      for (auto it = bstOther.begin(); it != bstOther.end(); ++it)
+         assertUnit(it->get() % 6 == 0);
+   }  // teardown
+
+   /***************************************
+    * ALLOCATOR
+    *    BST<T, Balance, Compare, Allocator>
+    ***************************************/
+
+   // every node comes from the allocator, rebound to the node, and
+   // goes back to it whether erased, extracted or cleared
+   void test_allocator_everyNode()
+   {  // setup
+      using Tree = custom::BST <int, custom::balance::redBlack, std::less<int>, SpyAllocator<int>>;
+      SpyLedger ledger;
+      {
+         Tree bst{ SpyAllocator<int>(&ledger) };
+         // exercise
+         for (int i = 0; i < 10; i++)
+            bst.insert(i);
+         bst.emplace(10);
+         size_t numBytes = ledger.numBytes;
+         bst.erase(3);
+         auto it = bst.begin();
+         bst.erase(it);
+         {
+            auto nh = bst.extract(5);
+            assertUnit(nh.get_allocator() == bst.get_allocator());
+         }
+         // verify
+         assertUnit(numBytes == 11 * sizeof(Tree::BNode));
+         assertUnit(ledger.numAllocate == 11);
+         assertUnit(ledger.numDeallocate == 3);
+         assertUnit(bst.size() == 8);
+      }
+      assertUnit(ledger.numDeallocate == 11);
+      assertUnit(ledger.numBytes == 0);
+   }  // teardown
+
+   // a copy uses the same allocator. Moving into a tree whose allocator
+   // differs and stays puts every element in a node of its own
+   void test_allocator_copyMove()
+   {  // setup
+      using Tree = custom::BST <int, custom::balance::avl, std::less<int>, SpyAllocator<int>>;
+      SpyLedger ledgerA;
+      SpyLedger ledgerB;
+      Tree bstA{ SpyAllocator<int>(&ledgerA) };
+      for (int i = 0; i < 5; i++)
+         bstA.insert(i);
+      Tree bstB{ SpyAllocator<int>(&ledgerB) };
+      // exercise
+      Tree bstCopy(bstA);
+      bstB = std::move(bstCopy);
+      // verify
+      assertUnit(bstCopy.get_allocator().pLedger == &ledgerA);
+      assertUnit(bstB.get_allocator().pLedger == &ledgerB);
+      assertUnit(bstCopy.empty());
+      assertUnit(ledgerA.numAllocate == 10);
+      assertUnit(ledgerA.numDeallocate == 5);
+      assertUnit(ledgerB.numAllocate == 5);
+      std::vector<int> values(bstB.begin(), bstB.end());
+      assertUnit(values == std::vector<int>({ 0, 1, 2, 3, 4 }));
+      assertUnit(isBalanced(bstB.root, custom::balance::avl()));
+   }  // teardown
+
+   // an allocator that propagates goes along with the nodes instead
+   void test_allocator_propagate()
+   {  // setup
+      using Tree = custom::BST <int, custom::balance::redBlack, std::less<int>, SpyAllocator<int, true>>;
+      SpyLedger ledgerA;
+      SpyLedger ledgerB;
+      Tree bstA{ SpyAllocator<int, true>(&ledgerA) };
+      for (int i = 0; i < 5; i++)
+         bstA.insert(i);
+      Tree bstB{ SpyAllocator<int, true>(&ledgerB) };
+      bstB.insert(99);
+      // exercise
+      bstB = std::move(bstA);
+      Tree bstC{ SpyAllocator<int, true>(&ledgerB) };
+      bstC.swap(bstB);
+      // verify
+      assertUnit(ledgerA.numAllocate == 5);
+      assertUnit(ledgerA.numDeallocate == 0);
+      assertUnit(ledgerB.numAllocate == 1);
+      assertUnit(ledgerB.numDeallocate == 1);
+      assertUnit(bstB.empty());
+      assertUnit(bstB.get_allocator().pLedger == &ledgerB);
+      assertUnit(bstC.size() == 5);
+      assertUnit(bstC.get_allocator().pLedger == &ledgerA);
+   }  // teardown
+
+   // the set algebra keeps only nodes the allocator of lhs can free
+   void test_allocator_unequalSetOps()
+   {  // setup
+      using Tree = custom::BST <int, custom::balance::redBlack, std::less<int>, SpyAllocator<int>>;
+      SpyLedger ledgerA;
+      SpyLedger ledgerB;
+      {
+         Tree bstA{ SpyAllocator<int>(&ledgerA) };
+         Tree bstB{ SpyAllocator<int>(&ledgerB) };
+         for (int i = 0; i < 10; i++)
+         {
+            bstA.insert(i);
+            bstB.insert(i + 5);
+         }
+         // exercise
+         Tree bstUnion = Tree::setUnion(bstA, bstB);
+         // verify
+         assertUnit(bstA.empty() && bstB.empty());
+         assertUnit(bstUnion.get_allocator() == SpyAllocator<int>(&ledgerA));
+         assertUnit(ledgerB.numDeallocate == 10);
+         std::vector<int> values(bstUnion.begin(), bstUnion.end());
+         assertUnit(values.size() == 15);
+         assertUnit(values.front() == 0 && values.back() == 14);
+         assertUnit(isBalanced(bstUnion.root, custom::balance::redBlack()));
+      }
+      assertUnit(ledgerA.numBytes == 0);
+      assertUnit(ledgerB.numBytes == 0);
+   }  // teardown
+
+   /***************************************
+    * POOL
+    *    BST<T, Balance, Compare, pool<T>>
+    ***************************************/
+
+   // nodes given back on erase are the ones handed out on insert
+   void test_pool_reuse()
+   {  // setup
+      custom::BST <int, custom::balance::redBlack, std::less<int>, custom::pool<int>> bst;
+      for (int i = 0; i < 1000; i++)
+         bst.insert(i);
+      size_t numSlabs = bst.get_allocator().numSlabs();
+      // exercise
+      for (int i = 0; i < 1000; i += 2)
+         bst.erase(i);
+      for (int i = 1000; i < 1500; i++)
+         bst.insert(i);
+      // verify
+      assertUnit(numSlabs >= 1);
+      assertUnit(bst.get_allocator().numSlabs() == numSlabs);
+      assertUnit(bst.size() == 1000);
+      assertUnit(isBalanced(bst.root, custom::balance::redBlack()));
+   }  // teardown
+
+   // clear hands every slab back at once, and the tree can be used again
+   void test_pool_clear()
+   {  // setup
+      custom::BST <int, custom::balance::redBlack, std::less<int>, custom::pool<int>> bst;
+      for (int i = 0; i < 10000; i++)
+         bst.insert(i);
+      assertUnit(bst.get_allocator().numSlabs() > 1);
+      // exercise
+      bst.clear();
+      // verify
+      assertUnit(bst.empty());
+      assertUnit(bst.begin() == bst.end());
+      assertUnit(bst.get_allocator().numSlabs() == 0);
+      bst.insert(7);
+      assertUnit(bst.size() == 1);
+      assertUnit(*bst.begin() == 7);
+   }  // teardown
+
+   // the pieces of a split and an extracted node share the pool of their
+   // tree, and outlive it
+   void test_pool_shared()
+   {  // setup
+      using Tree = custom::BST <int, custom::balance::redBlack, std::less<int>, custom::pool<int>>;
+      std::optional<Tree::node_type> nh;
+      Tree bstHigh;
+      {
+         Tree bst;
+         for (int i = 0; i < 100; i++)
+            bst.insert(i);
+         // exercise
+         auto pieces = bst.split(50);
+         nh = pieces.first.extract(10);
+         assertUnit(pieces.first.get_allocator() == pieces.second.get_allocator());
+         assertUnit(nh->get_allocator() == pieces.first.get_allocator());
+         pieces.first.clear();
+         bstHigh = std::move(pieces.second);
+      }
+      // verify
+      assertUnit(nh->value() == 10);
+      assertUnit(bstHigh.size() == 50);
+      assertUnit(*bstHigh.begin() == 50);
+      assertUnit(bstHigh.get_allocator().numSlabs() == 1);
+      bstHigh.clear();
+      assertUnit(bstHigh.get_allocator().numSlabs() == 1);
+      nh.reset();
+   }  // teardown
+
+   /***************************************
+    * BALANCING POLICIES
+    *    BST<T, balance::none>
+    *    BST<T, balance::avl>
+    *    BST<T, balance::treap>
+    ***************************************/
+
+   // without balancing, sorted keys make a vine down the right side
+   void test_balanceNone_sortedShape()
+   {  // setup
+      custom::BST <int, custom::balance::none> bst;
+      // exercise
+      for (int i = 0; i < 100; i++)
+         bst.insert(i);
+      // verify
+      assertUnit(bst.size() == 100);
+      assertUnit(height(bst.root) == 100);
+      assertUnit(bst.root != nullptr);
+      if (bst.root)
+      {
+         assertUnit(bst.root->data == 0);
+         assertUnit(bst.root->pLeft == nullptr);
+      }
+   }  // teardown
+
+   // a million sorted keys stays within the AVL height bound
+   void test_balanceAVL_sortedHeight()
+   {  // setup
+      custom::BST <int, custom::balance::avl> bst;
+      const int num = 1000000;
+      // exercise
+      for (int i = 0; i < num; i++)
+         bst.insert(i);
+      // verify
+      assertUnit(bst.size() == num);
+      assertUnit(height(bst.root) <= 1.44 * std::log2(num + 2.0));
+      assertUnit(avlHeight(bst.root) == height(bst.root));
+      assertUnit(*bst.begin() == 0);
+   }  // teardown
+
+   // erasing most of a sorted AVL tree keeps it balanced
+   void test_balanceAVL_eraseKeepsBalance()
+   {  // setup
+      custom::BST <int, custom::balance::avl> bst;
+      const int num = 100000;
+      for (int i = 0; i < num; i++)
+         bst.insert(i);
+      // exercise
+      size_t numLeft = num;
+      for (int i = 0; i < num; i++)
+         if (i % 4 != 0)
+         {
+            auto it = bst.find(i);
+            bst.erase(it);
+            numLeft--;
+         }
+      // verify
+      assertUnit(bst.size() == numLeft);
+      assertUnit(avlHeight(bst.root) == height(bst.root));
+      assertUnit(height(bst.root) <= 1.44 * std::log2(numLeft + 2.0));
+      int expected = 0;
+      bool inOrder = true;
+      for (auto it = bst.begin(); it != bst.end(); ++it, expected += 4)
+         inOrder = inOrder && (*it == expected);
+      assertUnit(inOrder);
+      assertUnit(expected == num);
+   }  // teardown
+
+   // sorted keys in a treap give a logarithmic expected height
+   void test_balanceTreap_sortedHeight()
+   {  // setup
+      custom::BST <int, custom::balance::treap> bst;
+      const int num = 100000;
+      // exercise
+      for (int i = 0; i < num; i++)
+         bst.insert(i);
+      // verify
+      assertUnit(bst.size() == num);
+      assertUnit(isHeap(bst.root));
+      assertUnit(height(bst.root) <= 4.0 * std::log2(num + 1.0));
+      assertUnit(*bst.begin() == 0);
+   }  // teardown
+
+   // erasing most of a treap keeps the heap order on the priorities
+   void test_balanceTreap_eraseKeepsHeap()
+   {  // setup
+      custom::BST <int, custom::balance::treap> bst;
+      const int num = 100000;
+      for (int i = 0; i < num; i++)
+         bst.insert(i);
+      // exercise
+      size_t numLeft = num;
+      for (int i = 0; i < num; i++)
+         if (i % 4 != 0)
+         {
+            auto it = bst.find(i);
+            bst.erase(it);
+            numLeft--;
+         }
+      // verify
+      assertUnit(bst.size() == numLeft);
+      assertUnit(isHeap(bst.root));
+      int expected = 0;
+      bool inOrder = true;
+      for (auto it = bst.begin(); it != bst.end(); ++it, expected += 4)
+         inOrder = inOrder && (*it == expected);
+      assertUnit(inOrder);
+      assertUnit(expected == num);
+   }  // teardown
+
+   /***************************************
+    * ORDER STATISTICS
+    *    BST::rank(t)
+    *    BST::select(k)
+    *    BST::count(lo, hi)
+    *    BST::iterator::operator+=(n)
+    ***************************************/
+
+   // the subtree counts survive inserts, erases, and the rotations of
+   // every policy they can wrap
+   void test_sized_keepsCounts()
+   {  // setup
+      custom::BST <int, custom::balance::sized<custom::balance::none>>     bstNone;
+      custom::BST <int, custom::balance::sized<custom::balance::redBlack>> bstRedBlack;
+      custom::BST <int, custom::balance::sized<custom::balance::avl>>      bstAVL;
+      custom::BST <int, custom::balance::sized<custom::balance::treap>>    bstTreap;
+      std::vector<int> keys(2000);
+      for (int i = 0; i < (int)keys.size(); i++)
+         keys[i] = (i * 7919) % (int)keys.size();
+      // exercise
+      for (int key : keys)
+      {
+         bstNone.insert(key);
+         bstRedBlack.insert(key);
+         bstAVL.insert(key);
+         bstTreap.insert(key);
+      }
+      for (int i = 0; i < (int)keys.size(); i += 2)
+      {
+         auto itNone = bstNone.find(keys[i]);
+         bstNone.erase(itNone);
+         auto itRedBlack = bstRedBlack.find(keys[i]);
+         bstRedBlack.erase(itRedBlack);
+         auto itAVL = bstAVL.find(keys[i]);
+         bstAVL.erase(itAVL);
+         auto itTreap = bstTreap.find(keys[i]);
+         bstTreap.erase(itTreap);
+      }
+      // verify
+      assertUnit(subtreeSize(bstNone.root) == 1000);
+      assertUnit(subtreeSize(bstRedBlack.root) == 1000);
+      assertUnit(subtreeSize(bstAVL.root) == 1000);
+      assertUnit(subtreeSize(bstTreap.root) == 1000);
+      assertUnit(blackHeight(bstRedBlack.root) > 0);
+      assertUnit(avlHeight(bstAVL.root) > 0);
+      assertUnit(isHeap(bstTreap.root));
+      // exercise
+      bstRedBlack = { 5, 1, 4, 2, 3 };
+      // verify
+      assertUnit(subtreeSize(bstRedBlack.root) == 5);
+   }  // teardown
+
+   // rank counts the elements less than the key, present or not
+   void test_rank_standard()
+   {  // setup
+      custom::BST <int, custom::balance::sized<>> bst = { 20, 30, 40, 50, 60, 70, 80 };
+      // exercise and verify
+      assertUnit(bst.rank(10) == 0);
+      assertUnit(bst.rank(20) == 0);
+      assertUnit(bst.rank(50) == 3);
+      assertUnit(bst.rank(55) == 4);
+      assertUnit(bst.rank(80) == 6);
+      assertUnit(bst.rank(99) == 7);
+   }  // teardown
+
+   // select finds the k-th element from the smallest
+   void test_select_standard()
+   {  // setup
+      custom::BST <int, custom::balance::sized<>> bst;
+      for (int i = 0; i < 1000; i++)
+         bst.insert(999 - i);
+      // exercise and verify
+      bool allFound = true;
+      for (size_t k = 0; k < 1000; k++)
+         allFound = allFound && (*bst.select(k) == (int)k);
+      assertUnit(allFound);
+      assertUnit(bst.select(1000) == bst.end());
+   }  // teardown
+
+   // count the elements in a half-open range
+   void test_count_standard()
+   {  // setup
+      custom::BST <int, custom::balance::sized<>> bst = { 20, 30, 40, 50, 60, 70, 80 };
+      // exercise and verify
+      assertUnit(bst.count(30, 70) == 4);
+      assertUnit(bst.count(25, 75) == 5);
+      assertUnit(bst.count(0, 100) == 7);
+      assertUnit(bst.count(70, 30) == 0);
+      assertUnit(bst.count(50, 50) == 0);
+   }  // teardown
+
+   // jump forward and back several elements at a time
+   void test_iterator_jump()
+   {  // setup
+      custom::BST <int, custom::balance::sized<>> bst;
+      for (int i = 0; i < 100; i++)
+         bst.insert(i);
+      auto it = bst.begin();
+      // exercise
+      it += 42;
+      // verify
+      assertUnit(*it == 42);
+      // exercise
+      it -= 40;
+      // verify
+      assertUnit(*it == 2);
+      // exercise
+      it += 98;
+      // verify
+      assertUnit(it == bst.end());
+      // exercise
+      it -= 1;
+      // verify
+      assertUnit(*it == 99);
+   }  // teardown
+
+   /***************************************
+    * THREADED NODES
+    *    balance::threaded<>
+    ***************************************/
+
+   // the threads follow inserts, erases and rotations
+   void test_threaded_insertErase()
+   {  // setup
+      custom::BST <int, custom::balance::threaded<custom::balance::redBlack>> bstRedBlack;
+      custom::BST <int, custom::balance::threaded<custom::balance::treap>>    bstTreap;
+      std::vector<int> keys(2000);
+      for (int i = 0; i < (int)keys.size(); i++)
+         keys[i] = (i * 7919) % (int)keys.size();
+      // exercise
+      for (int key : keys)
+      {
+         bstRedBlack.insert(key);
+         bstTreap.insert(bstTreap.end(), key);
+      }
+      // verify
+      assertUnit(threadsOK(bstRedBlack));
+      assertUnit(threadsOK(bstTreap));
+      // exercise
+      for (int i = 0; i < (int)keys.size(); i += 2)
+      {
+         auto itRedBlack = bstRedBlack.find(keys[i]);
+         bstRedBlack.erase(itRedBlack);
+         auto itTreap = bstTreap.find(keys[i]);
+         bstTreap.erase(itTreap);
+      }
+      // verify
+      assertUnit(bstRedBlack.size() == 1000);
+      assertUnit(threadsOK(bstRedBlack));
+      assertUnit(threadsOK(bstTreap));
+      assertUnit(blackHeight(bstRedBlack.root) > 0);
+      assertUnit(isHeap(bstTreap.root));
+   }  // teardown
+
+   // a built tree and a copy of it are threaded too
+   void test_threaded_buildCopy()
+   {  // setup
+      custom::BST <int, custom::balance::threaded<>> bst;
+      // exercise
+      bst = { 5, 1, 4, 2, 3, 9, 0 };
+      custom::BST <int, custom::balance::threaded<>> bstCopy(bst);
+      // verify
+      assertUnit(threadsOK(bst));
+      assertUnit(threadsOK(bstCopy));
+      assertUnit(bstCopy.root != bst.root);
+      assertUnit(bstCopy.pLeftmost->pNext->data == 1);
+      assertUnit(bstCopy.pRightmost->pPrev->data == 5);
+      // exercise
+      bst = { 7, 8 };
+      bstCopy = bst;
+      // verify
+      assertUnit(bstCopy.size() == 2);
+      assertUnit(threadsOK(bstCopy));
+   }  // teardown
+
+   // the iterators walk the threads both ways
+   void test_threaded_iterate()
+   {  // setup
+      custom::BST <int, custom::balance::threaded<>> bst = { 50, 30, 70, 20, 40, 60, 80 };
+      // exercise
+      std::vector<int> forward(bst.begin(), bst.end());
+      std::vector<int> backward(bst.rbegin(), bst.rend());
+      // verify
+      assertUnit(forward == std::vector<int>({ 20, 30, 40, 50, 60, 70, 80 }));
+      assertUnit(backward == std::vector<int>({ 80, 70, 60, 50, 40, 30, 20 }));
+      assertUnit(*(--bst.end()) == 80);
+      assertUnit(--bst.begin() == bst.end());
+   }  // teardown
+
+   /***************************************
+    * SPLIT and JOIN
+    *    BST::split(t)
+    *    BST::join(lhs, rhs)
+    ***************************************/
+
+   // split the standard fixture between 40 and 50 without touching the data
+   void test_split_standard()
+   {  // setup
+      //                 50 
+      //          +-------+-------+
+      //         30              70  
+      //     +----+----+     +----+----+
+      //    20        40    60        80  
+      custom::BST <Spy> bst;
+      setupStandardFixture(bst);
+      Spy s45(45);
+      Spy::reset();
+      // exercise
+      auto pieces = bst.split(s45);
+      // verify
+      assertUnit(Spy::numAlloc() == 0);
+      assertUnit(Spy::numCopy() == 0);
+      assertUnit(Spy::numDelete() == 0);
+      assertUnit(Spy::numLessthan() == 3);
+      assertEmptyFixture(bst);
+      assertUnit(pieces.first.size() == 3);
+      assertUnit(pieces.second.size() == 4);
+      assertUnit(blackHeight(pieces.first.root) > 0);
+      assertUnit(blackHeight(pieces.second.root) > 0);
+      assertUnit(pieces.first.begin()->get() == 20);
+      assertUnit((--pieces.first.end())->get() == 40);
+      assertUnit(pieces.second.begin()->get() == 50);
+      assertUnit((--pieces.second.end())->get() == 80);
+   }  // teardown
+
+   // split and join back together at many keys, for every policy
+   void test_split_everyPolicy()
+   {
+      assertUnit(splitJoinOK<custom::balance::none>());
+      assertUnit(splitJoinOK<custom::balance::redBlack>());
+      assertUnit(splitJoinOK<custom::balance::avl>());
+      assertUnit(splitJoinOK<custom::balance::treap>());
+      assertUnit(splitJoinOK<custom::balance::sized<custom::balance::redBlack>>());
+      assertUnit(splitJoinOK<custom::balance::sized<custom::balance::avl>>());
+      assertUnit(splitJoinOK<custom::balance::sized<custom::balance::treap>>());
+      assertUnit(splitJoinOK<custom::balance::threaded<custom::balance::redBlack>>());
+      assertUnit(splitJoinOK<custom::balance::threaded<custom::balance::sized<custom::balance::avl>>>());
+   }
+
+   // join a small tree onto a much larger one
+   void test_join_standard()
+   {  // setup
+      custom::BST <Spy> bstLeft;
+      custom::BST <Spy> bstRight;
+      for (int i = 0; i < 1000; i++)
+         bstLeft.insert(Spy(i));
+      bstRight.insert(Spy(5000));
+      bstRight.insert(Spy(6000));
+      Spy::reset();
+      // exercise
+      custom::BST <Spy> bst = custom::BST <Spy>::join(bstLeft, bstRight);
+      // verify
+      assertUnit(Spy::numAlloc() == 0);
+      assertUnit(Spy::numCopy() == 0);
+      assertEmptyFixture(bstLeft);
+      assertEmptyFixture(bstRight);
+      assertUnit(bst.size() == 1002);
+      assertUnit(blackHeight(bst.root) > 0);
+      assertUnit(std::is_sorted(bst.begin(), bst.end()));
+      assertUnit(bst.begin()->get() == 0);
+      assertUnit((--bst.end())->get() == 6000);
+   }  // teardown
+
+   // joining with an empty tree just moves the other one
+   void test_join_empty()
+   {  // setup
+      custom::BST <int> bstLeft;
+      custom::BST <int> bstRight = { 1, 2, 3 };
+      // exercise
+      custom::BST <int> bst = custom::BST <int>::join(bstLeft, bstRight);
+      // verify
+      assertUnit(bst.size() == 3);
+      assertUnit(bstRight.empty());
+      assertUnit(bstRight.root == nullptr);
+      assertUnit(*bst.begin() == 1);
+      // exercise
+      bst = custom::BST <int>::join(bst, bstLeft);
+      // verify
+      assertUnit(bst.size() == 3);
+   }  // teardown
+
+   /***************************************
+    * SET ALGEBRA
+    *    BST::setUnion(lhs, rhs)
+    *    BST::setIntersection(lhs, rhs)
+    *    BST::setDifference(lhs, rhs)
+    ***************************************/
+
+   // union of the standard fixture with some new and some repeated values
+   void test_setUnion_standard()
+   {  // setup
+      //                 50 
+      //          +-------+-------+
+      //         30              70  
+      //     +----+----+     +----+----+
+      //    20        40    60        80  
+      custom::BST <Spy> bstLeft;
+      setupStandardFixture(bstLeft);
+      custom::BST <Spy> bstRight;
+      bstRight.insert(Spy(10));
+      bstRight.insert(Spy(40));
+      bstRight.insert(Spy(45));
+      bstRight.insert(Spy(80));
+      Spy::reset();
+      // exercise
+      custom::BST <Spy> bst = custom::BST <Spy>::setUnion(bstLeft, bstRight);
+      // verify
+      assertUnit(Spy::numAlloc() == 0);
+      assertUnit(Spy::numCopy() == 0);
+      assertUnit(Spy::numDelete() == 2);
+      assertEmptyFixture(bstLeft);
+      assertEmptyFixture(bstRight);
+      assertUnit(bst.size() == 9);
+      assertUnit(blackHeight(bst.root) > 0);
+      assertUnit(std::is_sorted(bst.begin(), bst.end()));
+      assertUnit(bst.begin()->get() == 10);
+      assertUnit((--bst.end())->get() == 80);
+   }  // teardown
+
+   // intersection keeps only what is in both
+   void test_setIntersection_standard()
+   {  // setup
+      custom::BST <Spy> bstLeft;
+      setupStandardFixture(bstLeft);
+      custom::BST <Spy> bstRight;
+      bstRight.insert(Spy(10));
+      bstRight.insert(Spy(40));
+      bstRight.insert(Spy(45));
+      bstRight.insert(Spy(80));
+      Spy::reset();
+      // exercise
+      custom::BST <Spy> bst = custom::BST <Spy>::setIntersection(bstLeft, bstRight);
+      // verify
+      assertUnit(Spy::numAlloc() == 0);
+      assertUnit(Spy::numCopy() == 0);
+      assertUnit(Spy::numDelete() == 9);
+      assertEmptyFixture(bstLeft);
+      assertEmptyFixture(bstRight);
+      assertUnit(bst.size() == 2);
+      assertUnit(blackHeight(bst.root) > 0);
+      assertUnit(bst.begin()->get() == 40);
+      assertUnit((--bst.end())->get() == 80);
+   }  // teardown
+
+   // difference keeps only what is in lhs alone
+   void test_setDifference_standard()
+   {  // setup
+      custom::BST <Spy> bstLeft;
+      setupStandardFixture(bstLeft);
+      custom::BST <Spy> bstRight;
+      bstRight.insert(Spy(10));
+      bstRight.insert(Spy(40));
+      bstRight.insert(Spy(45));
+      bstRight.insert(Spy(80));
+      Spy::reset();
+      // exercise
+      custom::BST <Spy> bst = custom::BST <Spy>::setDifference(bstLeft, bstRight);
+      // verify
+      assertUnit(Spy::numAlloc() == 0);
+      assertUnit(Spy::numCopy() == 0);
+      assertUnit(Spy::numDelete() == 6);
+      assertEmptyFixture(bstLeft);
+      assertEmptyFixture(bstRight);
+      assertUnit(bst.size() == 5);
+      assertUnit(blackHeight(bst.root) > 0);
+      assertUnit(bst.begin()->get() == 20);
+      assertUnit((--bst.end())->get() == 70);
+   }  // teardown
+
+   // all three operations on overlapping trees, for every policy
+   void test_setOps_everyPolicy()
+   {
+      assertUnit(setOpsOK<custom::balance::none>(2000));
+      assertUnit(setOpsOK<custom::balance::redBlack>(2000));
+      assertUnit(setOpsOK<custom::balance::avl>(2000));
+      assertUnit(setOpsOK<custom::balance::treap>(2000));
+      assertUnit(setOpsOK<custom::balance::sized<custom::balance::redBlack>>(2000));
+      assertUnit(setOpsOK<custom::balance::sized<custom::balance::avl>>(2000));
+      assertUnit(setOpsOK<custom::balance::sized<custom::balance::treap>>(2000));
+      assertUnit(setOpsOK<custom::balance::threaded<custom::balance::redBlack>>(2000));
+      assertUnit(setOpsOK<custom::balance::threaded<custom::balance::sized<custom::balance::avl>>>(2000));
+   }
+
+   // trees big enough that the halves are worked on by separate threads
+   void test_setOps_parallel()
+   {
+      assertUnit(setOpsOK<custom::balance::redBlack>(100000));
+      assertUnit(setOpsOK<custom::balance::sized<custom::balance::avl>>(100000));
+   }
+
+   /***************************************
+    * DEGENERATE SHAPES
+    * Copy and delete must not recurse per level
+    ***************************************/
+
+   // clear a tree that is a single million-node path
+   void test_clear_deepVine()
+   {  // setup
+      custom::BST <int, custom::balance::none> bst;
+      buildVine(bst, VINE_RIGHT, 1000000);
+      // exercise
+      bst.clear();
+      // verify
+      assertUnit(bst.root == nullptr);
+      assertUnit(bst.pLeftmost == nullptr);
+      assertUnit(bst.pRightmost == nullptr);
+      assertUnit(bst.numElements == 0);
+   }  // teardown
+
+   // copy a million nodes hanging off each other to the right
+   void test_constructCopy_rightVine()
+   {  // setup
+      custom::BST <int, custom::balance::none> bstSrc;
+      buildVine(bstSrc, VINE_RIGHT, 1000000);
+      // exercise
+      custom::BST <int, custom::balance::none> bstDest(bstSrc);
+      // verify
+      assertUnit(bstDest.size() == 1000000);
+      assertUnit(bstDest.root != bstSrc.root);
+      assertUnit(sameTree(bstSrc.root, bstDest.root));
+   }  // teardown
+
+   // copy a million nodes hanging off each other to the left
+   void test_constructCopy_leftVine()
+   {  // setup
+      custom::BST <int, custom::balance::none> bstSrc;
+      buildVine(bstSrc, VINE_LEFT, 1000000);
+      // exercise
+      custom::BST <int, custom::balance::none> bstDest(bstSrc);
+      // verify
+      assertUnit(bstDest.size() == 1000000);
+      assertUnit(bstDest.root != bstSrc.root);
+      assertUnit(sameTree(bstSrc.root, bstDest.root));
+   }  // teardown
+
+   // assign a zig-zag path onto a vine, reusing the vine's nodes
+   void test_assign_zigZagOntoVine()
+   {  // setup
+      custom::BST <int, custom::balance::none> bstSrc;
+      custom::BST <int, custom::balance::none> bstDest;
+      buildVine(bstSrc, VINE_ZIGZAG, 1000000);
+      buildVine(bstDest, VINE_RIGHT, 500000);
+      auto pRootDest = bstDest.root;
+      // exercise
+      bstDest = bstSrc;
+      // verify
+      assertUnit(bstDest.size() == 1000000);
+      assertUnit(bstDest.root == pRootDest);
+      assertUnit(sameTree(bstSrc.root, bstDest.root));
+      int expected = 0;
+      bool inOrder = true;
+      for (auto it = bstDest.begin(); it != bstDest.end(); ++it, expected++)
+         inOrder = inOrder && (*it == expected);
+      assertUnit(inOrder);
+      assertUnit(expected == 1000000);
+   }  // teardown
+
+   /**************************************************************
+    * HEIGHT
+    * Number of levels in a subtree
+    *************************************************************/
+   template <class T>
+   int height(const T* p)
+   {
+      if (p == nullptr)
+         return 0;
+      return 1 + std::max(height(p->pLeft), height(p->pRight));
+   }
+
+   /**************************************************************
+    * BLACK HEIGHT
+    * Number of black nodes on every path to a leaf, or -1 when
+    * the subtree breaks a red-black rule
+    *************************************************************/
+   template <class T>
+   int blackHeight(const T* p)
+   {
+      if (p == nullptr)
+         return 1;
+      if (p->pParent == nullptr && p->isRed)
+         return -1;
+      if (p->isRed && ((p->pLeft && p->pLeft->isRed) || (p->pRight && p->pRight->isRed)))
+         return -1;
+      if ((p->pLeft && p->pLeft->pParent != p) || (p->pRight && p->pRight->pParent != p))
+         return -1;
+      int left = blackHeight(p->pLeft);
+      int right = blackHeight(p->pRight);
+      if (left < 0 || left != right)
+         return -1;
+      return left + (p->isRed ? 0 : 1);
+   }
+
+   /**************************************************************
+    * AVL HEIGHT
+    * Height of an AVL subtree, or -1 when a stored height is wrong
+    * or two sibling subtrees differ by more than one
+    *************************************************************/
+   template <class T>
+   int avlHeight(const T* p)
+   {
+      if (p == nullptr)
+         return 0;
+      int left = avlHeight(p->pLeft);
+      int right = avlHeight(p->pRight);
+      if (left < 0 || right < 0 || left - right > 1 || right - left > 1)
+         return -1;
+      if (p->height != 1 + std::max(left, right))
+         return -1;
+      return p->height;
+   }
+
+   /**************************************************************
+    * IS BALANCED
+    * Does a subtree keep the rules of its balancing policy?
+    *************************************************************/
+   template <class T>
+   bool isBalanced(const T* p, custom::balance::none)     { return true; }
+   template <class T>
+   bool isBalanced(const T* p, custom::balance::redBlack) { return blackHeight(p) > 0; }
+   template <class T>
+   bool isBalanced(const T* p, custom::balance::avl)      { return avlHeight(p) >= 0; }
+   template <class T>
+   bool isBalanced(const T* p, custom::balance::treap)    { return isHeap(p); }
+   template <class T, class Base>
+   bool isBalanced(const T* p, custom::balance::sized<Base>)
+   {
+      return subtreeSize(p) >= 0 && isBalanced(p, Base());
+   }
+   template <class T, class Base>
+   bool isBalanced(const T* p, custom::balance::threaded<Base>)
+   {
+      return isBalanced(p, Base());
+   }
+
+   /**************************************************************
+    * THREADS OK
+    * Does every node point to its neighbors by the shape of the tree?
+    * Always true when the policy does not thread the nodes
+    *************************************************************/
+   template <class T, class Balance>
+   bool threadsOK(const custom::BST <T, Balance>& bst)
+   {
+      if constexpr (custom::balance::isThreaded<Balance>::value)
+      {
+         using BNode = typename custom::BST <T, Balance>::BNode;
+         std::vector<const BNode*> nodes;
+         std::vector<const BNode*> stack;
+         for (const BNode* p = bst.root; p || !stack.empty(); p = p->pRight)
+         {
+            for (; p; p = p->pLeft)
+               stack.push_back(p);
+            p = stack.back();
+            stack.pop_back();
+            nodes.push_back(p);
+         }
+
+         for (size_t i = 0; i < nodes.size(); i++)
+         {
+            if (nodes[i]->pPrev != (i == 0 ? nullptr : nodes[i - 1]) ||
+                nodes[i]->pNext != (i + 1 == nodes.size() ? nullptr : nodes[i + 1]))
+               return false;
+         }
+      }
+      return true;
+   }
+
+   /**************************************************************
+    * SPLIT JOIN OK
+    * Split a shuffled tree at several keys and join the pieces back.
+    * Is every piece in order, the right size, and balanced?
+    *************************************************************/
+   template <class Balance>
+   bool splitJoinOK()
+   {
+      const int num = 2000;
+      bool isOK = true;
+      for (int key : { -1, 0, 1, 777, 1000, 1999, 2000 })
+      {
+         custom::BST <int, Balance> bst;
+         for (int i = 0; i < num; i++)
+            bst.insert((i * 7919) % num);
+
+         auto pieces = bst.split(key);
+         int numLess = std::max(0, std::min(key, num));
+         isOK = isOK && bst.empty() && bst.root == nullptr;
+         isOK = isOK && (int)pieces.first.size() == numLess;
+         isOK = isOK && (int)pieces.second.size() == num - numLess;
+         isOK = isOK && std::vector<int>(pieces.first.begin(), pieces.first.end()).size() == (size_t)numLess;
+         isOK = isOK && (pieces.first.empty() || *(--pieces.first.end()) == numLess - 1);
+         isOK = isOK && (pieces.second.empty() || *pieces.second.begin() == numLess);
+         isOK = isOK && isBalanced(pieces.first.root, Balance());
+         isOK = isOK && isBalanced(pieces.second.root, Balance());
+         isOK = isOK && threadsOK(pieces.first) && threadsOK(pieces.second);
+         isOK = isOK && (!pieces.first.root || pieces.first.root->pParent == nullptr);
+         isOK = isOK && (!pieces.second.root || pieces.second.root->pParent == nullptr);
+
+         bst = custom::BST <int, Balance>::join(pieces.first, pieces.second);
+         isOK = isOK && (int)bst.size() == num;
+         isOK = isOK && isBalanced(bst.root, Balance());
+         isOK = isOK && threadsOK(bst);
+         int expected = 0;
+         for (auto it = bst.begin(); it != bst.end(); ++it)
+            isOK = isOK && (*it == expected++);
+         isOK = isOK && expected == num;
+      }
+      return isOK;
+   }
+
+   /**************************************************************
+    * ERASE RANGE OK
+    * Erase several ranges out of a tree with duplicates. Is what is
+    * left what std::vector::erase leaves, and is it balanced?
+    *************************************************************/
+   template <class Balance>
+   bool eraseRangeOK()
+   {
+      const int num = 1000;
+      bool isOK = true;
+      for (auto window : { std::make_pair(0, 1), std::make_pair(0, 999), std::make_pair(1, 1000),
+                           std::make_pair(500, 501), std::make_pair(123, 877), std::make_pair(301, 302),
+                           std::make_pair(0, 1000), std::make_pair(400, 400) })
+      {
+         custom::BST <int, Balance> bst;
+         std::vector<int> values;
+         for (int i = 0; i < num; i++)
+         {
+            bst.insert((i * 7919) % num / 4);
+            values.push_back((i * 7919) % num / 4);
+         }
+         std::sort(values.begin(), values.end());
+
+         auto itFirst = bst.begin();
+         for (int i = 0; i < window.first; i++)
+            ++itFirst;
+         auto itLast = itFirst;
+         for (int i = window.first; i < window.second; i++)
+            ++itLast;
+         auto itReturn = bst.erase(itFirst, itLast);
+         values.erase(values.begin() + window.first, values.begin() + window.second);
+
+         isOK = isOK && itReturn == itLast;
+         isOK = isOK && bst.size() == values.size();
+         isOK = isOK && std::vector<int>(bst.begin(), bst.end()) == values;
+         isOK = isOK && std::vector<int>(bst.rbegin(), bst.rend()) == std::vector<int>(values.rbegin(), values.rend());
+         isOK = isOK && isBalanced(bst.root, Balance());
+         isOK = isOK && threadsOK(bst);
+         isOK = isOK && (!bst.root || bst.root->pParent == nullptr);
+      }
+      return isOK;
+   }
+
+   /**************************************************************
+    * SET OPS OK
+    * Union, intersect and subtract the multiples of 2 and of 3 below
+    * num. Does each agree with std::set_*, and is it balanced?
+    *************************************************************/
+   template <class Balance>
+   bool setOpsOK(int num)
+   {
+      std::vector<int> twos;
+      std::vector<int> threes;
+      for (int i = 0; i < num; i += 2)
+         twos.push_back(i);
+      for (int i = 0; i < num; i += 3)
+         threes.push_back(i);
+
+      bool isOK = true;
+      for (int op = 0; op < 3; op++)
+      {
+         custom::BST <int, Balance> bstLeft;
+         custom::BST <int, Balance> bstRight;
+         for (int i = 0; i < (int)twos.size(); i++)
+            bstLeft.insert(twos[(i * 7919) % twos.size()]);
+         for (int i = 0; i < (int)threes.size(); i++)
+            bstRight.insert(threes[(i * 7919) % threes.size()]);
+
+         std::vector<int> expected;
+         custom::BST <int, Balance> bst;
+         if (op == 0)
+         {
+            std::set_union(twos.begin(), twos.end(), threes.begin(), threes.end(),
+                           std::back_inserter(expected));
+            bst = custom::BST <int, Balance>::setUnion(bstLeft, bstRight);
+         }
+         else if (op == 1)
+         {
+            std::set_intersection(twos.begin(), twos.end(), threes.begin(), threes.end(),
+                                  std::back_inserter(expected));
+            bst = custom::BST <int, Balance>::setIntersection(bstLeft, bstRight);
+         }
+         else
+         {
+            std::set_difference(twos.begin(), twos.end(), threes.begin(), threes.end(),
+                                std::back_inserter(expected));
+            bst = custom::BST <int, Balance>::setDifference(bstLeft, bstRight);
+         }
+
+         isOK = isOK && bstLeft.empty() && bstLeft.root == nullptr;
+         isOK = isOK && bstRight.empty() && bstRight.root == nullptr;
+         isOK = isOK && bst.size() == expected.size();
+         isOK = isOK && std::vector<int>(bst.begin(), bst.end()) == expected;
+         isOK = isOK && isBalanced(bst.root, Balance());
+         isOK = isOK && threadsOK(bst);
+         isOK = isOK && (!bst.root || bst.root->pParent == nullptr);
+      }
+      return isOK;
+   }
+
+   /**************************************************************
+    * SUBTREE SIZE
+    * Number of nodes under p, or -1 when a stored count is wrong
+    *************************************************************/
+   template <class T>
+   int subtreeSize(const T* p)
+   {
+      if (p == nullptr)
+         return 0;
+      int left = subtreeSize(p->pLeft);
+      int right = subtreeSize(p->pRight);
+      if (left < 0 || right < 0 || (int)p->size != 1 + left + right)
+         return -1;
+      return (int)p->size;
+   }
+
+   /**************************************************************
+    * IS HEAP
+    * Is no treap priority larger than that of its parent?
+    *************************************************************/
+   template <class T>
+   bool isHeap(const T* p)
+   {
+      if (p == nullptr)
+         return true;
+      if ((p->pLeft && p->pLeft->priority > p->priority) ||
+          (p->pRight && p->pRight->priority > p->priority))
+         return false;
+      return isHeap(p->pLeft) && isHeap(p->pRight);
+   }
+
+   /**************************************************************
+    * BUILD VINE
+    * A tree of 0..num-1 that is a single path:
+    *    VINE_RIGHT  : 0 - 1 - 2 - ... every node a right child
+    *    VINE_LEFT   : num-1 - num-2 - ... every node a left child
+    *    VINE_ZIGZAG : 0 - (num-1) - 1 - (num-2) - ... alternating
+    *************************************************************/
+   enum VineShape { VINE_RIGHT, VINE_LEFT, VINE_ZIGZAG };
+   template <class Tree>
+   void buildVine(Tree& bst, VineShape shape, int num)
+   {
+      assert(bst.root == nullptr);
+      typename Tree::BNode* pLast = nullptr;
+      int lo = 0;
+      int hi = num - 1;
+      for (int i = 0; i < num; i++)
+      {
+         bool goRight = (shape == VINE_RIGHT || (shape == VINE_ZIGZAG && i % 2 == 0));
+         auto pNode = new typename Tree::BNode(goRight ? lo++ : hi--);
+         if (pLast == nullptr)
+            bst.root = pNode;
+         else if (shape == VINE_RIGHT || (shape == VINE_ZIGZAG && i % 2 == 1))
+            pLast->addRight(pNode);
+         else
+            pLast->addLeft(pNode);
+         pLast = pNode;
+      }
+      bst.numElements = num;
+   }
+
+   /**************************************************************
+    * SAME TREE
+    * Do two trees have the same shape and data, and are the
+    * parent pointers right? Walks both without recursion
+    *************************************************************/
+   template <class Node>
+   bool sameTree(const Node* pLhs, const Node* pRhs)
+   {
+      std::vector<std::pair<const Node*, const Node*>> stack;
+      stack.push_back({ pLhs, pRhs });
+      while (!stack.empty())
+      {
+         auto top = stack.back();
+         stack.pop_back();
+         if ((top.first == nullptr) != (top.second == nullptr))
+            return false;
+         if (top.first == nullptr)
+            continue;
+         if (!(top.first->data == top.second->data))
+            return false;
+         if ((top.second->pLeft && top.second->pLeft->pParent != top.second) ||
+             (top.second->pRight && top.second->pRight->pParent != top.second))
+            return false;
+         stack.push_back({ top.first->pLeft, top.second->pLeft });
+         stack.push_back({ top.first->pRight, top.second->pRight });
+      }
+      return true;
+   }
+
    /**************************************************************
     * SETUP STANDARD FIXTURE
     *                (50) 
@@ -2513,6 +4518,8 @@ public:
 
       // now assign everything to the bst
       bst.root = p50;
+      bst.pLeftmost = p20;
+      bst.pRightmost = p80;
       bst.numElements = 7;
    }
 
@@ -2522,6 +4529,8 @@ public:
    void assertEmptyFixtureParameters(const custom::BST <Spy>& bst, int line, const char* function)
    {
       assertUnit(bst.root == nullptr);
+      assertUnit(bst.pLeftmost == nullptr);
+      assertUnit(bst.pRightmost == nullptr);
       assertUnit(bst.numElements == 0);
    }
 
@@ -2538,6 +4547,8 @@ public:
       // verify the member variables
       assertIndirect(bst.numElements == 7);
       assertIndirect(bst.root != nullptr);
+      assertIndirect(bst.pLeftmost != nullptr && bst.pLeftmost->data == Spy(20));
+      assertIndirect(bst.pRightmost != nullptr && bst.pRightmost->data == Spy(80));
 
       // verify the pointers down
       assertIndirect(bst.root != nullptr);
@@ -2626,6 +4637,7 @@ public:
       }
       bst.root = nullptr;
       bst.numElements = 0;
+      bst.pLeftmost = bst.pRightmost = nullptr;
    }
 
   
@@ -16,6 +16,7 @@
 #include "testPair.h"      // for the pair unit tests
 #include "testBST.h"       // for the BST unit tests
 #include "testMap.h"       // for the map unit tests
+#include "benchBST.h"      // for the BST benchmarks
 int Spy::counters[] = {};
 
 /**********************************************************************
@@ -31,6 +32,11 @@ int main()
    TestBST().run();
    TestMap().run();
 #endif // DEBUG
+
+#ifdef BENCHMARK
+   // benchmarks
+   BenchBST().run();
+#endif // BENCHMARK
    
    return 0;
 }
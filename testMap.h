@@ -11,11 +11,19 @@
 #ifdef DEBUG
 
 #include "map.h"        // class under test
+#include "spy.h"        // spy is a mock class to monitor the class under test
+#include "pool.h"       // pool is an allocator carving nodes from slabs
+#include "compact.h"    // compactMap links its nodes by index
+#include "lean.h"       // leanMap has no parent pointers
+#include "btree.h"      // map over a B+-tree
+#include "frozen.h"     // frozenMap is a read-only snapshot
 #include "unitTest.h"   // unit test baseclass
 
 
 #include <map>
 #include <vector>
+#include <algorithm>  // for std::is_sorted
+#include <random>     // for std::mt19937
 
 /***********************************************
  * TEST MAP
@@ -42,6 +50,8 @@ public:
       test_constructRange_empty();
       test_constructRange_one();
       test_constructRange_standard();
+      test_constructRange_duplicates();
+      test_constructRange_sortedLarge();
       test_destructor_empty();
       test_destructor_standard();
 
@@ -67,6 +77,7 @@ public:
       test_begin_empty();
       test_begin_standard();
       test_end_standard();
+      test_rbegin_standard();
       test_iterator_increment_standardToChild();
       test_iterator_increment_standardToParent();
       test_iterator_dereference_standardRead();
@@ -81,6 +92,7 @@ public:
       test_access_emptyWrite();
       test_access_standardFrontInsert();
       test_access_standardMiddleInsert();
+      test_access_standardPresent();
       test_at_standardRootRead();
       test_at_standardLeftRead();
       test_at_standardRightRead();
@@ -94,6 +106,21 @@ public:
       test_find_standardLeft();
       test_find_standardRight();
       test_find_standardMissing();
+      test_tryEmplace_missing();
+      test_tryEmplace_present();
+      test_find_bareKey();
+      test_find_heterogeneous();
+      test_find_transparent();
+      test_findBatch_random();
+      test_findBatch_empty();
+      test_emplace_standard();
+      test_bounds_standard();
+      test_equalRange_standard();
+      test_range_window();
+      test_compare_greater();
+      test_compare_stateful();
+      test_rank_sized();
+      test_select_sized();
 
       // Insert
       test_insertCopy_empty();
@@ -101,6 +128,9 @@ public:
       test_insertCopy_standardMiddle();
       test_insertMove_empty();
       test_insertMove_standard();
+      test_insertHint_standardEnd();
+      test_insertHint_standardDuplicate();
+      test_emplaceHint_empty();
 
       // Remove
       test_clear_empty();
@@ -113,6 +143,59 @@ public:
       test_erase_standardIteratorMissing();
       test_erase_emptyRange();
       test_erase_standardRange();
+      test_erase_window();
+
+      // Node handles
+      test_extract_changeKey();
+      test_merge_standard();
+
+      // Allocator
+      test_allocator_everyNode();
+      test_allocator_unequal();
+      test_allocator_poolClear();
+      test_allocator_poolMerge();
+
+      // Split and join
+      test_split_standard();
+      test_split_noDefault();
+      test_join_standard();
+
+      // Threaded nodes
+      test_threaded_scan();
+
+      // Compact nodes
+      test_compact_nodeSize();
+      test_compact_insertFind();
+      test_compact_erase();
+      test_compact_iterate();
+      test_compact_copyClear();
+
+      // Lean nodes
+      test_lean_nodeSize();
+      test_lean_insertErase();
+      test_lean_iterate();
+      test_lean_emplace();
+      test_lean_copyClear();
+
+      // B-tree
+      test_btree_nodeSize();
+      test_btree_insertErase();
+      test_btree_iterate();
+      test_btree_eraseRange();
+      test_btree_copyClear();
+      test_btree_throwingValue();
+
+      // Frozen
+      test_freeze_layout();
+      test_freeze_blockLayout();
+      test_freeze_blockLargest();
+      test_freeze_find();
+      test_freeze_bounds();
+      test_freeze_iterate();
+      test_freeze_copy();
+
+      // SIMD
+      test_simd_kernels();
 
       // Status
       test_empty_empty();
@@ -169,6 +252,7 @@ public:
       bnode50 = new custom::BST < custom::pair<std::string, int> > ::BNode(p50);
       mSrc.bst.root = bnode50;
       mSrc.bst.numElements = 1;
+      mSrc.bst.pLeftmost = mSrc.bst.pRightmost = bnode50;
       
       // exercise
       custom::map<std::string, int> mDes(mSrc);
@@ -262,6 +346,7 @@ public:
       bnode50 = new custom::BST < custom::pair<std::string, int> > ::BNode(p50);
       mSrc.bst.root = bnode50;
       mSrc.bst.numElements = 1;
+      mSrc.bst.pLeftmost = mSrc.bst.pRightmost = bnode50;
       
       // exercise
       custom::map<std::string, int> mDes(std::move(mSrc));
@@ -448,6 +533,46 @@ public:
       teardownStandardFixture(m);
    }
 
+   // construct from a range with repeated keys: the first one wins
+   void test_constructRange_duplicates()
+   {  // setup
+      //      { ("70",70)  ("30",30)  ("50",50)  ("30",99)  ("70",99) }
+      std::vector<custom::pair<std::string, int>> v;
+      v.push_back(custom::pair<std::string, int>(std::string("70"), int(70)));
+      v.push_back(custom::pair<std::string, int>(std::string("30"), int(30)));
+      v.push_back(custom::pair<std::string, int>(std::string("50"), int(50)));
+      v.push_back(custom::pair<std::string, int>(std::string("30"), int(99)));
+      v.push_back(custom::pair<std::string, int>(std::string("70"), int(99)));
+      // exercise
+      custom::map<std::string, int> m(v.begin(), v.end());
+      // verify
+      //    "30"     "50"     "70" 
+      //   +----+   +----+   +----+
+      //   | 30 | - | 50 | - | 70 |
+      //   +----+   +----+   +----+
+      assertStandardFixture(m);
+      // teardown
+      teardownStandardFixture(m);
+   }
+
+   // construct from a large sorted range
+   void test_constructRange_sortedLarge()
+   {  // setup
+      std::vector<custom::pair<int, int>> v;
+      for (int i = 0; i < 100000; i++)
+         v.push_back(custom::pair<int, int>(i, i * 2));
+      // exercise
+      custom::map<int, int> m(v.begin(), v.end());
+      // verify
+      assertUnit(m.size() == 100000);
+      assertUnit(m[0] == 0);
+      assertUnit(m[99999] == 199998);
+      assertUnit((*m.begin()).first == 0);
+      assertUnit((*(--m.end())).first == 99999);
+      // teardown
+      m.clear();
+   }
+
    /***************************************
     * DESTRUCTOR
     ***************************************/
@@ -1082,6 +1207,26 @@ public:
       teardownStandardFixture(m);
    }
 
+   // rbegin() to rend() from the standard fixture
+   void test_rbegin_standard()
+   {  // setup
+      //    "30"     "50"     "70"   = m
+      //   +----+   +----+   +----+
+      //   | 30 | - | 50 | - | 70 |
+      //   +----+   +----+   +----+
+      custom::map<std::string, int> m;
+      setupStandardFixture(m);
+      std::string keys;
+      // exercise
+      for (auto it = m.rbegin(); it != m.rend(); ++it)
+         keys += (*it).first;
+      // verify
+      assertUnit(keys == std::string("705030"));
+      assertStandardFixture(m);
+      // teardown
+      teardownStandardFixture(m);
+   }
+
    // iterator increment to the parent from the standard fixture
    void test_iterator_increment_standardToParent()
    {  // setup
@@ -1287,6 +1432,326 @@ public:
       teardownStandardFixture(m);
    }
 
+   // try_emplace a new key, building the value once inside the node
+   void test_tryEmplace_missing()
+   {  // setup
+      custom::map<int, Spy> m;
+      for (int i = 0; i < 10; i++)
+         m.try_emplace(i * 10, i);
+      Spy::reset();
+      // exercise
+      auto pairReturn = m.try_emplace(45, 99);
+      // verify
+      assertUnit(Spy::numNondefault() == 1);
+      assertUnit(Spy::numDefault() == 0);
+      assertUnit(Spy::numCopy() == 0);
+      assertUnit(Spy::numCopyMove() == 0);
+      assertUnit(Spy::numAssign() == 0);
+      assertUnit(Spy::numAssignMove() == 0);
+      assertUnit(pairReturn.second);
+      assertUnit((*pairReturn.first).first == 45);
+      assertUnit((*pairReturn.first).second.get() == 99);
+      assertUnit(m.size() == 11);
+   }  // teardown
+
+   // try_emplace a key that is there: the value is never built
+   void test_tryEmplace_present()
+   {  // setup
+      custom::map<int, Spy> m;
+      for (int i = 0; i < 10; i++)
+         m.try_emplace(i * 10, i);
+      Spy::reset();
+      // exercise
+      auto pairReturn = m.try_emplace(40, 99);
+      // verify
+      assertUnit(Spy::numNondefault() == 0);
+      assertUnit(Spy::numDefault() == 0);
+      assertUnit(Spy::numAlloc() == 0);
+      assertUnit(Spy::numCopy() == 0);
+      assertUnit(!pairReturn.second);
+      assertUnit((*pairReturn.first).second.get() == 4);
+      assertUnit(m.size() == 10);
+   }  // teardown
+
+   // find, at, lower_bound and erase by key never build a value
+   void test_find_bareKey()
+   {  // setup
+      custom::map<int, Spy> m;
+      for (int i = 0; i < 10; i++)
+         m.try_emplace(i * 10, i);
+      Spy::reset();
+      // exercise
+      auto itFind = m.find(40);
+      auto itMissing = m.find(45);
+      Spy & s = m.at(70);
+      auto itLower = m.lower_bound(25);
+      size_t numErased = m.erase(90);
+      // verify
+      assertUnit(Spy::numDefault() == 0);
+      assertUnit(Spy::numNondefault() == 0);
+      assertUnit(Spy::numAlloc() == 0);
+      assertUnit(Spy::numCopy() == 0);
+      assertUnit(Spy::numCopyMove() == 0);
+      assertUnit(Spy::numDelete() == 1);
+      assertUnit(itFind != m.end() && (*itFind).second.get() == 4);
+      assertUnit(itMissing == m.end());
+      assertUnit(s.get() == 7);
+      assertUnit(itLower != m.end() && (*itLower).first == 30);
+      assertUnit(numErased == 1);
+      assertUnit(m.size() == 9);
+   }  // teardown
+
+   // look up a string key with a string literal
+   void test_find_heterogeneous()
+   {  // setup
+      //    "30"     "50"     "70"   = m
+      //   +----+   +----+   +----+
+      //   | 30 | - | 50 | - | 70 |
+      //   +----+   +----+   +----+
+      custom::map<std::string, int> m;
+      setupStandardFixture(m);
+      // exercise
+      auto itFound = m.find("50");
+      auto itMissing = m.find("60");
+      auto itUpper = m.upper_bound("50");
+      // verify
+      assertUnit(itFound != m.end() && (*itFound).second == 50);
+      assertUnit(itMissing == m.end());
+      assertUnit(itUpper != m.end() && (*itUpper).first == std::string("70"));
+      // teardown
+      teardownStandardFixture(m);
+   }
+
+   // with std::less<> the literal is compared as is, never made a string
+   void test_find_transparent()
+   {  // setup
+      custom::map<std::string, int, custom::balance::redBlack, std::less<>> m;
+      for (const char* key : { "30", "50", "70" })
+         m[key] = std::stoi(key);
+      // exercise
+      auto itFound = m.find("50");
+      auto itMissing = m.find("60");
+      auto itLower = m.lower_bound("60");
+      // verify
+      assertUnit(itFound != m.end() && (*itFound).second == 50);
+      assertUnit(itMissing == m.end());
+      assertUnit(itLower != m.end() && (*itLower).first == std::string("70"));
+   }  // teardown
+
+   // a batch finds what a loop of find() finds, shuffled or sorted
+   void test_findBatch_random()
+   {  // setup
+      custom::map<int, int> m;
+      for (int i = 0; i < 10000; i++)
+         m[i * 2] = i;
+      std::vector<int> keys;
+      std::mt19937 random(2025);
+      for (int i = 0; i < 512; i++)
+         keys.push_back(int(random() % 20010) - 5);
+      std::vector<custom::map<int, int>::iterator> out(keys.size());
+      std::vector<int> keysSorted(keys);
+      std::sort(keysSorted.begin(), keysSorted.end());
+      std::vector<custom::map<int, int>::iterator> outSorted(keys.size());
+      // exercise
+      m.find_batch(keys, out);
+      m.find_batch(keysSorted, outSorted);
+      // verify
+      for (size_t i = 0; i < keys.size(); i++)
+      {
+         assertUnit(out[i] == m.find(keys[i]));
+         assertUnit(outSorted[i] == m.find(keysSorted[i]));
+      }
+      assertUnit(std::count(out.begin(), out.end(), m.end()) > 0);
+      assertUnit(std::count(out.begin(), out.end(), m.end()) < 512);
+   }  // teardown
+
+   // nothing is found in an empty map, and an empty batch finds nothing
+   void test_findBatch_empty()
+   {  // setup
+      custom::map<int, int> m;
+      custom::map<int, int> mEmpty;
+      m[3] = 30;
+      std::vector<int> keys = { 3, 1, 3 };
+      std::vector<int> keysNone;
+      std::vector<custom::map<int, int>::iterator> out(keys.size(), m.begin());
+      std::vector<custom::map<int, int>::iterator> outNone;
+      // exercise
+      mEmpty.find_batch(keys, out);
+      m.find_batch(keysNone, outNone);
+      // verify
+      for (auto it : out)
+         assertUnit(it == mEmpty.end());
+      assertUnit(outNone.empty());
+   }  // teardown
+
+   // emplace a pair from the arguments of its constructor
+   void test_emplace_standard()
+   {  // setup
+      //    "30"     "50"     "70"   = m
+      //   +----+   +----+   +----+
+      //   | 30 | - | 50 | - | 70 |
+      //   +----+   +----+   +----+
+      custom::map<std::string, int> m;
+      setupStandardFixture(m);
+      // exercise
+      auto pairNew = m.emplace(std::string("60"), 60);
+      auto pairOld = m.emplace(std::string("30"), 0);
+      // verify
+      assertUnit(pairNew.second);
+      assertUnit((*pairNew.first).second == 60);
+      assertUnit(!pairOld.second);
+      assertUnit((*pairOld.first).second == 30);
+      assertUnit(m.size() == 4);
+      // teardown
+      teardownStandardFixture(m);
+   }
+
+   // the bounds around keys that are and are not in the standard fixture
+   void test_bounds_standard()
+   {  // setup
+      //    "30"     "50"     "70"   = m
+      //   +----+   +----+   +----+
+      //   | 30 | - | 50 | - | 70 |
+      //   +----+   +----+   +----+
+      custom::map<std::string, int> m;
+      setupStandardFixture(m);
+      // exercise and verify
+      assertUnit((*m.lower_bound(std::string("50"))).first == "50");
+      assertUnit((*m.upper_bound(std::string("50"))).first == "70");
+      assertUnit((*m.lower_bound(std::string("40"))).first == "50");
+      assertUnit((*m.upper_bound(std::string("40"))).first == "50");
+      assertUnit(m.lower_bound(std::string("00")) == m.begin());
+      assertUnit(m.lower_bound(std::string("99")) == m.end());
+      assertUnit(m.upper_bound(std::string("70")) == m.end());
+      assertStandardFixture(m);
+      // teardown
+      teardownStandardFixture(m);
+   }
+
+   // the range of one key is that key, or nothing where it would go
+   void test_equalRange_standard()
+   {  // setup
+      //    "30"     "50"     "70"   = m
+      //   +----+   +----+   +----+
+      //   | 30 | - | 50 | - | 70 |
+      //   +----+   +----+   +----+
+      custom::map<std::string, int> m;
+      setupStandardFixture(m);
+      // exercise
+      auto range30 = m.equal_range(std::string("30"));
+      auto range60 = m.equal_range(std::string("60"));
+      // verify
+      assertUnit((*range30.first).first == "30");
+      assertUnit((*range30.second).first == "50");
+      assertUnit(range60.first == range60.second);
+      assertUnit((*range60.first).first == "70");
+      assertStandardFixture(m);
+      // teardown
+      teardownStandardFixture(m);
+   }
+
+   // walk a window of keys in place
+   void test_range_window()
+   {  // setup
+      custom::map<int, int> m;
+      for (int i = 0; i < 100; i++)
+         m[i * 10] = i;
+      // exercise
+      auto range = m.range(195, 250);
+      // verify
+      int expected = 200;
+      for (auto it = range.begin(); it != range.end(); ++it)
+      {
+         assertUnit((*it).first == expected);
+         expected += 10;
+      }
+      assertUnit(expected == 250);
+      assertUnit(m.range(300, 300).empty());
+      assertUnit(m.range(500, 100).empty());
+      assertUnit(m.range(2000, 3000).begin() == m.end());
+   }  // teardown
+
+   // a map ordered by std::greater walks from the largest key down
+   void test_compare_greater()
+   {  // setup
+      custom::map<int, int, custom::balance::redBlack, std::greater<int>> m;
+      for (int i = 0; i < 100; i++)
+         m.try_emplace(i * 10, i);
+      // exercise
+      auto range = m.range(250, 195);
+      // verify
+      int expected = 250;
+      for (auto it = range.begin(); it != range.end(); ++it)
+      {
+         assertUnit((*it).first == expected);
+         expected -= 10;
+      }
+      assertUnit(expected == 190);
+      assertUnit((*m.begin()).first == 990);
+      assertUnit(m.at(500) == 50);
+      assertUnit(m.find(505) == m.end());
+   }  // teardown
+
+   // the comparator of each map is its own, and copies keep it
+   void test_compare_stateful()
+   {  // setup
+      struct Direction
+      {
+         bool isReverse;
+         bool operator () (int lhs, int rhs) const { return isReverse ? rhs < lhs : lhs < rhs; }
+      };
+      custom::map<int, int, custom::balance::redBlack, Direction> mForward(Direction{ false });
+      custom::map<int, int, custom::balance::redBlack, Direction> mReverse(Direction{ true });
+      for (int i = 0; i < 10; i++)
+      {
+         mForward[i] = i;
+         mReverse[i] = i;
+      }
+      // exercise
+      auto mCopy(mReverse);
+      mCopy[10] = 10;
+      // verify
+      assertUnit((*mForward.begin()).first == 0);
+      assertUnit((*mReverse.begin()).first == 9);
+      assertUnit((*mCopy.begin()).first == 10);
+      assertUnit(mCopy.size() == 11);
+      assertUnit(mCopy.key_comp().isReverse);
+   }  // teardown
+
+   // rank and count by key in a map that keeps subtree sizes
+   void test_rank_sized()
+   {  // setup
+      custom::map<int, int, custom::balance::sized<>> m;
+      for (int i = 0; i < 100; i++)
+         m[i * 10] = i;
+      // exercise and verify
+      assertUnit(m.rank(0) == 0);
+      assertUnit(m.rank(255) == 26);
+      assertUnit(m.rank(1000) == 100);
+      assertUnit(m.count(100, 200) == 10);
+   }  // teardown
+
+   // the median of a map, and iterators that jump
+   void test_select_sized()
+   {  // setup
+      custom::map<int, int, custom::balance::sized<>> m;
+      for (int i = 0; i < 101; i++)
+         m[i * 10] = i;
+      custom::map<int, int, custom::balance::sized<>>::iterator it;
+      // exercise
+      it = m.select(m.size() / 2);
+      // verify
+      assertUnit((*it).first == 500);
+      // exercise
+      it += 25;
+      // verify
+      assertUnit((*it).second == 75);
+      // exercise
+      it -= 75;
+      // verify
+      assertUnit(it == m.begin());
+   }  // teardown
+
    /***************************************
     * INSERT
     *    map::insert(const T &)
@@ -1556,6 +2021,70 @@ public:
       teardownStandardFixture(m);
    }
 
+   // insert after the last element with end() as the hint
+   void test_insertHint_standardEnd()
+   {  // setup
+      //    "30"     "50"     "70"   = m
+      //   +----+   +----+   +----+
+      //   | 30 | - | 50 | - | 70 |
+      //   +----+   +----+   +----+
+      custom::map<std::string, int> m;
+      setupStandardFixture(m);
+      custom::map<std::string, int>::iterator it;
+      // exercise
+      it = m.insert(m.end(), custom::pair<std::string, int>(std::string("80"), int(80)));
+      // verify
+      //    "30"     "50"     "70"     "80"   = m
+      //   +----+   +----+   +----+   +----+
+      //   | 30 | - | 50 | - | 70 | - | 80 |
+      //   +----+   +----+   +----+   +----+
+      //                                it
+      assertUnit(it != m.end());
+      assertUnit((*it).first == std::string("80"));
+      assertUnit(m.bst.numElements == 4);
+      if (m.bst.root && m.bst.root->pRight)
+         assertUnit(it.it.pNode->pParent == m.bst.root->pRight);
+      assertUnit(m.bst.pRightmost == it.it.pNode);
+      // teardown
+      m.clear();
+   }
+
+   // a hint next to an existing key returns that key
+   void test_insertHint_standardDuplicate()
+   {  // setup
+      //    "30"     "50"     "70"   = m
+      //   +----+   +----+   +----+
+      //   | 30 | - | 50 | - | 70 |
+      //   +----+   +----+   +----+
+      custom::map<std::string, int> m;
+      setupStandardFixture(m);
+      custom::map<std::string, int>::iterator it;
+      // exercise
+      it = m.insert(m.find(std::string("50")), custom::pair<std::string, int>(std::string("50"), int(99)));
+      // verify
+      assertUnit(it.it.pNode == m.bst.root);
+      assertUnit((*it).second == 50);
+      assertStandardFixture(m);
+      // teardown
+      teardownStandardFixture(m);
+   }
+
+   // emplace into an empty map with a hint
+   void test_emplaceHint_empty()
+   {  // setup
+      custom::map<std::string, int> m;
+      custom::map<std::string, int>::iterator it;
+      // exercise
+      it = m.emplace_hint(m.end(), std::string("50"), int(50));
+      it = m.emplace_hint(it, std::string("60"), int(60));
+      // verify
+      assertUnit(m.size() == 2);
+      assertUnit((*it).first == std::string("60"));
+      assertUnit((*m.begin()).first == std::string("50"));
+      // teardown
+      m.clear();
+   }
+
 
    /***************************************
     * SQUARE BRACKET
@@ -1876,6 +2405,23 @@ public:
       teardownStandardFixture(m);
    }
 
+   // reach a value that is there: no value is built to look for it
+   void test_access_standardPresent()
+   {  // setup
+      custom::map<int, Spy> m;
+      for (int i = 0; i < 10; i++)
+         m.try_emplace(i * 10, i);
+      Spy::reset();
+      // exercise
+      Spy & s = m[40];
+      // verify
+      assertUnit(Spy::numDefault() == 0);
+      assertUnit(Spy::numNondefault() == 0);
+      assertUnit(Spy::numAlloc() == 0);
+      assertUnit(s.get() == 4);
+      assertUnit(m.size() == 10);
+   }  // teardown
+
 
    /***************************************
     * AT
@@ -2329,6 +2875,1129 @@ public:
       // teardown
       teardownStandardFixture(m);
    }
+
+   // erase a window of keys out of a large map
+   void test_erase_window()
+   {  // setup
+      custom::map<int, int> m;
+      for (int i = 0; i < 10000; i++)
+         m[(i * 7919) % 10000] = i;
+      // exercise
+      auto itReturn = m.erase(m.lower_bound(1000), m.lower_bound(9000));
+      // verify
+      assertUnit((*itReturn).first == 9000);
+      assertUnit(m.size() == 2000);
+      assertUnit(m.find(999) != m.end());
+      assertUnit(m.find(1000) == m.end());
+      assertUnit(m.find(8999) == m.end());
+      int numInOrder = 0;
+      int previous = -1;
+      for (auto it = m.begin(); it != m.end(); ++it, numInOrder++)
+      {
+         assertUnit((*it).first > previous);
+         previous = (*it).first;
+      }
+      assertUnit(numInOrder == 2000);
+   }  // teardown
+
+   /***************************************
+    * NODE HANDLES
+    *    map::extract(k)
+    *    map::insert(node_type&&)
+    *    map::merge(rhs)
+    ***************************************/
+
+   // take an element out, give it a new key, and put it back
+   void test_extract_changeKey()
+   {  // setup
+      //    "30"     "50"     "70"   = m
+      //   +----+   +----+   +----+
+      //   | 30 | - | 50 | - | 70 |
+      //   +----+   +----+   +----+
+      custom::map<std::string, int> m;
+      setupStandardFixture(m);
+      // exercise
+      auto nh = m.extract(std::string("50"));
+      auto pNode = nh.pNode;
+      nh.key() = "60";
+      nh.mapped() = 60;
+      auto result = m.insert(std::move(nh));
+      // verify
+      assertUnit(result.inserted);
+      assertUnit(result.position.it.pNode == pNode);
+      assertUnit(result.node.empty());
+      assertUnit(m.size() == 3);
+      assertUnit(m.find(std::string("50")) == m.end());
+      assertUnit(m.at(std::string("60")) == 60);
+      // exercise
+      auto nh30 = m.extract(m.begin());
+      auto nhMissing = m.extract(std::string("99"));
+      // verify
+      assertUnit(nh30.key() == "30");
+      assertUnit(nhMissing.empty());
+      assertUnit(m.size() == 2);
+      // teardown
+      teardownStandardFixture(m);
+   }
+
+   // merge maps that share some keys, which keep their old values
+   void test_merge_standard()
+   {  // setup
+      custom::map<int, int> m;
+      custom::map<int, int> mOther;
+      for (int i = 0; i < 10; i++)
+      {
+         m[i] = i;
+         mOther[i + 5] = -1;
+      }
+      // exercise
+      m.merge(mOther);
+      // verify
+      assertUnit(m.size() == 15);
+      assertUnit(mOther.size() == 5);
+      assertUnit(m.at(7) == 7);
+      assertUnit(m.at(14) == -1);
+      assertUnit((*mOther.begin()).first == 5);
+      assertUnit((*(--mOther.end())).first == 9);
+   }  // teardown
+
+   /***************************************
+    * ALLOCATOR
+    *    map<K, V, Balance, Compare, Allocator>
+    ***************************************/
+
+   // every node of a map comes from its allocator and goes back to it,
+   // and a node handle moves between maps that share one
+   void test_allocator_everyNode()
+   {  // setup
+      using Map = custom::map<int, Spy, custom::balance::redBlack, std::less<int>,
+                              SpyAllocator<custom::pair<int, Spy>>>;
+      SpyLedger ledger;
+      {
+         Map m{ SpyAllocator<custom::pair<int, Spy>>(&ledger) };
+         Map mOther(std::less<int>(), m.get_allocator());
+         // exercise
+         for (int i = 0; i < 10; i++)
+            m.try_emplace(i, i);
+         m[10] = Spy(10);
+         m.erase(3);
+         mOther.insert(m.extract(4));
+         auto pieces = m.split(7);
+         // verify
+         assertUnit(ledger.numAllocate == 11);
+         assertUnit(ledger.numDeallocate == 1);
+         assertUnit(mOther.size() == 1);
+         assertUnit(pieces.first.size() == 5 && pieces.second.size() == 4);
+         assertUnit(pieces.second.get_allocator() == m.get_allocator());
+      }
+      assertUnit(ledger.numDeallocate == 11);
+      assertUnit(ledger.numBytes == 0);
+   }  // teardown
+
+   // merge and join between maps whose allocators are not equal move the
+   // elements into nodes from the allocator of the map they end up in
+   void test_allocator_unequal()
+   {  // setup
+      using Alloc = SpyAllocator<custom::pair<int, int>>;
+      using Map = custom::map<int, int, custom::balance::redBlack, std::less<int>, Alloc>;
+      SpyLedger ledgerA;
+      SpyLedger ledgerB;
+      SpyLedger ledgerC;
+      {
+         Map mA{ Alloc(&ledgerA) };
+         Map mB{ Alloc(&ledgerB) };
+         Map mC{ Alloc(&ledgerC) };
+         for (int i = 0; i < 10; i++)
+         {
+            mA[i] = i;
+            mB[i + 5] = i + 5;
+            mC[i + 20] = i + 20;
+         }
+         // exercise
+         mA.merge(mB);
+         Map mJoin = Map::join(mA, mC);
+         // verify
+         assertUnit(mB.size() == 5);
+         assertUnit((*mB.begin()).first == 5);
+         assertUnit(mA.empty() && mC.empty());
+         assertUnit(mJoin.size() == 25);
+         assertUnit(mJoin.get_allocator() == Alloc(&ledgerA));
+         assertUnit(ledgerA.numAllocate == 25);
+         assertUnit(ledgerB.numDeallocate == 5);
+         assertUnit(ledgerC.numDeallocate == 10);
+         int expected = 0;
+         for (auto it = mJoin.begin(); it != mJoin.end(); ++it, expected += (expected == 14 ? 6 : 1))
+            assertUnit((*it).first == expected && (*it).second == expected);
+         assertUnit(expected == 30);
+      }
+      assertUnit(ledgerA.numBytes == 0);
+      assertUnit(ledgerB.numBytes == 0);
+      assertUnit(ledgerC.numBytes == 0);
+   }  // teardown
+
+   // a pooled map of values with destructors still destroys each one on
+   // clear, and the slabs stay for the next insert
+   void test_allocator_poolClear()
+   {  // setup
+      using Map = custom::map<int, Spy, custom::balance::redBlack, std::less<int>,
+                              custom::pool<custom::pair<int, Spy>>>;
+      Map m;
+      for (int i = 0; i < 100; i++)
+         m.try_emplace(i, i);
+      size_t numSlabs = m.get_allocator().numSlabs();
+      Spy::reset();
+      // exercise
+      m.clear();
+      // verify
+      assertUnit(Spy::numDestructor() == 100);
+      assertUnit(m.empty());
+      assertUnit(m.get_allocator().numSlabs() == numSlabs);
+      m.try_emplace(5, 5);
+      assertUnit(m.size() == 1);
+      assertUnit(m.get_allocator().numSlabs() == numSlabs);
+   }  // teardown
+
+   // two maps built apart have pools of their own, so what one merges or
+   // joins from the other outlives the pool it came from
+   void test_allocator_poolMerge()
+   {  // setup
+      using Map = custom::map<int, int, custom::balance::redBlack, std::less<int>,
+                              custom::pool<custom::pair<int, int>>>;
+      Map mA;
+      Map mJoin;
+      for (int i = 0; i < 100; i++)
+         mA[i * 2] = i;
+      assertUnit(mA.get_allocator() != Map().get_allocator());
+      // exercise
+      {
+         Map mB;
+         Map mC;
+         for (int i = 0; i < 100; i++)
+         {
+            mB[i * 2 + 1] = i;
+            mC[i + 200] = i;
+         }
+         mA.merge(mB);
+         mJoin = Map::join(mA, mC);
+         assertUnit(mB.empty() && mC.empty());
+      }
+      // verify
+      assertUnit(mJoin.size() == 300);
+      int expected = 0;
+      for (auto it = mJoin.begin(); it != mJoin.end(); ++it, expected++)
+         assertUnit((*it).first == expected);
+      assertUnit(expected == 300);
+      mJoin.erase(150);
+      mJoin[1000] = 1000;
+      assertUnit(mJoin.size() == 300);
+   }  // teardown
+
+   /***************************************
+    * SPLIT and JOIN
+    *    map::split(k)
+    *    map::join(lhs, rhs)
+    ***************************************/
+
+   // split the standard fixture at "50"
+   void test_split_standard()
+   {  // setup
+      //    "30"     "50"     "70"   = m
+      //   +----+   +----+   +----+
+      //   | 30 | - | 50 | - | 70 |
+      //   +----+   +----+   +----+
+      custom::map<std::string, int> m;
+      setupStandardFixture(m);
+      // exercise
+      auto pieces = m.split(std::string("50"));
+      // verify
+      //    "30"           "50"     "70"
+      //   +----+         +----+   +----+
+      //   | 30 |         | 50 | - | 70 |
+      //   +----+         +----+   +----+
+      assertEmptyFixture(m);
+      assertUnit(pieces.first.size() == 1);
+      assertUnit(pieces.second.size() == 2);
+      assertUnit((*pieces.first.begin()).first == std::string("30"));
+      assertUnit((*pieces.second.begin()).first == std::string("50"));
+      assertUnit(pieces.second.find(std::string("70")) != pieces.second.end());
+   }  // teardown
+
+   // split a map whose values cannot be default constructed
+   void test_split_noDefault()
+   {  // setup
+      struct Value
+      {
+         explicit Value(int i) : i(i) {}
+         int i;
+      };
+      custom::map<int, Value> m;
+      for (int i = 0; i < 10; i++)
+         m.try_emplace(i, i);
+      // exercise
+      auto pieces = m.split(4);
+      // verify
+      assertUnit(m.empty());
+      assertUnit(pieces.first.size() == 4);
+      assertUnit(pieces.second.size() == 6);
+      assertUnit((*pieces.second.begin()).first == 4);
+      assertUnit((*pieces.second.begin()).second.i == 4);
+   }  // teardown
+
+   // join two maps whose keys do not overlap
+   void test_join_standard()
+   {  // setup
+      custom::map<int, int> mLeft;
+      custom::map<int, int> mRight;
+      for (int i = 0; i < 100; i++)
+      {
+         mLeft[i] = i;
+         mRight[i + 100] = i + 100;
+      }
+      // exercise
+      custom::map<int, int> m = custom::map<int, int>::join(mLeft, mRight);
+      // verify
+      assertUnit(mLeft.empty());
+      assertUnit(mRight.empty());
+      assertUnit(m.size() == 200);
+      assertUnit(m.at(150) == 150);
+      assertUnit((*m.begin()).first == 0);
+      assertUnit((*(--m.end())).first == 199);
+   }  // teardown
+
+   // scan a map whose nodes are threaded, after erasing from it
+   void test_threaded_scan()
+   {  // setup
+      custom::map<int, int, custom::balance::threaded<>> m;
+      for (int i = 0; i < 100; i++)
+         m[(i * 37) % 100] = i;
+      // exercise
+      for (int i = 0; i < 100; i += 3)
+         m.erase(i);
+      // verify
+      int expected = 1;
+      for (auto it = m.begin(); it != m.end(); ++it)
+      {
+         assertUnit((*it).first == expected);
+         expected += (expected % 3 == 1 ? 1 : 2);
+      }
+      assertUnit(expected == 100);
+      assertUnit((*(--m.end())).first == 98);
+   }  // teardown
+
+   /***************************************
+    * COMPACT NODES
+    *    compactMap<K, V>
+    ***************************************/
+
+   // a node linked by indices is half the size of one linked by pointers
+   void test_compact_nodeSize()
+   {  // setup
+      using Compact = custom::compactMap<int, int>;
+      using BNode = custom::BST<custom::pair<int, int>>::BNode;
+      // exercise
+      // verify
+      assertUnit(sizeof(Compact::Node) == 20);
+      assertUnit(sizeof(Compact::Node) * 2 <= sizeof(BNode));
+   }  // teardown
+
+   // every way in lands the element in order in a red-black tree
+   void test_compact_insertFind()
+   {  // setup
+      custom::compactMap<int, int> m;
+      // exercise
+      for (int i = 0; i < 1000; i++)
+      {
+         int key = (i * 7919) % 1000;
+         switch (i % 4)
+         {
+         case 0: m[key] = key;                                   break;
+         case 1: m.insert(custom::pair<int, int>(key, key));     break;
+         case 2: m.emplace(key, key);                            break;
+         case 3: m.try_emplace(key, key);                        break;
+         }
+      }
+      auto pairReturn = m.try_emplace(500, 99);
+      // verify
+      assertUnit(!pairReturn.second);
+      assertUnit((*pairReturn.first).second == 500);
+      assertUnit(m.size() == 1000);
+      assertUnit(isCompactRedBlack(m));
+      int expected = 0;
+      for (auto it = m.begin(); it != m.end(); ++it, expected++)
+         assertUnit(it->first == expected && it->second == expected);
+      assertUnit(expected == 1000);
+      assertUnit(m.find(999) != m.end() && m.find(999)->second == 999);
+      assertUnit(m.find(1000) == m.end());
+      assertUnit(m.find(-1) == m.end());
+      assertUnit(m.at(42) == 42);
+      try
+      {
+         m.at(1000);
+         assertUnit(false);
+      }
+      catch (const std::out_of_range&)
+      {
+      }
+   }  // teardown
+
+   // erase keeps the tree red-black, and the nodes it frees are used again
+   void test_compact_erase()
+   {  // setup
+      custom::compactMap<int, int> m;
+      for (int i = 0; i < 1000; i++)
+         m[(i * 7919) % 1000] = i;
+      size_t numSlots = m.numSlots;
+      // exercise
+      for (int i = 0; i < 1000; i += 2)
+         assertUnit(m.erase((i * 601) % 1000) == 1);
+      assertUnit(m.erase(-1) == 0);
+      auto it = m.erase(m.find(501));
+      // verify
+      assertUnit(it != m.end() && it->first == 503);
+      assertUnit(m.size() == 499);
+      assertUnit(isCompactRedBlack(m));
+      for (int i = 0; i < 501; i++)
+         m[i * 2] = i;
+      assertUnit(m.numSlots == numSlots);
+      assertUnit(m.size() == 1000);
+      assertUnit(m.find(501) == m.end());
+      assertUnit(isCompactRedBlack(m));
+      it = m.erase(m.begin(), m.find(100));
+      assertUnit(it->first == 100);
+      assertUnit(m.begin()->first == 100);
+      assertUnit(isCompactRedBlack(m));
+   }  // teardown
+
+   // walk both ways, search by bounds, and keep an iterator as the array grows
+   void test_compact_iterate()
+   {  // setup
+      custom::compactMap<int, int> m;
+      m[10] = 1;
+      auto itTen = m.find(10);
+      // exercise
+      for (int i = 0; i < 100; i++)
+         m[i * 20] = i;
+      // verify
+      assertUnit(m.capacity() >= 100);
+      assertUnit(itTen->first == 10 && itTen->second == 1);
+      std::vector<int> keys;
+      for (auto it = m.rbegin(); it != m.rend(); ++it)
+         keys.push_back(it->first);
+      std::vector<int> expected;
+      for (int i = 99; i > 0; i--)
+         expected.push_back(i * 20);
+      expected.push_back(10);
+      expected.push_back(0);
+      assertUnit(keys == expected);
+      assertUnit((*(--m.end())).first == 1980);
+      assertUnit(m.lower_bound(15)->first == 20);
+      assertUnit(m.lower_bound(20)->first == 20);
+      assertUnit(m.upper_bound(20)->first == 40);
+      assertUnit(m.upper_bound(1980) == m.end());
+      auto range = m.equal_range(40);
+      assertUnit(range.first->first == 40 && range.second->first == 60);
+   }  // teardown
+
+   // a copy has the same shape, and clear destroys every value
+   void test_compact_copyClear()
+   {  // setup
+      custom::compactMap<int, Spy> m;
+      for (int i = 0; i < 100; i++)
+         m.try_emplace(i, i);
+      m.erase(50);
+      Spy::reset();
+      // exercise
+      custom::compactMap<int, Spy> mCopy(m);
+      custom::compactMap<int, Spy> mMove(std::move(m));
+      // verify
+      assertUnit(Spy::numCopy() == 99);
+      assertUnit(Spy::numLessthan() == 0);
+      assertUnit(m.empty());
+      assertUnit(mCopy.size() == 99);
+      assertUnit(mCopy.root == mMove.root);
+      assertUnit(isCompactRedBlack(mCopy));
+      Spy::reset();
+      mCopy.clear();
+      assertUnit(Spy::numDestructor() == 99);
+      assertUnit(mCopy.empty());
+      assertUnit(mCopy.begin() == mCopy.end());
+      mCopy[3] = Spy(3);
+      assertUnit(mCopy.size() == 1);
+      assertUnit(mMove.find(50) == mMove.end());
+      assertUnit(mMove.find(51)->second.get() == 51);
+   }  // teardown
+   /***************************************
+    * LEAN NODES
+    *    leanMap<K, V>
+    ***************************************/
+
+   // a node without a parent pointer is a pointer smaller
+   void test_lean_nodeSize()
+   {  // setup
+      using Lean = custom::leanMap<int, int>;
+      using BNode = custom::BST<custom::pair<int, int>>::BNode;
+      // exercise
+      // verify
+      assertUnit(sizeof(Lean::Node) == 32);
+      assertUnit(sizeof(Lean::Node) + sizeof(void*) == sizeof(BNode));
+   }  // teardown
+
+   // rebalancing along the path keeps the tree red-black both ways
+   void test_lean_insertErase()
+   {  // setup
+      custom::leanMap<int, int> m;
+      // exercise
+      for (int i = 0; i < 1000; i++)
+      {
+         int key = (i * 7919) % 1000;
+         switch (i % 3)
+         {
+         case 0: m[key] = key;                                   break;
+         case 1: m.insert(custom::pair<int, int>(key, key));     break;
+         case 2: m.emplace(key, key);                            break;
+         }
+      }
+      assertUnit(m.size() == 1000);
+      assertUnit(isLeanRedBlack(m));
+      for (int i = 0; i < 1000; i += 2)
+         assertUnit(m.erase((i * 601) % 1000) == 1);
+      auto it = m.erase(m.find(501));
+      // verify
+      assertUnit(m.erase(-1) == 0);
+      assertUnit(it != m.end() && it->first == 503);
+      assertUnit(m.size() == 499);
+      assertUnit(isLeanRedBlack(m));
+      int expected = 1;
+      for (auto it = m.begin(); it != m.end(); ++it, expected += (expected == 499 ? 4 : 2))
+         assertUnit(it->first == expected && it->second == expected);
+      assertUnit(expected == 1001);
+      assertUnit(m.at(999) == 999);
+      assertUnit(m.find(500) == m.end());
+      it = m.erase(m.begin(), m.find(101));
+      assertUnit(it->first == 101);
+      assertUnit(m.begin()->first == 101);
+      assertUnit(m.size() == 449);
+      assertUnit(isLeanRedBlack(m));
+   }  // teardown
+
+   // walk both ways from a search, and from end()
+   void test_lean_iterate()
+   {  // setup
+      custom::leanMap<int, int> m;
+      for (int i = 0; i < 100; i++)
+         m[i * 10] = i;
+      // exercise
+      auto it = m.lower_bound(455);
+      auto itBack = it;
+      --itBack;
+      // verify
+      assertUnit(it->first == 460);
+      assertUnit(itBack->first == 450);
+      assertUnit(m.upper_bound(460)->first == 470);
+      assertUnit(m.upper_bound(990) == m.end());
+      assertUnit((*(--m.end())).first == 990);
+      std::vector<int> keys;
+      for (auto itR = m.rbegin(); itR != m.rend(); ++itR)
+         keys.push_back(itR->first);
+      assertUnit(keys.size() == 100);
+      assertUnit(keys.front() == 990 && keys.back() == 0);
+      assertUnit(std::is_sorted(keys.rbegin(), keys.rend()));
+   }  // teardown
+
+   // the other ways in that map has: with a hint, and moving the key in
+   void test_lean_emplace()
+   {  // setup
+      custom::leanMap<std::string, int> m;
+      m.try_emplace(std::string("30"), 30);
+      std::string key("50");
+      // exercise
+      auto itHint = m.emplace_hint(m.begin(), std::string("70"), 70);
+      auto pairTry = m.try_emplace(std::move(key), 50);
+      auto pairTaken = m.try_emplace(std::string("50"), 0);
+      // verify
+      assertUnit(itHint->first == std::string("70"));
+      assertUnit(pairTry.second && pairTry.first->first == std::string("50"));
+      assertUnit(!pairTaken.second && pairTaken.first->second == 50);
+      assertUnit(m.size() == 3);
+      assertUnit(isLeanRedBlack(m));
+   }  // teardown
+
+   // a copy has the same shape, and clear destroys every value
+   void test_lean_copyClear()
+   {  // setup
+      custom::leanMap<int, Spy> m;
+      for (int i = 0; i < 100; i++)
+         m.try_emplace(i, i);
+      Spy::reset();
+      // exercise
+      custom::leanMap<int, Spy> mCopy(m);
+      custom::leanMap<int, Spy> mMove(std::move(m));
+      // verify
+      assertUnit(Spy::numCopy() == 100);
+      assertUnit(Spy::numLessthan() == 0);
+      assertUnit(m.empty());
+      assertUnit(isLeanRedBlack(mCopy));
+      Spy::reset();
+      mCopy.clear();
+      assertUnit(Spy::numDestructor() == 100);
+      assertUnit(mCopy.begin() == mCopy.end());
+      assertUnit(mMove.size() == 100);
+      assertUnit(mMove.find(51)->second.get() == 51);
+   }  // teardown
+
+   /***************************************
+    * B-TREE
+    *    map<K, V, balance::btree<nodeBytes>>
+    ***************************************/
+
+   // the nodes fill the bytes asked for
+   void test_btree_nodeSize()
+   {  // setup
+      using Tree = custom::BTree<int, int, std::less<int>, std::allocator<custom::pair<int, int>>, 256>;
+      using Small = custom::BTree<int, int, std::less<int>, std::allocator<custom::pair<int, int>>, 64>;
+      // exercise
+      // verify
+      assertUnit(sizeof(Tree::Leaf) == 256);
+      assertUnit(sizeof(Tree::Inner) == 256);
+      assertUnit(Tree::leafMax == 29);
+      assertUnit(Tree::innerMax == 20);
+      assertUnit(Small::leafMax == 5);
+      assertUnit(Small::innerMax == 4);
+   }  // teardown
+
+   // small nodes split and merge many levels deep
+   void test_btree_insertErase()
+   {  // setup
+      custom::map<int, int, custom::balance::btree<64>> m;
+      // exercise
+      for (int i = 0; i < 1000; i++)
+      {
+         int key = (i * 7919) % 1000;
+         switch (i % 3)
+         {
+         case 0: m[key] = key;                                   break;
+         case 1: m.insert(custom::pair<int, int>(key, key));     break;
+         case 2: m.emplace(key, key);                            break;
+         }
+      }
+      assertUnit(m.size() == 1000);
+      assertUnit(isBTree(m.tree));
+      assertUnit(!m.insert(custom::pair<int, int>(7, 0)).second);
+      for (int i = 0; i < 1000; i += 2)
+         assertUnit(m.erase((i * 601) % 1000) == 1);
+      auto it = m.erase(m.find(501));
+      // verify
+      assertUnit(m.erase(-1) == 0);
+      assertUnit(it != m.end() && it->first == 503);
+      assertUnit(m.size() == 499);
+      assertUnit(isBTree(m.tree));
+      int expected = 1;
+      for (auto it = m.begin(); it != m.end(); ++it, expected += (expected == 499 ? 4 : 2))
+         assertUnit(it->first == expected && it->second == expected);
+      assertUnit(expected == 1001);
+      assertUnit(m.at(999) == 999);
+      assertUnit(m.find(500) == m.end());
+   }  // teardown
+
+   // walk both ways from a search, and from end()
+   void test_btree_iterate()
+   {  // setup
+      custom::map<int, int, custom::balance::btree<64>> m;
+      for (int i = 0; i < 100; i++)
+         m[i * 10] = i;
+      // exercise
+      auto it = m.lower_bound(455);
+      auto itBack = it;
+      --itBack;
+      // verify
+      assertUnit(it->first == 460);
+      assertUnit(itBack->first == 450);
+      assertUnit(m.lower_bound(460)->first == 460);
+      assertUnit(m.upper_bound(460)->first == 470);
+      assertUnit(m.upper_bound(990) == m.end());
+      assertUnit(m.lower_bound(-5) == m.begin());
+      assertUnit((*(--m.end())).first == 990);
+      std::vector<int> keys;
+      for (auto itR = m.rbegin(); itR != m.rend(); ++itR)
+         keys.push_back(itR->first);
+      assertUnit(keys.size() == 100);
+      assertUnit(keys.front() == 990 && keys.back() == 0);
+      assertUnit(std::is_sorted(keys.rbegin(), keys.rend()));
+   }  // teardown
+
+   // erasing a run stops at the key last was on, and matches std::map
+   void test_btree_eraseRange()
+   {  // setup
+      custom::map<int, int, custom::balance::btree<64>> m;
+      std::map<int, int> mStd;
+      for (int i = 0; i < 5000; i++)
+      {
+         int key = (i * 2654435761u) % 3000;
+         if (i % 4 == 3)
+            assertUnit(m.erase(key) == mStd.erase(key));
+         else
+            assertUnit(m.try_emplace(key, i).second == mStd.try_emplace(key, i).second);
+      }
+      assertUnit(isBTree(m.tree));
+      // exercise
+      auto it = m.erase(m.lower_bound(1000), m.lower_bound(2000));
+      mStd.erase(mStd.lower_bound(1000), mStd.lower_bound(2000));
+      // verify
+      assertUnit(it == m.lower_bound(2000));
+      assertUnit(isBTree(m.tree));
+      assertUnit(m.size() == mStd.size());
+      assertUnit(std::equal(m.begin(), m.end(), mStd.begin(),
+         [](const custom::pair<int, int>& lhs, const std::pair<const int, int>& rhs)
+         { return lhs.first == rhs.first && lhs.second == rhs.second; }));
+      assertUnit(m.erase(m.begin(), m.end()) == m.end());
+      assertUnit(m.empty());
+      assertUnit(m.tree.root == nullptr);
+   }  // teardown
+
+   // a copy has the same shape, and clear destroys every value
+   void test_btree_copyClear()
+   {  // setup
+      custom::map<int, Spy, custom::balance::btree<64>> m;
+      for (int i = 0; i < 100; i++)
+         m.try_emplace(i, i);
+      Spy::reset();
+      // exercise
+      custom::map<int, Spy, custom::balance::btree<64>> mCopy(m);
+      custom::map<int, Spy, custom::balance::btree<64>> mMove(std::move(m));
+      // verify
+      assertUnit(Spy::numCopy() == 100);
+      assertUnit(Spy::numLessthan() == 0);
+      assertUnit(m.empty());
+      assertUnit(isBTree(mCopy.tree));
+      Spy::reset();
+      mCopy.clear();
+      assertUnit(Spy::numDestructor() == 100);
+      assertUnit(mCopy.begin() == mCopy.end());
+      assertUnit(mMove.size() == 100);
+      assertUnit(mMove.find(51)->second.get() == 51);
+      assertUnit((--mMove.end())->second.get() == 99);
+   }  // teardown
+
+   // a value that cannot be built leaves the tree as it was, even the
+   // first one, whose leaf is made for it
+   void test_btree_throwingValue()
+   {  // setup
+      struct Value
+      {
+         explicit Value(int i) : i(i)
+         {
+            if (i < 0)
+               throw "Error: no negative values";
+         }
+         int i;
+      };
+      custom::map<int, Value, custom::balance::btree<64>> m;
+      // exercise
+      bool isThrownEmpty = false;
+      try
+      {
+         m.try_emplace(1, -1);
+      }
+      catch (const char*)
+      {
+         isThrownEmpty = true;
+      }
+      bool isStillEmpty = m.empty() && m.begin() == m.end();
+      for (int i = 0; i < 20; i++)
+         m.try_emplace(i * 2, i * 2);
+      bool isThrownFull = false;
+      try
+      {
+         m.try_emplace(7, -7);
+      }
+      catch (const char*)
+      {
+         isThrownFull = true;
+      }
+      // verify
+      assertUnit(isThrownEmpty && isThrownFull);
+      assertUnit(isStillEmpty);
+      assertUnit(m.size() == 20);
+      assertUnit(isBTree(m.tree));
+      int expected = 0;
+      for (auto it = m.begin(); it != m.end(); ++it, expected += 2)
+         assertUnit(it->first == expected && it->second.i == expected);
+      assertUnit(expected == 40);
+      assertUnit(m.find(7) == m.end());
+   }  // teardown
+
+   /***************************************
+    * FREEZE
+    *    frozenMap<K, V, Compare> map::freeze() const
+    ***************************************/
+
+   // the root is the median and each level follows breadth first, for
+   // keys the line kernels do not take
+   void test_freeze_layout()
+   {  // setup
+      custom::map<short, int> m;
+      for (short i = 1; i <= 7; i++)
+         m[i] = i * 10;
+      // exercise
+      custom::frozenMap<short, int> frozen = m.freeze();
+      // verify
+      assertUnit(frozen.size() == 7);
+      short expected[] = { 0, 4, 2, 6, 1, 3, 5, 7 };
+      for (int i = 1; i <= 7; i++)
+      {
+         assertUnit(frozen.keys[i] == expected[i]);
+         assertUnit(frozen.values[i] == expected[i] * 10);
+      }
+      assertUnit(reinterpret_cast<uintptr_t>(frozen.keys) % 64 == 0);
+      assertUnit(m.size() == 7);
+      custom::map<short, int, custom::balance::btree<64>> mTree(m.begin(), m.end());
+      custom::frozenMap<short, int> frozenTree = mTree.freeze();
+      assertUnit(std::equal(frozen.keys + 1, frozen.keys + 8, frozenTree.keys + 1));
+   }  // teardown
+
+   // int keys are sorted in lines, the last filled out with the largest
+   // int, under a line of the first key of each
+   void test_freeze_blockLayout()
+   {  // setup
+      custom::map<int32_t, int> m;
+      for (int i = 0; i < 40; i++)
+         m[i * 10] = i;
+      // exercise
+      custom::frozenMap<int32_t, int> frozen = m.freeze();
+      // verify
+      assertUnit(frozen.numLevels == 2);
+      assertUnit(frozen.levelSizes[0] == 40 && frozen.levelSizes[1] == 3);
+      assertUnit(reinterpret_cast<uintptr_t>(frozen.keys) % 64 == 0);
+      for (int i = 0; i < 48; i++)
+         assertUnit(frozen.keys[i] == (i < 40 ? i * 10 : INT32_MAX));
+      for (int i = 0; i < 40; i++)
+         assertUnit(frozen.values[i] == i);
+      assertUnit(frozen.levels[1] == frozen.keys + 48);
+      assertUnit(frozen.levels[1][0] == 0 && frozen.levels[1][1] == 160 && frozen.levels[1][2] == 320);
+      assertUnit(frozen.levels[1][3] == INT32_MAX && frozen.levels[1][15] == INT32_MAX);
+   }  // teardown
+
+   // the largest key there is can still be found among the fill
+   void test_freeze_blockLargest()
+   {  // setup
+      custom::map<int64_t, int> m;
+      for (int i = 0; i < 100; i++)
+         m[INT64_MAX - 99 + i] = i;
+      // exercise
+      custom::frozenMap<int64_t, int> frozen = m.freeze();
+      // verify
+      assertUnit(frozen.numLevels == 3);
+      assertUnit(frozen.find(INT64_MAX) != frozen.end());
+      assertUnit(frozen.find(INT64_MAX)->second == 99);
+      assertUnit(frozen.lower_bound(INT64_MAX)->second == 99);
+      assertUnit(frozen.upper_bound(INT64_MAX) == frozen.end());
+      assertUnit(frozen.upper_bound(INT64_MAX - 1)->second == 99);
+      assertUnit(frozen.lower_bound(INT64_MIN)->second == 0);
+      assertUnit(frozen.find(INT64_MIN) == frozen.end());
+   }  // teardown
+
+   // every key is found, every gap is not
+   void test_freeze_find()
+   {  // setup
+      custom::map<int, int> m;
+      for (int i = 0; i < 1000; i++)
+         m[i * 2] = i;
+      custom::frozenMap<int, int> frozen = m.freeze();
+      // exercise
+      // verify
+      for (int i = 0; i < 1000; i++)
+      {
+         auto it = frozen.find(i * 2);
+         assertUnit(it != frozen.end());
+         assertUnit(it->first == i * 2 && it->second == i);
+         assertUnit(frozen.find(i * 2 + 1) == frozen.end());
+      }
+      assertUnit(frozen.find(-1) == frozen.end());
+      assertUnit(frozen.at(1998) == 999);
+      try
+      {
+         frozen.at(3);
+         assertUnit(false);
+      }
+      catch (const std::out_of_range&)
+      {
+      }
+   }  // teardown
+
+   // lower_bound and upper_bound agree with the map for trees that are
+   // full, one short of full and one past full, and for one to three
+   // levels of lines
+   void test_freeze_bounds()
+   {  // setup
+      // exercise
+      // verify
+      assertFreezeBounds<short>();     // Eytzinger
+      assertFreezeBounds<int32_t>();   // lines of sixteen
+      assertFreezeBounds<int64_t>();   // lines of eight
+   }  // teardown
+
+   // the snapshot walks in key order both ways
+   void test_freeze_iterate()
+   {  // setup
+      custom::map<int, int> m;
+      for (int i = 0; i < 100; i++)
+         m[(i * 37) % 100] = i;
+      custom::frozenMap<int, int> frozen = m.freeze();
+      // exercise
+      std::vector<int> keys;
+      for (auto it = frozen.begin(); it != frozen.end(); ++it)
+         keys.push_back((*it).first);
+      std::vector<int> keysBack;
+      for (auto it = frozen.rbegin(); it != frozen.rend(); ++it)
+         keysBack.push_back(it->first);
+      // verify
+      assertUnit(keys.size() == 100);
+      assertUnit(std::is_sorted(keys.begin(), keys.end()));
+      assertUnit(keys.front() == 0 && keys.back() == 99);
+      assertUnit(std::equal(keys.rbegin(), keys.rend(), keysBack.begin(), keysBack.end()));
+      assertUnit((--frozen.end())->first == 99);
+      assertUnit((--frozen.lower_bound(50))->first == 49);
+      custom::map<short, int> mShort;
+      for (short i = 0; i < 100; i++)
+         mShort[short((i * 37) % 100)] = i;
+      custom::frozenMap<short, int> frozenShort = mShort.freeze();
+      assertUnit(std::equal(frozenShort.begin(), frozenShort.end(), frozen.begin(), frozen.end(),
+         [](const std::pair<const short&, const int&>& lhs, const std::pair<const int&, const int&>& rhs)
+         { return lhs.first == rhs.first && lhs.second == rhs.second; }));
+      assertUnit((--frozenShort.end())->first == 99);
+   }  // teardown
+
+   // freezing copies each value once and compares nothing, and an
+   // empty map freezes to an empty snapshot
+   void test_freeze_copy()
+   {  // setup
+      custom::map<int, Spy> m;
+      for (int i = 0; i < 100; i++)
+         m.try_emplace(i, i);
+      custom::map<int, Spy> mEmpty;
+      Spy::reset();
+      // exercise
+      custom::frozenMap<int, Spy> frozen = m.freeze();
+      custom::frozenMap<int, Spy> frozenCopy(frozen);
+      custom::frozenMap<int, Spy> frozenEmpty = mEmpty.freeze();
+      // verify
+      assertUnit(Spy::numCopy() == 200);
+      assertUnit(Spy::numLessthan() == 0);
+      assertUnit(frozenCopy.size() == 100);
+      assertUnit(frozenCopy.find(51)->second.get() == 51);
+      assertUnit(m.size() == 100);
+      assertUnit(frozenEmpty.empty());
+      assertUnit(frozenEmpty.begin() == frozenEmpty.end());
+      assertUnit(frozenEmpty.find(3) == frozenEmpty.end());
+   }  // teardown
+
+   /***************************************
+    * SIMD
+    *    simd::Kernels<T> simd::kernels(Level)
+    ***************************************/
+
+   // every level this CPU runs counts the same as the scalar loop
+   void test_simd_kernels()
+   {  // setup
+      std::mt19937 random(2024);
+      int32_t line32[16];
+      int64_t line64[8];
+      int32_t probes32[] = { INT32_MIN, -1, 0, 1, 5, INT32_MAX };
+      int64_t probes64[] = { INT64_MIN, -1, 0, 1, 5, INT64_MAX };
+      auto scalar32 = custom::simd::kernels<int32_t>(custom::simd::scalar);
+      auto scalar64 = custom::simd::kernels<int64_t>(custom::simd::scalar);
+      // exercise
+      for (int level = custom::simd::scalar; level <= custom::simd::detect(); level++)
+      {
+         auto kernels32 = custom::simd::kernels<int32_t>(custom::simd::Level(level));
+         auto kernels64 = custom::simd::kernels<int64_t>(custom::simd::Level(level));
+         for (int trial = 0; trial < 100; trial++)
+         {
+            for (int i = 0; i < 16; i++)
+               line32[i] = int32_t(random() % 11) - 5 + (trial % 7 == 0 ? INT32_MAX - 5 : 0);
+            for (int i = 0; i < 8; i++)
+               line64[i] = int64_t(random() % 11) - 5 + (trial % 7 == 0 ? INT64_MIN + 5 : 0);
+            // verify
+            for (int32_t k : probes32)
+            {
+               assertUnit(kernels32.countLess(line32, k) == scalar32.countLess(line32, k));
+               assertUnit(kernels32.countLessEqual(line32, k) == scalar32.countLessEqual(line32, k));
+            }
+            for (int64_t k : probes64)
+            {
+               assertUnit(kernels64.countLess(line64, k) == scalar64.countLess(line64, k));
+               assertUnit(kernels64.countLessEqual(line64, k) == scalar64.countLessEqual(line64, k));
+            }
+         }
+      }
+      assertUnit(scalar32.countLess(line32, INT32_MIN) == 0);
+      assertUnit(scalar64.countLessEqual(line64, INT64_MAX) == 8);
+   }  // teardown
+
+   /****************************************************************
+    * ASSERT FREEZE BOUNDS
+    * The bounds of a snapshot of 0 to 300 keys match the map's
+    ****************************************************************/
+   template <class K>
+   void assertFreezeBounds()
+   {
+      for (int num = 0; num <= 300; num++)
+      {
+         custom::map<K, int> m;
+         for (int i = 0; i < num; i++)
+            m[K(i * 10)] = i;
+         custom::frozenMap<K, int> frozen = m.freeze();
+         for (int key = -5; key <= num * 10 + 5; key += 5)
+         {
+            auto itLower = frozen.lower_bound(K(key));
+            auto itUpper = frozen.upper_bound(K(key));
+            auto itMapLower = m.lower_bound(K(key));
+            auto itMapUpper = m.upper_bound(K(key));
+            assertUnit((itLower == frozen.end()) == (itMapLower == m.end()));
+            assertUnit((itUpper == frozen.end()) == (itMapUpper == m.end()));
+            if (itLower != frozen.end() && itMapLower != m.end())
+               assertUnit(itLower->first == (*itMapLower).first);
+            if (itUpper != frozen.end() && itMapUpper != m.end())
+               assertUnit(itUpper->first == (*itMapUpper).first);
+         }
+      }
+   }
+
+   /****************************************************************
+    * IS B TREE
+    * Every leaf at one depth, every node but the root at least half
+    * full, every key between the keys around its child, and the chain
+    * of leaves the same as the leaves in order
+    ****************************************************************/
+   template <class Tree>
+   bool isBTree(const Tree& tree)
+   {
+      if (tree.root == nullptr)
+         return tree.numElements == 0 && tree.pFirst == nullptr && tree.pLast == nullptr;
+      std::vector<const typename Tree::Leaf*> leaves;
+      int depthLeaf = -1;
+      using K = decltype(Tree::Pairs::first);
+      if (!isBTreeNode<Tree, K>(tree, tree.root, 0, depthLeaf, nullptr, nullptr, leaves))
+         return false;
+
+      size_t num = 0;
+      const typename Tree::Leaf* pPrev = nullptr;
+      const typename Tree::Leaf* pLeaf = tree.pFirst;
+      for (size_t i = 0; i < leaves.size(); i++, pPrev = pLeaf, pLeaf = pLeaf->pNext)
+      {
+         if (pLeaf != leaves[i] || pLeaf->pPrev != pPrev)
+            return false;
+         num += pLeaf->num;
+      }
+      return pLeaf == nullptr && pPrev == tree.pLast && num == tree.numElements;
+   }
+
+   template <class Tree, class K>
+   bool isBTreeNode(const Tree& tree, const typename Tree::Node* pNode, int depth, int& depthLeaf,
+                    const K* pLow, const K* pHigh, std::vector<const typename Tree::Leaf*>& leaves)
+   {
+      if (pNode != tree.root && pNode->num < (pNode->isLeaf ? Tree::leafMin : Tree::innerMin))
+         return false;
+
+      if (pNode->isLeaf)
+      {
+         auto pLeaf = static_cast<const typename Tree::Leaf*>(pNode);
+         if (depthLeaf != -1 && depthLeaf != depth)
+            return false;
+         depthLeaf = depth;
+         leaves.push_back(pLeaf);
+         for (size_t i = 0; i < pLeaf->num; i++)
+         {
+            const K& key = pLeaf->slots()[i].first;
+            if ((i > 0 && !(pLeaf->slots()[i - 1].first < key)) ||
+                (pLow && key < *pLow) || (pHigh && !(key < *pHigh)))
+               return false;
+         }
+         return true;
+      }
+
+      auto pInner = static_cast<const typename Tree::Inner*>(pNode);
+      const K* keys = pInner->keys();
+      for (size_t i = 0; i <= pInner->num; i++)
+      {
+         if (i > 0 && i < pInner->num && !(keys[i - 1] < keys[i]))
+            return false;
+         if (!isBTreeNode(tree, pInner->children[i], depth + 1, depthLeaf,
+                          i > 0 ? keys + i - 1 : pLow, i < pInner->num ? keys + i : pHigh, leaves))
+            return false;
+      }
+      return true;
+   }
+
+   /****************************************************************
+    * IS LEAN RED BLACK
+    * In order, no red node with a red child, and the same number of
+    * black nodes down every path
+    ****************************************************************/
+   template <class K, class V>
+   bool isLeanRedBlack(const custom::leanMap<K, V>& m)
+   {
+      if (m.root == nullptr)
+         return m.numElements == 0;
+      size_t num = 0;
+      return !m.root->isRed && leanBlackHeight<K, V>(m.root, num) > 0 && num == m.numElements;
+   }
+
+   template <class K, class V>
+   int leanBlackHeight(const typename custom::leanMap<K, V>::Node* p, size_t& num)
+   {
+      if (p == nullptr)
+         return 1;
+      num++;
+      if (p->pLeft && !(p->pLeft->data.first < p->data.first))
+         return -1;
+      if (p->pRight && !(p->data.first < p->pRight->data.first))
+         return -1;
+      if (p->isRed && ((p->pLeft && p->pLeft->isRed) || (p->pRight && p->pRight->isRed)))
+         return -1;
+      int heightLeft = leanBlackHeight<K, V>(p->pLeft, num);
+      int heightRight = leanBlackHeight<K, V>(p->pRight, num);
+      if (heightLeft < 0 || heightLeft != heightRight)
+         return -1;
+      return heightLeft + (p->isRed ? 0 : 1);
+   }
+
+   /****************************************************************
+    * IS COMPACT RED BLACK
+    * In order, linked both ways, no red node with a red child, and the
+    * same number of black nodes down every path
+    ****************************************************************/
+   template <class K, class V>
+   bool isCompactRedBlack(const custom::compactMap<K, V>& m)
+   {
+      if (m.root == m.nil)
+         return m.numElements == 0;
+      size_t num = 0;
+      return !m.isRed(m.root) && m.parent(m.root) == m.nil &&
+             compactBlackHeight(m, m.root, num) > 0 && num == m.numElements;
+   }
+
+   template <class K, class V>
+   int compactBlackHeight(const custom::compactMap<K, V>& m, uint32_t i, size_t& num)
+   {
+      if (i == m.nil)
+         return 1;
+      num++;
+      uint32_t iLeft = m.nodes[i].left;
+      uint32_t iRight = m.nodes[i].right;
+      if (iLeft != m.nil && (m.parent(iLeft) != i || !(m.nodes[iLeft].data().first < m.nodes[i].data().first)))
+         return -1;
+      if (iRight != m.nil && (m.parent(iRight) != i || !(m.nodes[i].data().first < m.nodes[iRight].data().first)))
+         return -1;
+      if (m.isRed(i) && (m.isRed(iLeft) || m.isRed(iRight)))
+         return -1;
+      int heightLeft = compactBlackHeight(m, iLeft, num);
+      int heightRight = compactBlackHeight(m, iRight, num);
+      if (heightLeft < 0 || heightLeft != heightRight)
+         return -1;
+      return heightLeft + (m.isRed(i) ? 0 : 1);
+   }
+
    /****************************************************************
     * Setup Standard Fixture
     *    "30"     "50"     "70"
@@ -2365,6 +4034,8 @@ public:
 
       // place the nodes in the bst
       m.bst.root = bnode50;
+      m.bst.pLeftmost = bnode30;
+      m.bst.pRightmost = bnode70;
       m.bst.numElements = 3;
    }
 
@@ -2377,6 +4048,8 @@ public:
       assertIndirect(m.bst.size() == 0);
       assertIndirect(m.bst.empty() == true);
       assertIndirect(m.bst.numElements == 0);
+      assertIndirect(m.bst.pLeftmost == nullptr);
+      assertIndirect(m.bst.pRightmost == nullptr);
    }
 
    /****************************************************************
@@ -2467,6 +4140,7 @@ public:
       }
       m.bst.root = nullptr;
       m.bst.numElements = 0;
+      m.bst.pLeftmost = m.bst.pRightmost = nullptr;
    }
 
    void teardownStandardFixture(custom::map<std::string, int>& m)
@@ -2497,6 +4171,7 @@ public:
       }
       m.bst.root = nullptr;
       m.bst.numElements = 0;
+      m.bst.pLeftmost = m.bst.pRightmost = nullptr;
    }
 };
 
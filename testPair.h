@@ -30,6 +30,7 @@ public:
       test_create_default();
       test_create_nondefault();
       test_create_nondefaultMove();
+      test_create_inPlace();
       
       // Make Pair
       test_makePair_default();
@@ -67,6 +68,7 @@ public:
       test_equivalence_same();
       test_equivalence_firstSmaller();
       test_equivalence_firstLarger();
+      test_equivalence_comparatorType();
       
       // Swap
       test_swap_defaultToDefault();
@@ -154,6 +156,21 @@ public:
       // Spy()
       assertUnit(s.empty());
    }  // teardown
+
+   // build the second straight from its constructor arguments
+   void test_create_inPlace()
+   {  // setup
+      Spy::reset();
+      // exercise
+      custom::pair <int, Spy> p(std::in_place, 100, 99);
+      // verify
+      assertUnit(Spy::numAlloc() == 1);      // p.second
+      assertUnit(Spy::numNondefault() == 1); // 99 -> p.second
+      assertUnit(Spy::numCopy() == 0);       // nothing copied
+      assertUnit(Spy::numCopyMove() == 0);   // nothing moved
+      assertUnit(p.first == 100);
+      assertUnit(p.second.get() == 99);
+   }  // teardown
    
    /***************************************
     * MAKE PAIR
@@ -629,6 +646,20 @@ public:
       assertStandardFixture(pLeft);
       assertEmptyFixture(pRight);
    }  // teardown
+
+   // the comparator is only a type: it orders the pair but takes no room
+   void test_equivalence_comparatorType()
+   {  // setup
+      custom::pair <int, int, std::greater<int>> pLeft(99, 100);
+      custom::pair <int, int, std::greater<int>> pRight(0, 0);
+      // exercise
+      bool lessthan    = (pLeft < pRight);
+      bool greaterthan = (pLeft > pRight);
+      // verify
+      assertUnit(lessthan    == true);
+      assertUnit(greaterthan == false);
+      assertUnit(sizeof(custom::pair <int, int>) == 2 * sizeof(int));
+   }  // teardown
    
 
    /***************************************
@@ -68,6 +68,13 @@ public:
       test_lessthan_same();
       test_lessthan_firstSmaller();
       test_lessthan_firstLarger();
+
+      // Three-Way Compare
+      test_compare_emptyToEmpty();
+      test_compare_emptyToFull();
+      test_compare_same();
+      test_compare_firstSmaller();
+      test_compare_firstLarger();
   
       report("Spy");
    }
@@ -733,8 +740,92 @@ public:
          delete sDes.p;
       sDes.p = sSrc.p = nullptr;
    }
-};
 
-#endif // DEBUG
+   /***************************************
+    * THREE-WAY COMPARE
+    * Order two things with one comparison
+    *     Spy::compare(const Spy &)
+    ***************************************/
+
+   // empty <=> empty
+   void test_compare_emptyToEmpty()
+   {  // setup
+      Spy sSrc;
+      Spy sDes;
+      Spy::reset();
+      // exercise
+      int value = sSrc.compare(sDes);
+      // verify
+      assertUnit(value == 0);
+      assertUnit(Spy::numLessthan() == 1);   // sSrc <=> sDes
+      assertUnit(Spy::numEquals() == 0);     // no separate equality check
+      assertUnit(Spy::numAlloc() == 0);      // nothing allocated
+      assertUnit(Spy::numDelete() == 0);     // nothing deleted
+   }  // teardown
+
+   // empty <=> 99
+   void test_compare_emptyToFull()
+   {  // setup
+      Spy sSrc;
+      Spy sDes(99);
+      Spy::reset();
+      // exercise
+      int value = sSrc.compare(sDes);
+      // verify
+      assertUnit(value < 0);
+      assertUnit(Spy::numLessthan() == 1);   // sSrc <=> sDes
+      assertUnit(Spy::numEquals() == 0);     // no separate equality check
+      assertUnit(Spy::numAlloc() == 0);      // nothing allocated
+      assertUnit(Spy::numDelete() == 0);     // nothing deleted
+   }  // teardown
+
+   // 99 <=> 99
+   void test_compare_same()
+   {  // setup
+      Spy sSrc(99);
+      Spy sDes(99);
+      Spy::reset();
+      // exercise
+      int value = sSrc.compare(sDes);
+      // verify
+      assertUnit(value == 0);
+      assertUnit(Spy::numLessthan() == 1);   // sSrc <=> sDes
+      assertUnit(Spy::numEquals() == 0);     // no separate equality check
+      assertUnit(Spy::numAlloc() == 0);      // nothing allocated
+      assertUnit(Spy::numDelete() == 0);     // nothing deleted
+   }  // teardown
+
+   // 9 <=> 99
+   void test_compare_firstSmaller()
+   {  // setup
+      Spy sSrc(9);
+      Spy sDes(99);
+      Spy::reset();
+      // exercise
+      int value = sSrc.compare(sDes);
+      // verify
+      assertUnit(value < 0);
+      assertUnit(Spy::numLessthan() == 1);   // sSrc <=> sDes
+      assertUnit(Spy::numEquals() == 0);     // no separate equality check
+      assertUnit(Spy::numAlloc() == 0);      // nothing allocated
+      assertUnit(Spy::numDelete() == 0);     // nothing deleted
+   }  // teardown
 
+   // 99 <=> 9
+   void test_compare_firstLarger()
+   {  // setup
+      Spy sSrc(99);
+      Spy sDes(9);
+      Spy::reset();
+      // exercise
+      int value = sSrc.compare(sDes);
+      // verify
+      assertUnit(value > 0);
+      assertUnit(Spy::numLessthan() == 1);   // sSrc <=> sDes
+      assertUnit(Spy::numEquals() == 0);     // no separate equality check
+      assertUnit(Spy::numAlloc() == 0);      // nothing allocated
+      assertUnit(Spy::numDelete() == 0);     // nothing deleted
+   }  // teardown
+};
 
+#endif // DEBUG